@@ -2,6 +2,7 @@
 using Birdie.Interop;
 using Birdie.Network;
 using Birdie.Process;
+using Birdie.Utility;
 using Birdie.Watcher;
 using Microsoft.CSharp;
 using System;
@@ -10,6 +11,7 @@ using System.Collections.Generic;
 using System.Diagnostics;
 using System.Linq;
 using System.Net;
+using System.Net.Sockets;
 using System.Reflection;
 using System.Text;
 using System.Threading.Tasks;
@@ -35,9 +37,43 @@ namespace Birdie
             public const int AddCategory = 4;
             public const int AddLogMessage = 5;
             public const int AddCustomTypeHandler = 6;
+            public const int Batch = 7;
+            public const int AddWatches = 8;
+            public const int RemoveWatchObjects = 9;
+            public const int PublishWatches = 10;
+            public const int UseSharedMemory = 11;
+            public const int AddLogFormat = 12;
+            public const int AddDeferredLogMessage = 13;
+            public const int AddString = 14;
+            public const int UseCompression = 15;
+            public const int Compressed = 16;
+            public const int AddZones = 17;
+            public const int AddSampleWindows = 18;
+            public const int SampleRing = 19;
+            public const int AddImageWatch = 20;
+            public const int ImageTiles = 21;
+            public const int AddArrayWatch = 22;
+            public const int Fragment = 23;
+        }
+
+        // Operations we send to the client, each one is an operation type (4b) followed by a value (4b)
+        public static class ToolOperationTypes
+        {
+            public const int SharedMemoryAnswer = 1;
+            public const int SetLogLevel = 2;
+            public const int CompressionAnswer = 3;
+            public const int FetchSamples = 4;
         }
         #endregion
 
+        #region Constants
+        // Set on string fields that carry an interned string id instead of a length
+        private const UInt32 StringIdFlag = 0x80000000;
+
+        // Compression methods a client can offer, we only take LZ4 blocks
+        private const UInt32 CompressionMethodLz4 = 1;
+        #endregion
+
         #region Events
         public event IBirdieContextDelegates.ProcessDelegate ProcessConnect;
         public event IBirdieContextDelegates.ProcessDelegate ProcessDisconnect;
@@ -45,7 +81,13 @@ namespace Birdie
         public event IBirdieContextDelegates.WatchMemoryObjectDelegate WatchMemoryObjectRemove;
         public event IBirdieContextDelegates.WatchCategoryObjectDelegate WatchCategoryObjectAdd;
         public event IBirdieContextDelegates.WatchCategoryObjectDelegate WatchCategoryObjectRemove;
+        public event IBirdieContextDelegates.WatchImageObjectDelegate WatchImageObjectAdd;
+        public event IBirdieContextDelegates.WatchImageObjectDelegate WatchImageObjectRemove;
+        public event IBirdieContextDelegates.WatchImageObjectDelegate WatchImageObjectUpdate;
         public event IBirdieContextDelegates.LogMessageDelegate LogMessageAdd;
+        public event IBirdieContextDelegates.ZoneSamplesDelegate ZoneSamplesAdd;
+        public event IBirdieContextDelegates.SampleWindowsDelegate SampleWindowsAdd;
+        public event IBirdieContextDelegates.SampleRingDelegate SampleRingReceive;
         #endregion
 
         #region Methods
@@ -91,6 +133,29 @@ namespace Birdie
             // Set the termination flag to prevent re-use
             hasTerminated = true;
         }
+
+        public bool SetLogLevel(ProcessData processData, LogLevels threshold)
+        {
+            if (processData == null || processData.ClientContext == null)
+                return false;
+
+            ClientContext clientContext = processData.ClientContext;
+
+            // Shares the socket with the shared memory answer
+            lock (clientContext)
+                return SendToolOperation(clientContext, ToolOperationTypes.SetLogLevel, (UInt32)threshold);
+        }
+
+        public bool FetchSamples(WatchMemoryObject watchMemoryObject)
+        {
+            if (watchMemoryObject == null || watchMemoryObject.ProcessData == null || watchMemoryObject.ProcessData.ClientContext == null)
+                return false;
+
+            ClientContext clientContext = watchMemoryObject.ProcessData.ClientContext;
+
+            lock (clientContext)
+                return SendToolOperation(clientContext, ToolOperationTypes.FetchSamples, watchMemoryObject.Handle);
+        }
         #endregion
 
         #region Callbacks
@@ -101,6 +166,9 @@ namespace Birdie
 
         private void ClientDisconnect(ClientContext clientContext)
         {
+            if (clientContext.SharedMemoryChannel != null)
+                clientContext.SharedMemoryChannel.Close();
+
             lock (AttachedProcesses)
             {
                 if (AttachedProcesses.Contains(clientContext.ProcessData))
@@ -113,55 +181,225 @@ namespace Birdie
 
         private void DataReceived(ClientContext clientContext)
         {
-            // Lock, to be safe
+            ChunkReceived(clientContext, clientContext.Data);
+        }
+
+        private void ChunkReceived(ClientContext clientContext, byte[] data)
+        {
+            // Lock, to be safe. Chunks can come from the socket and the shared memory reader.
             lock (clientContext)
             {
-                switch (BitConverter.ToUInt32(clientContext.Data, 0))
-                {
-                    case DataTypes.RegisterProcess:
-                        RegisterProcess(clientContext);
-                        break;
+                HandleOperation(clientContext, data, 0);
+            }
+        }
 
-                    case DataTypes.AddWatch:
-                        AddWatch(clientContext);
-                        break;
+        private void HandleOperation(ClientContext clientContext, byte[] data, int offset)
+        {
+            UInt32 operationType = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
 
-                    case DataTypes.RemoveWatchObject:
-                        RemoveWatchBaseObject(clientContext);
-                        break;
+            switch (operationType)
+            {
+                case DataTypes.RegisterProcess:
+                    RegisterProcess(clientContext, data, offset);
+                    break;
 
-                    case DataTypes.AddCategory:
-                        AddCategory(clientContext);
-                        break;
+                case DataTypes.AddWatch:
+                    AddWatch(clientContext, data, offset);
+                    break;
 
-                    case DataTypes.AddLogMessage:
-                        AddLogMessage(clientContext);
-                        break;
+                case DataTypes.RemoveWatchObject:
+                    RemoveWatchBaseObject(clientContext, data, offset);
+                    break;
 
-                    case DataTypes.AddCustomTypeHandler:
-                        AddCustomTypeHandler(clientContext);
-                        break;
-                }
+                case DataTypes.AddCategory:
+                    AddCategory(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddLogMessage:
+                    AddLogMessage(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddCustomTypeHandler:
+                    AddCustomTypeHandler(clientContext, data, offset);
+                    break;
+
+                case DataTypes.Batch:
+                    HandleBatch(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddWatches:
+                    AddWatches(clientContext, data, offset);
+                    break;
+
+                case DataTypes.RemoveWatchObjects:
+                    RemoveWatchBaseObjects(clientContext, data, offset);
+                    break;
+
+                case DataTypes.PublishWatches:
+                    PublishWatches(clientContext, data, offset);
+                    break;
+
+                case DataTypes.UseSharedMemory:
+                    UseSharedMemory(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddLogFormat:
+                    AddLogFormat(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddDeferredLogMessage:
+                    AddDeferredLogMessage(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddString:
+                    AddString(clientContext, data, offset);
+                    break;
+
+                case DataTypes.UseCompression:
+                    UseCompression(clientContext, data, offset);
+                    break;
+
+                case DataTypes.Compressed:
+                    HandleCompressed(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddZones:
+                    AddZones(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddSampleWindows:
+                    AddSampleWindows(clientContext, data, offset);
+                    break;
+
+                case DataTypes.SampleRing:
+                    HandleSampleRing(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddImageWatch:
+                    AddImageWatch(clientContext, data, offset);
+                    break;
+
+                case DataTypes.ImageTiles:
+                    HandleImageTiles(clientContext, data, offset);
+                    break;
+
+                case DataTypes.AddArrayWatch:
+                    AddArrayWatch(clientContext, data, offset);
+                    break;
+
+                case DataTypes.Fragment:
+                    HandleFragment(clientContext, data, offset);
+                    break;
             }
         }
 
-        private void RegisterProcess(ClientContext clientContext)
+        private void HandleBatch(ClientContext clientContext, byte[] data, int offset)
         {
-            // Starting offset in 'data'
-            int offset = sizeof(UInt32);
+            // Layout of the Batch data chunk:
+            // - Operation count (4b)
+            // - For every operation: Length (4b), Operation data chunk (*b)
+            UInt32 operationCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
 
-            // Remote processes are not supported by the memory watcher,
-            // they can use the logging system however
-            if (clientContext.IsRemote)
+            for (UInt32 i = 0; i < operationCount; i++)
+            {
+                int operationLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+
+                HandleOperation(clientContext, data, offset);
+                offset += operationLength;
+            }
+        }
+
+        private void HandleCompressed(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the Compressed data chunk:
+            // - Uncompressed size (4b)
+            // - Compressed size (4b)
+            // - LZ4 block (*b), which holds complete chunks: Chunk size (4b), Operation data chunk (*b)
+            int uncompressedSize = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            int compressedSize = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+
+            byte[] uncompressedData = new byte[uncompressedSize];
+
+            if (!Lz4.Decompress(data, offset, compressedSize, uncompressedData))
             {
-                // Silent return, it's not an error
+                // Everything after this would be out of step
+                clientContext.Disconnect();
                 return;
             }
 
+            int chunkOffset = 0;
+
+            while (chunkOffset < uncompressedSize)
+            {
+                int chunkSize = BitConverter.ToInt32(uncompressedData, chunkOffset); chunkOffset += sizeof(Int32);
+
+                HandleOperation(clientContext, uncompressedData, chunkOffset);
+                chunkOffset += chunkSize;
+            }
+        }
+
+        private void HandleFragment(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the Fragment data chunk:
+            // - Stream Id (4b), shared by the fragments of one operation
+            // - Operation size (4b)
+            // - Fragment size (4b), then the next part of the operation (*b)
+            // Fragments of different streams may be mixed, those of a single stream always arrive in order.
+            UInt32 streamId = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            int operationSize = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            int fragmentSize = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+
+            FragmentStream fragmentStream;
+
+            if (!clientContext.FragmentStreams.TryGetValue(streamId, out fragmentStream))
+            {
+                fragmentStream = new FragmentStream()
+                {
+                    Data = new byte[operationSize]
+                };
+
+                clientContext.FragmentStreams.Add(streamId, fragmentStream);
+            }
+
+            if (fragmentStream.ReceivedBytes + fragmentSize > fragmentStream.Data.Length)
+            {
+                // Everything after this would be out of step
+                clientContext.Disconnect();
+                return;
+            }
+
+            Buffer.BlockCopy(data, offset, fragmentStream.Data, fragmentStream.ReceivedBytes, fragmentSize);
+            fragmentStream.ReceivedBytes += fragmentSize;
+
+            if (fragmentStream.ReceivedBytes < fragmentStream.Data.Length)
+                return;
+
+            clientContext.FragmentStreams.Remove(streamId);
+
+            HandleOperation(clientContext, fragmentStream.Data, 0);
+        }
+
+        private void RegisterProcess(ClientContext clientContext, byte[] data, int offset)
+        {
             // All registering needs is a process Id
-            UInt64 processId = BitConverter.ToUInt64(clientContext.Data, offset);
+            UInt64 processId = BitConverter.ToUInt64(data, offset);
 
-            ProcessData newProcessData = ProcessReader.OpenProcess((int)processId);
+            ProcessData newProcessData = null;
+
+            // Remote processes can't be read out by the memory watcher,
+            // their watches only show what they publish themselves
+            if (clientContext.IsRemote)
+            {
+                newProcessData = new ProcessData()
+                {
+                    ProcessHandle = IntPtr.Zero,
+                    ProcessName = clientContext.Socket.RemoteEndPoint.ToString(),
+                    ProcessId = processId,
+                    IsRemote = true
+                };
+            }
+            else
+                newProcessData = ProcessReader.OpenProcess((int)processId);
 
             if (newProcessData == null)
             {
@@ -170,6 +408,7 @@ namespace Birdie
             }
 
             clientContext.ProcessData = newProcessData;
+            newProcessData.ClientContext = clientContext;
 
             lock (attachedProcesses)
                 attachedProcesses.Add(newProcessData);
@@ -178,42 +417,98 @@ namespace Birdie
                 ProcessConnect(newProcessData);
         }
 
-        private void AddWatch(ClientContext clientContext)
+        private void AddWatch(ClientContext clientContext, byte[] data, int offset)
         {
-            // Starting offset in 'data'
-            int offset = sizeof(UInt32);
+            ReadWatch(clientContext, data, ref offset);
+        }
 
-            // Remote processes don't have memory watching support, ignore their pleas
-            if (clientContext.IsRemote)
-                return;
+        private void AddWatches(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the AddWatches data chunk:
+            // - Watch count (4b)
+            // - For every watch: the same layout as the AddWatch data chunk
+            UInt32 watchCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            for (UInt32 i = 0; i < watchCount; i++)
+                ReadWatch(clientContext, data, ref offset);
+        }
+
+        private void ReadWatch(ClientContext clientContext, byte[] data, ref int offset)
+        {
+            WatchMemoryObject watchMemoryObject = new WatchMemoryObject();
+            UInt32 rootHandle = ReadWatchHeader(clientContext, data, ref offset, watchMemoryObject);
+
+            AddWatchMemoryObject(clientContext, rootHandle, watchMemoryObject);
+        }
+
+        private void AddArrayWatch(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the AddArrayWatch data chunk:
+            // - The same layout as the AddWatch data chunk, the size covers every element
+            // - Element count (4b)
+            // - Field count (4b)
+            // - For every field: Name string (see ReadString), Type string (see ReadString), Offset (4b), Size (4b), Stride (4b)
+            WatchArrayObject watchArrayObject = new WatchArrayObject();
+            UInt32 rootHandle = ReadWatchHeader(clientContext, data, ref offset, watchArrayObject);
+
+            watchArrayObject.ElementCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 fieldCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            watchArrayObject.Fields = new List<ArrayField>();
+
+            for (UInt32 i = 0; i < fieldCount; i++)
+            {
+                string nameString = ReadString(clientContext, data, ref offset);
+                string typeString = ReadString(clientContext, data, ref offset);
+
+                UInt32 fieldOffset = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+                UInt32 size = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+                UInt32 stride = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+                watchArrayObject.Fields.Add(new ArrayField()
+                {
+                    Name = nameString,
+                    Type = typeString,
+                    Offset = fieldOffset,
+                    Size = size,
+                    Stride = stride
+                });
+            }
 
+            AddWatchMemoryObject(clientContext, rootHandle, watchArrayObject);
+        }
+
+        private UInt32 ReadWatchHeader(ClientContext clientContext, byte[] data, ref int offset, WatchMemoryObject watchMemoryObject)
+        {
             // Layout of the AddWatch data chunk:
-            // - Length (4b), Type string (*b)
-            // - Length (4b), Name string (*b)
+            // - Type string (see ReadString)
+            // - Name string (see ReadString)
             // - Root handle (categories) (4b)
             // - Cross-process handle (4b)
             // - Base ptr (8b)
             // - Max size (4b)
-            int typeLength = BitConverter.ToInt32(clientContext.Data, offset); offset += sizeof(Int32);
-            string typeString = Encoding.ASCII.GetString(clientContext.Data, offset, typeLength); offset += typeLength;
-
-            int nameLength = BitConverter.ToInt32(clientContext.Data, offset); offset += sizeof(Int32);
-            string nameString = Encoding.ASCII.GetString(clientContext.Data, offset, nameLength); offset += nameLength;
-
-            UInt32 rootHandle = BitConverter.ToUInt32(clientContext.Data, offset); offset += sizeof(UInt32);
-            UInt32 handle = BitConverter.ToUInt32(clientContext.Data, offset); offset += sizeof(UInt32);
-            UInt64 basePtr = BitConverter.ToUInt64(clientContext.Data, offset); offset += sizeof(UInt64);
-            UInt32 maxSize = BitConverter.ToUInt32(clientContext.Data, offset); offset += sizeof(UInt32);
+            string typeString = ReadString(clientContext, data, ref offset);
+            string nameString = ReadString(clientContext, data, ref offset);
+
+            UInt32 rootHandle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt64 basePtr = BitConverter.ToUInt64(data, offset); offset += sizeof(UInt64);
+            UInt32 maxSize = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            watchMemoryObject.ProcessData = clientContext.ProcessData;
+            watchMemoryObject.BaseAddress = basePtr;
+            watchMemoryObject.Name = nameString;
+            watchMemoryObject.Type = typeString;
+            watchMemoryObject.MaxSize = maxSize;
+            watchMemoryObject.Handle = handle;
+
+            return rootHandle;
+        }
 
-            WatchMemoryObject watchMemoryObject = new WatchMemoryObject()
-            {
-                ProcessData = clientContext.ProcessData,
-                BaseAddress = basePtr,
-                Name = nameString,
-                Type = typeString,
-                MaxSize = maxSize,
-                Handle = handle
-            };
+        private void AddWatchMemoryObject(ClientContext clientContext, UInt32 rootHandle, WatchMemoryObject watchMemoryObject)
+        {
+            // A reconnecting client replays its watches, an object that was already added is replaced
+            RemoveWatchBaseObject(clientContext, watchMemoryObject.Handle);
 
             clientContext.ProcessData.AddWatchBaseObject(rootHandle, watchMemoryObject);
 
@@ -221,49 +516,154 @@ namespace Birdie
                 WatchMemoryObjectAdd(watchMemoryObject);
         }
 
-        private void RemoveWatchBaseObject(ClientContext clientContext)
+        private void RemoveWatchBaseObject(ClientContext clientContext, byte[] data, int offset)
         {
-            // Starting offset in 'data'
-            int offset = sizeof(UInt32);
+            // RemoveWatch only uses 1 handle variable
+            UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
 
-            // Remote processes don't have memory watching support, ignore their pleas
-            if (clientContext.IsRemote)
-                return;
+            RemoveWatchBaseObject(clientContext, handle);
+        }
 
-            // RemoveWatch only uses 1 handle variable
-            UInt32 handle = BitConverter.ToUInt32(clientContext.Data, offset); offset += sizeof(UInt32);
+        private void RemoveWatchBaseObjects(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the RemoveWatchObjects data chunk:
+            // - Handle count (4b)
+            // - Handles (4b each)
+            UInt32 handleCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
 
+            for (UInt32 i = 0; i < handleCount; i++)
+            {
+                UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+                RemoveWatchBaseObject(clientContext, handle);
+            }
+        }
+
+        private void RemoveWatchBaseObject(ClientContext clientContext, UInt32 handle)
+        {
             // Get the watch object
             WatchBaseObject watchBaseObject = clientContext.ProcessData.RemoveAndGetWatchBaseObject(handle);
 
             if (watchBaseObject != null)
             {
-                if (watchBaseObject.GetType() == typeof(WatchMemoryObject) && WatchMemoryObjectRemove != null)
+                if (watchBaseObject is WatchMemoryObject && WatchMemoryObjectRemove != null)
                     WatchMemoryObjectRemove((WatchMemoryObject)watchBaseObject);
                 else if (watchBaseObject.GetType() == typeof(WatchCategoryObject) && WatchCategoryObjectRemove != null)
                     WatchCategoryObjectRemove((WatchCategoryObject)watchBaseObject);
+                else if (watchBaseObject.GetType() == typeof(WatchImageObject) && WatchImageObjectRemove != null)
+                    WatchImageObjectRemove((WatchImageObject)watchBaseObject);
             }
         }
 
-        private void AddCategory(ClientContext clientContext)
+        private void PublishWatches(ClientContext clientContext, byte[] data, int offset)
         {
-            // Starting offset in 'data'
-            int offset = sizeof(UInt32);
+            // Layout of the PublishWatches data chunk, only watches that changed are included:
+            // - Watch count (4b)
+            // - For every watch: Cross-process handle (4b), Range count (4b)
+            // - For every range: Offset (4b), Length (4b), Data (*b)
+            UInt32 watchCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
 
-            // Remote processes don't have memory watching support, ignore their pleas
-            if (clientContext.IsRemote)
-                return;
+            for (UInt32 i = 0; i < watchCount; i++)
+            {
+                UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+                UInt32 rangeCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
 
-            // Layout of the AddCategory data chunk:
+                // Data for watches we don't know (anymore) is simply skipped
+                WatchMemoryObject watchMemoryObject = clientContext.ProcessData.GetWatchBaseObject(handle) as WatchMemoryObject;
+                byte[] publishedData = null;
+
+                if (watchMemoryObject != null)
+                {
+                    // Patch a copy, the watcher may be reading the current data on another thread
+                    if (watchMemoryObject.PublishedData != null)
+                        publishedData = (byte[])watchMemoryObject.PublishedData.Clone();
+                    else
+                        publishedData = new byte[watchMemoryObject.MaxSize];
+                }
+
+                for (UInt32 j = 0; j < rangeCount; j++)
+                {
+                    int rangeOffset = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+                    int rangeLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+
+                    if (publishedData != null && rangeOffset + rangeLength <= publishedData.Length)
+                        Buffer.BlockCopy(data, offset, publishedData, rangeOffset, rangeLength);
+
+                    offset += rangeLength;
+                }
+
+                if (publishedData != null)
+                    watchMemoryObject.PublishedData = publishedData;
+            }
+        }
+
+        private void UseSharedMemory(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the UseSharedMemory data chunk:
             // - Length (4b), Name string (*b)
+            // - Capacity (4b)
+            int nameLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            string nameString = Encoding.ASCII.GetString(data, offset, nameLength); offset += nameLength;
+
+            int capacity = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+
+            // Shared memory only exists on this machine
+            if (!clientContext.IsRemote && clientContext.SharedMemoryChannel == null)
+                clientContext.SharedMemoryChannel = SharedMemoryChannel.Open(clientContext, nameString, capacity, ChunkReceived);
+
+            // The client waits for our answer before it switches over, the reader is already running by now
+            UInt32 answer = clientContext.SharedMemoryChannel != null ? 1u : 0u;
+
+            SendToolOperation(clientContext, ToolOperationTypes.SharedMemoryAnswer, answer);
+        }
+
+        private void UseCompression(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the UseCompression data chunk:
+            // - Compression method (4b)
+            UInt32 method = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            // Only worth it over the network, the client keeps sending uncompressed frames unless we agree
+            UInt32 answer = (method == CompressionMethodLz4 && clientContext.IsRemote) ? 1u : 0u;
+
+            SendToolOperation(clientContext, ToolOperationTypes.CompressionAnswer, answer);
+        }
+
+        private bool SendToolOperation(ClientContext clientContext, int operationType, UInt32 value)
+        {
+            byte[] operation = new byte[sizeof(UInt32) * 2];
+
+            Buffer.BlockCopy(BitConverter.GetBytes(operationType), 0, operation, 0, sizeof(UInt32));
+            Buffer.BlockCopy(BitConverter.GetBytes(value), 0, operation, sizeof(UInt32), sizeof(UInt32));
+
+            try
+            {
+                clientContext.Socket.Send(operation);
+            }
+            catch (SocketException)
+            {
+                // The disconnect is handled by the network code
+                return false;
+            }
+            catch (ObjectDisposedException)
+            {
+                return false;
+            }
+
+            return true;
+        }
+
+        private void AddCategory(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the AddCategory data chunk:
+            // - Name string (see ReadString)
             // - Root handle (categories) (4b)
             // - Cross-process handle (4b)
 
-            int nameLength = BitConverter.ToInt32(clientContext.Data, offset); offset += sizeof(Int32);
-            string nameString = Encoding.ASCII.GetString(clientContext.Data, offset, nameLength); offset += nameLength;
+            string nameString = ReadString(clientContext, data, ref offset);
 
-            UInt32 rootHandle = BitConverter.ToUInt32(clientContext.Data, offset); offset += sizeof(UInt32);
-            UInt32 handle = BitConverter.ToUInt32(clientContext.Data, offset); offset += sizeof(UInt32);
+            UInt32 rootHandle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
 
             WatchCategoryObject watchCategoryObject = new WatchCategoryObject()
             {
@@ -272,33 +672,82 @@ namespace Birdie
                 Handle = handle
             };
 
+            // Same as for watches, a replayed category replaces the one that was already added
+            RemoveWatchBaseObject(clientContext, handle);
+
             clientContext.ProcessData.AddWatchBaseObject(rootHandle, watchCategoryObject);
 
             if (WatchCategoryObjectAdd != null)
                 WatchCategoryObjectAdd(watchCategoryObject);
         }
 
-        private void AddLogMessage(ClientContext clientContext)
+        private void AddLogMessage(ClientContext clientContext, byte[] data, int offset)
         {
-            // Starting offset in 'data'
-            int offset = sizeof(UInt32);
-            
             // Layout is easy:
+            // - Level (4b)
             // - Length (4b), Message string (*b)
-            // - Length (4b), Filter string (*b)
+            // - Filter string (see ReadString)
+            LogLevels level = (LogLevels)BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            int messageLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            string messageString = Encoding.ASCII.GetString(data, offset, messageLength); offset += messageLength;
+
+            string filterString = ReadString(clientContext, data, ref offset);
+
+            LogMessage logMessage = new LogMessage()
+            {
+                Filter = filterString,
+                Level = level,
+                Message = messageString,
+                MessageOrigin = MessageOrigins.Client
+            };
+
+            if (LogMessageAdd != null)
+                LogMessageAdd(clientContext.ProcessData, logMessage);
+        }
+
+        private void AddLogFormat(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the AddLogFormat data chunk:
+            // - Format Id (4b)
+            // - Length (4b), Format string (*b)
+            UInt32 formatId = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            int formatLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            string formatString = Encoding.ASCII.GetString(data, offset, formatLength); offset += formatLength;
+
+            clientContext.LogFormats[formatId] = formatString;
+        }
+
+        private void AddDeferredLogMessage(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the AddDeferredLogMessage data chunk:
+            // - Level (4b)
+            // - Format Id (4b)
+            // - Length (4b), Arguments (*b), every argument is a kind (1b) followed by its value
+            // - Filter string (see ReadString)
+            LogLevels level = (LogLevels)BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 formatId = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
 
-            int messageLength = BitConverter.ToInt32(clientContext.Data, offset); offset += sizeof(Int32);
-            string messageString = Encoding.ASCII.GetString(clientContext.Data, offset, messageLength); offset += messageLength;
+            int argumentsLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            List<object> arguments = LogFormatter.ReadArguments(data, offset, argumentsLength); offset += argumentsLength;
 
-            int filterLength = BitConverter.ToInt32(clientContext.Data, offset); offset += sizeof(Int32);
-            string filterString = "";
+            string filterString = ReadString(clientContext, data, ref offset);
 
-            if (filterLength > 0)
-                filterString = Encoding.ASCII.GetString(clientContext.Data, offset, filterLength); offset += filterLength;
+            string formatString = null;
+            string messageString = null;
+
+            if (!clientContext.LogFormats.TryGetValue(formatId, out formatString))
+                messageString = string.Format("<Unknown log format {0}>", formatId);
+            else if (arguments == null)
+                messageString = string.Format("<Malformed arguments for \"{0}\">", formatString);
+            else
+                messageString = LogFormatter.Format(formatString, arguments);
 
             LogMessage logMessage = new LogMessage()
             {
                 Filter = filterString,
+                Level = level,
                 Message = messageString,
                 MessageOrigin = MessageOrigins.Client
             };
@@ -307,20 +756,264 @@ namespace Birdie
                 LogMessageAdd(clientContext.ProcessData, logMessage);
         }
 
-        void AddCustomTypeHandler(ClientContext clientContext)
+        private void AddString(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the AddString data chunk:
+            // - String Id (4b)
+            // - Length (4b), String (*b)
+            UInt32 stringId = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            int stringLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            string stringValue = Encoding.ASCII.GetString(data, offset, stringLength); offset += stringLength;
+
+            clientContext.Strings[stringId] = stringValue;
+        }
+
+        private void AddZones(ClientContext clientContext, byte[] data, int offset)
         {
-            // Starting offset in 'data'
-            int offset = sizeof(UInt32);
+            // Layout of the AddZones data chunk:
+            // - Thread Id (4b)
+            // - Timestamp frequency (8b), ticks per second. 0 if the client couldn't tell yet.
+            // - Count (4b), then per event: Timestamp (8b), Zone string Id (4b), Kind (4b, 0 is begin and 1 is end)
+            UInt32 threadId = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt64 frequency = BitConverter.ToUInt64(data, offset); offset += sizeof(UInt64);
+            int count = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
 
+            if (frequency != 0)
+                clientContext.TimestampFrequency = frequency;
+
+            Stack<KeyValuePair<UInt32, UInt64>> openZones;
+
+            if (!clientContext.OpenZones.TryGetValue(threadId, out openZones))
+            {
+                openZones = new Stack<KeyValuePair<UInt32, UInt64>>();
+                clientContext.OpenZones[threadId] = openZones;
+            }
+
+            List<ZoneSample> zoneSamples = new List<ZoneSample>();
+            double ticksPerSecond = clientContext.TimestampFrequency;
+
+            for (int i = 0; i < count; i++)
+            {
+                UInt64 timestamp = BitConverter.ToUInt64(data, offset); offset += sizeof(UInt64);
+                UInt32 zoneId = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+                UInt32 kind = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+                if (kind == 0)
+                {
+                    openZones.Push(new KeyValuePair<UInt32, UInt64>(zoneId, timestamp));
+                    continue;
+                }
+
+                // Zones that were never ended (or began before we were connected) are skipped
+                while (openZones.Count > 0 && openZones.Peek().Key != zoneId)
+                    openZones.Pop();
+
+                if (openZones.Count == 0 || ticksPerSecond == 0)
+                    continue;
+
+                KeyValuePair<UInt32, UInt64> openZone = openZones.Pop();
+                string zoneName = null;
+
+                if (!clientContext.Strings.TryGetValue(zoneId, out zoneName))
+                    zoneName = string.Format("<Unknown zone {0}>", zoneId);
+
+                zoneSamples.Add(new ZoneSample()
+                {
+                    Name = zoneName,
+                    ThreadId = threadId,
+                    Depth = openZones.Count,
+                    Start = TimeSpan.FromSeconds(openZone.Value / ticksPerSecond),
+                    Duration = TimeSpan.FromSeconds((timestamp - openZone.Value) / ticksPerSecond)
+                });
+            }
+
+            if (zoneSamples.Count > 0 && ZoneSamplesAdd != null)
+                ZoneSamplesAdd(clientContext.ProcessData, zoneSamples);
+        }
+
+        private void AddSampleWindows(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the AddSampleWindows data chunk:
+            // - Count (4b)
+            // - For every window: Cross-process handle (4b), Sample count (4b), Sequence (8b),
+            //   Minimum (8b), Maximum (8b), Mean (8b), Last (8b)
+            int count = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+
+            List<SampleWindow> sampleWindows = new List<SampleWindow>();
+
+            for (int i = 0; i < count; i++)
+            {
+                UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+                UInt32 sampleCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+                UInt64 sequence = BitConverter.ToUInt64(data, offset); offset += sizeof(UInt64);
+                double minimum = BitConverter.ToDouble(data, offset); offset += sizeof(double);
+                double maximum = BitConverter.ToDouble(data, offset); offset += sizeof(double);
+                double mean = BitConverter.ToDouble(data, offset); offset += sizeof(double);
+                double last = BitConverter.ToDouble(data, offset); offset += sizeof(double);
+
+                // Windows of watches we don't know (anymore) are simply skipped
+                WatchMemoryObject watchMemoryObject = clientContext.ProcessData.GetWatchBaseObject(handle) as WatchMemoryObject;
+
+                if (watchMemoryObject == null)
+                    continue;
+
+                sampleWindows.Add(new SampleWindow()
+                {
+                    WatchMemoryObject = watchMemoryObject,
+                    SampleCount = sampleCount,
+                    Sequence = sequence,
+                    Minimum = minimum,
+                    Maximum = maximum,
+                    Mean = mean,
+                    Last = last
+                });
+            }
+
+            if (sampleWindows.Count > 0 && SampleWindowsAdd != null)
+                SampleWindowsAdd(clientContext.ProcessData, sampleWindows);
+        }
+
+        private void HandleSampleRing(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the SampleRing data chunk:
+            // - Cross-process handle (4b)
+            // - Sample rate (4b), samples per second
+            // - Sequence (8b), samples the watch had when the ring was sent
+            // - Count (4b), then every sample (8b), oldest first
+            UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 sampleRate = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt64 sequence = BitConverter.ToUInt64(data, offset); offset += sizeof(UInt64);
+            int count = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+
+            WatchMemoryObject watchMemoryObject = clientContext.ProcessData.GetWatchBaseObject(handle) as WatchMemoryObject;
+
+            if (watchMemoryObject == null || SampleRingReceive == null)
+                return;
+
+            double[] samples = new double[count];
+            Buffer.BlockCopy(data, offset, samples, 0, count * sizeof(double));
+
+            SampleRingReceive(clientContext.ProcessData, new SampleRing()
+            {
+                WatchMemoryObject = watchMemoryObject,
+                SampleRate = sampleRate,
+                Sequence = sequence,
+                Samples = samples
+            });
+        }
+
+        private void AddImageWatch(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the AddImageWatch data chunk:
+            // - Name string (see ReadString)
+            // - Root handle (categories) (4b)
+            // - Cross-process handle (4b)
+            // - Width (4b), Height (4b), as the image is sent
+            // - Pixel format (4b)
+            // - Tile size (4b)
+            string nameString = ReadString(clientContext, data, ref offset);
+
+            UInt32 rootHandle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 width = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 height = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            PixelFormats format = (PixelFormats)BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 tileSize = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            WatchImageObject watchImageObject = new WatchImageObject()
+            {
+                Name = nameString,
+                ProcessData = clientContext.ProcessData,
+                Handle = handle,
+                Type = "Image",
+                Width = width,
+                Height = height,
+                Format = format,
+                TileSize = tileSize,
+                Pixels = new byte[width * height * WatchImageObject.GetPixelSize(format)]
+            };
+
+            // A replayed image replaces the one that was already added, the process sends all of its tiles again
+            RemoveWatchBaseObject(clientContext, handle);
+
+            clientContext.ProcessData.AddWatchBaseObject(rootHandle, watchImageObject);
+
+            if (WatchImageObjectAdd != null)
+                WatchImageObjectAdd(watchImageObject);
+        }
+
+        private void HandleImageTiles(ClientContext clientContext, byte[] data, int offset)
+        {
+            // Layout of the ImageTiles data chunk, only tiles that changed are included:
+            // - Cross-process handle (4b)
+            // - Tile count (4b)
+            // - For every tile: X (4b), Y (4b), Width (4b), Height (4b), then its rows of pixels without any padding
+            UInt32 handle = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+            UInt32 tileCount = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            // Tiles of images we don't know (anymore) are simply skipped
+            WatchImageObject watchImageObject = clientContext.ProcessData.GetWatchBaseObject(handle) as WatchImageObject;
+
+            if (watchImageObject == null)
+                return;
+
+            int pixelSize = WatchImageObject.GetPixelSize(watchImageObject.Format);
+            int imagePitch = (int)watchImageObject.Width * pixelSize;
+
+            for (UInt32 i = 0; i < tileCount; i++)
+            {
+                int x = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+                int y = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+                int width = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+                int height = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+
+                int tilePitch = width * pixelSize;
+
+                for (int row = 0; row < height; row++)
+                {
+                    Buffer.BlockCopy(data, offset, watchImageObject.Pixels, (y + row) * imagePitch + x * pixelSize, tilePitch);
+                    offset += tilePitch;
+                }
+            }
+
+            if (WatchImageObjectUpdate != null)
+                WatchImageObjectUpdate(watchImageObject);
+        }
+
+        private string ReadString(ClientContext clientContext, byte[] data, ref int offset)
+        {
+            // Strings are either:
+            // - Length (4b), String (*b)
+            // - String Id (4b) with the top bit set, the string was sent by AddString before
+            UInt32 lengthOrId = BitConverter.ToUInt32(data, offset); offset += sizeof(UInt32);
+
+            if ((lengthOrId & StringIdFlag) == 0)
+            {
+                string stringValue = Encoding.ASCII.GetString(data, offset, (int)lengthOrId); offset += (int)lengthOrId;
+                return stringValue;
+            }
+
+            UInt32 stringId = lengthOrId & ~StringIdFlag;
+            string internedString = null;
+
+            if (!clientContext.Strings.TryGetValue(stringId, out internedString))
+                internedString = string.Format("<Unknown string {0}>", stringId);
+
+            return internedString;
+        }
+
+        void AddCustomTypeHandler(ClientContext clientContext, byte[] data, int offset)
+        {
             // Layout of the data chunk:
             // - Length (4b), Type string (*b)
             // - Length (4b), Code string (*b)
 
-            int typeLength = BitConverter.ToInt32(clientContext.Data, offset); offset += sizeof(Int32);
-            string typeString = Encoding.ASCII.GetString(clientContext.Data, offset, typeLength); offset += typeLength;
+            int typeLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            string typeString = Encoding.ASCII.GetString(data, offset, typeLength); offset += typeLength;
 
-            int codeLength = BitConverter.ToInt32(clientContext.Data, offset); offset += sizeof(Int32);
-            string codeString = Encoding.ASCII.GetString(clientContext.Data, offset, codeLength); offset += codeLength;
+            int codeLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+            string codeString = Encoding.ASCII.GetString(data, offset, codeLength); offset += codeLength;
 
             // Now compile the code
 
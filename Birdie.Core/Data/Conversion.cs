@@ -26,7 +26,8 @@ namespace Birdie.Data
         Float64,
         ANSIString,
         UTF8String,
-        HEXPattern
+        HEXPattern,
+        Array
     }
 
     /// <summary>
@@ -98,6 +99,8 @@ namespace Birdie.Data
             dataConverter.AddConversionFunction(BaseTypes.ANSIString.ToString(), ANSIStringToString);
             dataConverter.AddConversionFunction(BaseTypes.UTF8String.ToString(), UTF8StringToString);
             dataConverter.AddConversionFunction(BaseTypes.HEXPattern.ToString(), HEXPatternToString);
+
+            dataConverter.AddConversionFunction(BaseTypes.Array.ToString(), ArrayToString);
         }
 
         public static object BoolToString(WatchMemoryObject watchMemoryObject)
@@ -174,6 +177,21 @@ namespace Birdie.Data
 
             return hex;
         }
+
+        public static object ArrayToString(WatchMemoryObject watchMemoryObject)
+        {
+            // Elements are only converted once they're asked for, see WatchArrayObject.GetElement
+            WatchArrayObject watchArrayObject = watchMemoryObject as WatchArrayObject;
+
+            if (watchArrayObject == null)
+                return null;
+
+            // A single element is a reflected structure, its fields are few enough to show right away
+            if (watchArrayObject.ElementCount == 1)
+                return string.Join(", ", watchArrayObject.GetElement(0).Select(field => string.Format("{0}: {1}", field.Name, field.DataAsObject)));
+
+            return string.Format("[{0} elements]", watchArrayObject.ElementCount);
+        }
         #endregion
     }
 }
@@ -0,0 +1,391 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Text;
+
+namespace Birdie.Data
+{
+    /// <summary>
+    /// Formats deferred log messages. Follows printf, since that's what the client would have used.
+    /// </summary>
+    internal static class LogFormatter
+    {
+        #region Classes
+        public static class ArgumentKinds
+        {
+            public const byte Int32 = 1;
+            public const byte UInt32 = 2;
+            public const byte Int64 = 3;
+            public const byte UInt64 = 4;
+            public const byte Float64 = 5;
+            public const byte String = 6;
+            public const byte Pointer = 7;
+        }
+        #endregion
+
+        #region Methods
+        /// <summary>
+        /// Reads arguments encoded as a kind (1b) followed by the value.
+        /// Returns null if the data is malformed.
+        /// </summary>
+        public static List<object> ReadArguments(byte[] data, int offset, int length)
+        {
+            List<object> arguments = new List<object>();
+            int end = offset + length;
+
+            while (offset < end)
+            {
+                byte kind = data[offset]; offset += sizeof(byte);
+
+                switch (kind)
+                {
+                    case ArgumentKinds.Int32:
+                        arguments.Add(BitConverter.ToInt32(data, offset)); offset += sizeof(Int32);
+                        break;
+
+                    case ArgumentKinds.UInt32:
+                        arguments.Add(BitConverter.ToUInt32(data, offset)); offset += sizeof(UInt32);
+                        break;
+
+                    case ArgumentKinds.Int64:
+                        arguments.Add(BitConverter.ToInt64(data, offset)); offset += sizeof(Int64);
+                        break;
+
+                    case ArgumentKinds.UInt64:
+                    case ArgumentKinds.Pointer:
+                        arguments.Add(BitConverter.ToUInt64(data, offset)); offset += sizeof(UInt64);
+                        break;
+
+                    case ArgumentKinds.Float64:
+                        arguments.Add(BitConverter.ToDouble(data, offset)); offset += sizeof(double);
+                        break;
+
+                    case ArgumentKinds.String:
+                        int stringLength = BitConverter.ToInt32(data, offset); offset += sizeof(Int32);
+                        arguments.Add(Encoding.ASCII.GetString(data, offset, stringLength)); offset += stringLength;
+                        break;
+
+                    default:
+                        return null;
+                }
+            }
+
+            return offset == end ? arguments : null;
+        }
+
+        public static string Format(string format, List<object> arguments)
+        {
+            StringBuilder result = new StringBuilder(format.Length * 2);
+            int argumentIndex = 0;
+            int i = 0;
+
+            while (i < format.Length)
+            {
+                char c = format[i++];
+
+                if (c != '%' || i == format.Length)
+                {
+                    result.Append(c);
+                    continue;
+                }
+
+                if (format[i] == '%')
+                {
+                    result.Append('%');
+                    i++;
+                    continue;
+                }
+
+                // Flags
+                bool leftAlign = false, showSign = false, spaceSign = false, alternate = false, zeroPad = false;
+
+                for (; i < format.Length; i++)
+                {
+                    if (format[i] == '-') leftAlign = true;
+                    else if (format[i] == '+') showSign = true;
+                    else if (format[i] == ' ') spaceSign = true;
+                    else if (format[i] == '#') alternate = true;
+                    else if (format[i] == '0') zeroPad = true;
+                    else if (format[i] != '\'') break;
+                }
+
+                // Width and precision
+                int width = ReadNumber(format, ref i, arguments, ref argumentIndex);
+                int precision = -1;
+
+                if (width < 0)
+                {
+                    leftAlign = true;
+                    width = -width;
+                }
+
+                if (i < format.Length && format[i] == '.')
+                {
+                    i++;
+                    precision = Math.Max(ReadNumber(format, ref i, arguments, ref argumentIndex), 0);
+                }
+
+                // Length modifiers only matter for the narrow types, the client already sent the right size
+                int narrowBits = 0;
+
+                if (i + 1 < format.Length && format[i] == 'h' && format[i + 1] == 'h') { narrowBits = 8; i += 2; }
+                else if (i < format.Length && format[i] == 'h') { narrowBits = 16; i++; }
+                else if (i + 2 < format.Length && format[i] == 'I' && (format.Substring(i, 3) == "I64" || format.Substring(i, 3) == "I32")) i += 3;
+                else if (i + 1 < format.Length && format[i] == 'l' && format[i + 1] == 'l') i += 2;
+                else if (i < format.Length && "lLzjtwIq".IndexOf(format[i]) >= 0) i++;
+
+                if (i == format.Length)
+                    break;
+
+                char conversion = format[i++];
+                object argument = argumentIndex < arguments.Count ? arguments[argumentIndex++] : null;
+
+                if (argument == null)
+                {
+                    result.Append("<missing>");
+                    continue;
+                }
+
+                string text = null;
+                string prefix = "";
+                bool isNumeric = true;
+
+                switch (conversion)
+                {
+                    case 'd':
+                    case 'i':
+                        Int64 signedValue = ToInt64(argument, narrowBits);
+                        text = ApplyIntegerPrecision(signedValue == Int64.MinValue ? "9223372036854775808" : Math.Abs(signedValue).ToString(CultureInfo.InvariantCulture), precision);
+                        prefix = signedValue < 0 ? "-" : showSign ? "+" : spaceSign ? " " : "";
+                        break;
+
+                    case 'u':
+                        text = ApplyIntegerPrecision(ToUInt64(argument, narrowBits).ToString(CultureInfo.InvariantCulture), precision);
+                        break;
+
+                    case 'x':
+                    case 'X':
+                        UInt64 hexValue = ToUInt64(argument, narrowBits);
+                        text = ApplyIntegerPrecision(hexValue.ToString(conversion == 'x' ? "x" : "X"), precision);
+
+                        if (alternate && hexValue != 0)
+                            prefix = conversion == 'x' ? "0x" : "0X";
+                        break;
+
+                    case 'o':
+                        text = ApplyIntegerPrecision(Convert.ToString((long)ToUInt64(argument, narrowBits), 8), precision);
+
+                        if (alternate && text[0] != '0')
+                            text = "0" + text;
+                        break;
+
+                    case 'c':
+                        text = ((char)(ToUInt64(argument, 8) & 0xFF)).ToString();
+                        isNumeric = false;
+                        break;
+
+                    case 's':
+                        text = argument as string ?? Convert.ToString(argument, CultureInfo.InvariantCulture);
+
+                        if (precision >= 0 && precision < text.Length)
+                            text = text.Substring(0, precision);
+
+                        isNumeric = false;
+                        break;
+
+                    case 'p':
+                        text = ToUInt64(argument, 0).ToString("X16");
+                        isNumeric = false;
+                        break;
+
+                    case 'f':
+                    case 'F':
+                    case 'e':
+                    case 'E':
+                    case 'g':
+                    case 'G':
+                    case 'a':
+                    case 'A':
+                        double doubleValue = Convert.ToDouble(argument, CultureInfo.InvariantCulture);
+                        text = FormatDouble(Math.Abs(doubleValue), conversion, precision < 0 ? 6 : precision, alternate);
+                        prefix = (doubleValue < 0 || (doubleValue == 0 && 1 / doubleValue < 0)) ? "-" : showSign ? "+" : spaceSign ? " " : "";
+
+                        if (double.IsNaN(doubleValue) || double.IsInfinity(doubleValue))
+                            isNumeric = false;
+                        break;
+
+                    default:
+                        // Unknown conversion, show it as it was
+                        text = "%" + conversion;
+                        argumentIndex--;
+                        isNumeric = false;
+                        break;
+                }
+
+                // Zero padding goes between the sign and the digits, and integers ignore it when there's a precision
+                bool padWithZeros = zeroPad && !leftAlign && isNumeric && (precision < 0 || "fFeEgGaA".IndexOf(conversion) >= 0);
+                int padding = width - prefix.Length - text.Length;
+
+                if (padding <= 0)
+                    result.Append(prefix).Append(text);
+                else if (leftAlign)
+                    result.Append(prefix).Append(text).Append(' ', padding);
+                else if (padWithZeros)
+                    result.Append(prefix).Append('0', padding).Append(text);
+                else
+                    result.Append(' ', padding).Append(prefix).Append(text);
+            }
+
+            return result.ToString();
+        }
+
+        private static int ReadNumber(string format, ref int i, List<object> arguments, ref int argumentIndex)
+        {
+            if (i < format.Length && format[i] == '*')
+            {
+                i++;
+                return argumentIndex < arguments.Count ? (int)ToInt64(arguments[argumentIndex++], 0) : 0;
+            }
+
+            int number = 0;
+
+            for (; i < format.Length && format[i] >= '0' && format[i] <= '9'; i++)
+                number = number * 10 + (format[i] - '0');
+
+            return number;
+        }
+
+        private static Int64 ToInt64(object argument, int narrowBits)
+        {
+            Int64 value;
+
+            if (argument is UInt32)
+                value = (Int32)(UInt32)argument;
+            else if (argument is UInt64)
+                value = (Int64)(UInt64)argument;
+            else if (argument is double)
+                value = (Int64)(double)argument;
+            else if (argument is string)
+                value = 0;
+            else
+                value = Convert.ToInt64(argument, CultureInfo.InvariantCulture);
+
+            if (narrowBits == 8)
+                return (sbyte)value;
+
+            if (narrowBits == 16)
+                return (Int16)value;
+
+            return value;
+        }
+
+        private static UInt64 ToUInt64(object argument, int narrowBits)
+        {
+            UInt64 value;
+
+            // 32 bit arguments stay 32 bit, just like printf would see them
+            if (argument is Int32)
+                value = (UInt32)(Int32)argument;
+            else if (argument is Int64)
+                value = (UInt64)(Int64)argument;
+            else if (argument is double)
+                value = (UInt64)(double)argument;
+            else if (argument is string)
+                value = 0;
+            else
+                value = Convert.ToUInt64(argument, CultureInfo.InvariantCulture);
+
+            if (narrowBits == 8)
+                return (byte)value;
+
+            if (narrowBits == 16)
+                return (UInt16)value;
+
+            return value;
+        }
+
+        private static string ApplyIntegerPrecision(string digits, int precision)
+        {
+            // A zero precision prints nothing for a zero value
+            if (precision == 0 && digits == "0")
+                return "";
+
+            return precision > digits.Length ? new string('0', precision - digits.Length) + digits : digits;
+        }
+
+        private static string FormatDouble(double value, char conversion, int precision, bool alternate)
+        {
+            bool isUpper = char.IsUpper(conversion);
+
+            if (double.IsNaN(value))
+                return isUpper ? "NAN" : "nan";
+
+            if (double.IsInfinity(value))
+                return isUpper ? "INF" : "inf";
+
+            string text;
+
+            switch (char.ToLowerInvariant(conversion))
+            {
+                case 'f':
+                    text = value.ToString("F" + precision, CultureInfo.InvariantCulture);
+
+                    if (alternate && precision == 0)
+                        text += ".";
+                    break;
+
+                case 'e':
+                    text = FormatExponent(value, precision, alternate);
+                    break;
+
+                case 'g':
+                    // Picks %e or %f based on the exponent, then drops the trailing zeros
+                    int significantDigits = precision == 0 ? 1 : precision;
+                    // Rounding can bump the exponent, %e knows the real one
+                    string exponentText = FormatExponent(value, significantDigits - 1, false);
+                    int exponent = int.Parse(exponentText.Substring(exponentText.IndexOf('e') + 1), CultureInfo.InvariantCulture);
+
+                    if (exponent >= -4 && exponent < significantDigits)
+                        text = value.ToString("F" + (significantDigits - 1 - exponent), CultureInfo.InvariantCulture);
+                    else
+                        text = exponentText;
+
+                    if (!alternate)
+                        text = TrimFractionZeros(text);
+                    break;
+
+                default:
+                    // Hexadecimal floats are rare enough to not bother, round-trip notation keeps all bits
+                    text = value.ToString("R", CultureInfo.InvariantCulture);
+                    break;
+            }
+
+            return isUpper ? text.ToUpperInvariant() : text;
+        }
+
+        private static string FormatExponent(double value, int precision, bool alternate)
+        {
+            // printf wants at least two exponent digits
+            string pattern = precision > 0 ? "0." + new string('0', precision) + "e+00" : "0e+00";
+            string text = value.ToString(pattern, CultureInfo.InvariantCulture);
+
+            if (alternate && precision == 0)
+                text = text.Insert(1, ".");
+
+            return text;
+        }
+
+        private static string TrimFractionZeros(string text)
+        {
+            int exponentIndex = text.IndexOf('e');
+            string mantissa = exponentIndex >= 0 ? text.Substring(0, exponentIndex) : text;
+            string exponent = exponentIndex >= 0 ? text.Substring(exponentIndex) : "";
+
+            if (mantissa.IndexOf('.') >= 0)
+                mantissa = mantissa.TrimEnd('0').TrimEnd('.');
+
+            return mantissa + exponent;
+        }
+        #endregion
+    }
+}
@@ -13,6 +13,17 @@ namespace Birdie.Data
         Birdie
     }
 
+    // Same values as BIRDIE_LOG_LEVEL, None is only used as a threshold
+    public enum LogLevels
+    {
+        Trace,
+        Debug,
+        Info,
+        Warning,
+        Error,
+        None
+    }
+
     /// <summary>
     /// This class represents log messages, either from a client or from Birdie components themselves.
     /// </summary>
@@ -21,6 +32,7 @@ namespace Birdie.Data
         #region Properties
         public string Message { get; set; }
         public string Filter { get; set; }
+        public LogLevels Level { get; set; }
         public MessageOrigins MessageOrigin { get; internal set; }
         #endregion
     }
@@ -0,0 +1,22 @@
+﻿using Birdie.Watcher;
+using System;
+
+namespace Birdie.Data
+{
+    /// <summary>
+    /// This class contains the raw samples a client kept of one of its sampled watches, as fetched by FetchSamples.
+    /// </summary>
+    public class SampleRing
+    {
+        #region Properties
+        public WatchMemoryObject WatchMemoryObject { get; set; }
+        public UInt32 SampleRate { get; set; }
+
+        // Samples the watch had when the ring was sent, the last sample is the one before it
+        public UInt64 Sequence { get; set; }
+
+        // Oldest first
+        public double[] Samples { get; set; }
+        #endregion
+    }
+}
@@ -0,0 +1,26 @@
+﻿using Birdie.Watcher;
+using System;
+
+namespace Birdie.Data
+{
+    /// <summary>
+    /// This class represents the aggregate of a window of samples, taken by a client of one of its sampled watches.
+    /// </summary>
+    public class SampleWindow
+    {
+        #region Properties
+        public WatchMemoryObject WatchMemoryObject { get; set; }
+
+        // Fewer than the sample rate asks for if the client fell behind
+        public UInt32 SampleCount { get; set; }
+
+        // Samples the watch had when the window ended, matches the sequence of a SampleRing
+        public UInt64 Sequence { get; set; }
+
+        public double Minimum { get; set; }
+        public double Maximum { get; set; }
+        public double Mean { get; set; }
+        public double Last { get; set; }
+        #endregion
+    }
+}
@@ -0,0 +1,22 @@
+﻿using System;
+
+namespace Birdie.Data
+{
+    /// <summary>
+    /// This class represents one run through a profiling zone of a client, from its begin to its end.
+    /// </summary>
+    public class ZoneSample
+    {
+        #region Properties
+        public string Name { get; set; }
+        public UInt32 ThreadId { get; set; }
+
+        // Zones that were still open around this one on the same thread
+        public int Depth { get; set; }
+
+        // Only comparable to the starts of other zones of the same process
+        public TimeSpan Start { get; set; }
+        public TimeSpan Duration { get; set; }
+        #endregion
+    }
+}
@@ -11,7 +11,11 @@ namespace Birdie
         public delegate void ProcessDelegate(ProcessData processData);
         public delegate void WatchMemoryObjectDelegate(WatchMemoryObject watchMemoryObject);
         public delegate void WatchCategoryObjectDelegate(WatchCategoryObject watchCategoryObject);
+        public delegate void WatchImageObjectDelegate(WatchImageObject watchImageObject);
         public delegate void LogMessageDelegate(ProcessData processData, LogMessage logMessage);
+        public delegate void ZoneSamplesDelegate(ProcessData processData, List<ZoneSample> zoneSamples);
+        public delegate void SampleWindowsDelegate(ProcessData processData, List<SampleWindow> sampleWindows);
+        public delegate void SampleRingDelegate(ProcessData processData, SampleRing sampleRing);
     }
 
     public interface IBirdieContext
@@ -23,7 +27,13 @@ namespace Birdie
         event IBirdieContextDelegates.WatchMemoryObjectDelegate WatchMemoryObjectRemove;
         event IBirdieContextDelegates.WatchCategoryObjectDelegate WatchCategoryObjectAdd;
         event IBirdieContextDelegates.WatchCategoryObjectDelegate WatchCategoryObjectRemove;
+        event IBirdieContextDelegates.WatchImageObjectDelegate WatchImageObjectAdd;
+        event IBirdieContextDelegates.WatchImageObjectDelegate WatchImageObjectRemove;
+        event IBirdieContextDelegates.WatchImageObjectDelegate WatchImageObjectUpdate;
         event IBirdieContextDelegates.LogMessageDelegate LogMessageAdd;
+        event IBirdieContextDelegates.ZoneSamplesDelegate ZoneSamplesAdd;
+        event IBirdieContextDelegates.SampleWindowsDelegate SampleWindowsAdd;
+        event IBirdieContextDelegates.SampleRingDelegate SampleRingReceive;
         #endregion
 
         #region Methods
@@ -42,6 +52,23 @@ namespace Birdie
         void Terminate();
         #endregion 
 
+        #region Process control methods
+        /// <summary>
+        /// Sets the lowest log level the process still sends, everything below it is dropped before it's formatted.
+        /// </summary>
+        /// <param name="processData">A connected process</param>
+        /// <param name="threshold">The lowest level to receive, or None for no messages at all</param>
+        /// <returns>True if the request was sent, else false</returns>
+        bool SetLogLevel(ProcessData processData, LogLevels threshold);
+
+        /// <summary>
+        /// Asks the process for the raw samples it kept of a sampled watch, they arrive through SampleRingReceive.
+        /// </summary>
+        /// <param name="watchMemoryObject">A watch the process samples</param>
+        /// <returns>True if the request was sent, else false</returns>
+        bool FetchSamples(WatchMemoryObject watchMemoryObject);
+        #endregion
+
         #endregion
 
         #region Properties
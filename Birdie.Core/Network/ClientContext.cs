@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.Diagnostics;
 using System.Net.Sockets;
 
@@ -11,11 +12,25 @@ namespace Birdie.Network
         AwaitChunkBody
     }
 
+    /// <summary>
+    /// An operation the client sent in fragments, while not all of them are in yet
+    /// </summary>
+    internal class FragmentStream
+    {
+        public byte[] Data { get; set; }
+        public int ReceivedBytes { get; set; }
+    }
+
     /// <summary>
     /// Contains all the data necessary for the network thread
     /// </summary>
     internal class ClientContext
     {
+        #region Constants
+        // Clients cut every chunk larger than this into fragments, so receive buffers up to this size are worth keeping
+        public const int MaxReusedChunkSize = 256 * 1024;
+        #endregion
+
         #region Methods
         public ClientContext()
         {
@@ -59,6 +74,14 @@ namespace Birdie.Network
         public int ReceivedBytes { get { return receivedBytes; } }
         public bool IsClosed { get; set; }
         public bool IsRemote { get; set; }
+        public SharedMemoryChannel SharedMemoryChannel { get; set; }
+        public Dictionary<UInt32, string> LogFormats { get { return logFormats; } }
+        public Dictionary<UInt32, string> Strings { get { return strings; } }
+        public Dictionary<UInt32, FragmentStream> FragmentStreams { get { return fragmentStreams; } }
+
+        // Zones that began but haven't ended yet, per thread. Every entry is a zone Id and its begin timestamp.
+        public Dictionary<UInt32, Stack<KeyValuePair<UInt32, UInt64>>> OpenZones { get { return openZones; } }
+        public UInt64 TimestampFrequency { get; set; }
 
         public IoStates IoState 
         { 
@@ -80,14 +103,25 @@ namespace Birdie.Network
                 }
                 else if (value == IoStates.AwaitChunkSize)
                 {
-                    data = new byte[sizeof(Int32)];
+                    data = chunkSizeBuffer;
                     ChunkSize = 0;
                     expectedBytes = data.Length;
                     receivedBytes = 0;
                 }
                 else if (value == IoStates.AwaitChunkBody)
                 {
-                    data = new byte[ChunkSize];
+                    // A chunk is handled before the next one is received, so its buffer can be used again.
+                    // Only chunks that weren't cut into fragments need one of their own.
+                    if (ChunkSize > MaxReusedChunkSize)
+                        data = new byte[ChunkSize];
+                    else
+                    {
+                        if (chunkBuffer.Length < ChunkSize)
+                            chunkBuffer = new byte[ChunkSize];
+
+                        data = chunkBuffer;
+                    }
+
                     expectedBytes = ChunkSize;
                     receivedBytes = 0;
                 }
@@ -101,6 +135,12 @@ namespace Birdie.Network
         private int receivedBytes = 0;
         private int ioState = (int)IoStates.AwaitChallenge;
         private byte[] data = null;
+        private byte[] chunkSizeBuffer = new byte[sizeof(Int32)];
+        private byte[] chunkBuffer = new byte[0];
+        private Dictionary<UInt32, string> logFormats = new Dictionary<UInt32, string>();
+        private Dictionary<UInt32, string> strings = new Dictionary<UInt32, string>();
+        private Dictionary<UInt32, FragmentStream> fragmentStreams = new Dictionary<UInt32, FragmentStream>();
+        private Dictionary<UInt32, Stack<KeyValuePair<UInt32, UInt64>>> openZones = new Dictionary<UInt32, Stack<KeyValuePair<UInt32, UInt64>>>();
         #endregion
     }
 }
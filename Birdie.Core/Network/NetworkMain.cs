@@ -180,14 +180,19 @@ namespace Birdie.Network
                     }
 
                     asyncEventArgs.SetBuffer(clientContext.Data, 0, clientContext.ExpectedBytes);
+                }
+                else
+                {
+                    // Large chunks usually arrive in pieces, continue where we left off
+                    asyncEventArgs.SetBuffer(clientContext.Data, clientContext.ReceivedBytes, clientContext.ExpectedBytes - clientContext.ReceivedBytes);
+                }
 
-                    if (!disconnect)
-                    {
-                        bool blocking = clientContext.Socket.ReceiveAsync(asyncEventArgs);
+                if (!disconnect)
+                {
+                    bool blocking = clientContext.Socket.ReceiveAsync(asyncEventArgs);
 
-                        if (!blocking)
-                            ProcessReceive(asyncEventArgs);
-                    }
+                    if (!blocking)
+                        ProcessReceive(asyncEventArgs);
                 }
             }
             else
@@ -0,0 +1,184 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO.MemoryMappedFiles;
+using System.Threading;
+
+namespace Birdie.Network
+{
+    /// <summary>
+    /// Reads the chunks of a client that sends through a shared-memory ring instead of its socket.
+    /// The ring carries the same byte stream as the socket would, starting at the first chunk size.
+    /// </summary>
+    internal class SharedMemoryChannel
+    {
+        #region Delegates, Events
+        public delegate void ChunkDelegate(ClientContext clientContext, byte[] data);
+        #endregion
+
+        #region Methods
+        /// <summary>
+        /// Attaches to the ring of a client and starts reading it.
+        /// </summary>
+        /// <returns>The channel, or null if the ring could not be opened.</returns>
+        public static SharedMemoryChannel Open(ClientContext clientContext, string name, int capacity, ChunkDelegate onChunkReceived)
+        {
+            // The capacity has to be a power of two, or the cursors can't be masked
+            if (capacity <= 0 || (capacity & (capacity - 1)) != 0)
+                return null;
+
+            SharedMemoryChannel channel = new SharedMemoryChannel()
+            {
+                clientContext = clientContext,
+                capacity = capacity,
+                onChunkReceived = onChunkReceived
+            };
+
+            try
+            {
+                channel.mappedFile = MemoryMappedFile.OpenExisting(name);
+                channel.accessor = channel.mappedFile.CreateViewAccessor(0, HeaderSize + capacity);
+                channel.dataEvent = EventWaitHandle.OpenExisting(name + "_Data");
+            }
+            catch (Exception exception)
+            {
+                Debug.WriteLine(String.Format(@"BirdieCore: Opening shared memory {0} failed with exception: {1}", name, exception.ToString()));
+                channel.Close();
+                return null;
+            }
+
+            channel.readThread = new Thread(channel.ReadLoop) { IsBackground = true, Name = "Birdie shared memory reader" };
+            channel.readThread.Start();
+
+            return channel;
+        }
+
+        public void Close()
+        {
+            isStopping = true;
+
+            if (accessor != null)
+            {
+                // Writers give up on the ring as soon as they see this
+                accessor.Write(ReaderClosedOffset, 1);
+            }
+
+            if (dataEvent != null)
+                dataEvent.Set();
+
+            if (readThread != null && readThread != Thread.CurrentThread)
+                readThread.Join(1000);
+
+            if (accessor != null)
+                accessor.Dispose();
+
+            if (mappedFile != null)
+                mappedFile.Dispose();
+
+            if (dataEvent != null)
+                dataEvent.Dispose();
+
+            accessor = null;
+            mappedFile = null;
+            dataEvent = null;
+        }
+
+        private void ReadLoop()
+        {
+            byte[] chunkSizeData = new byte[sizeof(Int32)];
+            byte[] chunkBuffer = new byte[0];
+
+            while (!isStopping)
+            {
+                if (!Read(chunkSizeData, sizeof(Int32)))
+                    break;
+
+                int chunkSize = BitConverter.ToInt32(chunkSizeData, 0);
+                byte[] chunkData = null;
+
+                // Same as for the socket, a chunk is handled before the next one is read
+                if (chunkSize > ClientContext.MaxReusedChunkSize)
+                    chunkData = new byte[chunkSize];
+                else
+                {
+                    if (chunkBuffer.Length < chunkSize)
+                        chunkBuffer = new byte[chunkSize];
+
+                    chunkData = chunkBuffer;
+                }
+
+                if (!Read(chunkData, chunkSize))
+                    break;
+
+                onChunkReceived(clientContext, chunkData);
+            }
+        }
+
+        /// <summary>
+        /// Fills the buffer from the ring, waiting for the client when it's empty.
+        /// </summary>
+        /// <returns>False if the channel was closed in the meantime.</returns>
+        private bool Read(byte[] buffer, int count)
+        {
+            int bytesRead = 0;
+
+            while (bytesRead < count)
+            {
+                if (isStopping)
+                    return false;
+
+                long writeCursor = accessor.ReadInt64(WriteCursorOffset);
+                Thread.MemoryBarrier();
+
+                if (writeCursor == readCursor)
+                {
+                    // Announce that we're going to sleep, then check once more to not miss a wake-up
+                    accessor.Write(ReaderSleepingOffset, 1);
+                    Thread.MemoryBarrier();
+
+                    if (accessor.ReadInt64(WriteCursorOffset) == readCursor)
+                        dataEvent.WaitOne(10);
+
+                    accessor.Write(ReaderSleepingOffset, 0);
+                    continue;
+                }
+
+                int offset = (int)(readCursor & (capacity - 1));
+                long bytesAvailable = writeCursor - readCursor;
+
+                int bytesToRead = (int)Math.Min(bytesAvailable, count - bytesRead);
+                bytesToRead = Math.Min(bytesToRead, capacity - offset);
+
+                accessor.ReadArray(HeaderSize + offset, buffer, bytesRead, bytesToRead);
+
+                bytesRead += bytesToRead;
+                readCursor += bytesToRead;
+
+                // Hand the space back to the client once we're done copying
+                Thread.MemoryBarrier();
+                accessor.Write(ReadCursorOffset, readCursor);
+            }
+
+            return true;
+        }
+        #endregion
+
+        #region Fields
+        // Header layout, keep in sync with BIRDIE_SHARED_RING_HEADER
+        private const int WriteCursorOffset = 0;
+        private const int ReadCursorOffset = 64;
+        private const int ReaderSleepingOffset = 128;
+        private const int ReaderClosedOffset = 132;
+        private const int HeaderSize = 256;
+
+        private ClientContext clientContext = null;
+        private ChunkDelegate onChunkReceived = null;
+        private MemoryMappedFile mappedFile = null;
+        private MemoryMappedViewAccessor accessor = null;
+        private EventWaitHandle dataEvent = null;
+        private Thread readThread = null;
+        private int capacity = 0;
+        private long readCursor = 0;
+        private volatile bool isStopping = false;
+        #endregion
+    }
+}
@@ -1,4 +1,5 @@
 ﻿using Birdie.Data;
+using Birdie.Network;
 using Birdie.Watcher;
 using System;
 using System.Collections.Generic;
@@ -36,6 +37,14 @@ namespace Birdie.Process
             watchBaseObjects.Add(watchBaseObject.Handle, watchBaseObject);
         }
 
+        public WatchBaseObject GetWatchBaseObject(UInt32 watchBaseObjectHandle)
+        {
+            WatchBaseObject watchBaseObject = null;
+            watchBaseObjects.TryGetValue(watchBaseObjectHandle, out watchBaseObject);
+
+            return watchBaseObject;
+        }
+
         public WatchBaseObject RemoveAndGetWatchBaseObject(UInt32 watchBaseObjectHandle)
         {
             if (watchBaseObjects.ContainsKey(watchBaseObjectHandle))
@@ -59,6 +68,8 @@ namespace Birdie.Process
         public IntPtr ProcessHandle { get; internal set; }
         public UInt64 ProcessId { get; internal set; }
         public string ProcessName { get; internal set; }
+        public bool IsRemote { get; internal set; }
+        internal ClientContext ClientContext { get; set; }
         public WatchObjectContainer RootWatchBaseObjects { get { return rootWatchBaseObjects; } }
         public DataConverter DataConverter { get { return dataConverter; } }
         #endregion
@@ -0,0 +1,86 @@
+﻿using System;
+
+namespace Birdie.Utility
+{
+    /// <summary>
+    /// Decodes the LZ4 block format, which is what clients compress their frames with
+    /// </summary>
+    public static class Lz4
+    {
+        private const int MinMatch = 4;
+
+        /// <summary>
+        /// Decompresses a block into output, which has to be exactly the uncompressed size.
+        /// </summary>
+        /// <returns>True if the block was valid and filled the output, else false.</returns>
+        public static bool Decompress(byte[] input, int offset, int length, byte[] output)
+        {
+            int inputEnd = offset + length;
+            int outputOffset = 0;
+
+            while (offset < inputEnd)
+            {
+                // Token: literal length (high 4 bits), match length (low 4 bits)
+                int token = input[offset++];
+
+                int literalLength = token >> 4;
+
+                if (literalLength == 15 && !ReadLength(input, ref offset, inputEnd, ref literalLength))
+                    return false;
+
+                if (literalLength > inputEnd - offset || literalLength > output.Length - outputOffset)
+                    return false;
+
+                Buffer.BlockCopy(input, offset, output, outputOffset, literalLength);
+                offset += literalLength;
+                outputOffset += literalLength;
+
+                // The last sequence only has literals
+                if (offset == inputEnd)
+                    break;
+
+                if (inputEnd - offset < sizeof(UInt16))
+                    return false;
+
+                int matchOffset = input[offset] | (input[offset + 1] << 8);
+                offset += sizeof(UInt16);
+
+                int matchLength = token & 0xF;
+
+                if (matchLength == 15 && !ReadLength(input, ref offset, inputEnd, ref matchLength))
+                    return false;
+
+                matchLength += MinMatch;
+
+                if (matchOffset == 0 || matchOffset > outputOffset || matchLength > output.Length - outputOffset)
+                    return false;
+
+                // Matches may overlap what they produce, so they're copied byte by byte
+                int matchPosition = outputOffset - matchOffset;
+
+                for (int i = 0; i < matchLength; i++)
+                    output[outputOffset++] = output[matchPosition++];
+            }
+
+            return outputOffset == output.Length;
+        }
+
+        private static bool ReadLength(byte[] input, ref int offset, int inputEnd, ref int length)
+        {
+            // Every byte adds to the length, anything but 255 ends it
+            int value;
+
+            do
+            {
+                if (offset >= inputEnd)
+                    return false;
+
+                value = input[offset++];
+                length += value;
+            }
+            while (value == 255);
+
+            return true;
+        }
+    }
+}
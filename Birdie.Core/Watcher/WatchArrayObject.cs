@@ -0,0 +1,79 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace Birdie.Watcher
+{
+    /// <summary>
+    /// Describes a field of every element of an array watch.
+    /// </summary>
+    public class ArrayField
+    {
+        #region Properties
+        public string Name { get; internal set; }
+        public string Type { get; internal set; }
+
+        // From the start of the array's data to the field of the first element, and from one element to the next
+        public UInt32 Offset { get; internal set; }
+        public UInt32 Size { get; internal set; }
+        public UInt32 Stride { get; internal set; }
+        #endregion
+    }
+
+    /// <summary>
+    /// This class contains an array the process registered as a single watch. Its data holds every element, they're
+    /// only split out when they're asked for.
+    /// </summary>
+    public class WatchArrayObject : WatchMemoryObject
+    {
+        #region Methods
+        /// <summary>
+        /// Splits the fields of an element out of the data that was last read, each one converted like a watch of its own.
+        /// </summary>
+        /// <param name="index">Index of the element</param>
+        /// <returns>A watch per field, or an empty list if there is no data or the index is out of range</returns>
+        public List<WatchMemoryObject> GetElement(UInt32 index)
+        {
+            List<WatchMemoryObject> fields = new List<WatchMemoryObject>();
+            byte[] data = Data;
+
+            if (data == null || index >= ElementCount)
+                return fields;
+
+            foreach (ArrayField field in Fields)
+            {
+                long fieldOffset = field.Offset + (long)index * field.Stride;
+
+                // Reads of another process' memory may come up short
+                if (fieldOffset + field.Size > data.Length)
+                    continue;
+
+                byte[] fieldData = new byte[field.Size];
+                Buffer.BlockCopy(data, (int)fieldOffset, fieldData, 0, (int)field.Size);
+
+                WatchMemoryObject watchMemoryObject = new WatchMemoryObject()
+                {
+                    ProcessData = ProcessData,
+                    BaseAddress = BaseAddress + (UInt64)fieldOffset,
+                    Name = field.Name,
+                    Type = field.Type,
+                    MaxSize = field.Size,
+                    Handle = Handle,
+                    Parent = this,
+                    Data = fieldData,
+                    LastError = ""
+                };
+
+                watchMemoryObject.DataAsObject = ProcessData.DataConverter.Convert(watchMemoryObject);
+                fields.Add(watchMemoryObject);
+            }
+
+            return fields;
+        }
+        #endregion
+
+        #region Properties
+        public UInt32 ElementCount { get; internal set; }
+        public List<ArrayField> Fields { get; internal set; }
+        #endregion
+    }
+}
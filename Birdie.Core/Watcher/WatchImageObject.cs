@@ -0,0 +1,35 @@
+﻿using System;
+
+namespace Birdie.Watcher
+{
+    public enum PixelFormats
+    {
+        RGBA8 = 0,
+        BGRA8,
+        R8
+    }
+
+    /// <summary>
+    /// This class contains an image a process publishes tile by tile, such as a framebuffer or a debug view.
+    /// </summary>
+    public class WatchImageObject : WatchBaseObject
+    {
+        #region Methods
+        public static int GetPixelSize(PixelFormats format)
+        {
+            return format == PixelFormats.R8 ? 1 : 4;
+        }
+        #endregion
+
+        #region Properties
+        // Sizes are of the image as the process sends it, which may be downscaled
+        public UInt32 Width { get; internal set; }
+        public UInt32 Height { get; internal set; }
+        public PixelFormats Format { get; internal set; }
+        public UInt32 TileSize { get; internal set; }
+
+        // Rows of pixels without any padding, tiles the process didn't send yet are all zero
+        public byte[] Pixels { get; internal set; }
+        #endregion
+    }
+}
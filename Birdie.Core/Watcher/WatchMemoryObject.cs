@@ -14,7 +14,19 @@ namespace Birdie.Watcher
         public void ReadMemory()
         {
             LastError = "";
-            Data = ProcessReader.ReadProcessMemory(this);
+
+            // Published data is pushed by the process itself, only read it out when there is none
+            byte[] publishedData = PublishedData;
+
+            if (publishedData != null)
+                Data = publishedData;
+            else if (ProcessData.IsRemote)
+            {
+                LastError = "Waiting for published data";
+                Data = null;
+            }
+            else
+                Data = ProcessReader.ReadProcessMemory(this);
 
             if (Data != null)
                 DataAsObject = ProcessData.DataConverter.Convert(this);
@@ -29,6 +41,7 @@ namespace Birdie.Watcher
         public UInt64 MaxSize { get; internal set; }
         public string LastError { get; internal set; }
         public byte[] Data { get; internal set; }
+        public byte[] PublishedData { get; internal set; }
 
         public UInt64 BaseAddress 
         { 
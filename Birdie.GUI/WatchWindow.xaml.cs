@@ -46,7 +46,7 @@ namespace Birdie
             {
                 ProcessTabItem processTabItem = processDataToTabDictionary[watchObject.ProcessData];
 
-                if (watchObject.GetType() == typeof(WatchMemoryObject))
+                if (watchObject is WatchMemoryObject)
                     processTabItem.WatcherControl.MonitoredObjects.Add((WatchMemoryObject)watchObject);
             });
         }
@@ -57,7 +57,7 @@ namespace Birdie
             {
                 ProcessTabItem processTabItem = processDataToTabDictionary[watchObject.ProcessData];
 
-                if (watchObject.GetType() == typeof(WatchMemoryObject))
+                if (watchObject is WatchMemoryObject)
                     processTabItem.WatcherControl.MonitoredObjects.Remove((WatchMemoryObject)watchObject);
             });
         }
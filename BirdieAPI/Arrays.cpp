@@ -0,0 +1,198 @@
+#include "Arrays.h"
+#include "StringTable.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+typedef struct
+{
+	BIRDIE_HANDLE handle;
+
+	// Encoded once, the fields never change while the watch lives
+	char*         pLayout;
+	size_t        layoutSize;
+} BIRDIE_ARRAY;
+
+static BIRDIE_ARRAY* g_pArrays = NULL;
+static size_t        g_arrayCount = 0;
+static size_t        g_arrayCapacity = 0;
+
+
+// Prototypes
+
+static const BIRDIE_ARRAY* Birdie_FindArray(BIRDIE_HANDLE handle);
+static void Birdie_DropRemovedArrays();
+static uint64_t Birdie_GetFieldStride(const BIRDIE_ARRAY_DESCRIPTOR* pDescriptor, const BIRDIE_ARRAY_FIELD* pField);
+
+
+// Function implementations
+
+void Birdie_FreeArrays()
+{
+	for (size_t i = 0; i < g_arrayCount; i++)
+		g_deallocFunction(g_pArrays[i].pLayout);
+
+	if (g_pArrays != NULL)
+		g_deallocFunction(g_pArrays);
+
+	g_pArrays = NULL;
+	g_arrayCount = 0;
+	g_arrayCapacity = 0;
+}
+
+size_t Birdie_GetArrayRegionSize(const BIRDIE_ARRAY_DESCRIPTOR* pDescriptor)
+{
+	if (pDescriptor->pName == NULL || pDescriptor->pName[0] == '\0' || pDescriptor->pBase == NULL)
+		return 0;
+
+	if (pDescriptor->elementCount == 0 || pDescriptor->elementCount > 0xFFFFFFFFu)
+		return 0;
+
+	if (pDescriptor->pFields == NULL || pDescriptor->fieldCount == 0 || pDescriptor->fieldCount > BIRDIE_MAX_ARRAY_FIELDS)
+		return 0;
+
+	uint64_t regionSize = 0;
+
+	for (size_t i = 0; i < pDescriptor->fieldCount; i++)
+	{
+		const BIRDIE_ARRAY_FIELD* pField = &pDescriptor->pFields[i];
+
+		if (pField->pName == NULL || pField->type == NULL || pField->dataSizeBytes == 0)
+			return 0;
+
+		if (pField->pName[0] == '\0' || pField->type[0] == '\0')
+			return 0;
+
+		uint64_t stride = Birdie_GetFieldStride(pDescriptor, pField);
+
+		// Elements of a single element array don't need to be apart
+		if (stride == 0 && pDescriptor->elementCount > 1)
+			return 0;
+
+		// Region sizes are sent as 32 bit values, which also keeps this from overflowing
+		if (pField->offset > 0xFFFFFFFFu || pField->dataSizeBytes > 0xFFFFFFFFu || stride > 0xFFFFFFFFu)
+			return 0;
+
+		uint64_t fieldEnd = (uint64_t)pField->offset + (uint64_t)(pDescriptor->elementCount - 1) * stride + pField->dataSizeBytes;
+
+		if (fieldEnd > 0xFFFFFFFFu)
+			return 0;
+
+		if (fieldEnd > regionSize)
+			regionSize = fieldEnd;
+	}
+
+	return (size_t)regionSize;
+}
+
+BIRDIE_ERROR Birdie_AddArray(BIRDIE_HANDLE handle, const BIRDIE_ARRAY_DESCRIPTOR* pDescriptor, const uint32_t* pStringIds)
+{
+	Birdie_DropRemovedArrays();
+
+	if (g_arrayCount == g_arrayCapacity)
+	{
+		size_t newCapacity = g_arrayCapacity == 0 ? 4 : g_arrayCapacity * 2;
+		BIRDIE_ARRAY* pNewArrays = (BIRDIE_ARRAY*)g_allocFunction(newCapacity * sizeof(BIRDIE_ARRAY));
+
+		if (pNewArrays == NULL)
+			return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+		if (g_pArrays != NULL)
+		{
+			memcpy((void*)pNewArrays, (void*)g_pArrays, g_arrayCount * sizeof(BIRDIE_ARRAY));
+			g_deallocFunction(g_pArrays);
+		}
+
+		g_pArrays = pNewArrays;
+		g_arrayCapacity = newCapacity;
+	}
+
+	size_t layoutSize = sizeof(uint32_t) * 2 + pDescriptor->fieldCount * sizeof(uint32_t) * 5;
+	char* pLayout = (char*)g_allocFunction(layoutSize);
+
+	if (pLayout == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	uint32_t elementCount = (uint32_t)pDescriptor->elementCount;
+	uint32_t fieldCount = (uint32_t)pDescriptor->fieldCount;
+
+	size_t offset = 0;
+
+	memcpy((void*)(pLayout + offset), (void*)&elementCount, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pLayout + offset), (void*)&fieldCount, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	// Strides are resolved here, so the tool never needs the stride of the array itself
+	for (size_t i = 0; i < pDescriptor->fieldCount; i++)
+	{
+		const BIRDIE_ARRAY_FIELD* pField = &pDescriptor->pFields[i];
+
+		uint32_t field[5] =
+		{
+			pStringIds[i * 2] | BIRDIE_STRING_ID_FLAG,
+			pStringIds[i * 2 + 1] | BIRDIE_STRING_ID_FLAG,
+			(uint32_t)pField->offset,
+			(uint32_t)pField->dataSizeBytes,
+			(uint32_t)Birdie_GetFieldStride(pDescriptor, pField)
+		};
+
+		memcpy((void*)(pLayout + offset), (void*)field, sizeof(field));
+		offset += sizeof(field);
+	}
+
+	g_pArrays[g_arrayCount].handle = handle;
+	g_pArrays[g_arrayCount].pLayout = pLayout;
+	g_pArrays[g_arrayCount].layoutSize = layoutSize;
+	g_arrayCount++;
+
+	return BIRDIE_SUCCESS;
+}
+
+const char* Birdie_GetArrayLayout(BIRDIE_HANDLE handle, size_t* pSize)
+{
+	const BIRDIE_ARRAY* pArray = Birdie_FindArray(handle);
+
+	if (pArray == NULL)
+		return NULL;
+
+	*pSize = pArray->layoutSize;
+
+	return pArray->pLayout;
+}
+
+static const BIRDIE_ARRAY* Birdie_FindArray(BIRDIE_HANDLE handle)
+{
+	for (size_t i = 0; i < g_arrayCount; i++)
+	{
+		if (g_pArrays[i].handle == handle)
+			return &g_pArrays[i];
+	}
+
+	return NULL;
+}
+
+static void Birdie_DropRemovedArrays()
+{
+	// Same as for images, the handles of removed watches simply aren't live anymore
+	for (size_t i = 0; i < g_arrayCount;)
+	{
+		if (Birdie_FindWatchEntry(g_pArrays[i].handle) != NULL)
+		{
+			i++;
+			continue;
+		}
+
+		g_deallocFunction(g_pArrays[i].pLayout);
+		g_pArrays[i] = g_pArrays[--g_arrayCount];
+	}
+}
+
+static uint64_t Birdie_GetFieldStride(const BIRDIE_ARRAY_DESCRIPTOR* pDescriptor, const BIRDIE_ARRAY_FIELD* pField)
+{
+	// Fields of an array of structures share the stride of the array, those of a structure of arrays have their own
+	return pField->stride != 0 ? pField->stride : pDescriptor->stride;
+}
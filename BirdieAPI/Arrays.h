@@ -0,0 +1,30 @@
+#ifndef BIRDIEAPI_ARRAYS_H
+#define BIRDIEAPI_ARRAYS_H
+
+#include "Birdie.h"
+#include "Platform.h"
+#include "WatchRegistry.h"
+
+// This header contains the fields of array watches.
+// An array is registered as a single watch whose region spans every field of every element, so it's read, published
+// and diffed as one block. The fields are only needed by the tool to split that block into elements, they're kept
+// here so a new connection can be sent them again. Everything here expects the watch registry to be locked.
+
+// Keeps the layout of an AddArrayWatch operation within the scratch buffer
+#define BIRDIE_MAX_ARRAY_FIELDS 256
+
+void Birdie_FreeArrays();
+
+// Returns the size of the region that holds every field of every element, or 0 if the descriptor is malformed
+size_t Birdie_GetArrayRegionSize(const BIRDIE_ARRAY_DESCRIPTOR* pDescriptor);
+
+// Keeps the fields of an array watch that was just registered. pStringIds holds the name and type id of every field.
+// Drops the fields of arrays that were removed since.
+BIRDIE_ERROR Birdie_AddArray(BIRDIE_HANDLE handle, const BIRDIE_ARRAY_DESCRIPTOR* pDescriptor, const uint32_t* pStringIds);
+
+// Returns the fields of an array watch as they're sent, or NULL if the watch isn't an array.
+// The layout is: element count (4b), field count (4b), then every field as: name reference (4b), type reference (4b),
+// offset (4b), size (4b), stride (4b). Offsets are from the base of the watch to the field of the first element.
+const char* Birdie_GetArrayLayout(BIRDIE_HANDLE handle, size_t* pSize);
+
+#endif
@@ -1,13 +1,40 @@
 #include "Birdie.h"
-
+#include "Arrays.h"
+#include "Compression.h"
+#include "CustomTypes.h"
+#include "Images.h"
+#include "LogFormats.h"
+#include "Sampling.h"
+#include "SendQueue.h"
+#include "SharedRing.h"
+#include "Stats.h"
+#include "StringTable.h"
+#include "ThreadContext.h"
+#include "TraceFile.h"
+#include "Transport.h"
+#include "WatchRegistry.h"
+#include "Zones.h"
+
+#include <stdarg.h>
 #include <stdio.h>
-#include <WinSock2.h>
-#include <WS2tcpip.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Maximum amount of spans a single chunk can be gathered from, including the chunk size
+#define BIRDIE_MAX_SEND_BUFFERS 8
+
+// Size of a watch as encoded by Birdie_EncodeWatch: type and name references, parent, handle, base pointer and size
+#define BIRDIE_ENCODED_WATCH_SIZE (sizeof(uint32_t) * 2 + sizeof(BIRDIE_HANDLE) * 2 + sizeof(uint64_t) + sizeof(uint32_t))
+
+// Chunk sizes are sent as 32 bit values, the send queue reserves the top bit of its record headers
+#define BIRDIE_MAX_CHUNK_SIZE   0x7FFFFFF0
 
-// 256k
-#define BIRDIE_SCRATCH_BUFFER_SIZE 262144
+// Larger chunks are cut into fragments, so no queue record, shared ring record or receive buffer of the tool has to
+// hold one in a single piece
+#define BIRDIE_MAX_FRAGMENT_SIZE BIRDIE_SCRATCH_BUFFER_SIZE
 
-typedef int WSA_ERROR;
+// Chunk size, operation type, stream id, operation size and fragment size
+#define BIRDIE_FRAGMENT_HEADER_SIZE (sizeof(uint32_t) * 5)
 
 typedef enum
 {
@@ -16,523 +43,3339 @@ typedef enum
 	RemoveWatchObject = 3,
 	AddCategory = 4,
 	AddLogMessage = 5,
-	AddCustomTypeHandler = 6
+	AddCustomTypeHandler = 6,
+	Batch = 7,
+	AddWatches = 8,
+	RemoveWatchObjects = 9,
+	PublishWatches = 10,
+	UseSharedMemory = 11,
+	AddLogFormat = 12,
+	AddDeferredLogMessage = 13,
+	AddString = 14,
+	UseCompression = 15,
+	Compressed = 16,
+	AddZones = 17,
+	AddSampleWindows = 18,
+	SampleRing = 19,
+	AddImageWatch = 20,
+	ImageTiles = 21,
+	AddArrayWatch = 22,
+	Fragment = 23
 } BIRDIE_OPERATION_TYPE;
 
+// Operations the tool sends to us, every one of them is an operation type (4b) followed by a value (4b)
+typedef enum
+{
+	SharedMemoryAnswer = 1,
+	SetLogLevel = 2,
+	CompressionAnswer = 3,
+	FetchSamples = 4
+} BIRDIE_TOOL_OPERATION_TYPE;
 
-// Global data used for the Birdie tool connection.
+// Sends a single fragment built by Birdie_SendFragments, the header included
+typedef BIRDIE_ERROR (*BIRDIE_FRAGMENT_FUNCTION)(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData);
 
-static BIRDIE_ALLOCATION_FUNCTION	  g_allocFunction = malloc;
-static BIRDIE_DEALLOCATION_FUNCTION  g_deallocFunction = free;
 
-static SOCKET				  g_toolSocket = INVALID_SOCKET;
-static bool					  g_isConnected = false;
-static volatile BIRDIE_HANDLE g_handleCounter = 0;
+// Global data used for the Birdie tool connection.
 
-static WSAData				  g_wsaData;
-static CRITICAL_SECTION       g_csBuffer;
-static char*				  g_topScratchBuffer = NULL;
-static char*				  g_scratchBuffer = NULL;
+// The memory handlers are shared with the other translation units
+BIRDIE_ALLOCATION_FUNCTION	  g_allocFunction = malloc;
+BIRDIE_DEALLOCATION_FUNCTION  g_deallocFunction = free;
+
+static BIRDIE_TRANSPORT*	  g_pTransport = NULL;
+static volatile bool		  g_isConnected = false;
+static bool					  g_isInitialized = false;
+
+// Only guards the transport in blocking mode, encoding happens in per-thread scratch buffers
+static CRITICAL_SECTION       g_csSend;
+
+// Asynchronous sending, the queue is only used while g_senderThread is running
+static size_t				  g_asyncQueueSize = 0;
+static BIRDIE_OVERFLOW_POLICY g_asyncOverflowPolicy = BIRDIE_OVERFLOW_DROP;
+static BIRDIE_SEND_QUEUE	  g_sendQueue;
+static HANDLE				  g_senderThread = NULL;
+static HANDLE				  g_senderWakeEvent = NULL;
+static volatile LONG		  g_senderSleeping = 0;
+static volatile LONG		  g_senderStop = 0;
+
+static volatile bool		  g_isAutoBatching = false;
+static volatile bool		  g_isDeferringLogFormatting = false;
+
+// Messages below the threshold are dropped. It's kept at none while there's no connection, so that it's the only check needed.
+// Exported, so that the log macros can check it without a call.
+volatile int32_t			  g_birdieLogLevelThreshold = BIRDIE_LOG_LEVEL_NONE;
+static BIRDIE_LOG_LEVEL		  g_logLevel = BIRDIE_LOG_LEVEL_TRACE;
+
+// Operations from the tool, they're picked up whenever somebody polls
+static char					  g_toolOperation[sizeof(uint32_t) * 2];
+static size_t				  g_toolOperationSize = 0;
+static volatile LONG		  g_isPollingTool = 0;
+
+// Shared-memory transport, only negotiated for connections to a tool on the same machine
+static size_t				  g_sharedRingSize = 0;
+static BIRDIE_SHARED_RING	  g_sharedRing;
+static bool					  g_isUsingSharedRing = false;
+
+// Frame compression, only negotiated for connections to a tool on another machine
+static size_t				  g_compressionThreshold = 0;
+static BIRDIE_COMPRESSOR	  g_compressor;
+static bool					  g_isCompressing = false;
+
+// Only updated by whoever sends, kept for the statistics
+static BIRDIE_COMPRESSION_STATS g_compressionStats;
+
+// Statistics of the send side, only updated by whoever sends.
+// The published copy is what the watches of Birdie_AddStatsWatches point at.
+static BIRDIE_SEND_STATS	  g_sendStats;
+static BIRDIE_STATS			  g_publishedStats;
+static volatile bool		  g_isPublishingStats = false;
+
+// Sampling of watches, started by the first call to Birdie_SetWatchSampling
+static HANDLE				  g_samplerThread = NULL;
+static HANDLE				  g_samplerWakeEvent = NULL;
+static volatile LONG		  g_samplerStop = 0;
+
+// Reconnecting, only done for connections made by Birdie_Initialize
+static uint32_t				  g_reconnectInitialDelay = 0;
+static uint32_t				  g_reconnectMaxDelay = 0;
+static uint64_t				  g_challengeKey = 0;
+static char*				  g_pReconnectAddress = NULL;
+static char*				  g_pReconnectPort = NULL;
+static HANDLE				  g_reconnectThread = NULL;
+static HANDLE				  g_reconnectEvent = NULL;
+static volatile LONG		  g_reconnectStop = 0;
+
+// Fragments of different chunks may be sent at the same time, each chunk has its own stream
+static volatile LONG		  g_fragmentStreamId = 0;
+
+// Every new connection is sent the whole session state at once, as a single batch.
+// Only used while the session state is locked.
+static char*				  g_pReplayBuffer = NULL;
+static size_t				  g_replayBufferSize = 0;
+static size_t				  g_replaySize = 0;
+static uint32_t				  g_replayCount = 0;
+static size_t				  g_replayWatchesOffset = 0;
+static uint32_t				  g_replayWatchCount = 0;
 
 
 // Prototypes
 
-BIRDIE_HANDLE Birdie_GetNewHandle();
-WSA_ERROR Birdie_SendData(size_t size, bool sendChunkSize = true);
+size_t Birdie_EncodeWatch(char* pBuffer, const BIRDIE_WATCH_DESCRIPTOR* pDescriptor, uint32_t nameReference, uint32_t typeReference, BIRDIE_HANDLE handle);
+BIRDIE_ERROR Birdie_SendWatches(char* pBuffer, size_t size, uint32_t watchCount);
+BIRDIE_ERROR Birdie_SendNewWatches(const BIRDIE_WATCH_DESCRIPTOR* pDescriptors, const uint32_t* pStringIds, size_t count, const BIRDIE_HANDLE* pHandles);
+BIRDIE_ERROR Birdie_SendData(char* pScratchBuffer, size_t size, bool sendChunkSize = true);
+BIRDIE_ERROR Birdie_SendDataV(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
+BIRDIE_ERROR Birdie_SendChunk(const char* pData, size_t totalSize);
+BIRDIE_ERROR Birdie_SendChunkV(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize);
+BIRDIE_ERROR Birdie_SendFragments(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize, size_t maxFragmentSize, BIRDIE_FRAGMENT_FUNCTION pFunction, void* pUserData);
+BIRDIE_ERROR Birdie_QueueFragments(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize);
+BIRDIE_ERROR Birdie_SendFragment(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData);
+BIRDIE_ERROR Birdie_SendRawFragment(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData);
+BIRDIE_ERROR Birdie_CommitFragment(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData);
+BIRDIE_ERROR Birdie_WaitForFragment(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData);
+BIRDIE_ERROR Birdie_SendWholeChunkV(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
+BIRDIE_ERROR Birdie_AppendToBatch(BIRDIE_THREAD_CONTEXT* pContext, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t size);
+BIRDIE_ERROR Birdie_FlushBatch(BIRDIE_THREAD_CONTEXT* pContext);
+BIRDIE_ERROR Birdie_FlushAutoBatches();
+bool Birdie_SendRaw(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
+bool Birdie_SendCompressed(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize);
+bool Birdie_SendToTransport(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
 BIRDIE_ERROR Birdie_RemoveWatchObject(BIRDIE_HANDLE handle);
-
-// Header fuction implementations
-
-BIRDIEAPI BIRDIE_ERROR Birdie_SetMemoryHandlers(BIRDIE_ALLOCATION_FUNCTION allocationFunction, BIRDIE_DEALLOCATION_FUNCTION deallocationFunction)
+BIRDIE_ERROR Birdie_StartSession(uint64_t challengeKey);
+BIRDIE_ERROR Birdie_ResumeSession(BIRDIE_TRANSPORT* pTransport);
+void Birdie_LockSessionState();
+void Birdie_UnlockSessionState();
+BIRDIE_ERROR Birdie_SendHandshake();
+BIRDIE_ERROR Birdie_SendReplay();
+char* Birdie_ReserveReplay(size_t size);
+BIRDIE_ERROR Birdie_AppendToReplay(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
+BIRDIE_ERROR Birdie_ReplayString(const BIRDIE_INTERNED_STRING* pInternedString);
+BIRDIE_ERROR Birdie_ReplayLogFormat(const BIRDIE_LOG_FORMAT* pLogFormat);
+BIRDIE_ERROR Birdie_ReplayCustomType(const BIRDIE_CUSTOM_TYPE* pCustomType);
+BIRDIE_ERROR Birdie_ReplayWatch(const BIRDIE_WATCH_ENTRY* pEntry);
+void Birdie_CloseReplayWatches();
+void Birdie_DiscardAutoBatches();
+void Birdie_OnConnectionLost();
+bool Birdie_StartReconnecting(const char* pAddress, const char* pPort);
+void Birdie_StopReconnecting();
+DWORD WINAPI Birdie_ReconnectThread(LPVOID pParameter);
+BIRDIE_ERROR Birdie_SendDefinition(uint32_t operationType, uint32_t id, const void* pData, size_t length);
+BIRDIE_ERROR Birdie_SendLogFormat(const BIRDIE_LOG_FORMAT* pLogFormat);
+BIRDIE_ERROR Birdie_SendDeferredLogMessage(const BIRDIE_LOG_FORMAT* pLogFormat, BIRDIE_LOG_LEVEL level, uint32_t filterReference, const void* pArguments, size_t argumentsSize);
+BIRDIE_ERROR Birdie_SendLogMessage(BIRDIE_LOG_LEVEL level, uint32_t filterReference, const char* pMessage, size_t messageLength);
+BIRDIE_ERROR Birdie_LogV(BIRDIE_LOG_LEVEL level, uint32_t filterReference, const char* pFormat, va_list args);
+BIRDIE_ERROR Birdie_SendString(const BIRDIE_INTERNED_STRING* pInternedString);
+uint32_t Birdie_GetStringReference(const char* pString);
+BIRDIE_ERROR Birdie_GetFilterReference(const char* pFilter, uint32_t* pFilterReference);
+uint32_t Birdie_GetLogFilterReference(BIRDIE_LOG_FILTER logFilter);
+void Birdie_PollTool();
+void Birdie_HandleToolOperation(uint32_t operationType, uint32_t value);
+bool Birdie_WaitForToolAnswer(uint32_t answerType, uint32_t* pValue);
+bool Birdie_NegotiateSharedRing();
+bool Birdie_NegotiateCompression();
+bool Birdie_StartSender();
+void Birdie_StopSender();
+void Birdie_WakeSender();
+DWORD WINAPI Birdie_SenderThread(LPVOID pParameter);
+void Birdie_RefreshPublishedStats();
+bool Birdie_StartSampler();
+void Birdie_StopSampler();
+DWORD WINAPI Birdie_SamplerThread(LPVOID pParameter);
+BIRDIE_ERROR Birdie_SampleWatches(LONGLONG now, LONGLONG* pNextSample);
+void Birdie_SendSampleRings();
+BIRDIE_ERROR Birdie_RecordZoneEvent(BIRDIE_ZONE zone, BIRDIE_ZONE_EVENT_KIND kind);
+BIRDIE_ERROR Birdie_FlushZones(BIRDIE_THREAD_CONTEXT* pContext);
+void Birdie_FlushAllZones();
+
+inline bool Birdie_IsBelowLogLevel(BIRDIE_LOG_LEVEL level)
 {
-	if (allocationFunction == NULL || deallocationFunction == NULL)
-		return BIRDIE_ERROR_INVALID_PARAMS;
-
-	g_allocFunction = allocationFunction;
-	g_deallocFunction = deallocationFunction;
-
-	return BIRDIE_SUCCESS;
+	return (int32_t)level < g_birdieLogLevelThreshold;
 }
 
-BIRDIEAPI BIRDIE_ERROR Birdie_Initialize(uint64_t challengeKey, const char* pAddress, const char* pPort)
+inline void Birdie_CountOperation(BIRDIE_THREAD_CONTEXT* pContext, uint32_t operationType, size_t size)
 {
-	// Initialize WinSock
-	WSA_ERROR wsaError = WSAStartup(MAKEWORD(2, 0), &g_wsaData);
-
-	if (wsaError != 0)
-		return BIRDIE_ERROR_COULD_NOT_CONNECT;
-
-	addrinfo hints;
-
-	memset(&hints, 0, sizeof(hints));
-	hints.ai_family = AF_UNSPEC;
-	hints.ai_socktype = SOCK_STREAM;
+	if (pContext == NULL)
+		return;
 
-	addrinfo* serverInfo;
-	WSA_ERROR getAddrInfoError = getaddrinfo(pAddress, pPort, &hints, &serverInfo);
+	BIRDIE_STATS_OPERATION_KIND kind = BIRDIE_STATS_METADATA;
 
-	if (getAddrInfoError != 0)
-		return BIRDIE_ERROR_COULD_NOT_CONNECT;
-
-	addrinfo* connection = NULL;
-
-	// Loop through network interfaces to find one that can make a valid connection
-	for (connection = serverInfo; connection != NULL; connection = connection->ai_next)
+	switch (operationType)
 	{
-		if ((g_toolSocket = socket(connection->ai_family, connection->ai_socktype, connection->ai_protocol)) == INVALID_SOCKET)
-			continue;
-
-		if (connect(g_toolSocket, connection->ai_addr, (int)connection->ai_addrlen) != 0)
-		{
-			shutdown(g_toolSocket, SD_BOTH);
-			continue;
-		}
-
+	case AddLogMessage:
+	case AddDeferredLogMessage:
+		kind = BIRDIE_STATS_LOG;
+		break;
+	case AddWatch:
+	case AddWatches:
+	case AddCategory:
+	case AddImageWatch:
+	case AddArrayWatch:
+		kind = BIRDIE_STATS_WATCH;
+		break;
+	case RemoveWatchObject:
+	case RemoveWatchObjects:
+		kind = BIRDIE_STATS_REMOVE;
+		break;
+	case PublishWatches:
+	case AddSampleWindows:
+	case SampleRing:
+	case ImageTiles:
+		kind = BIRDIE_STATS_PUBLISH;
+		break;
+	case AddZones:
+		kind = BIRDIE_STATS_ZONE;
 		break;
 	}
 
-	if (connection == NULL)
-	{
-		g_toolSocket = INVALID_SOCKET;
-		return BIRDIE_ERROR_COULD_NOT_CONNECT;
-	}
-
-	// Disable Nagle's algorithm, failure should not be fatal
-	int optVal = 1;
-	setsockopt(g_toolSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&optVal, (int) sizeof(optVal));
-
-	freeaddrinfo(serverInfo);
-
-	// We're connected, let's initialize all of the other stuff
-	g_handleCounter = 0;
-	g_isConnected = true;
-
-	InitializeCriticalSection(&g_csBuffer);
+	pContext->stats.operationCounts[kind]++;
+	pContext->stats.encodedBytes += size;
+}
 
-	// Lets initialize the scratch buffers
-	g_topScratchBuffer = (char*)g_allocFunction(BIRDIE_SCRATCH_BUFFER_SIZE + sizeof(uint32_t));
-	g_scratchBuffer = g_topScratchBuffer + sizeof(uint32_t);
+// Header fuction implementations
 
-	// Now, send the challenge
-	memcpy((void*)g_scratchBuffer, &challengeKey, sizeof(uint64_t));
-	Birdie_SendData(sizeof(uint64_t), false);
+BIRDIEAPI BIRDIE_ERROR Birdie_SetMemoryHandlers(BIRDIE_ALLOCATION_FUNCTION allocationFunction, BIRDIE_DEALLOCATION_FUNCTION deallocationFunction)
+{
+	if (allocationFunction == NULL || deallocationFunction == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	// And the process info
-	uint64_t processId = (uint64_t)GetCurrentProcessId();
+	g_allocFunction = allocationFunction;
+	g_deallocFunction = deallocationFunction;
 
-	size_t offset = 0;
-	uint32_t operationType = RegisterProcess;
+	return BIRDIE_SUCCESS;
+}
 
-	memcpy((void*)(g_scratchBuffer + offset), &operationType, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+BIRDIEAPI BIRDIE_ERROR Birdie_SetAsyncMode(size_t queueSizeBytes, BIRDIE_OVERFLOW_POLICY overflowPolicy)
+{
+	if (g_isInitialized)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	memcpy((void*)(g_scratchBuffer + offset), &processId, sizeof(uint64_t));
-	offset += sizeof(uint64_t);
+	if (overflowPolicy != BIRDIE_OVERFLOW_DROP && overflowPolicy != BIRDIE_OVERFLOW_BLOCK && overflowPolicy != BIRDIE_OVERFLOW_GROW)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	Birdie_SendData(offset);
+	g_asyncQueueSize = queueSizeBytes;
+	g_asyncOverflowPolicy = overflowPolicy;
 
 	return BIRDIE_SUCCESS;
 }
 
-BIRDIEAPI BIRDIE_ERROR Birdie_Terminate(void)
+BIRDIEAPI BIRDIE_ERROR Birdie_SetSharedMemoryMode(size_t ringSizeBytes)
 {
-	if (g_isConnected == false)
-		return BIRDIE_ERROR_NOT_CONNECTED;
+	if (g_isInitialized)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	// Shut down our socket and WinSock
-	shutdown(g_toolSocket, SD_BOTH);
-	closesocket(g_toolSocket);
-	WSACleanup();
+	g_sharedRingSize = ringSizeBytes;
 
-	// Clean up the extra stuff
-	// Enter our buffer critical section in order to make sure it's removable
-	EnterCriticalSection(&g_csBuffer);
-	LeaveCriticalSection(&g_csBuffer);
-	DeleteCriticalSection(&g_csBuffer);
+	return BIRDIE_SUCCESS;
+}
 
-	// Only need to clear the top, since the other one is an alias
-	g_deallocFunction(g_topScratchBuffer);
+BIRDIEAPI BIRDIE_ERROR Birdie_SetCompressionMode(size_t thresholdBytes)
+{
+	if (g_isInitialized)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	g_handleCounter = 0;
+	g_compressionThreshold = thresholdBytes;
 
 	return BIRDIE_SUCCESS;
 }
 
-BIRDIEAPI BIRDIE_ERROR Birdie_AddWatchCategory(const char* pName, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+BIRDIEAPI BIRDIE_ERROR Birdie_SetReconnectMode(uint32_t initialDelayMs, uint32_t maxDelayMs)
 {
-	if (pHandle == NULL || pName == NULL)
+	if (g_isInitialized)
 		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	*pHandle = Birdie_GetNewHandle();
+	if (initialDelayMs > 0 && maxDelayMs < initialDelayMs)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	if (g_isConnected == false)
-		return BIRDIE_ERROR_NOT_CONNECTED;
+	g_reconnectInitialDelay = initialDelayMs;
+	g_reconnectMaxDelay = maxDelayMs;
 
-	size_t nameLength = strlen(pName);
+	return BIRDIE_SUCCESS;
+}
 
-	if (nameLength == 0)
+BIRDIEAPI BIRDIE_ERROR Birdie_Initialize(uint64_t challengeKey, const char* pAddress, const char* pPort)
+{
+	if (g_isInitialized)
 		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	size_t totalSize =
-		sizeof(uint32_t) +
-		sizeof(uint32_t) +
-		nameLength +
-		sizeof(BIRDIE_HANDLE) +
-		sizeof(BIRDIE_HANDLE);
-
-	if (totalSize > BIRDIE_SCRATCH_BUFFER_SIZE)
-		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	g_pTransport = Birdie_CreateSocketTransport(pAddress, pPort);
 
-	size_t offset = 0;
-	uint32_t operationType = AddCategory;
+	if (g_pTransport == NULL)
+		return BIRDIE_ERROR_COULD_NOT_CONNECT;
 
-	EnterCriticalSection(&g_csBuffer);
+	BIRDIE_ERROR error = Birdie_StartSession(challengeKey);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&operationType, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	// Without the background thread a lost connection simply stays lost
+	if (error == BIRDIE_SUCCESS && g_reconnectInitialDelay > 0)
+		Birdie_StartReconnecting(pAddress, pPort);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&nameLength, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	return error;
+}
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)pName, nameLength);
-	offset += nameLength;
+BIRDIEAPI BIRDIE_ERROR Birdie_InitializeWithSink(BIRDIE_SINK_FUNCTION sinkFunction, void* pUserData)
+{
+	if (sinkFunction == NULL || g_isInitialized)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&parent, sizeof(BIRDIE_HANDLE));
-	offset += sizeof(BIRDIE_HANDLE);
+	g_pTransport = Birdie_CreateSinkTransport(sinkFunction, pUserData);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)pHandle, sizeof(BIRDIE_HANDLE));
-	offset += sizeof(BIRDIE_HANDLE);
+	if (g_pTransport == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
 
-	WSA_ERROR wsaError = Birdie_SendData(offset);
+	// Nobody checks the challenge, the stream is otherwise identical to what the tool would receive
+	return Birdie_StartSession(0);
+}
 
-	LeaveCriticalSection(&g_csBuffer);
+BIRDIEAPI BIRDIE_ERROR Birdie_InitializeWithTraceFile(uint64_t challengeKey, const char* pPath, size_t segmentSizeBytes)
+{
+	if (pPath == NULL || g_isInitialized)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	if (wsaError != 0)
-		return BIRDIE_ERROR_NOT_CONNECTED;
+	g_pTransport = Birdie_CreateTraceTransport(pPath, segmentSizeBytes);
 
-	return BIRDIE_SUCCESS;
-}
+	if (g_pTransport == NULL)
+		return BIRDIE_ERROR_COULD_NOT_CONNECT;
 
-BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatchCategory(BIRDIE_HANDLE handle)
-{
-	return Birdie_RemoveWatchObject(handle);
+	// The challenge is recorded as well, so the trace can be replayed into a tool expecting it
+	return Birdie_StartSession(challengeKey);
 }
 
-BIRDIEAPI BIRDIE_ERROR Birdie_AddWatch(const char* pName, BIRDIE_TYPE type, void* pBase, size_t dataSizeBytes, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+BIRDIEAPI BIRDIE_ERROR Birdie_ReplayTraceFile(const char* pPath, const char* pAddress, const char* pPort, float speed)
 {
-	if (pName == NULL || type == NULL || pBase == NULL || dataSizeBytes == 0)
+	if (pPath == NULL || pAddress == NULL || pPort == NULL || speed < 0.0f)
 		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	BIRDIE_HANDLE newHandle = Birdie_GetNewHandle();
+	// Has nothing to do with the session, the replay makes a connection of its own
+	BIRDIE_TRANSPORT* pTransport = Birdie_CreateSocketTransport(pAddress, pPort);
 
-	if (pHandle)
-		*pHandle = newHandle;
-
-	if (g_isConnected == false)
-		return BIRDIE_ERROR_NOT_CONNECTED;
+	if (pTransport == NULL)
+		return BIRDIE_ERROR_COULD_NOT_CONNECT;
 
-	size_t nameLength = strlen(pName);
+	BIRDIE_ERROR error = Birdie_ReplayTrace(pPath, pTransport, speed);
 
-	if (nameLength == 0)
-		return BIRDIE_ERROR_INVALID_PARAMS;
+	pTransport->pClose(pTransport);
 
-	size_t typeLength = strlen(type);
+	return error;
+}
 
-	if (typeLength == 0)
+BIRDIEAPI BIRDIE_ERROR Birdie_ReplayTraceFileToSink(const char* pPath, BIRDIE_SINK_FUNCTION sinkFunction, void* pUserData, float speed)
+{
+	if (pPath == NULL || sinkFunction == NULL || speed < 0.0f)
 		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	size_t totalSize =
-		sizeof(uint32_t) +
-		sizeof(uint32_t) +
-		nameLength +
-		sizeof(uint32_t) +
-		typeLength +
-		sizeof(BIRDIE_HANDLE) +
-		sizeof(BIRDIE_HANDLE) +
-		sizeof(uint64_t) +
-		sizeof(uint32_t);
+	BIRDIE_TRANSPORT* pTransport = Birdie_CreateSinkTransport(sinkFunction, pUserData);
 
-	if (totalSize > BIRDIE_SCRATCH_BUFFER_SIZE)
+	if (pTransport == NULL)
 		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
 
-	uint64_t basePtr64 = (uint64_t)pBase;
+	BIRDIE_ERROR error = Birdie_ReplayTrace(pPath, pTransport, speed);
 
-	size_t offset = 0;
-	uint32_t operationType = AddWatch;
+	pTransport->pClose(pTransport);
 
-	EnterCriticalSection(&g_csBuffer);
+	return error;
+}
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&operationType, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+BIRDIEAPI BIRDIE_ERROR Birdie_Terminate(void)
+{
+	if (g_isInitialized == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&typeLength, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	// Nothing may replace the transport from here on
+	Birdie_StopReconnecting();
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)type, typeLength);
-	offset += typeLength;
+	// Sampled watches are read until the sampler thread is gone
+	Birdie_StopSampler();
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&nameLength, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	// The sender thread may have lost the connection already, but still needs to be cleaned up
+	bool wasConnected = g_isConnected;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)pName, nameLength);
-	offset += nameLength;
+	// Send whatever is still queued before closing the connection
+	Birdie_StopSender();
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&parent, sizeof(BIRDIE_HANDLE));
-	offset += sizeof(BIRDIE_HANDLE);
+	// The tool sees the connection close right away, give it a chance to read the rest of the ring first
+	if (g_isUsingSharedRing && g_isConnected)
+		Birdie_DrainSharedRing(&g_sharedRing, 1000);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&newHandle, sizeof(BIRDIE_HANDLE));
-	offset += sizeof(BIRDIE_HANDLE);
+	g_isConnected = false;
+	g_isInitialized = false;
+	g_birdieLogLevelThreshold = BIRDIE_LOG_LEVEL_NONE;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&basePtr64, sizeof(uint64_t));
-	offset += sizeof(uint64_t);
+	g_pTransport->pClose(g_pTransport);
+	g_pTransport = NULL;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&dataSizeBytes, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	if (g_isUsingSharedRing)
+	{
+		Birdie_DestroySharedRing(&g_sharedRing);
+		g_isUsingSharedRing = false;
+	}
 
-	WSA_ERROR wsaError = Birdie_SendData(offset);
+	g_isCompressing = false;
+	Birdie_DestroyCompressor(&g_compressor);
 
-	LeaveCriticalSection(&g_csBuffer);
+	g_isPublishingStats = false;
 
-	if (wsaError != 0)
+	// Clean up the extra stuff
+	// Enter our send critical section in order to make sure it's removable
+	EnterCriticalSection(&g_csSend);
+	LeaveCriticalSection(&g_csSend);
+	DeleteCriticalSection(&g_csSend);
+
+	Birdie_FreeThreadContexts();
+	Birdie_FreeSampling();
+	Birdie_FreeImages();
+	Birdie_FreeArrays();
+	Birdie_FreeWatchRegistry();
+	Birdie_FreeLogFormats();
+	Birdie_FreeStringTable();
+	Birdie_FreeCustomTypes();
+
+	if (wasConnected == false)
 		return BIRDIE_ERROR_NOT_CONNECTED;
 
 	return BIRDIE_SUCCESS;
 }
 
-BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatch(BIRDIE_HANDLE handle)
-{
-	return Birdie_RemoveWatchObject(handle);
-}
-
-BIRDIEAPI BIRDIE_ERROR Birdie_Log(const char* pFilter, const char* pMessage)
+BIRDIEAPI BIRDIE_ERROR Birdie_Flush(void)
 {
 	if (g_isConnected == false)
 		return BIRDIE_ERROR_NOT_CONNECTED;
 
-	if (pMessage == NULL)
-		return BIRDIE_ERROR_INVALID_PARAMS;
-
-	const char* filter = "";
-
-	if (pFilter != NULL)
-		filter = pFilter;
-
-	size_t filterLength = strlen(filter);
-	size_t messageLength = strlen(pMessage);
-
-	size_t totalSize =
-		sizeof(uint32_t) +
-		sizeof(uint32_t) +
-		filterLength +
-		sizeof(uint32_t) +
-		messageLength;
-
-	if (totalSize > BIRDIE_SCRATCH_BUFFER_SIZE)
-		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	Birdie_PollTool();
+	Birdie_FlushAllZones();
+	Birdie_FlushAutoBatches();
 
-	size_t offset = 0;
-	uint32_t operationType = AddLogMessage;
+	if (g_senderThread == NULL)
+		return BIRDIE_SUCCESS;
 
-	EnterCriticalSection(&g_csBuffer);
+	BIRDIE_QUEUE_SEGMENT* pSegment = NULL;
+	LONGLONG flushTicket = Birdie_QueueGetFlushTicket(&g_sendQueue, &pSegment);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&operationType, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	Birdie_WakeSender();
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&messageLength, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	// Spin for a bit first, most flushes only have to wait for a handful of sends
+	for (int spinCount = 0; Birdie_AtomicLoad64(&pSegment->readCursor) < flushTicket; spinCount++)
+	{
+		if (g_isConnected == false)
+			return BIRDIE_ERROR_NOT_CONNECTED;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)pMessage, messageLength);
-	offset += messageLength;
+		if (spinCount < 64)
+			SwitchToThread();
+		else
+			Sleep(1);
+	}
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&filterLength, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	return BIRDIE_SUCCESS;
+}
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)filter, filterLength);
-	offset += filterLength;
+BIRDIEAPI BIRDIE_ERROR Birdie_BeginBatch(void)
+{
+	if (g_isConnected == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
 
-	WSA_ERROR wsaError = Birdie_SendData(offset);
+	BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
 
-	LeaveCriticalSection(&g_csBuffer);
+	if (pContext == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
 
-	if (wsaError != 0)
-		return BIRDIE_ERROR_NOT_CONNECTED;
+	pContext->batchDepth++;
 
 	return BIRDIE_SUCCESS;
 }
 
-BIRDIEAPI BIRDIE_ERROR Birdie_LogF(const char* pFilter, const char* pFormat, ...)
+BIRDIEAPI BIRDIE_ERROR Birdie_EndBatch(void)
 {
-	if (g_isConnected == false)
-		return BIRDIE_ERROR_NOT_CONNECTED;
+	BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
 
-	if (pFormat == NULL)
+	if (pContext == NULL || pContext->batchDepth == 0)
 		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	const char* filter = "";
+	pContext->batchDepth--;
 
-	if (pFilter != NULL)
-		filter = pFilter;
+	// With automatic batching the batch just stays open until the end of the frame
+	if (pContext->batchDepth > 0 || g_isAutoBatching)
+		return BIRDIE_SUCCESS;
 
-	size_t filterLength = strlen(filter);
-	size_t formatLength = strlen(pFormat);
+	while (InterlockedExchange(&pContext->batchLock, 1) != 0)
+		YieldProcessor();
 
-	size_t approximateTotalSize =
-		sizeof(uint32_t) +
-		sizeof(uint32_t) +
-		filterLength +
-		sizeof(uint32_t) +
-		formatLength * 2;
+	BIRDIE_ERROR error = Birdie_FlushBatch(pContext);
 
-	if (approximateTotalSize > BIRDIE_SCRATCH_BUFFER_SIZE)
-		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	InterlockedExchange(&pContext->batchLock, 0);
 
-	size_t offset = 0;
-	size_t messageLengthOffset = 0;
-	size_t messageLength = 0;
-	uint32_t operationType = AddLogMessage;
+	return error;
+}
 
-	EnterCriticalSection(&g_csBuffer);
+BIRDIEAPI BIRDIE_ERROR Birdie_SetAutoBatching(bool enabled)
+{
+	g_isAutoBatching = enabled;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&operationType, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	if (!enabled && g_isConnected)
+		Birdie_FlushAutoBatches();
 
-	// Skip message length for now
-	messageLengthOffset = offset;
-	offset += sizeof(uint32_t);
+	return BIRDIE_SUCCESS;
+}
 
-	va_list args;
-	va_start(args, pFormat);
+BIRDIEAPI BIRDIE_ERROR Birdie_EndFrame(void)
+{
+	if (g_isConnected == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
 
-	messageLength = (size_t)vsprintf((char*)(g_scratchBuffer + offset), pFormat, args);
-	va_end(args);
+	Birdie_PollTool();
 
-	offset += messageLength;
+	if (g_isPublishingStats)
+		Birdie_RefreshPublishedStats();
 
-	memcpy((void*)(g_scratchBuffer + messageLengthOffset), (void*)&messageLength, sizeof(uint32_t));
+	Birdie_FlushAllZones();
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&filterLength, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	return Birdie_FlushAutoBatches();
+}
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)filter, filterLength);
-	offset += filterLength;
+BIRDIEAPI BIRDIE_ERROR Birdie_AddWatchCategory(const char* pName, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+{
+	if (pHandle == NULL || pName == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	WSA_ERROR wsaError = Birdie_SendData(offset);
+	*pHandle = 0;
 
-	LeaveCriticalSection(&g_csBuffer);
+	if (pName[0] == '\0')
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	if (wsaError != 0)
-		return BIRDIE_ERROR_NOT_CONNECTED;
+	// Names repeat a lot across categories, they're sent as interned strings.
+	// The registry keeps the id as well, for when the category has to be sent again.
+	uint32_t nameReference = Birdie_GetStringReference(pName);
 
-	return BIRDIE_SUCCESS;
-}
+	if (nameReference == 0)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	// Categories have no data, they're only registered so their children can be removed with them
+	BIRDIE_ERROR error = Birdie_AddWatchEntry(parent, nameReference & ~BIRDIE_STRING_ID_FLAG, 0, NULL, 0, pHandle);
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
 
-BIRDIE_ERROR Birdie_AddCustomTypeHandler(BIRDIE_TYPE type, const char* handlerCode)
-{
 	if (g_isConnected == false)
 		return BIRDIE_ERROR_NOT_CONNECTED;
 
-	uint32_t typeLength = (uint32_t)strlen(type);
-	uint32_t codeLength = (uint32_t)strlen(handlerCode);
-
-	size_t totalSize = 
-		sizeof(uint32_t) + 
-		sizeof(uint32_t) +
+	size_t totalSize =
 		sizeof(uint32_t) +
-		typeLength +
 		sizeof(uint32_t) +
-		codeLength;
-
-	if (totalSize > BIRDIE_SCRATCH_BUFFER_SIZE)
-		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+		sizeof(BIRDIE_HANDLE) +
+		sizeof(BIRDIE_HANDLE);
 
 	size_t offset = 0;
-	uint32_t operationType = AddCustomTypeHandler;
+	uint32_t operationType = AddCategory;
 
-	EnterCriticalSection(&g_csBuffer);
+	char* pBuffer = Birdie_GetScratchBuffer(totalSize);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&operationType, sizeof(uint32_t));
-	offset += sizeof(uint32_t);
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&typeLength, sizeof(uint32_t));
+	memcpy((void*)(pBuffer + offset), (void*)&operationType, sizeof(uint32_t));
 	offset += sizeof(uint32_t);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)type, typeLength);
-	offset += typeLength;
-
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&codeLength, sizeof(uint32_t));
+	memcpy((void*)(pBuffer + offset), (void*)&nameReference, sizeof(uint32_t));
 	offset += sizeof(uint32_t);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)handlerCode, codeLength);
-	offset += codeLength;
-
-	WSA_ERROR wsaError = Birdie_SendData(offset);
-
-	LeaveCriticalSection(&g_csBuffer);
+	memcpy((void*)(pBuffer + offset), (void*)&parent, sizeof(BIRDIE_HANDLE));
+	offset += sizeof(BIRDIE_HANDLE);
 
-	if (wsaError != 0)
-		return BIRDIE_ERROR_NOT_CONNECTED;
+	memcpy((void*)(pBuffer + offset), (void*)pHandle, sizeof(BIRDIE_HANDLE));
+	offset += sizeof(BIRDIE_HANDLE);
 
-	return BIRDIE_SUCCESS;
+	return Birdie_SendData(pBuffer, offset);
 }
 
-BIRDIE_HANDLE Birdie_GetNewHandle()
+BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatchCategory(BIRDIE_HANDLE handle)
 {
-	return (BIRDIE_HANDLE)InterlockedIncrement(&g_handleCounter);
+	return Birdie_RemoveWatchObject(handle);
 }
 
-WSA_ERROR Birdie_SendData(size_t size, bool sendChunkSize)
+BIRDIEAPI BIRDIE_ERROR Birdie_AddWatch(const char* pName, BIRDIE_TYPE type, void* pBase, size_t dataSizeBytes, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
 {
-	if (!g_isConnected)
-		return SOCKET_ERROR;
+	if (pHandle)
+		*pHandle = 0;
 
-	size_t startOffset = 0;
-	size_t totalSize = size;
+	if (pName == NULL || type == NULL || pBase == NULL || dataSizeBytes == 0)
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	if (sendChunkSize)
-	{
-		totalSize += sizeof(uint32_t);
-		*((uint32_t*)g_topScratchBuffer) = (uint32_t)size;
-	}
-	else
-		startOffset = sizeof(uint32_t);
+	if (pName[0] == '\0' || type[0] == '\0')
+		return BIRDIE_ERROR_INVALID_PARAMS;
 
-	size_t bytesRemaining = totalSize;
+	uint32_t nameReference = Birdie_GetStringReference(pName);
+	uint32_t typeReference = Birdie_GetStringReference(type);
 
-	while (bytesRemaining > 0)
-	{
-		WSA_ERROR bytesSent = send(g_toolSocket, (const char*)(g_topScratchBuffer + startOffset + (totalSize - bytesRemaining)), (int)bytesRemaining, 0);
+	if (nameReference == 0 || typeReference == 0)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
 
-		if (bytesSent == SOCKET_ERROR)
-			return WSAGetLastError();
+	BIRDIE_HANDLE newHandle = 0;
+	BIRDIE_ERROR error = Birdie_AddWatchEntry(parent, nameReference & ~BIRDIE_STRING_ID_FLAG, typeReference & ~BIRDIE_STRING_ID_FLAG, pBase, dataSizeBytes, &newHandle);
 
-		bytesRemaining -= (size_t)bytesSent;
-	}
+	if (error != BIRDIE_SUCCESS)
+		return error;
 
-	return 0;
-}
+	if (pHandle)
+		*pHandle = newHandle;
 
-BIRDIE_ERROR Birdie_RemoveWatchObject(BIRDIE_HANDLE handle)
-{
 	if (g_isConnected == false)
 		return BIRDIE_ERROR_NOT_CONNECTED;
 
-	size_t offset = 0;
-	uint32_t operationType = RemoveWatchObject;
+	size_t totalSize =
+		sizeof(uint32_t) +
+		BIRDIE_ENCODED_WATCH_SIZE;
+
+	BIRDIE_WATCH_DESCRIPTOR descriptor = { pName, type, pBase, dataSizeBytes, parent };
+
+	size_t offset = 0;
+	uint32_t operationType = AddWatch;
+
+	char* pBuffer = Birdie_GetScratchBuffer(totalSize);
+
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	memcpy((void*)(pBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	offset += Birdie_EncodeWatch(pBuffer + offset, &descriptor, nameReference, typeReference, newHandle);
+
+	return Birdie_SendData(pBuffer, offset);
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatch(BIRDIE_HANDLE handle)
+{
+	return Birdie_RemoveWatchObject(handle);
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_AddWatches(const BIRDIE_WATCH_DESCRIPTOR* pDescriptors, size_t count, LPBIRDIE_HANDLE pHandles)
+{
+	if (pDescriptors == NULL || count == 0)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	// Validate everything up front, so we never end up with half of the watches registered
+	for (size_t i = 0; i < count; i++)
+	{
+		const BIRDIE_WATCH_DESCRIPTOR* pDescriptor = &pDescriptors[i];
+
+		if (pDescriptor->pName == NULL || pDescriptor->type == NULL || pDescriptor->pBase == NULL || pDescriptor->dataSizeBytes == 0)
+			return BIRDIE_ERROR_INVALID_PARAMS;
+
+		if (pDescriptor->pName[0] == '\0' || pDescriptor->type[0] == '\0')
+			return BIRDIE_ERROR_INVALID_PARAMS;
+	}
+
+	// The name and type ids of every watch, followed by the handles if the caller doesn't want them.
+	// The handles are needed for encoding either way.
+	size_t stringIdsSize = count * 2 * sizeof(uint32_t);
+	uint32_t* pStringIds = (uint32_t*)g_allocFunction(stringIdsSize + (pHandles == NULL ? count * sizeof(BIRDIE_HANDLE) : 0));
+
+	if (pStringIds == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	LPBIRDIE_HANDLE pNewHandles = pHandles != NULL ? pHandles : (LPBIRDIE_HANDLE)((char*)pStringIds + stringIdsSize);
+	BIRDIE_ERROR error = BIRDIE_SUCCESS;
+
+	for (size_t i = 0; i < count && error == BIRDIE_SUCCESS; i++)
+	{
+		pStringIds[i * 2] = Birdie_InternString(pDescriptors[i].pName, strlen(pDescriptors[i].pName), Birdie_SendString);
+		pStringIds[i * 2 + 1] = Birdie_InternString(pDescriptors[i].type, strlen(pDescriptors[i].type), Birdie_SendString);
+
+		if (pStringIds[i * 2] == 0 || pStringIds[i * 2 + 1] == 0)
+			error = BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	if (error == BIRDIE_SUCCESS)
+		error = Birdie_AddWatchEntries(pDescriptors, pStringIds, count, pNewHandles);
+
+	if (error != BIRDIE_SUCCESS)
+	{
+		if (pHandles != NULL)
+			memset((void*)pHandles, 0, count * sizeof(BIRDIE_HANDLE));
+	}
+	else if (g_isConnected == false)
+		error = BIRDIE_ERROR_NOT_CONNECTED;
+	else
+		error = Birdie_SendNewWatches(pDescriptors, pStringIds, count, pNewHandles);
+
+	g_deallocFunction(pStringIds);
+
+	return error;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatches(const BIRDIE_HANDLE* pHandles, size_t count)
+{
+	if (pHandles == NULL || count == 0)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	// Nothing to tell the tool, the watches still have to go
+	if (g_isConnected == false)
+	{
+		for (size_t i = 0; i < count; i++)
+			Birdie_RemoveWatchEntry(pHandles[i]);
+
+		return BIRDIE_ERROR_NOT_CONNECTED;
+	}
+
+	size_t headerSize = sizeof(uint32_t) + sizeof(uint32_t);
+	size_t maxHandlesPerChunk = (BIRDIE_SCRATCH_BUFFER_SIZE - headerSize) / sizeof(BIRDIE_HANDLE);
+
+	size_t i = 0;
+
+	while (i < count)
+	{
+		size_t handleCount = count - i;
+
+		if (handleCount > maxHandlesPerChunk)
+			handleCount = maxHandlesPerChunk;
+
+		char* pBuffer = Birdie_GetScratchBuffer(headerSize + handleCount * sizeof(BIRDIE_HANDLE));
+
+		if (pBuffer == NULL)
+			return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+		// Handles that aren't live are left out. That includes children of a category that was removed earlier in the array.
+		size_t offset = headerSize;
+		uint32_t removedCount = 0;
+
+		for (; i < count && removedCount < handleCount; i++)
+		{
+			if (Birdie_RemoveWatchEntry(pHandles[i]) != BIRDIE_SUCCESS)
+				continue;
+
+			memcpy((void*)(pBuffer + offset), (void*)&pHandles[i], sizeof(BIRDIE_HANDLE));
+			offset += sizeof(BIRDIE_HANDLE);
+
+			removedCount++;
+		}
+
+		if (removedCount == 0)
+			continue;
+
+		uint32_t operationType = RemoveWatchObjects;
+
+		memcpy((void*)pBuffer, (void*)&operationType, sizeof(uint32_t));
+		memcpy((void*)(pBuffer + sizeof(uint32_t)), (void*)&removedCount, sizeof(uint32_t));
+
+		BIRDIE_ERROR error = Birdie_SendData(pBuffer, offset);
+
+		if (error != BIRDIE_SUCCESS)
+			return error;
+	}
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_AddArrayWatch(const BIRDIE_ARRAY_DESCRIPTOR* pDescriptor, LPBIRDIE_HANDLE pHandle)
+{
+	if (pHandle)
+		*pHandle = 0;
+
+	if (pDescriptor == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	size_t dataSizeBytes = Birdie_GetArrayRegionSize(pDescriptor);
+
+	if (dataSizeBytes == 0)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	uint32_t nameReference = Birdie_GetStringReference(pDescriptor->pName);
+	uint32_t typeReference = Birdie_GetStringReference(BIRDIE_TYPE_ARRAY);
+
+	if (nameReference == 0 || typeReference == 0)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	// The name and type id of every field
+	uint32_t* pStringIds = (uint32_t*)g_allocFunction(pDescriptor->fieldCount * 2 * sizeof(uint32_t));
+
+	if (pStringIds == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	BIRDIE_ERROR error = BIRDIE_SUCCESS;
+
+	for (size_t i = 0; i < pDescriptor->fieldCount && error == BIRDIE_SUCCESS; i++)
+	{
+		const BIRDIE_ARRAY_FIELD* pField = &pDescriptor->pFields[i];
+
+		pStringIds[i * 2] = Birdie_InternString(pField->pName, strlen(pField->pName), Birdie_SendString);
+		pStringIds[i * 2 + 1] = Birdie_InternString(pField->type, strlen(pField->type), Birdie_SendString);
+
+		if (pStringIds[i * 2] == 0 || pStringIds[i * 2 + 1] == 0)
+			error = BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	// The whole block is a single region, so publishing and diffing it works like for any other watch
+	BIRDIE_HANDLE newHandle = 0;
+	bool isConnected = g_isConnected;
+	char* pBuffer = NULL;
+	size_t offset = 0;
+
+	Birdie_LockWatchRegistry();
+
+	if (error == BIRDIE_SUCCESS)
+		error = Birdie_AddWatchEntry(pDescriptor->parent, nameReference & ~BIRDIE_STRING_ID_FLAG, typeReference & ~BIRDIE_STRING_ID_FLAG, pDescriptor->pBase, dataSizeBytes, &newHandle);
+
+	if (error == BIRDIE_SUCCESS)
+	{
+		error = Birdie_AddArray(newHandle, pDescriptor, pStringIds);
+
+		if (error != BIRDIE_SUCCESS)
+		{
+			Birdie_RemoveWatchEntry(newHandle);
+			newHandle = 0;
+		}
+	}
+
+	// Layout: operation type, the watch laid out like in AddWatch, then its fields (see Birdie_GetArrayLayout)
+	if (error == BIRDIE_SUCCESS && isConnected)
+	{
+		size_t layoutSize = 0;
+		const char* pLayout = Birdie_GetArrayLayout(newHandle, &layoutSize);
+
+		pBuffer = Birdie_GetScratchBuffer(sizeof(uint32_t) + BIRDIE_ENCODED_WATCH_SIZE + layoutSize);
+
+		if (pBuffer != NULL)
+		{
+			BIRDIE_WATCH_DESCRIPTOR descriptor = { pDescriptor->pName, BIRDIE_TYPE_ARRAY, pDescriptor->pBase, dataSizeBytes, pDescriptor->parent };
+			uint32_t operationType = AddArrayWatch;
+
+			memcpy((void*)(pBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+			offset += sizeof(uint32_t);
+
+			offset += Birdie_EncodeWatch(pBuffer + offset, &descriptor, nameReference, typeReference, newHandle);
+
+			memcpy((void*)(pBuffer + offset), (void*)pLayout, layoutSize);
+			offset += layoutSize;
+		}
+	}
+
+	Birdie_UnlockWatchRegistry();
+
+	g_deallocFunction(pStringIds);
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
+
+	if (pHandle)
+		*pHandle = newHandle;
+
+	if (isConnected == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	return Birdie_SendData(pBuffer, offset);
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_PublishWatches(void)
+{
+	if (g_isConnected == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	// Watches that are still waiting in an automatic batch have to reach the tool before their data does
+	Birdie_FlushAutoBatches();
+
+	if (g_isPublishingStats)
+		Birdie_RefreshPublishedStats();
+
+	// Layout: chunk size, operation type, count, then the changed ranges of every region that changed
+	size_t headerSize = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint32_t);
+	size_t totalSize = 0;
+	uint32_t regionCount = 0;
+
+	Birdie_LockWatchRegistry();
+
+	char* pBuffer = Birdie_SnapshotWatchRegions(headerSize, &totalSize, &regionCount);
+
+	if (pBuffer == NULL)
+	{
+		Birdie_UnlockWatchRegistry();
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	// Nothing changed since the last publish
+	if (regionCount == 0)
+	{
+		Birdie_UnlockWatchRegistry();
+		return BIRDIE_SUCCESS;
+	}
+
+	if (totalSize - sizeof(uint32_t) > BIRDIE_MAX_CHUNK_SIZE)
+	{
+		Birdie_DiscardWatchSnapshot(headerSize, totalSize);
+		Birdie_UnlockWatchRegistry();
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	uint32_t chunkSize = (uint32_t)(totalSize - sizeof(uint32_t));
+	uint32_t operationType = PublishWatches;
+
+	size_t offset = 0;
+
+	memcpy((void*)(pBuffer + offset), (void*)&chunkSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&regionCount, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	Birdie_CountOperation(Birdie_GetThreadContext(), operationType, totalSize);
+
+	// Snapshots are never batched, they're usually far bigger than a batch anyway
+	BIRDIE_ERROR error = Birdie_SendChunk(pBuffer, totalSize);
+
+	// The tool never saw these changes, they're sent again in full next time
+	if (error != BIRDIE_SUCCESS)
+		Birdie_DiscardWatchSnapshot(headerSize, totalSize);
+
+	Birdie_UnlockWatchRegistry();
+
+	return error;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_SetWatchSampling(BIRDIE_HANDLE handle, uint32_t sampleRateHz, uint32_t windowMs)
+{
+	// The sampler thread only lives as long as the connection does
+	if (g_isInitialized == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	Birdie_LockWatchRegistry();
+
+	const BIRDIE_WATCH_ENTRY* pEntry = Birdie_FindWatchEntry(handle);
+	BIRDIE_ERROR error = pEntry != NULL ? Birdie_SetSampling(pEntry, sampleRateHz, windowMs) : BIRDIE_ERROR_INVALID_PARAMS;
+
+	if (error == BIRDIE_SUCCESS && sampleRateHz != 0 && g_samplerThread == NULL && !Birdie_StartSampler())
+	{
+		Birdie_SetSampling(pEntry, 0, 0);
+		error = BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	Birdie_UnlockWatchRegistry();
+
+	// Picks up the new rate right away, instead of after the current wait
+	if (error == BIRDIE_SUCCESS && g_samplerWakeEvent != NULL)
+		SetEvent(g_samplerWakeEvent);
+
+	return error;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_AddImageWatch(const char* pName, uint32_t width, uint32_t height, uint32_t pitch, BIRDIE_PIXEL_FORMAT format, uint32_t downscale, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+{
+	if (pHandle == NULL || pName == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	*pHandle = 0;
+
+	uint32_t pixelSize = Birdie_GetPixelSize(format);
+
+	if (pName[0] == '\0' || width == 0 || height == 0 || pixelSize == 0 || (uint64_t)pitch < (uint64_t)width * pixelSize)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	if (downscale == 0 || downscale > BIRDIE_IMAGE_MAX_DOWNSCALE)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	uint32_t nameReference = Birdie_GetStringReference(pName);
+	uint32_t typeReference = Birdie_GetStringReference(BIRDIE_TYPE_IMAGE);
+
+	if (nameReference == 0 || typeReference == 0)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	// Images have no region, so snapshots of the watches leave them out. The registry keeps them so they're removed
+	// and replayed like any other watch.
+	BIRDIE_IMAGE_LAYOUT layout;
+
+	Birdie_LockWatchRegistry();
+
+	BIRDIE_ERROR error = Birdie_AddWatchEntry(parent, nameReference & ~BIRDIE_STRING_ID_FLAG, typeReference & ~BIRDIE_STRING_ID_FLAG, NULL, 0, pHandle);
+
+	if (error == BIRDIE_SUCCESS)
+	{
+		error = Birdie_AddImage(*pHandle, width, height, pitch, format, downscale);
+
+		if (error != BIRDIE_SUCCESS)
+		{
+			Birdie_RemoveWatchEntry(*pHandle);
+			*pHandle = 0;
+		}
+		else
+			Birdie_GetImageLayout(*pHandle, &layout);
+	}
+
+	Birdie_UnlockWatchRegistry();
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
+
+	if (g_isConnected == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	// Layout: operation type, name, parent, handle, then the width, height, format and tile size as the tool gets them
+	uint32_t image[8] = { AddImageWatch, nameReference, parent, *pHandle, layout.width, layout.height, layout.format, layout.tileSize };
+
+	char* pBuffer = Birdie_GetScratchBuffer(sizeof(image));
+
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	memcpy((void*)pBuffer, (void*)image, sizeof(image));
+
+	return Birdie_SendData(pBuffer, sizeof(image));
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_PublishImage(BIRDIE_HANDLE handle, const void* pPixels)
+{
+	if (pPixels == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	if (g_isConnected == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	// The watch may still be waiting in an automatic batch, it has to reach the tool before its tiles do
+	Birdie_FlushAutoBatches();
+
+	// Layout: chunk size, operation type, handle, tile count, then the tiles
+	size_t headerSize = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(BIRDIE_HANDLE) + sizeof(uint32_t);
+	BIRDIE_IMAGE_LAYOUT layout;
+
+	Birdie_LockWatchRegistry();
+
+	if (Birdie_FindWatchEntry(handle) == NULL || !Birdie_GetImageLayout(handle, &layout))
+	{
+		Birdie_UnlockWatchRegistry();
+		return BIRDIE_ERROR_INVALID_PARAMS;
+	}
+
+	BIRDIE_ERROR error = BIRDIE_SUCCESS;
+	uint32_t nextTile = 0;
+
+	do
+	{
+		size_t totalSize = 0;
+		uint32_t tileCount = 0;
+
+		char* pBuffer = Birdie_SnapshotImageTiles(handle, pPixels, headerSize, &totalSize, &tileCount, &nextTile);
+
+		if (pBuffer == NULL)
+		{
+			error = BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+			break;
+		}
+
+		if (tileCount == 0)
+			continue;
+
+		uint32_t chunkSize = (uint32_t)(totalSize - sizeof(uint32_t));
+		uint32_t operationType = ImageTiles;
+
+		size_t offset = 0;
+
+		memcpy((void*)(pBuffer + offset), (void*)&chunkSize, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		memcpy((void*)(pBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		memcpy((void*)(pBuffer + offset), (void*)&handle, sizeof(BIRDIE_HANDLE));
+		offset += sizeof(BIRDIE_HANDLE);
+
+		memcpy((void*)(pBuffer + offset), (void*)&tileCount, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		Birdie_CountOperation(Birdie_GetThreadContext(), operationType, totalSize);
+
+		// Like snapshots of the watches, tiles are never batched
+		error = Birdie_SendChunk(pBuffer, totalSize);
+	} while (error == BIRDIE_SUCCESS && nextTile != 0);
+
+	// Tiles the tool didn't get are sent again next time
+	if (error != BIRDIE_SUCCESS)
+		Birdie_ResetImageTiles(handle);
+
+	Birdie_UnlockWatchRegistry();
+
+	return error;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_Log(const char* pFilter, const char* pMessage)
+{
+	if (Birdie_IsBelowLogLevel(BIRDIE_LOG_LEVEL_INFO))
+		return g_isConnected ? BIRDIE_SUCCESS : BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (pMessage == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	uint32_t filterReference = 0;
+	BIRDIE_ERROR error = Birdie_GetFilterReference(pFilter, &filterReference);
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
+
+	return Birdie_SendLogMessage(BIRDIE_LOG_LEVEL_INFO, filterReference, pMessage, strlen(pMessage));
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_LogF(const char* pFilter, const char* pFormat, ...)
+{
+	if (Birdie_IsBelowLogLevel(BIRDIE_LOG_LEVEL_INFO))
+		return g_isConnected ? BIRDIE_SUCCESS : BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (pFormat == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	uint32_t filterReference = 0;
+	BIRDIE_ERROR error = Birdie_GetFilterReference(pFilter, &filterReference);
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
+
+	va_list args;
+	va_start(args, pFormat);
+
+	error = Birdie_LogV(BIRDIE_LOG_LEVEL_INFO, filterReference, pFormat, args);
+	va_end(args);
+
+	return error;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_RegisterLogFilter(const char* pFilter, LPBIRDIE_LOG_FILTER pLogFilter)
+{
+	if (pFilter == NULL || pLogFilter == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	*pLogFilter = BIRDIE_LOG_FILTER_NONE;
+
+	if (pFilter[0] == '\0')
+		return BIRDIE_SUCCESS;
+
+	uint32_t stringId = Birdie_InternString(pFilter, strlen(pFilter), Birdie_SendString);
+
+	if (stringId == 0)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	Birdie_AddLogFilter(stringId);
+
+	*pLogFilter = stringId;
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_LogFiltered(BIRDIE_LOG_FILTER logFilter, const char* pMessage)
+{
+	return Birdie_LogEx(BIRDIE_LOG_LEVEL_INFO, logFilter, pMessage);
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_LogFilteredF(BIRDIE_LOG_FILTER logFilter, const char* pFormat, ...)
+{
+	if (Birdie_IsBelowLogLevel(BIRDIE_LOG_LEVEL_INFO))
+		return g_isConnected ? BIRDIE_SUCCESS : BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (pFormat == NULL || (logFilter != BIRDIE_LOG_FILTER_NONE && !Birdie_IsLogFilterValid(logFilter)))
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	va_list args;
+	va_start(args, pFormat);
+
+	BIRDIE_ERROR error = Birdie_LogV(BIRDIE_LOG_LEVEL_INFO, Birdie_GetLogFilterReference(logFilter), pFormat, args);
+	va_end(args);
+
+	return error;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_SetDeferredLogFormatting(bool enabled)
+{
+	g_isDeferringLogFormatting = enabled;
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_LogArguments(const char* pFilter, const char* pFormat, const void* pArguments, size_t argumentsSize)
+{
+	if (Birdie_IsBelowLogLevel(BIRDIE_LOG_LEVEL_INFO))
+		return g_isConnected ? BIRDIE_SUCCESS : BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (pFormat == NULL || (pArguments == NULL && argumentsSize > 0))
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	uint32_t filterReference = 0;
+	BIRDIE_ERROR error = Birdie_GetFilterReference(pFilter, &filterReference);
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
+
+	const BIRDIE_LOG_FORMAT* pLogFormat = Birdie_GetLogFormat(pFormat, Birdie_SendLogFormat);
+
+	if (pLogFormat == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	return Birdie_SendDeferredLogMessage(pLogFormat, BIRDIE_LOG_LEVEL_INFO, filterReference, pArguments, argumentsSize);
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_SetLogLevel(BIRDIE_LOG_LEVEL threshold)
+{
+	if ((uint32_t)threshold > BIRDIE_LOG_LEVEL_NONE)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	g_logLevel = threshold;
+
+	// Without a connection the threshold stays at none, the session picks the level up when it starts
+	if (g_isConnected)
+		g_birdieLogLevelThreshold = threshold;
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_LogEx(BIRDIE_LOG_LEVEL level, BIRDIE_LOG_FILTER logFilter, const char* pMessage)
+{
+	if (Birdie_IsBelowLogLevel(level))
+		return g_isConnected ? BIRDIE_SUCCESS : BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (pMessage == NULL || (uint32_t)level >= BIRDIE_LOG_LEVEL_NONE || (logFilter != BIRDIE_LOG_FILTER_NONE && !Birdie_IsLogFilterValid(logFilter)))
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	return Birdie_SendLogMessage(level, Birdie_GetLogFilterReference(logFilter), pMessage, strlen(pMessage));
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_LogExF(BIRDIE_LOG_LEVEL level, BIRDIE_LOG_FILTER logFilter, const char* pFormat, ...)
+{
+	if (Birdie_IsBelowLogLevel(level))
+		return g_isConnected ? BIRDIE_SUCCESS : BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (pFormat == NULL || (uint32_t)level >= BIRDIE_LOG_LEVEL_NONE || (logFilter != BIRDIE_LOG_FILTER_NONE && !Birdie_IsLogFilterValid(logFilter)))
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	va_list args;
+	va_start(args, pFormat);
+
+	BIRDIE_ERROR error = Birdie_LogV(level, Birdie_GetLogFilterReference(logFilter), pFormat, args);
+	va_end(args);
+
+	return error;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_LogExArguments(BIRDIE_LOG_LEVEL level, BIRDIE_LOG_FILTER logFilter, const char* pFormat, const void* pArguments, size_t argumentsSize)
+{
+	if (Birdie_IsBelowLogLevel(level))
+		return g_isConnected ? BIRDIE_SUCCESS : BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (pFormat == NULL || (pArguments == NULL && argumentsSize > 0) || (uint32_t)level >= BIRDIE_LOG_LEVEL_NONE)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	if (logFilter != BIRDIE_LOG_FILTER_NONE && !Birdie_IsLogFilterValid(logFilter))
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	const BIRDIE_LOG_FORMAT* pLogFormat = Birdie_GetLogFormat(pFormat, Birdie_SendLogFormat);
+
+	if (pLogFormat == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	return Birdie_SendDeferredLogMessage(pLogFormat, level, Birdie_GetLogFilterReference(logFilter), pArguments, argumentsSize);
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_RegisterZone(const char* pName, LPBIRDIE_ZONE pZone)
+{
+	if (pName == NULL || pZone == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	*pZone = 0;
+
+	if (pName[0] == '\0')
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	uint32_t stringId = Birdie_InternString(pName, strlen(pName), Birdie_SendString);
+
+	if (stringId == 0)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	*pZone = stringId;
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_BeginZone(BIRDIE_ZONE zone)
+{
+	return Birdie_RecordZoneEvent(zone, BIRDIE_ZONE_BEGIN);
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_EndZone(BIRDIE_ZONE zone)
+{
+	return Birdie_RecordZoneEvent(zone, BIRDIE_ZONE_END);
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_GetStats(BIRDIE_STATS* pStats)
+{
+	if (pStats == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	Birdie_CollectStats(pStats, &g_sendStats, &g_compressionStats);
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIEAPI BIRDIE_ERROR Birdie_AddStatsWatches(BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+{
+	BIRDIE_ERROR error = Birdie_AddWatchCategory("Birdie", parent, pHandle);
+
+	// Without a connection the category is still registered, the next connection gets it with the replay
+	if (error != BIRDIE_SUCCESS && error != BIRDIE_ERROR_NOT_CONNECTED)
+		return error;
+
+	Birdie_RefreshPublishedStats();
+	g_isPublishingStats = true;
+
+	BIRDIE_WATCH_DESCRIPTOR descriptors[BIRDIE_STATS_WATCH_COUNT];
+	BIRDIE_HANDLE handles[BIRDIE_STATS_WATCH_COUNT];
+
+	size_t count = Birdie_GetStatsWatchDescriptors(&g_publishedStats, *pHandle, descriptors);
+	BIRDIE_ERROR watchError = Birdie_AddWatches(descriptors, count, handles);
+
+	return watchError != BIRDIE_SUCCESS ? watchError : error;
+}
+
+BIRDIE_ERROR Birdie_AddCustomTypeHandler(BIRDIE_TYPE type, const char* handlerCode)
+{
+	if (type == NULL || handlerCode == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	// Types are only registered once, a copy is kept for new connections
+	if (Birdie_AddCustomType(type, handlerCode) != BIRDIE_SUCCESS)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	if (g_isConnected == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	uint32_t typeLength = (uint32_t)strlen(type);
+	uint32_t codeLength = (uint32_t)strlen(handlerCode);
+
+	// Handler code can get big, it's sent straight from the caller's memory
+	uint32_t header[2] = { AddCustomTypeHandler, typeLength };
+
+	BIRDIE_SEND_BUFFER buffers[] =
+	{
+		{ header, sizeof(header) },
+		{ type, typeLength },
+		{ &codeLength, sizeof(uint32_t) },
+		{ handlerCode, codeLength }
+	};
+
+	return Birdie_SendDataV(buffers, sizeof(buffers) / sizeof(buffers[0]));
+}
+
+BIRDIEAPI bool Birdie_IsCustomTypeRegistered(BIRDIE_TYPE type)
+{
+	if (type == NULL)
+		return false;
+
+	return Birdie_HasCustomType(type);
+}
+
+size_t Birdie_EncodeWatch(char* pBuffer, const BIRDIE_WATCH_DESCRIPTOR* pDescriptor, uint32_t nameReference, uint32_t typeReference, BIRDIE_HANDLE handle)
+{
+	uint64_t basePtr64 = (uint64_t)pDescriptor->pBase;
+
+	size_t offset = 0;
+
+	memcpy((void*)(pBuffer + offset), (void*)&typeReference, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&nameReference, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&pDescriptor->parent, sizeof(BIRDIE_HANDLE));
+	offset += sizeof(BIRDIE_HANDLE);
+
+	memcpy((void*)(pBuffer + offset), (void*)&handle, sizeof(BIRDIE_HANDLE));
+	offset += sizeof(BIRDIE_HANDLE);
+
+	memcpy((void*)(pBuffer + offset), (void*)&basePtr64, sizeof(uint64_t));
+	offset += sizeof(uint64_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&pDescriptor->dataSizeBytes, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	return offset;
+}
+
+BIRDIE_ERROR Birdie_SendNewWatches(const BIRDIE_WATCH_DESCRIPTOR* pDescriptors, const uint32_t* pStringIds, size_t count, const BIRDIE_HANDLE* pHandles)
+{
+	// Layout: operation type, count, then every watch laid out like in AddWatch.
+	// Watches are packed into as few chunks as the scratch buffer size allows.
+	size_t headerSize = sizeof(uint32_t) + sizeof(uint32_t);
+	size_t offset = headerSize;
+	uint32_t watchCount = 0;
+
+	char* pBuffer = Birdie_GetScratchBuffer(headerSize);
+
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const BIRDIE_WATCH_DESCRIPTOR* pDescriptor = &pDescriptors[i];
+
+		uint32_t nameReference = pStringIds[i * 2] | BIRDIE_STRING_ID_FLAG;
+		uint32_t typeReference = pStringIds[i * 2 + 1] | BIRDIE_STRING_ID_FLAG;
+
+		size_t watchSize = BIRDIE_ENCODED_WATCH_SIZE;
+
+		// Chunk is full, send it and start a new one
+		if (offset + watchSize > BIRDIE_SCRATCH_BUFFER_SIZE)
+		{
+			BIRDIE_ERROR error = Birdie_SendWatches(pBuffer, offset, watchCount);
+
+			if (error != BIRDIE_SUCCESS)
+				return error;
+
+			offset = headerSize;
+			watchCount = 0;
+		}
+
+		pBuffer = Birdie_GetScratchBuffer(offset + watchSize);
+
+		if (pBuffer == NULL)
+			return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+		offset += Birdie_EncodeWatch(pBuffer + offset, pDescriptor, nameReference, typeReference, pHandles[i]);
+		watchCount++;
+	}
+
+	return Birdie_SendWatches(pBuffer, offset, watchCount);
+}
+
+BIRDIE_ERROR Birdie_SendWatches(char* pBuffer, size_t size, uint32_t watchCount)
+{
+	uint32_t operationType = AddWatches;
+
+	memcpy((void*)pBuffer, (void*)&operationType, sizeof(uint32_t));
+	memcpy((void*)(pBuffer + sizeof(uint32_t)), (void*)&watchCount, sizeof(uint32_t));
+
+	return Birdie_SendData(pBuffer, size);
+}
+
+BIRDIE_ERROR Birdie_SendData(char* pScratchBuffer, size_t size, bool sendChunkSize)
+{
+	if (!g_isConnected)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	// The scratch buffer came from this thread's context, so it exists
+	BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
+
+	// Scratch buffers always have room for the chunk size in front of them
+	char* pData = pScratchBuffer;
+	size_t totalSize = size;
+
+	if (sendChunkSize)
+	{
+		pData -= sizeof(uint32_t);
+		totalSize += sizeof(uint32_t);
+		*((uint32_t*)pData) = (uint32_t)size;
+	}
+
+	uint32_t operationType;
+	memcpy((void*)&operationType, (void*)(pData + sizeof(uint32_t)), sizeof(uint32_t));
+
+	Birdie_CountOperation(pContext, operationType, totalSize);
+
+	if (sendChunkSize)
+	{
+		if (pContext->batchDepth > 0 || g_isAutoBatching)
+		{
+			BIRDIE_SEND_BUFFER buffer = { pData, totalSize };
+			return Birdie_AppendToBatch(pContext, &buffer, 1, totalSize);
+		}
+	}
+
+	return Birdie_SendChunk(pData, totalSize);
+}
+
+BIRDIE_ERROR Birdie_SendDataV(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	if (!g_isConnected)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (bufferCount >= BIRDIE_MAX_SEND_BUFFERS)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	// The chunk size is the only thing that has to be put in front, the spans are left where they are
+	BIRDIE_SEND_BUFFER buffers[BIRDIE_MAX_SEND_BUFFERS];
+	uint32_t chunkSize = 0;
+	size_t size = 0;
+
+	for (size_t i = 0; i < bufferCount; i++)
+	{
+		buffers[i + 1] = pBuffers[i];
+		size += pBuffers[i].size;
+	}
+
+	if (size > BIRDIE_MAX_CHUNK_SIZE)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	chunkSize = (uint32_t)size;
+
+	buffers[0].pData = &chunkSize;
+	buffers[0].size = sizeof(uint32_t);
+
+	size_t totalSize = sizeof(uint32_t) + size;
+
+	BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
+
+	// Every operation starts with its type
+	uint32_t operationType;
+	memcpy((void*)&operationType, pBuffers[0].pData, sizeof(uint32_t));
+
+	Birdie_CountOperation(pContext, operationType, totalSize);
+
+	if (pContext != NULL && (pContext->batchDepth > 0 || g_isAutoBatching))
+		return Birdie_AppendToBatch(pContext, buffers, bufferCount + 1, totalSize);
+
+	return Birdie_SendChunkV(buffers, bufferCount + 1, totalSize);
+}
+
+BIRDIE_ERROR Birdie_SendChunk(const char* pData, size_t totalSize)
+{
+	BIRDIE_SEND_BUFFER buffer = { pData, totalSize };
+
+	return Birdie_SendChunkV(&buffer, 1, totalSize);
+}
+
+BIRDIE_ERROR Birdie_SendChunkV(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize)
+{
+	if (!g_isConnected)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	if (totalSize <= BIRDIE_MAX_FRAGMENT_SIZE)
+		return Birdie_SendWholeChunkV(pBuffers, bufferCount);
+
+	if (g_senderThread != NULL)
+		return Birdie_QueueFragments(pBuffers, bufferCount, totalSize);
+
+	return Birdie_SendFragments(pBuffers, bufferCount, totalSize, BIRDIE_MAX_FRAGMENT_SIZE, Birdie_SendFragment, NULL);
+}
+
+BIRDIE_ERROR Birdie_QueueFragments(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize)
+{
+	// A dropped fragment would leave the tool waiting for the rest of its operation forever.
+	// So the fragments are queued as a whole or not at all, only a lost connection can cut a stream short.
+	size_t capacity = Birdie_QueueGetCapacity(&g_sendQueue);
+	size_t maxFragmentSize = BIRDIE_MAX_FRAGMENT_SIZE;
+
+	// A queue that doesn't grow may never have room for all fragments at once. Every fragment is then made to fit on its
+	// own and waited for in turn. That goes for a dropping queue as well, it would otherwise refuse the chunk every time.
+	bool isGrowing = g_sendQueue.overflowPolicy == BIRDIE_OVERFLOW_GROW;
+
+	if (!isGrowing && Birdie_QueueGetRecordSize(maxFragmentSize) > capacity)
+		maxFragmentSize = capacity - sizeof(uint32_t);
+
+	size_t maxPartSize = maxFragmentSize - BIRDIE_FRAGMENT_HEADER_SIZE;
+	size_t operationSize = totalSize - sizeof(uint32_t);
+	size_t fullFragmentCount = operationSize / maxPartSize;
+	size_t lastPartSize = operationSize % maxPartSize;
+
+	size_t reservationSize = fullFragmentCount * Birdie_QueueGetRecordSize(maxFragmentSize);
+
+	if (lastPartSize > 0)
+		reservationSize += Birdie_QueueGetRecordSize(BIRDIE_FRAGMENT_HEADER_SIZE + lastPartSize);
+
+	if (!isGrowing && reservationSize > capacity)
+		return Birdie_SendFragments(pBuffers, bufferCount, totalSize, maxFragmentSize, Birdie_WaitForFragment, NULL);
+
+	BIRDIE_QUEUE_RESERVATION reservation;
+	BIRDIE_ERROR error = Birdie_QueueReserve(&g_sendQueue, reservationSize, g_sendQueue.overflowPolicy, &reservation);
+
+	if (error == BIRDIE_ERROR_QUEUE_FULL)
+	{
+		BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
+
+		if (pContext != NULL)
+			pContext->stats.droppedCount++;
+	}
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
+
+	return Birdie_SendFragments(pBuffers, bufferCount, totalSize, maxFragmentSize, Birdie_CommitFragment, &reservation);
+}
+
+BIRDIE_ERROR Birdie_SendFragments(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize, size_t maxFragmentSize, BIRDIE_FRAGMENT_FUNCTION pFunction, void* pUserData)
+{
+	if (bufferCount > BIRDIE_MAX_SEND_BUFFERS)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	// Layout: chunk size, operation type, stream id, operation size, fragment size, then the next part of the operation.
+	// The chunk size of the operation itself is left out, the tool handles the operation once all of its parts are in.
+	uint32_t header[5] = { 0, Fragment, (uint32_t)InterlockedIncrement(&g_fragmentStreamId), (uint32_t)(totalSize - sizeof(uint32_t)), 0 };
+	size_t maxPartSize = maxFragmentSize - sizeof(header);
+
+	// Position within the spans, past the chunk size
+	size_t bufferIndex = 0;
+	size_t bufferOffset = sizeof(uint32_t);
+	size_t remainingSize = totalSize - sizeof(uint32_t);
+
+	while (remainingSize > 0)
+	{
+		// A fragment never needs more spans than the chunk itself had, plus its header
+		BIRDIE_SEND_BUFFER buffers[BIRDIE_MAX_SEND_BUFFERS + 1];
+		size_t fragmentBufferCount = 1;
+		size_t fragmentSize = 0;
+
+		while (fragmentSize < maxPartSize && remainingSize > 0)
+		{
+			// Spans are consumed in order, an exhausted one moves on to the next
+			if (bufferOffset >= pBuffers[bufferIndex].size)
+			{
+				bufferOffset -= pBuffers[bufferIndex].size;
+				bufferIndex++;
+				continue;
+			}
+
+			size_t spanSize = pBuffers[bufferIndex].size - bufferOffset;
+
+			if (spanSize > maxPartSize - fragmentSize)
+				spanSize = maxPartSize - fragmentSize;
+
+			buffers[fragmentBufferCount].pData = (const char*)pBuffers[bufferIndex].pData + bufferOffset;
+			buffers[fragmentBufferCount].size = spanSize;
+			fragmentBufferCount++;
+
+			bufferOffset += spanSize;
+			fragmentSize += spanSize;
+			remainingSize -= spanSize;
+		}
+
+		header[0] = (uint32_t)(sizeof(header) - sizeof(uint32_t) + fragmentSize);
+		header[4] = (uint32_t)fragmentSize;
+
+		buffers[0].pData = header;
+		buffers[0].size = sizeof(header);
+
+		// A lost fragment loses the rest of the operation, the tool drops its parts along with the connection
+		BIRDIE_ERROR error = pFunction(buffers, fragmentBufferCount, pUserData);
+
+		if (error != BIRDIE_SUCCESS)
+			return error;
+	}
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_SendFragment(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData)
+{
+	return Birdie_SendWholeChunkV(pBuffers, bufferCount);
+}
+
+BIRDIE_ERROR Birdie_SendRawFragment(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData)
+{
+	// For whoever already owns the transport, like the replay of a new connection
+	if (!Birdie_SendRaw(pBuffers, bufferCount))
+		return BIRDIE_ERROR_COULD_NOT_CONNECT;
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_CommitFragment(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData)
+{
+	// The room was reserved up front, the sender thread can go ahead with every fragment that's in
+	BIRDIE_ERROR error = Birdie_QueueCommit((BIRDIE_QUEUE_RESERVATION*)pUserData, pBuffers, bufferCount);
+
+	if (error == BIRDIE_SUCCESS)
+		Birdie_WakeSender();
+
+	return error;
+}
+
+BIRDIE_ERROR Birdie_WaitForFragment(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, void* pUserData)
+{
+	// Dropping a single fragment would cut the stream short, so even a dropping queue is waited for
+	size_t size = 0;
+
+	for (size_t i = 0; i < bufferCount; i++)
+		size += pBuffers[i].size;
+
+	BIRDIE_QUEUE_RESERVATION reservation;
+	BIRDIE_ERROR error = Birdie_QueueReserve(&g_sendQueue, Birdie_QueueGetRecordSize(size), BIRDIE_OVERFLOW_BLOCK, &reservation);
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
+
+	return Birdie_CommitFragment(pBuffers, bufferCount, &reservation);
+}
+
+BIRDIE_ERROR Birdie_SendWholeChunkV(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	if (!g_isConnected)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	// In asynchronous mode the data only gets gathered into the queue, the sender thread does the rest
+	if (g_senderThread != NULL)
+	{
+		BIRDIE_ERROR error = Birdie_QueuePushV(&g_sendQueue, pBuffers, bufferCount);
+
+		if (error == BIRDIE_SUCCESS)
+		{
+			Birdie_WakeSender();
+		}
+		else if (error == BIRDIE_ERROR_QUEUE_FULL)
+		{
+			BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
+
+			if (pContext != NULL)
+				pContext->stats.droppedCount++;
+		}
+
+		return error;
+	}
+
+	// Encoding was done without any locking, only the transport itself is shared.
+	// The connection is checked again under the lock, it may have been lost or replaced in the meantime.
+	// Only a contended lock is timed, taking a free one costs what it always did.
+	if (!TryEnterCriticalSection(&g_csSend))
+	{
+		LARGE_INTEGER startTime;
+		LARGE_INTEGER endTime;
+
+		QueryPerformanceCounter(&startTime);
+		EnterCriticalSection(&g_csSend);
+		QueryPerformanceCounter(&endTime);
+
+		BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
+
+		if (pContext != NULL)
+		{
+			pContext->stats.sendLockContentionCount++;
+			pContext->stats.sendLockWaitTicks += (uint64_t)(endTime.QuadPart - startTime.QuadPart);
+		}
+	}
+
+	bool isSent = false;
+
+	if (g_isConnected)
+	{
+		isSent = Birdie_SendRaw(pBuffers, bufferCount);
+
+		if (!isSent)
+		{
+			g_sendStats.droppedCount++;
+			Birdie_OnConnectionLost();
+		}
+	}
+
+	LeaveCriticalSection(&g_csSend);
+
+	if (!isSent)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_AppendToBatch(BIRDIE_THREAD_CONTEXT* pContext, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t size)
+{
+	BIRDIE_ERROR error = BIRDIE_SUCCESS;
+	size_t batchHeaderSize = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint32_t);
+
+	// Uncontended unless another thread is flushing our automatic batch
+	while (InterlockedExchange(&pContext->batchLock, 1) != 0)
+		YieldProcessor();
+
+	if (pContext->pTopBatchBuffer == NULL)
+		pContext->pTopBatchBuffer = (char*)g_allocFunction(batchHeaderSize + BIRDIE_BATCH_BUFFER_SIZE);
+
+	if (pContext->pTopBatchBuffer == NULL)
+	{
+		// No memory for batching, fall back to sending right away
+		InterlockedExchange(&pContext->batchLock, 0);
+		return Birdie_SendChunkV(pBuffers, bufferCount, size);
+	}
+
+	// Make room first, this keeps the operations in order
+	if (pContext->batchSize + size > BIRDIE_BATCH_BUFFER_SIZE)
+		error = Birdie_FlushBatch(pContext);
+
+	if (size > BIRDIE_BATCH_BUFFER_SIZE)
+	{
+		// Too big to be batched at all
+		InterlockedExchange(&pContext->batchLock, 0);
+		return Birdie_SendChunkV(pBuffers, bufferCount, size);
+	}
+
+	// The operation keeps its own chunk size, so a batch is simply a sequence of chunks
+	for (size_t i = 0; i < bufferCount; i++)
+	{
+		memcpy((void*)(pContext->pTopBatchBuffer + batchHeaderSize + pContext->batchSize), pBuffers[i].pData, pBuffers[i].size);
+		pContext->batchSize += pBuffers[i].size;
+	}
+
+	pContext->batchCount++;
+
+	InterlockedExchange(&pContext->batchLock, 0);
+
+	return error;
+}
+
+BIRDIE_ERROR Birdie_FlushBatch(BIRDIE_THREAD_CONTEXT* pContext)
+{
+	// Expects the batch lock to be held, or the batch to only be accessed by its own thread
+	if (pContext->batchCount == 0)
+		return BIRDIE_SUCCESS;
+
+	uint32_t chunkSize = (uint32_t)(sizeof(uint32_t) + sizeof(uint32_t) + pContext->batchSize);
+	uint32_t operationType = Batch;
+
+	size_t offset = 0;
+
+	memcpy((void*)(pContext->pTopBatchBuffer + offset), (void*)&chunkSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pContext->pTopBatchBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pContext->pTopBatchBuffer + offset), (void*)&pContext->batchCount, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	BIRDIE_ERROR error = Birdie_SendChunk(pContext->pTopBatchBuffer, offset + pContext->batchSize);
+
+	pContext->batchSize = 0;
+	pContext->batchCount = 0;
+
+	return error;
+}
+
+void Birdie_FlushThreadContext(BIRDIE_THREAD_CONTEXT* pContext)
+{
+	// The zones go first, with automatic batching they end up in the batch
+	Birdie_FlushZones(pContext);
+
+	while (InterlockedExchange(&pContext->batchLock, 1) != 0)
+		YieldProcessor();
+
+	// A batch the thread never ended is sent as it is, there's no one left to end it
+	if (pContext->batchCount > 0)
+		Birdie_FlushBatch(pContext);
+
+	pContext->batchDepth = 0;
+
+	InterlockedExchange(&pContext->batchLock, 0);
+}
+
+BIRDIE_ERROR Birdie_FlushAutoBatches()
+{
+	BIRDIE_ERROR error = BIRDIE_SUCCESS;
+
+	for (BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContexts(); pContext != NULL; pContext = pContext->pNext)
+	{
+		// Explicit batches are left alone, they're sent by their own thread
+		if (pContext->batchCount == 0 || pContext->batchDepth > 0)
+			continue;
+
+		while (InterlockedExchange(&pContext->batchLock, 1) != 0)
+			YieldProcessor();
+
+		BIRDIE_ERROR flushError = Birdie_FlushBatch(pContext);
+
+		InterlockedExchange(&pContext->batchLock, 0);
+
+		if (flushError != BIRDIE_SUCCESS)
+			error = flushError;
+	}
+
+	return error;
+}
+
+void Birdie_DiscardAutoBatches()
+{
+	for (BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContexts(); pContext != NULL; pContext = pContext->pNext)
+	{
+		// Explicit batches are left alone, they belong to their own thread
+		if (pContext->batchCount == 0 || pContext->batchDepth > 0)
+			continue;
+
+		while (InterlockedExchange(&pContext->batchLock, 1) != 0)
+			YieldProcessor();
+
+		pContext->batchSize = 0;
+		pContext->batchCount = 0;
+
+		InterlockedExchange(&pContext->batchLock, 0);
+	}
+}
+
+bool Birdie_SendRaw(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	if (g_isCompressing && !g_isUsingSharedRing)
+	{
+		size_t totalSize = 0;
+
+		for (size_t i = 0; i < bufferCount; i++)
+			totalSize += pBuffers[i].size;
+
+		// Small frames aren't worth the time
+		if (totalSize >= g_compressionThreshold)
+			return Birdie_SendCompressed(pBuffers, bufferCount, totalSize);
+	}
+
+	return Birdie_SendToTransport(pBuffers, bufferCount);
+}
+
+bool Birdie_SendCompressed(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize)
+{
+	LARGE_INTEGER startTime;
+	LARGE_INTEGER endTime;
+
+	QueryPerformanceCounter(&startTime);
+
+	const char* pCompressed = NULL;
+	size_t compressedSize = Birdie_Compress(&g_compressor, pBuffers, bufferCount, totalSize, &pCompressed);
+
+	QueryPerformanceCounter(&endTime);
+
+	// Layout: chunk size, operation type, uncompressed size, compressed size, then the compressed chunks
+	char header[sizeof(uint32_t) * 4];
+	size_t frameSize = sizeof(header) + compressedSize;
+
+	g_compressionStats.frameCount++;
+	g_compressionStats.uncompressedBytes += totalSize;
+	g_compressionStats.compressionTicks += (uint64_t)(endTime.QuadPart - startTime.QuadPart);
+
+	// Frames that don't get any smaller go out as they are
+	if (compressedSize == 0 || frameSize >= totalSize)
+	{
+		g_compressionStats.compressedBytes += totalSize;
+		return Birdie_SendToTransport(pBuffers, bufferCount);
+	}
+
+	g_compressionStats.compressedBytes += frameSize;
+
+	uint32_t chunkSize = (uint32_t)(frameSize - sizeof(uint32_t));
+	uint32_t operationType = Compressed;
+	uint32_t uncompressedSize = (uint32_t)totalSize;
+	uint32_t blockSize = (uint32_t)compressedSize;
+
+	size_t offset = 0;
+
+	memcpy((void*)(header + offset), (void*)&chunkSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(header + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(header + offset), (void*)&uncompressedSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(header + offset), (void*)&blockSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	BIRDIE_SEND_BUFFER buffers[2] =
+	{
+		{ header, sizeof(header) },
+		{ pCompressed, compressedSize }
+	};
+
+	return Birdie_SendToTransport(buffers, 2);
+}
+
+bool Birdie_SendToTransport(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	LARGE_INTEGER startTime;
+	LARGE_INTEGER endTime;
+
+	QueryPerformanceCounter(&startTime);
+
+	// A full ring blocks just like a full socket does
+	bool isSent = g_isUsingSharedRing
+		? Birdie_WriteSharedRing(&g_sharedRing, pBuffers, bufferCount)
+		: g_pTransport->pSend(g_pTransport, pBuffers, bufferCount);
+
+	QueryPerformanceCounter(&endTime);
+
+	g_sendStats.sendCount++;
+	g_sendStats.sendTicks += (uint64_t)(endTime.QuadPart - startTime.QuadPart);
+
+	for (size_t i = 0; i < bufferCount; i++)
+		g_sendStats.sentBytes += pBuffers[i].size;
+
+	return isSent;
+}
+
+BIRDIE_ERROR Birdie_StartSession(uint64_t challengeKey)
+{
+	g_isInitialized = true;
+	g_challengeKey = challengeKey;
+	g_toolOperationSize = 0;
+
+	memset(&g_compressionStats, 0, sizeof(g_compressionStats));
+	memset(&g_sendStats, 0, sizeof(g_sendStats));
+
+	Birdie_InitializeTimestamps();
+
+	InitializeCriticalSection(&g_csSend);
+
+	// The transport is connected at this point, the handshake is the same for all of them.
+	// Anything that was registered before the connection existed goes out with the replay.
+	Birdie_LockSessionState();
+
+	BIRDIE_ERROR error = Birdie_SendHandshake();
+
+	if (error == BIRDIE_SUCCESS)
+		error = Birdie_SendReplay();
+
+	if (error == BIRDIE_SUCCESS)
+	{
+		g_birdieLogLevelThreshold = g_logLevel;
+		g_isConnected = true;
+	}
+
+	Birdie_UnlockSessionState();
+
+	if (error != BIRDIE_SUCCESS)
+	{
+		// Whatever was registered is kept, just like when the connection couldn't be made at all
+		if (g_isUsingSharedRing)
+		{
+			Birdie_DestroySharedRing(&g_sharedRing);
+			g_isUsingSharedRing = false;
+		}
+
+		g_pTransport->pClose(g_pTransport);
+		g_pTransport = NULL;
+
+		DeleteCriticalSection(&g_csSend);
+
+		g_isInitialized = false;
+
+		return BIRDIE_ERROR_COULD_NOT_CONNECT;
+	}
+
+	// The handshake is always sent synchronously, the sender thread takes over from here.
+	// If it can't be started we simply keep using blocking sends.
+	if (g_asyncQueueSize > 0)
+		Birdie_StartSender();
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_ResumeSession(BIRDIE_TRANSPORT* pTransport)
+{
+	Birdie_LockSessionState();
+
+	// Whatever was meant for the old connection is dropped, the replay brings the tool up to date.
+	// The sender thread throws records away while there's no connection, so waiting for it empties the queue.
+	Birdie_DiscardAutoBatches();
+
+	if (g_senderThread != NULL)
+	{
+		BIRDIE_QUEUE_SEGMENT* pSegment = NULL;
+		LONGLONG flushTicket = Birdie_QueueGetFlushTicket(&g_sendQueue, &pSegment);
+
+		Birdie_WakeSender();
+
+		while (Birdie_AtomicLoad64(&pSegment->readCursor) < flushTicket)
+			Sleep(1);
+	}
+
+	if (g_isUsingSharedRing)
+	{
+		Birdie_DestroySharedRing(&g_sharedRing);
+		g_isUsingSharedRing = false;
+	}
+
+	g_pTransport->pClose(g_pTransport);
+	g_pTransport = pTransport;
+	g_toolOperationSize = 0;
+
+	BIRDIE_ERROR error = Birdie_SendHandshake();
+
+	if (error == BIRDIE_SUCCESS)
+		error = Birdie_SendReplay();
+
+	// Nothing can be sent in between the replay and this, so nothing can be missed or sent twice
+	if (error == BIRDIE_SUCCESS)
+	{
+		g_birdieLogLevelThreshold = g_logLevel;
+		g_isConnected = true;
+
+		g_sendStats.reconnectCount++;
+	}
+
+	Birdie_UnlockSessionState();
+
+	return error;
+}
+
+void Birdie_LockSessionState()
+{
+	// Always taken in this order. Anything that sends while holding one of these takes the send lock last as well.
+	Birdie_LockWatchRegistry();
+	Birdie_LockStringTable();
+	Birdie_LockLogFormats();
+	Birdie_LockCustomTypes();
+
+	EnterCriticalSection(&g_csSend);
+
+	// Keeps the transport to ourselves, nobody polls it while it's being replaced
+	while (InterlockedCompareExchange(&g_isPollingTool, 1, 0) != 0)
+		SwitchToThread();
+}
+
+void Birdie_UnlockSessionState()
+{
+	InterlockedExchange(&g_isPollingTool, 0);
+
+	LeaveCriticalSection(&g_csSend);
+
+	Birdie_UnlockCustomTypes();
+	Birdie_UnlockLogFormats();
+	Birdie_UnlockStringTable();
+	Birdie_UnlockWatchRegistry();
+}
+
+BIRDIE_ERROR Birdie_SendHandshake()
+{
+	// Layout: challenge key, then a RegisterProcess chunk (chunk size, operation type, process id).
+	// Sent straight to the transport, nothing may be batched or queued in front of it.
+	char handshake[sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t)];
+
+	uint32_t chunkSize = sizeof(uint32_t) + sizeof(uint64_t);
+	uint32_t operationType = RegisterProcess;
+	uint64_t processId = (uint64_t)GetCurrentProcessId();
+
+	size_t offset = 0;
+
+	memcpy((void*)(handshake + offset), (void*)&g_challengeKey, sizeof(uint64_t));
+	offset += sizeof(uint64_t);
+
+	memcpy((void*)(handshake + offset), (void*)&chunkSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(handshake + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(handshake + offset), (void*)&processId, sizeof(uint64_t));
+	offset += sizeof(uint64_t);
+
+	BIRDIE_SEND_BUFFER buffer = { handshake, offset };
+
+	// A new tool has to agree to compression first
+	g_isCompressing = false;
+
+	if (!Birdie_SendRaw(&buffer, 1))
+		return BIRDIE_ERROR_COULD_NOT_CONNECT;
+
+	// Switch to shared memory if the tool agrees, the connection stays open to keep the session alive
+	if (g_sharedRingSize > 0 && g_pTransport->isLoopback)
+		Birdie_NegotiateSharedRing();
+
+	// Compress frames if the tool can take them, only the network in between benefits from it
+	if (g_compressionThreshold > 0 && g_pTransport->isRemote)
+		Birdie_NegotiateCompression();
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_SendReplay()
+{
+	// Layout: chunk size, operation type, operation count, then every operation with its own chunk size, like any other batch.
+	// Strings, formats and custom types go first, everything after may use them. Parents always come before their children.
+	size_t headerSize = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint32_t);
+
+	g_replaySize = headerSize;
+	g_replayCount = 0;
+	g_replayWatchesOffset = 0;
+
+	BIRDIE_ERROR error = BIRDIE_SUCCESS;
+
+	if (Birdie_ReserveReplay(0) == NULL)
+		error = BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	if (error == BIRDIE_SUCCESS)
+		error = Birdie_ReplayStrings(Birdie_ReplayString);
+
+	if (error == BIRDIE_SUCCESS)
+		error = Birdie_ReplayLogFormats(Birdie_ReplayLogFormat);
+
+	if (error == BIRDIE_SUCCESS)
+		error = Birdie_ReplayCustomTypes(Birdie_ReplayCustomType);
+
+	if (error == BIRDIE_SUCCESS)
+		error = Birdie_ReplayWatchEntries(Birdie_ReplayWatch);
+
+	Birdie_CloseReplayWatches();
+
+	if (error == BIRDIE_SUCCESS && g_replaySize - sizeof(uint32_t) > BIRDIE_MAX_CHUNK_SIZE)
+		error = BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	// A fresh session has nothing to replay
+	if (error == BIRDIE_SUCCESS && g_replayCount > 0)
+	{
+		uint32_t chunkSize = (uint32_t)(g_replaySize - sizeof(uint32_t));
+		uint32_t operationType = Batch;
+
+		size_t offset = 0;
+
+		memcpy((void*)(g_pReplayBuffer + offset), (void*)&chunkSize, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		memcpy((void*)(g_pReplayBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		memcpy((void*)(g_pReplayBuffer + offset), (void*)&g_replayCount, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		BIRDIE_SEND_BUFFER buffer = { g_pReplayBuffer, g_replaySize };
+
+		// A large session doesn't fit in one piece either, the transport is ours so the fragments skip the queue
+		if (g_replaySize > BIRDIE_MAX_FRAGMENT_SIZE)
+			error = Birdie_SendFragments(&buffer, 1, g_replaySize, BIRDIE_MAX_FRAGMENT_SIZE, Birdie_SendRawFragment, NULL);
+		else if (!Birdie_SendRaw(&buffer, 1))
+			error = BIRDIE_ERROR_COULD_NOT_CONNECT;
+	}
+
+	// Replays are rare, the buffer isn't worth keeping around
+	if (g_pReplayBuffer != NULL)
+		g_deallocFunction(g_pReplayBuffer);
+
+	g_pReplayBuffer = NULL;
+	g_replayBufferSize = 0;
+
+	return error;
+}
+
+char* Birdie_ReserveReplay(size_t size)
+{
+	// Returns room for 'size' more bytes at the end of the replay
+	if (g_replaySize + size > g_replayBufferSize)
+	{
+		size_t newSize = g_replayBufferSize > 0 ? g_replayBufferSize : BIRDIE_BATCH_BUFFER_SIZE;
+
+		while (newSize < g_replaySize + size)
+			newSize <<= 1;
+
+		char* pNewBuffer = (char*)g_allocFunction(newSize);
+
+		if (pNewBuffer == NULL)
+			return NULL;
+
+		if (g_pReplayBuffer != NULL)
+		{
+			memcpy((void*)pNewBuffer, (void*)g_pReplayBuffer, g_replaySize);
+			g_deallocFunction(g_pReplayBuffer);
+		}
+
+		g_pReplayBuffer = pNewBuffer;
+		g_replayBufferSize = newSize;
+	}
+
+	return g_pReplayBuffer + g_replaySize;
+}
+
+BIRDIE_ERROR Birdie_AppendToReplay(const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	// Every operation keeps its own chunk size, the spans are copied in behind it
+	size_t size = 0;
+
+	for (size_t i = 0; i < bufferCount; i++)
+		size += pBuffers[i].size;
+
+	if (size > BIRDIE_MAX_CHUNK_SIZE)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	char* pBuffer = Birdie_ReserveReplay(sizeof(uint32_t) + size);
+
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	uint32_t chunkSize = (uint32_t)size;
+
+	memcpy((void*)pBuffer, (void*)&chunkSize, sizeof(uint32_t));
+	pBuffer += sizeof(uint32_t);
+
+	for (size_t i = 0; i < bufferCount; i++)
+	{
+		memcpy((void*)pBuffer, pBuffers[i].pData, pBuffers[i].size);
+		pBuffer += pBuffers[i].size;
+	}
+
+	g_replaySize += sizeof(uint32_t) + size;
+	g_replayCount++;
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_ReplayString(const BIRDIE_INTERNED_STRING* pInternedString)
+{
+	// Same layout as Birdie_SendString
+	uint32_t header[3] = { AddString, pInternedString->stringId, (uint32_t)pInternedString->length };
+
+	BIRDIE_SEND_BUFFER buffers[] =
+	{
+		{ header, sizeof(header) },
+		{ pInternedString->pString, pInternedString->length }
+	};
+
+	return Birdie_AppendToReplay(buffers, 2);
+}
+
+BIRDIE_ERROR Birdie_ReplayLogFormat(const BIRDIE_LOG_FORMAT* pLogFormat)
+{
+	// Same layout as Birdie_SendLogFormat
+	uint32_t header[3] = { AddLogFormat, pLogFormat->formatId, (uint32_t)pLogFormat->formatLength };
+
+	BIRDIE_SEND_BUFFER buffers[] =
+	{
+		{ header, sizeof(header) },
+		{ pLogFormat->pFormat, pLogFormat->formatLength }
+	};
+
+	return Birdie_AppendToReplay(buffers, 2);
+}
+
+BIRDIE_ERROR Birdie_ReplayCustomType(const BIRDIE_CUSTOM_TYPE* pCustomType)
+{
+	// Same layout as Birdie_AddCustomTypeHandler
+	uint32_t header[2] = { AddCustomTypeHandler, (uint32_t)pCustomType->typeLength };
+	uint32_t codeLength = (uint32_t)pCustomType->handlerCodeLength;
+
+	BIRDIE_SEND_BUFFER buffers[] =
+	{
+		{ header, sizeof(header) },
+		{ pCustomType->pType, pCustomType->typeLength },
+		{ &codeLength, sizeof(uint32_t) },
+		{ pCustomType->pHandlerCode, pCustomType->handlerCodeLength }
+	};
+
+	return Birdie_AppendToReplay(buffers, 4);
+}
+
+BIRDIE_ERROR Birdie_ReplayWatch(const BIRDIE_WATCH_ENTRY* pEntry)
+{
+	uint32_t nameReference = pEntry->nameId | BIRDIE_STRING_ID_FLAG;
+	BIRDIE_IMAGE_LAYOUT layout;
+
+	if (pEntry->pBase == NULL && pEntry->typeId != 0 && Birdie_GetImageLayout(pEntry->handle, &layout))
+	{
+		// Same layout as Birdie_AddImageWatch. The tool has none of the tiles, the next publish sends all of them.
+		Birdie_CloseReplayWatches();
+		Birdie_ResetImageTiles(pEntry->handle);
+
+		uint32_t image[8] = { AddImageWatch, nameReference, pEntry->parent, pEntry->handle, layout.width, layout.height, layout.format, layout.tileSize };
+		BIRDIE_SEND_BUFFER buffer = { image, sizeof(image) };
+
+		return Birdie_AppendToReplay(&buffer, 1);
+	}
+
+	size_t arrayLayoutSize = 0;
+	const char* pArrayLayout = pEntry->pBase != NULL ? Birdie_GetArrayLayout(pEntry->handle, &arrayLayoutSize) : NULL;
+
+	if (pArrayLayout != NULL)
+	{
+		// Same layout as Birdie_AddArrayWatch
+		Birdie_CloseReplayWatches();
+
+		char watch[sizeof(uint32_t) + BIRDIE_ENCODED_WATCH_SIZE];
+		uint32_t operationType = AddArrayWatch;
+
+		BIRDIE_WATCH_DESCRIPTOR descriptor = { NULL, NULL, (void*)pEntry->pBase, pEntry->dataSizeBytes, pEntry->parent };
+
+		memcpy((void*)watch, (void*)&operationType, sizeof(uint32_t));
+		Birdie_EncodeWatch(watch + sizeof(uint32_t), &descriptor, nameReference, pEntry->typeId | BIRDIE_STRING_ID_FLAG, pEntry->handle);
+
+		BIRDIE_SEND_BUFFER buffers[] =
+		{
+			{ watch, sizeof(watch) },
+			{ pArrayLayout, arrayLayoutSize }
+		};
+
+		return Birdie_AppendToReplay(buffers, 2);
+	}
+
+	if (pEntry->pBase == NULL)
+	{
+		// Same layout as Birdie_AddWatchCategory. It ends any run of watches, those have to stay in order.
+		Birdie_CloseReplayWatches();
+
+		uint32_t category[4] = { AddCategory, nameReference, pEntry->parent, pEntry->handle };
+		BIRDIE_SEND_BUFFER buffer = { category, sizeof(category) };
+
+		return Birdie_AppendToReplay(&buffer, 1);
+	}
+
+	// Runs of watches share a single AddWatches operation, its header is filled in once the run ends
+	size_t headerSize = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint32_t);
+
+	if (g_replayWatchesOffset == 0)
+	{
+		if (Birdie_ReserveReplay(headerSize) == NULL)
+			return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+		g_replayWatchesOffset = g_replaySize;
+		g_replayWatchCount = 0;
+		g_replaySize += headerSize;
+	}
+
+	char* pBuffer = Birdie_ReserveReplay(BIRDIE_ENCODED_WATCH_SIZE);
+
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	BIRDIE_WATCH_DESCRIPTOR descriptor = { NULL, NULL, (void*)pEntry->pBase, pEntry->dataSizeBytes, pEntry->parent };
+
+	g_replaySize += Birdie_EncodeWatch(pBuffer, &descriptor, nameReference, pEntry->typeId | BIRDIE_STRING_ID_FLAG, pEntry->handle);
+	g_replayWatchCount++;
+
+	return BIRDIE_SUCCESS;
+}
+
+void Birdie_CloseReplayWatches()
+{
+	if (g_replayWatchesOffset == 0)
+		return;
+
+	// Layout: chunk size, operation type, watch count, then the watches
+	uint32_t chunkSize = (uint32_t)(g_replaySize - g_replayWatchesOffset - sizeof(uint32_t));
+	uint32_t operationType = AddWatches;
+
+	size_t offset = g_replayWatchesOffset;
+
+	memcpy((void*)(g_pReplayBuffer + offset), (void*)&chunkSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(g_pReplayBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(g_pReplayBuffer + offset), (void*)&g_replayWatchCount, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	g_replayWatchesOffset = 0;
+	g_replayCount++;
+}
+
+BIRDIE_ERROR Birdie_SendDefinition(uint32_t operationType, uint32_t id, const void* pData, size_t length)
+{
+	// Layout: chunk size, operation type, id, length, data.
+	// Log formats and strings are shared by all threads. If a definition waited in the batch of its thread, another thread
+	// could send a batch referring to it first, so definitions are always sent directly.
+	uint32_t header[4] =
+	{
+		(uint32_t)(sizeof(uint32_t) * 3 + length),
+		operationType,
+		id,
+		(uint32_t)length
+	};
+
+	BIRDIE_SEND_BUFFER buffers[] =
+	{
+		{ header, sizeof(header) },
+		{ pData, length }
+	};
+
+	if (g_isConnected)
+		Birdie_CountOperation(Birdie_GetThreadContext(), operationType, sizeof(header) + length);
+
+	BIRDIE_ERROR error = Birdie_SendChunkV(buffers, 2, sizeof(header) + length);
+
+	// Without a connection the definition is only added to its table, the next connection gets it with the replay
+	return error == BIRDIE_ERROR_NOT_CONNECTED ? BIRDIE_SUCCESS : error;
+}
+
+BIRDIE_ERROR Birdie_SendLogFormat(const BIRDIE_LOG_FORMAT* pLogFormat)
+{
+	return Birdie_SendDefinition(AddLogFormat, pLogFormat->formatId, pLogFormat->pFormat, pLogFormat->formatLength);
+}
+
+BIRDIE_ERROR Birdie_SendDeferredLogMessage(const BIRDIE_LOG_FORMAT* pLogFormat, BIRDIE_LOG_LEVEL level, uint32_t filterReference, const void* pArguments, size_t argumentsSize)
+{
+	if (argumentsSize > BIRDIE_MAX_CHUNK_SIZE)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	// Layout: operation type, level, format id, arguments length, arguments, filter
+	uint32_t header[4] = { AddDeferredLogMessage, (uint32_t)level, pLogFormat->formatId, (uint32_t)argumentsSize };
+
+	BIRDIE_SEND_BUFFER buffers[] =
+	{
+		{ header, sizeof(header) },
+		{ pArguments, argumentsSize },
+		{ &filterReference, sizeof(uint32_t) }
+	};
+
+	return Birdie_SendDataV(buffers, sizeof(buffers) / sizeof(buffers[0]));
+}
+
+BIRDIE_ERROR Birdie_SendLogMessage(BIRDIE_LOG_LEVEL level, uint32_t filterReference, const char* pMessage, size_t messageLength)
+{
+	if (messageLength > BIRDIE_MAX_CHUNK_SIZE)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	// Only the fixed size fields are encoded, the message is sent from where it is
+	uint32_t header[3] = { AddLogMessage, (uint32_t)level, (uint32_t)messageLength };
+
+	BIRDIE_SEND_BUFFER buffers[] =
+	{
+		{ header, sizeof(header) },
+		{ pMessage, messageLength },
+		{ &filterReference, sizeof(uint32_t) }
+	};
+
+	return Birdie_SendDataV(buffers, sizeof(buffers) / sizeof(buffers[0]));
+}
+
+BIRDIE_ERROR Birdie_LogV(BIRDIE_LOG_LEVEL level, uint32_t filterReference, const char* pFormat, va_list args)
+{
+	BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
+
+	if (pContext == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	char* pBuffer = pContext->pScratchBuffer;
+	size_t availableSize = pContext->scratchBufferSize;
+
+	va_list argsCopy;
+
+	// Only the arguments are captured here, the tool does the formatting
+	if (g_isDeferringLogFormatting)
+	{
+		const BIRDIE_LOG_FORMAT* pLogFormat = Birdie_GetLogFormat(pFormat, Birdie_SendLogFormat);
+
+		if (pLogFormat != NULL && pLogFormat->canCaptureArguments)
+		{
+			va_copy(argsCopy, args);
+
+			size_t argumentsSize = Birdie_CaptureLogArguments(pLogFormat, pBuffer, availableSize, argsCopy);
+			va_end(argsCopy);
+
+			// Long strings, grow this thread's scratch buffer and capture again.
+			// Scratch buffers never grow past their limit, anything larger gets a buffer of its own and is sent in fragments.
+			char* pLargeBuffer = NULL;
+
+			if (argumentsSize > availableSize)
+			{
+				if (argumentsSize > BIRDIE_SCRATCH_BUFFER_SIZE)
+					pBuffer = pLargeBuffer = (char*)g_allocFunction(argumentsSize);
+				else
+					pBuffer = Birdie_GetScratchBuffer(argumentsSize);
+
+				if (pBuffer == NULL)
+					return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+				va_copy(argsCopy, args);
+				Birdie_CaptureLogArguments(pLogFormat, pBuffer, argumentsSize, argsCopy);
+				va_end(argsCopy);
+			}
+
+			BIRDIE_ERROR error = Birdie_SendDeferredLogMessage(pLogFormat, level, filterReference, pBuffer, argumentsSize);
+
+			if (pLargeBuffer != NULL)
+				g_deallocFunction(pLargeBuffer);
+
+			return error;
+		}
+	}
+
+	// The message is formatted straight into the scratch buffer and sent from there
+	va_copy(argsCopy, args);
+
+	int formattedLength = vsnprintf(pBuffer, availableSize, pFormat, argsCopy);
+	va_end(argsCopy);
+
+	if (formattedLength < 0)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	size_t messageLength = (size_t)formattedLength;
+
+	// Too small, grow this thread's scratch buffer and format again. Same as for captured arguments, messages that
+	// don't fit in any scratch buffer are formatted into a buffer of their own.
+	char* pLargeBuffer = NULL;
+
+	if (messageLength >= availableSize)
+	{
+		if (messageLength + 1 > BIRDIE_SCRATCH_BUFFER_SIZE)
+			pBuffer = pLargeBuffer = (char*)g_allocFunction(messageLength + 1);
+		else
+			pBuffer = Birdie_GetScratchBuffer(messageLength + 1);
+
+		if (pBuffer == NULL)
+			return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+		va_copy(argsCopy, args);
+		vsnprintf(pBuffer, messageLength + 1, pFormat, argsCopy);
+		va_end(argsCopy);
+	}
+
+	BIRDIE_ERROR error = Birdie_SendLogMessage(level, filterReference, pBuffer, messageLength);
+
+	if (pLargeBuffer != NULL)
+		g_deallocFunction(pLargeBuffer);
+
+	return error;
+}
+
+BIRDIE_ERROR Birdie_SendString(const BIRDIE_INTERNED_STRING* pInternedString)
+{
+	return Birdie_SendDefinition(AddString, pInternedString->stringId, pInternedString->pString, pInternedString->length);
+}
+
+uint32_t Birdie_GetStringReference(const char* pString)
+{
+	uint32_t stringId = Birdie_InternString(pString, strlen(pString), Birdie_SendString);
+
+	if (stringId == 0)
+		return 0;
+
+	return stringId | BIRDIE_STRING_ID_FLAG;
+}
+
+BIRDIE_ERROR Birdie_GetFilterReference(const char* pFilter, uint32_t* pFilterReference)
+{
+	// A zero reference reads as an empty string
+	*pFilterReference = 0;
+
+	if (pFilter == NULL || pFilter[0] == '\0')
+		return BIRDIE_SUCCESS;
+
+	*pFilterReference = Birdie_GetStringReference(pFilter);
+
+	if (*pFilterReference == 0)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	return BIRDIE_SUCCESS;
+}
+
+uint32_t Birdie_GetLogFilterReference(BIRDIE_LOG_FILTER logFilter)
+{
+	if (logFilter == BIRDIE_LOG_FILTER_NONE)
+		return 0;
+
+	return logFilter | BIRDIE_STRING_ID_FLAG;
+}
+
+void Birdie_PollTool()
+{
+	// Whoever gets here first reads, everyone else carries on
+	if (InterlockedCompareExchange(&g_isPollingTool, 1, 0) != 0)
+		return;
+
+	// A lost connection has nothing left to say
+	while (g_isConnected)
+	{
+		size_t bytesReceived = g_pTransport->pPoll(g_pTransport, g_toolOperation + g_toolOperationSize, sizeof(g_toolOperation) - g_toolOperationSize);
+
+		if (bytesReceived == 0)
+			break;
+
+		g_toolOperationSize += bytesReceived;
+
+		if (g_toolOperationSize < sizeof(g_toolOperation))
+			continue;
+
+		uint32_t operationType = 0;
+		uint32_t value = 0;
+
+		memcpy((void*)&operationType, (void*)g_toolOperation, sizeof(uint32_t));
+		memcpy((void*)&value, (void*)(g_toolOperation + sizeof(uint32_t)), sizeof(uint32_t));
+
+		g_toolOperationSize = 0;
+
+		Birdie_HandleToolOperation(operationType, value);
+	}
+
+	InterlockedExchange(&g_isPollingTool, 0);
+}
+
+void Birdie_HandleToolOperation(uint32_t operationType, uint32_t value)
+{
+	switch (operationType)
+	{
+	case SetLogLevel:
+		if (value <= BIRDIE_LOG_LEVEL_NONE && g_isConnected)
+			g_birdieLogLevelThreshold = (int32_t)value;
+		break;
+
+	case FetchSamples:
+		// The value is the handle of the watch, rings of watches that aren't sampled don't exist
+		if (Birdie_RequestSampleRing((BIRDIE_HANDLE)value) && g_samplerWakeEvent != NULL)
+			SetEvent(g_samplerWakeEvent);
+		break;
+
+	default:
+		// Newer tools may send operations we don't know about, they all have the same size
+		break;
+	}
+}
+
+bool Birdie_WaitForToolAnswer(uint32_t answerType, uint32_t* pValue)
+{
+	// Anything the tool sends before the answer is handled as usual.
+	// Tools that don't know about the offer never answer, so don't wait forever.
+	uint32_t toolOperation[2] = { 0, 0 };
+
+	for (;;)
+	{
+		if (!g_pTransport->pReceive(g_pTransport, toolOperation, sizeof(toolOperation), 1000))
+			return false;
+
+		if (toolOperation[0] == answerType)
+			break;
+
+		Birdie_HandleToolOperation(toolOperation[0], toolOperation[1]);
+	}
+
+	*pValue = toolOperation[1];
+
+	return true;
+}
+
+bool Birdie_NegotiateSharedRing()
+{
+	if (Birdie_CreateSharedRing(&g_sharedRing, g_sharedRingSize) != BIRDIE_SUCCESS)
+		return false;
+
+	uint32_t nameLength = (uint32_t)strlen(g_sharedRing.name);
+	uint32_t capacity = (uint32_t)g_sharedRing.capacity;
+
+	size_t totalSize =
+		sizeof(uint32_t) +
+		sizeof(uint32_t) +
+		sizeof(uint32_t) +
+		nameLength +
+		sizeof(uint32_t);
+
+	char* pBuffer = Birdie_GetScratchBuffer(totalSize);
+
+	if (pBuffer == NULL)
+	{
+		Birdie_DestroySharedRing(&g_sharedRing);
+		return false;
+	}
+
+	// Layout: chunk size, operation type, name length, name, capacity.
+	// The chunk size is written by hand, the offer must never end up in a batch.
+	size_t offset = 0;
+	uint32_t chunkSize = (uint32_t)(totalSize - sizeof(uint32_t));
+	uint32_t operationType = UseSharedMemory;
+
+	memcpy((void*)(pBuffer + offset), (void*)&chunkSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&nameLength, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)g_sharedRing.name, nameLength);
+	offset += nameLength;
+
+	memcpy((void*)(pBuffer + offset), (void*)&capacity, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	// Part of the handshake, it goes straight to the transport
+	BIRDIE_SEND_BUFFER buffer = { pBuffer, offset };
+
+	if (!Birdie_SendRaw(&buffer, 1))
+	{
+		Birdie_DestroySharedRing(&g_sharedRing);
+		return false;
+	}
+
+	// The tool answers with 1 if it attached to the ring
+	uint32_t answer = 0;
+
+	if (!Birdie_WaitForToolAnswer(SharedMemoryAnswer, &answer) || answer != 1)
+	{
+		Birdie_DestroySharedRing(&g_sharedRing);
+		return false;
+	}
+
+	g_isUsingSharedRing = true;
+
+	return true;
+}
 
-	EnterCriticalSection(&g_csBuffer);
+bool Birdie_NegotiateCompression()
+{
+	// Layout: chunk size, operation type, compression method
+	char offer[sizeof(uint32_t) * 3];
+
+	uint32_t chunkSize = sizeof(uint32_t) * 2;
+	uint32_t operationType = UseCompression;
+	uint32_t method = BIRDIE_COMPRESSION_METHOD_LZ4;
+
+	size_t offset = 0;
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+	memcpy((void*)(offer + offset), (void*)&chunkSize, sizeof(uint32_t));
 	offset += sizeof(uint32_t);
 
-	memcpy((void*)(g_scratchBuffer + offset), (void*)&handle, sizeof(BIRDIE_HANDLE));
-	offset += sizeof(BIRDIE_HANDLE);
+	memcpy((void*)(offer + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(offer + offset), (void*)&method, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	// Part of the handshake, it goes straight to the transport
+	BIRDIE_SEND_BUFFER buffer = { offer, offset };
+
+	if (!Birdie_SendRaw(&buffer, 1))
+		return false;
+
+	// The tool answers with 1 if it can decompress frames
+	uint32_t answer = 0;
+
+	if (!Birdie_WaitForToolAnswer(CompressionAnswer, &answer) || answer != 1)
+		return false;
+
+	g_isCompressing = true;
+
+	return true;
+}
+
+bool Birdie_StartSender()
+{
+	if (Birdie_QueueCreate(&g_sendQueue, g_asyncQueueSize, g_asyncOverflowPolicy) != BIRDIE_SUCCESS)
+		return false;
+
+	g_senderSleeping = 0;
+	g_senderStop = 0;
+
+	// Auto-reset, a single wake-up is enough for the single consumer
+	g_senderWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	if (g_senderWakeEvent != NULL)
+		g_senderThread = CreateThread(NULL, 0, Birdie_SenderThread, NULL, 0, NULL);
+
+	if (g_senderThread == NULL)
+	{
+		if (g_senderWakeEvent != NULL)
+			CloseHandle(g_senderWakeEvent);
+
+		g_senderWakeEvent = NULL;
+		Birdie_QueueDestroy(&g_sendQueue);
+
+		return false;
+	}
+
+	return true;
+}
+
+void Birdie_StopSender()
+{
+	if (g_senderThread == NULL)
+		return;
+
+	Birdie_Flush();
+
+	// The sender drains whatever is left before it exits, then let go of any blocked producers
+	InterlockedExchange(&g_senderStop, 1);
+	SetEvent(g_senderWakeEvent);
+	WaitForSingleObject(g_senderThread, INFINITE);
+
+	Birdie_QueueClose(&g_sendQueue);
+
+	HANDLE senderThread = g_senderThread;
+	g_senderThread = NULL;
+
+	CloseHandle(senderThread);
+	CloseHandle(g_senderWakeEvent);
+	g_senderWakeEvent = NULL;
+
+	Birdie_QueueDestroy(&g_sendQueue);
+}
+
+void Birdie_WakeSender()
+{
+	// Only pay for SetEvent when the sender thread is actually asleep
+	if (g_senderSleeping && InterlockedExchange(&g_senderSleeping, 0))
+		SetEvent(g_senderWakeEvent);
+}
+
+DWORD WINAPI Birdie_SenderThread(LPVOID pParameter)
+{
+	BIRDIE_QUEUE_RECORD record;
+
+	for (;;)
+	{
+		if (Birdie_QueuePeek(&g_sendQueue, &record))
+		{
+			size_t queueSize = Birdie_QueueGetSize(&g_sendQueue);
+
+			if (queueSize > g_sendStats.queueHighWaterBytes)
+				g_sendStats.queueHighWaterBytes = queueSize;
+
+			// A record that wraps around the end of its segment still goes out in a single send
+			BIRDIE_SEND_BUFFER buffers[2] =
+			{
+				{ record.pSpans[0], record.spanSizes[0] },
+				{ record.pSpans[1], record.spanSizes[1] }
+			};
+
+			// Records meant for a lost connection are dropped, a new connection is brought up to date by the replay
+			bool isDiscarded = !g_isConnected;
+			bool isSent = isDiscarded ? true : Birdie_SendRaw(buffers, 2);
+
+			Birdie_QueuePop(&g_sendQueue, &record);
+
+			if (isDiscarded || !isSent)
+				g_sendStats.droppedCount++;
+
+			if (!isSent)
+			{
+				Birdie_OnConnectionLost();
+
+				// Without reconnecting the tool is gone for good, stop accepting new data
+				if (g_reconnectThread == NULL)
+				{
+					Birdie_QueueClose(&g_sendQueue);
+					break;
+				}
+			}
+
+			continue;
+		}
+
+		if (g_senderStop)
+			break;
+
+		// Announce that we're going to sleep, then check once more to not miss a wake-up
+		InterlockedExchange(&g_senderSleeping, 1);
 
-	WSA_ERROR wsaError = Birdie_SendData(offset);
+		if (!Birdie_QueuePeek(&g_sendQueue, &record))
+		{
+			// Nothing was sent for a while, a good moment to see if the tool has something for us
+			if (WaitForSingleObject(g_senderWakeEvent, 10) == WAIT_TIMEOUT && g_isConnected)
+				Birdie_PollTool();
+		}
+
+		InterlockedExchange(&g_senderSleeping, 0);
+	}
+
+	return 0;
+}
+
+void Birdie_OnConnectionLost()
+{
+	// Called by whoever failed to send, while nobody else is using the transport
+	g_isConnected = false;
+	g_birdieLogLevelThreshold = BIRDIE_LOG_LEVEL_NONE;
+
+	g_sendStats.connectionLostCount++;
+
+	if (g_reconnectEvent != NULL)
+		SetEvent(g_reconnectEvent);
+}
+
+bool Birdie_StartReconnecting(const char* pAddress, const char* pPort)
+{
+	size_t addressLength = strlen(pAddress);
+	size_t portLength = strlen(pPort);
+
+	g_pReconnectAddress = (char*)g_allocFunction(addressLength + 1);
+	g_pReconnectPort = (char*)g_allocFunction(portLength + 1);
+
+	if (g_pReconnectAddress != NULL && g_pReconnectPort != NULL)
+	{
+		memcpy((void*)g_pReconnectAddress, (void*)pAddress, addressLength + 1);
+		memcpy((void*)g_pReconnectPort, (void*)pPort, portLength + 1);
+
+		g_reconnectStop = 0;
+
+		// Auto-reset, set once for every lost connection and once more to stop
+		g_reconnectEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+		if (g_reconnectEvent != NULL)
+			g_reconnectThread = CreateThread(NULL, 0, Birdie_ReconnectThread, NULL, 0, NULL);
+	}
+
+	if (g_reconnectThread == NULL)
+	{
+		Birdie_StopReconnecting();
+		return false;
+	}
+
+	return true;
+}
+
+void Birdie_StopReconnecting()
+{
+	if (g_reconnectThread != NULL)
+	{
+		// Only noticed in between attempts, an attempt that's underway is finished first
+		InterlockedExchange(&g_reconnectStop, 1);
+		SetEvent(g_reconnectEvent);
+		WaitForSingleObject(g_reconnectThread, INFINITE);
+
+		CloseHandle(g_reconnectThread);
+		g_reconnectThread = NULL;
+	}
+
+	if (g_reconnectEvent != NULL)
+		CloseHandle(g_reconnectEvent);
 
-	LeaveCriticalSection(&g_csBuffer);
+	if (g_pReconnectAddress != NULL)
+		g_deallocFunction(g_pReconnectAddress);
 
-	if (wsaError != 0)
+	if (g_pReconnectPort != NULL)
+		g_deallocFunction(g_pReconnectPort);
+
+	g_reconnectEvent = NULL;
+	g_pReconnectAddress = NULL;
+	g_pReconnectPort = NULL;
+}
+
+DWORD WINAPI Birdie_ReconnectThread(LPVOID pParameter)
+{
+	while (g_reconnectStop == 0)
+	{
+		// Sleeps until the connection is lost
+		WaitForSingleObject(g_reconnectEvent, INFINITE);
+
+		DWORD delay = g_reconnectInitialDelay;
+
+		while (g_reconnectStop == 0 && g_isConnected == false)
+		{
+			// The stop request wakes us up early
+			WaitForSingleObject(g_reconnectEvent, delay);
+
+			if (g_reconnectStop)
+				break;
+
+			BIRDIE_TRANSPORT* pTransport = Birdie_CreateSocketTransport(g_pReconnectAddress, g_pReconnectPort);
+
+			// The session takes the transport either way, a failed handshake is simply retried
+			if (pTransport != NULL && Birdie_ResumeSession(pTransport) == BIRDIE_SUCCESS)
+				break;
+
+			delay = delay * 2 < g_reconnectMaxDelay ? delay * 2 : g_reconnectMaxDelay;
+		}
+	}
+
+	return 0;
+}
+
+BIRDIE_ERROR Birdie_RecordZoneEvent(BIRDIE_ZONE zone, BIRDIE_ZONE_EVENT_KIND kind)
+{
+	// Read first, so that our own overhead is left out of the zone as much as possible
+	uint64_t timestamp = Birdie_ReadTimestamp();
+
+	if (!g_isConnected)
 		return BIRDIE_ERROR_NOT_CONNECTED;
 
+	if (zone == 0)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
+
+	if (pContext == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	if (pContext->pZoneEvents == NULL)
+	{
+		pContext->pZoneEvents = (BIRDIE_ZONE_EVENT*)g_allocFunction(sizeof(BIRDIE_ZONE_EVENT) * BIRDIE_ZONE_BUFFER_EVENTS);
+
+		if (pContext->pZoneEvents == NULL)
+			return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	ULONG writeIndex = (ULONG)pContext->zoneWriteIndex;
+
+	if (writeIndex - (ULONG)ReadAcquire(&pContext->zoneReadIndex) >= BIRDIE_ZONE_BUFFER_EVENTS)
+	{
+		// Full, the events are sent right away. Another thread may already be doing that for us.
+		Birdie_FlushZones(pContext);
+
+		if (writeIndex - (ULONG)ReadAcquire(&pContext->zoneReadIndex) >= BIRDIE_ZONE_BUFFER_EVENTS)
+		{
+			pContext->stats.droppedCount++;
+			return BIRDIE_ERROR_QUEUE_FULL;
+		}
+	}
+
+	BIRDIE_ZONE_EVENT* pEvent = &pContext->pZoneEvents[writeIndex & (BIRDIE_ZONE_BUFFER_EVENTS - 1)];
+
+	pEvent->timestamp = timestamp;
+	pEvent->zone = zone;
+	pEvent->kind = kind;
+
+	// Hands the event to whoever flushes next, no barrier needed
+	WriteRelease(&pContext->zoneWriteIndex, (LONG)(writeIndex + 1));
+
 	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_FlushZones(BIRDIE_THREAD_CONTEXT* pContext)
+{
+	while (InterlockedExchange(&pContext->zoneFlushLock, 1) != 0)
+		YieldProcessor();
+
+	ULONG writeIndex = (ULONG)ReadAcquire(&pContext->zoneWriteIndex);
+	ULONG readIndex = (ULONG)pContext->zoneReadIndex;
+
+	if (writeIndex == readIndex)
+	{
+		InterlockedExchange(&pContext->zoneFlushLock, 0);
+		return BIRDIE_SUCCESS;
+	}
+
+	// Layout: operation type, thread id, timestamp frequency (8b), count, then the events as they are in the buffer
+	uint32_t count = writeIndex - readIndex;
+	uint32_t operationType = AddZones;
+	uint32_t threadId = (uint32_t)pContext->threadId;
+	uint64_t frequency = Birdie_GetTimestampFrequency();
+
+	char header[sizeof(uint32_t) * 3 + sizeof(uint64_t)];
+	size_t offset = 0;
+
+	memcpy((void*)(header + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(header + offset), (void*)&threadId, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(header + offset), (void*)&frequency, sizeof(uint64_t));
+	offset += sizeof(uint64_t);
+
+	memcpy((void*)(header + offset), (void*)&count, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	// The events are sent straight from the ring, in two spans when they wrap around its end
+	uint32_t firstIndex = readIndex & (BIRDIE_ZONE_BUFFER_EVENTS - 1);
+	uint32_t firstCount = BIRDIE_ZONE_BUFFER_EVENTS - firstIndex;
+
+	if (firstCount > count)
+		firstCount = count;
+
+	BIRDIE_SEND_BUFFER buffers[] =
+	{
+		{ header, sizeof(header) },
+		{ pContext->pZoneEvents + firstIndex, sizeof(BIRDIE_ZONE_EVENT) * firstCount },
+		{ pContext->pZoneEvents, sizeof(BIRDIE_ZONE_EVENT) * (count - firstCount) }
+	};
+
+	BIRDIE_ERROR error = Birdie_SendDataV(buffers, firstCount < count ? 3 : 2);
+
+	// The events were copied or sent, or are lost along with the connection either way
+	WriteRelease(&pContext->zoneReadIndex, (LONG)writeIndex);
+
+	InterlockedExchange(&pContext->zoneFlushLock, 0);
+
+	return error;
+}
+
+void Birdie_FlushAllZones()
+{
+	for (BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContexts(); pContext != NULL; pContext = pContext->pNext)
+	{
+		if (pContext->zoneWriteIndex != pContext->zoneReadIndex)
+			Birdie_FlushZones(pContext);
+	}
+}
+
+void Birdie_RefreshPublishedStats()
+{
+	// Collected aside first, the tool may be reading the published copy at any time
+	BIRDIE_STATS stats;
+	Birdie_CollectStats(&stats, &g_sendStats, &g_compressionStats);
+
+	memcpy((void*)&g_publishedStats, (void*)&stats, sizeof(BIRDIE_STATS));
+}
+
+bool Birdie_StartSampler()
+{
+	g_samplerStop = 0;
+
+	// Auto-reset, woken for new sampled watches and for rings the tool asks for
+	g_samplerWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	if (g_samplerWakeEvent != NULL)
+		g_samplerThread = CreateThread(NULL, 0, Birdie_SamplerThread, NULL, 0, NULL);
+
+	if (g_samplerThread == NULL)
+	{
+		if (g_samplerWakeEvent != NULL)
+			CloseHandle(g_samplerWakeEvent);
+
+		g_samplerWakeEvent = NULL;
+
+		return false;
+	}
+
+	return true;
+}
+
+void Birdie_StopSampler()
+{
+	if (g_samplerThread == NULL)
+		return;
+
+	InterlockedExchange(&g_samplerStop, 1);
+	SetEvent(g_samplerWakeEvent);
+	WaitForSingleObject(g_samplerThread, INFINITE);
+
+	HANDLE samplerThread = g_samplerThread;
+	g_samplerThread = NULL;
+
+	CloseHandle(samplerThread);
+	CloseHandle(g_samplerWakeEvent);
+	g_samplerWakeEvent = NULL;
+}
+
+DWORD WINAPI Birdie_SamplerThread(LPVOID pParameter)
+{
+	// Sleeps are rounded up to the timer resolution, which is far too coarse for sampling by default
+	timeBeginPeriod(1);
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	while (!g_samplerStop)
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		LONGLONG nextSample = 0;
+		DWORD waitTime = INFINITE;
+
+		// Out of memory, try again in a bit
+		if (Birdie_SampleWatches(now.QuadPart, &nextSample) != BIRDIE_SUCCESS)
+			waitTime = 100;
+
+		Birdie_SendSampleRings();
+
+		if (nextSample != 0)
+		{
+			QueryPerformanceCounter(&now);
+
+			// Rounded up, waking early would only mean waiting once more
+			LONGLONG remaining = nextSample - now.QuadPart;
+			waitTime = remaining <= 0 ? 0 : (DWORD)((remaining * 1000 + frequency.QuadPart - 1) / frequency.QuadPart);
+		}
+
+		if (waitTime != 0)
+			WaitForSingleObject(g_samplerWakeEvent, waitTime);
+	}
+
+	timeEndPeriod(1);
+
+	return 0;
+}
+
+BIRDIE_ERROR Birdie_SampleWatches(LONGLONG now, LONGLONG* pNextSample)
+{
+	// Layout: chunk size, operation type, count, then the windows as they are in BIRDIE_SAMPLE_WINDOW
+	size_t headerSize = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint32_t);
+	size_t totalSize = 0;
+	uint32_t windowCount = 0;
+
+	// The registry keeps watches from going away while they're read, the windows are ours once they're taken
+	Birdie_LockWatchRegistry();
+
+	char* pBuffer = Birdie_TakeSamples(now, headerSize, &totalSize, &windowCount, pNextSample);
+
+	Birdie_UnlockWatchRegistry();
+
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	// Samples are still taken without a connection, the rings are there for the next one
+	if (windowCount == 0 || g_isConnected == false)
+		return BIRDIE_SUCCESS;
+
+	uint32_t chunkSize = (uint32_t)(totalSize - sizeof(uint32_t));
+	uint32_t operationType = AddSampleWindows;
+
+	size_t offset = 0;
+
+	memcpy((void*)(pBuffer + offset), (void*)&chunkSize, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&windowCount, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	Birdie_CountOperation(Birdie_GetThreadContext(), operationType, totalSize);
+
+	return Birdie_SendChunk(pBuffer, totalSize);
+}
+
+void Birdie_SendSampleRings()
+{
+	// Layout: chunk size, operation type, then the ring as described by Birdie_CopyRequestedSampleRing
+	size_t headerSize = sizeof(uint32_t) + sizeof(uint32_t);
+	size_t totalSize = 0;
+
+	for (char* pBuffer; (pBuffer = Birdie_CopyRequestedSampleRing(headerSize, &totalSize)) != NULL;)
+	{
+		if (g_isConnected == false)
+			continue;
+
+		uint32_t chunkSize = (uint32_t)(totalSize - sizeof(uint32_t));
+		uint32_t operationType = SampleRing;
+
+		memcpy((void*)pBuffer, (void*)&chunkSize, sizeof(uint32_t));
+		memcpy((void*)(pBuffer + sizeof(uint32_t)), (void*)&operationType, sizeof(uint32_t));
+
+		Birdie_CountOperation(Birdie_GetThreadContext(), operationType, totalSize);
+
+		Birdie_SendChunk(pBuffer, totalSize);
+	}
+}
+
+BIRDIE_ERROR Birdie_RemoveWatchObject(BIRDIE_HANDLE handle)
+{
+	if (Birdie_RemoveWatchEntry(handle) != BIRDIE_SUCCESS)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	if (g_isConnected == false)
+		return BIRDIE_ERROR_NOT_CONNECTED;
+
+	size_t offset = 0;
+	uint32_t operationType = RemoveWatchObject;
+
+	char* pBuffer = Birdie_GetScratchBuffer(sizeof(uint32_t) + sizeof(BIRDIE_HANDLE));
+
+	if (pBuffer == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	memcpy((void*)(pBuffer + offset), (void*)&operationType, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(pBuffer + offset), (void*)&handle, sizeof(BIRDIE_HANDLE));
+	offset += sizeof(BIRDIE_HANDLE);
+
+	return Birdie_SendData(pBuffer, offset);
 }
\ No newline at end of file
@@ -1,24 +1,42 @@
 #ifndef BIRDIEAPI_MAIN_H
 #define BIRDIEAPI_MAIN_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "Common.h"
 
 // This header contains the main Birdie API functions
 
+#if defined(_WIN32)
 #ifdef BIRDIEAPI_EXPORTS
 #define BIRDIEAPI extern "C" __declspec(dllexport)
 #else
 #define BIRDIEAPI extern "C" __declspec(dllimport)
 #endif
+#else
+#define BIRDIEAPI extern "C" __attribute__((visibility("default")))
+#endif
 
 typedef void* (*BIRDIE_ALLOCATION_FUNCTION)(size_t);
 typedef void(*BIRDIE_DEALLOCATION_FUNCTION)(void*);
 
+// Receives the encoded stream when initialized with Birdie_InitializeWithSink
+typedef void(*BIRDIE_SINK_FUNCTION)(void* pUserData, const void* pData, size_t size);
+
 typedef uint32_t BIRDIE_HANDLE;
 typedef BIRDIE_HANDLE *LPBIRDIE_HANDLE;
 
+// Filter registered with Birdie_RegisterLogFilter, valid until Birdie_Terminate
+typedef uint32_t BIRDIE_LOG_FILTER;
+typedef BIRDIE_LOG_FILTER *LPBIRDIE_LOG_FILTER;
+
+#define BIRDIE_LOG_FILTER_NONE ((BIRDIE_LOG_FILTER)0)
+
+// Zone registered with Birdie_RegisterZone, valid until Birdie_Terminate
+typedef uint32_t BIRDIE_ZONE;
+typedef BIRDIE_ZONE *LPBIRDIE_ZONE;
+
 typedef int BIRDIE_ERROR;
 typedef const char* BIRDIE_TYPE;
 
@@ -37,6 +55,12 @@ typedef const char* BIRDIE_TYPE;
 #define BIRDIE_TYPE_UTF8_STRING "UTF8String"
 #define BIRDIE_TYPE_HEX_PATTERN "HEXPattern"
 
+// Type of the watches added by Birdie_AddImageWatch, it can't be used with Birdie_AddWatch
+#define BIRDIE_TYPE_IMAGE       "Image"
+
+// Type of the watches added by Birdie_AddArrayWatch, it can't be used with Birdie_AddWatch
+#define BIRDIE_TYPE_ARRAY       "Array"
+
 #define BIRDIE_SIZE_BOOL        sizeof(bool)
 #define BIRDIE_SIZE_INT8	    sizeof(int8_t)
 #define BIRDIE_SIZE_INT16	    sizeof(int16_t)
@@ -56,9 +80,120 @@ typedef enum
 	BIRDIE_ERROR_INSUFFICIENT_MEMORY,
 	BIRDIE_ERROR_INVALID_PARAMS,
 	BIRDIE_ERROR_TYPE_PREEXISTING,
-	BIRDIE_ERROR_NOT_CONNECTED
+	BIRDIE_ERROR_NOT_CONNECTED,
+	BIRDIE_ERROR_QUEUE_FULL
 } BIRDIE_ERRORS;
 
+typedef struct
+{
+	const char*   pName;
+	BIRDIE_TYPE   type;
+	void*         pBase;
+	size_t        dataSizeBytes;
+	BIRDIE_HANDLE parent;
+} BIRDIE_WATCH_DESCRIPTOR;
+
+// A field of every element of an array watch, see Birdie_AddArrayWatch
+typedef struct
+{
+	const char*   pName;
+	BIRDIE_TYPE   type;
+	size_t        offset;          // From the base of the array to the field of the first element
+	size_t        dataSizeBytes;
+	size_t        stride;          // From the field of one element to that of the next, 0 uses the stride of the array
+} BIRDIE_ARRAY_FIELD;
+
+typedef struct
+{
+	const char*               pName;
+	void*                     pBase;
+	size_t                    elementCount;
+	size_t                    stride;
+	const BIRDIE_ARRAY_FIELD* pFields;
+	size_t                    fieldCount;
+	BIRDIE_HANDLE             parent;
+} BIRDIE_ARRAY_DESCRIPTOR;
+
+typedef enum
+{
+	BIRDIE_OVERFLOW_DROP = 0,
+	BIRDIE_OVERFLOW_BLOCK,
+	BIRDIE_OVERFLOW_GROW
+} BIRDIE_OVERFLOW_POLICY;
+
+// Layout of the pixels of an image watch, channels are listed in the order of their bytes
+typedef enum
+{
+	BIRDIE_PIXEL_FORMAT_RGBA8 = 0,
+	BIRDIE_PIXEL_FORMAT_BGRA8,
+	BIRDIE_PIXEL_FORMAT_R8
+} BIRDIE_PIXEL_FORMAT;
+
+// Arguments of deferred log messages are encoded as a kind (1b) followed by the value.
+// Strings are a length (4b) followed by the characters, pointers are always 8 bytes.
+typedef enum
+{
+	BIRDIE_LOG_ARGUMENT_INT32 = 1,
+	BIRDIE_LOG_ARGUMENT_UINT32,
+	BIRDIE_LOG_ARGUMENT_INT64,
+	BIRDIE_LOG_ARGUMENT_UINT64,
+	BIRDIE_LOG_ARGUMENT_FLOAT64,
+	BIRDIE_LOG_ARGUMENT_STRING,
+	BIRDIE_LOG_ARGUMENT_POINTER
+} BIRDIE_LOG_ARGUMENT_KIND;
+
+// Severity of a log message. Messages below the threshold set by Birdie_SetLogLevel, or by the tool, are dropped.
+// Messages logged without a level are logged as BIRDIE_LOG_LEVEL_INFO.
+typedef enum
+{
+	BIRDIE_LOG_LEVEL_TRACE = 0,
+	BIRDIE_LOG_LEVEL_DEBUG,
+	BIRDIE_LOG_LEVEL_INFO,
+	BIRDIE_LOG_LEVEL_WARNING,
+	BIRDIE_LOG_LEVEL_ERROR,
+	BIRDIE_LOG_LEVEL_NONE   // Only valid as a threshold, drops everything
+} BIRDIE_LOG_LEVEL;
+
+// What the library did during the current session, see Birdie_GetStats. All times are in nanoseconds.
+// Every field is a uint64_t, so that the whole structure can be watched as is.
+typedef struct
+{
+	// Operations that were encoded, by kind. Metadata is what the library sends along the way: strings, log formats and handlers.
+	uint64_t logMessageCount;
+	uint64_t watchOperationCount;
+	uint64_t removeOperationCount;
+	uint64_t publishCount;
+	uint64_t zoneFlushCount;
+	uint64_t metadataOperationCount;
+
+	// Bytes of all encoded operations, before batching and compression
+	uint64_t encodedBytes;
+
+	// Calls into the transport, the bytes they carried and the time spent in them
+	uint64_t sendCount;
+	uint64_t sentBytes;
+	uint64_t sendBlockedTime;
+
+	// Synchronous sends that found the send lock taken, and the time spent waiting for it
+	uint64_t sendLockContentionCount;
+	uint64_t sendLockWaitTime;
+
+	// Most bytes waiting in the asynchronous send queue at any one time
+	uint64_t queueHighWaterBytes;
+
+	// Chunks that were rejected by a full queue or lost along with the connection
+	uint64_t droppedCount;
+
+	uint64_t connectionLostCount;
+	uint64_t reconnectCount;
+
+	// Frames that were sent to a remote tool while compression was on
+	uint64_t compressedFrameCount;
+	uint64_t uncompressedBytes;
+	uint64_t compressedBytes;
+	uint64_t compressionTime;
+} BIRDIE_STATS;
+
 
 // Control functions
 
@@ -78,8 +213,76 @@ typedef enum
 /// </returns>
 BIRDIEAPI BIRDIE_ERROR Birdie_SetMemoryHandlers(BIRDIE_ALLOCATION_FUNCTION allocationFunction, BIRDIE_DEALLOCATION_FUNCTION deallocationFunction);
 
+/// <summary>
+///		Enables asynchronous sending. API calls then only copy their data into a lock-free queue,
+///		which is drained to the tool by a background thread. This needs to be called before initialization.
+/// </summary>
+/// <param name="queueSizeBytes">
+///		Size of the queue in bytes, rounded up to a power of two. Use '0' to go back to blocking sends.
+/// </param>
+/// <param name="overflowPolicy">
+///		What to do when the queue is full:
+///		* BIRDIE_OVERFLOW_DROP discards the call and returns BIRDIE_ERROR_QUEUE_FULL.
+///		  Calls with more data than the whole queue holds are the exception, they would never fit. Their data is cut
+///		  into fragments that do fit, and the call waits for the background thread to make room for every one of them.
+///		* BIRDIE_OVERFLOW_BLOCK waits for the background thread to make room.
+///		* BIRDIE_OVERFLOW_GROW allocates a bigger queue segment using the memory handlers.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the policy is unknown or the API is already initialized.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_SetAsyncMode(size_t queueSizeBytes, BIRDIE_OVERFLOW_POLICY overflowPolicy);
+
+/// <summary>
+///		Enables the shared-memory transport. When the tool runs on the same machine, Birdie_Initialize offers it
+///		a shared ring buffer and all data is sent through that instead of the socket. Tools on other machines,
+///		or tools that don't answer the offer, keep using the socket. This needs to be called before initialization.
+/// </summary>
+/// <param name="ringSizeBytes">
+///		Size of the ring in bytes, rounded up to a power of two (64k minimum). Use '0' to only use the socket.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the API is already initialized.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_SetSharedMemoryMode(size_t ringSizeBytes);
+
+/// <summary>
+///		Enables frame compression for tools on other machines. Birdie_Initialize offers it to the tool, and once the tool agrees,
+///		every frame of at least the threshold size is compressed right before it's sent. In asynchronous mode that's done
+///		on the background thread. Frames that don't get any smaller are sent as they are. This needs to be called before initialization.
+/// </summary>
+/// <param name="thresholdBytes">
+///		Frames smaller than this are never compressed. Use '0' to never compress.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the API is already initialized.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_SetCompressionMode(size_t thresholdBytes);
+
+/// <summary>
+///		Keeps reconnecting to the tool in the background when the connection made by Birdie_Initialize is lost.
+///		Every new connection is sent all registered strings, log formats, custom type handlers and watches in one batch,
+///		so the tool ends up in the same state. Calls made while disconnected return BIRDIE_ERROR_NOT_CONNECTED.
+///		Birdie_Terminate waits for a connection attempt that is underway. This needs to be called before initialization.
+/// </summary>
+/// <param name="initialDelayMs">
+///		Delay before the first attempt, doubled after every failed attempt. Use '0' to never reconnect.
+/// </param>
+/// <param name="maxDelayMs">
+///		Upper bound for the delay between attempts.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if maxDelayMs is smaller than initialDelayMs or the API is already initialized.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_SetReconnectMode(uint32_t initialDelayMs, uint32_t maxDelayMs);
+
 /// <summary>
 ///		Initializes the global Birdie API context and tries to connect to the Birdie tool.
+///		Watches, strings and custom type handlers registered before this call are sent once connected.
 /// </summary>
 /// <param name="challengeKey">
 ///		A 64bit key that is matched against the key set by the tool.
@@ -94,12 +297,101 @@ BIRDIEAPI BIRDIE_ERROR Birdie_SetMemoryHandlers(BIRDIE_ALLOCATION_FUNCTION alloc
 /// <returns>
 ///		* Returns BIRDIE_SUCCESS on success.
 ///		* Returns BIRDIE_ERROR_COULD_NOT_CONNECT upon failure,
-///		please use WSAGetLastError for more detailed WinSock error information.
+///		please use WSAGetLastError (or errno outside of Windows) for more detailed socket error information.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the API is already initialized.
 /// </returns>
 BIRDIEAPI BIRDIE_ERROR Birdie_Initialize(uint64_t challengeKey, const char* pAddress, const char* pPort);
 
+/// <summary>
+///		Initializes the global Birdie API context without a tool, the encoded stream is handed to a function instead.
+///		The stream is exactly what the tool would receive, starting with a zero challenge key.
+///		This is mostly useful for measuring the API itself, or for capturing a session.
+/// </summary>
+/// <param name="sinkFunction">
+///		Called with every piece of the stream, in order. Calls are never made concurrently.
+///		The data is only valid for the duration of the call.
+/// </param>
+/// <param name="pUserData">
+///		Passed along to every call of sinkFunction.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if sinkFunction is NULL or the API is already initialized.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the sink could not be allocated.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_InitializeWithSink(BIRDIE_SINK_FUNCTION sinkFunction, void* pUserData);
+
+/// <summary>
+///		Initializes the global Birdie API context without a tool, the encoded stream is recorded to a trace file instead.
+///		The trace is written through memory mappings of pre-sized segments named "[pPath].0", "[pPath].1" and so on,
+///		only moving on to the next segment costs system calls. Use Birdie_ReplayTraceFile to send it to a tool later.
+/// </summary>
+/// <param name="challengeKey">
+///		A 64bit key that is recorded with the stream, the tool the trace is replayed into has to expect it.
+/// </param>
+/// <param name="pPath">
+///		Path of the trace, without the segment suffix. Existing segments are overwritten.
+/// </param>
+/// <param name="segmentSizeBytes">
+///		Size of every segment file in bytes (64k minimum). The last segment is cut to size by Birdie_Terminate.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_COULD_NOT_CONNECT if the first segment could not be created.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if pPath is NULL or the API is already initialized.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_InitializeWithTraceFile(uint64_t challengeKey, const char* pPath, size_t segmentSizeBytes);
+
+/// <summary>
+///		Sends a trace recorded with Birdie_InitializeWithTraceFile to a tool, over a connection of its own.
+///		This does not need the API to be initialized, and blocks until the whole trace has been sent.
+/// </summary>
+/// <param name="pPath">
+///		Path of the trace, as passed to Birdie_InitializeWithTraceFile.
+/// </param>
+/// <param name="pAddress">
+///		The IP address or resolvable host name of the tool.
+/// </param>
+/// <param name="pPort">
+///		The port the tool is listening on.
+/// </param>
+/// <param name="speed">
+///		'1' keeps the original timing, '2' replays twice as fast and so on. Use '0' to send everything right away.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success, a trace cut short by a crash is replayed up until its last complete piece.
+///		* Returns BIRDIE_ERROR_COULD_NOT_CONNECT if the tool could not be reached, or the connection was lost.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed, or the trace could not be opened.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_ReplayTraceFile(const char* pPath, const char* pAddress, const char* pPort, float speed);
+
+/// <summary>
+///		Hands a trace recorded with Birdie_InitializeWithTraceFile to a function, exactly the way Birdie_InitializeWithSink would have.
+///		This does not need the API to be initialized, and blocks until the whole trace has been handed over.
+/// </summary>
+/// <param name="pPath">
+///		Path of the trace, as passed to Birdie_InitializeWithTraceFile.
+/// </param>
+/// <param name="sinkFunction">
+///		Called with every piece of the stream, in order. The data is only valid for the duration of the call.
+/// </param>
+/// <param name="pUserData">
+///		Passed along to every call of sinkFunction.
+/// </param>
+/// <param name="speed">
+///		'1' keeps the original timing, '2' replays twice as fast and so on. Use '0' to hand over everything right away.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed, or the trace could not be opened.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_ReplayTraceFileToSink(const char* pPath, BIRDIE_SINK_FUNCTION sinkFunction, void* pUserData, float speed);
+
 /// <summary>
 ///		Terminates any active connection to the Birdie tool.
+///		This also releases the per-thread scratch buffers, other threads should not be calling into the API at this point.
 /// </summary>
 /// <returns>
 ///		* Returns BIRDIE_SUCCESS on success.
@@ -108,18 +400,76 @@ BIRDIEAPI BIRDIE_ERROR Birdie_Initialize(uint64_t challengeKey, const char* pAdd
 /// </returns>
 BIRDIEAPI BIRDIE_ERROR Birdie_Terminate(void);
 
+/// <summary>
+///		Blocks until everything that was queued before this call has been handed to the network.
+///		Pending automatic batches are sent first.
+/// </summary>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_Flush(void);
+
+
+// Batch functions
+
+/// <summary>
+///		Starts a batch on the calling thread. Until the matching Birdie_EndBatch, operations from this thread are
+///		collected and sent to the tool as a single chunk. Batches can be nested, only the outermost one is sent.
+/// </summary>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the thread's state could not be allocated.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_BeginBatch(void);
+
+/// <summary>
+///		Ends a batch started with Birdie_BeginBatch and sends it once the outermost batch has ended.
+/// </summary>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if there is no batch to end.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the batch was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_EndBatch(void);
+
+/// <summary>
+///		Enables or disables automatic batching. When enabled, every thread collects its operations in a batch which
+///		is sent when it fills up, or at the latest when Birdie_EndFrame or Birdie_Flush is called.
+///		Note that operations from different threads are then only ordered per batch.
+/// </summary>
+/// <param name="enabled">
+///		Whether to batch automatically. Disabling sends all pending batches.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_SetAutoBatching(bool enabled);
+
+/// <summary>
+///		Marks the end of a frame. Sends the automatic batches and the zone events of all threads.
+/// </summary>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_EndFrame(void);
+
 
 // Watch functions
 
 /// <summary>
 ///		Creates a new watch category.
-///		A valid handle is returned, even if there is no connection.
+///		A valid handle is returned, even if there is no connection. Handles carry a generation, so a handle stays
+///		invalid after its category is removed, even if the slot is reused later on.
 /// </summary>
 /// <param name="pName">
 ///		Name of the category.
 /// </param>
 /// <param name="parent">
-///		Handle to a parent for this category. Optional, use '0' for no parent.
+///		Handle to a parent for this category. Optional, use '0' for no parent. Must not have been removed.
 /// </param>
 /// <param name="pHandle">
 ///		Pointer to a handle object in which the new watch category handle is stored.
@@ -141,7 +491,8 @@ BIRDIEAPI BIRDIE_ERROR Birdie_AddWatchCategory(const char* pName, BIRDIE_HANDLE
 /// </param>
 /// <returns>
 ///		* Returns BIRDIE_SUCCESS on success.
-///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the handle was already removed, or never valid.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool. The category is removed regardless.
 /// </returns>
 BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatchCategory(BIRDIE_HANDLE handle);
 
@@ -161,10 +512,11 @@ BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatchCategory(BIRDIE_HANDLE handle);
 /// </param>
 /// <param name="dataSizeBytes">
 ///		Determines the size in bytes to monitor. Use one of the BIRDIE_SIZE_* values if available.
-///		For strings and data using BIRDIE_TYPE_HEX, use an appropriate size value.
+///		For strings and data using BIRDIE_TYPE_HEX, use an appropriate size value. Must be less than 4 GB.
 /// </param>
 /// <param name="parent">
 ///		Handle to a parent. This can be a category, or a watch object. Optional, use '0' for no parent.
+///		Must not have been removed.
 /// </param>
 /// <param name="pHandle">
 ///		Pointer to a handle object in which the new watch handle is stored.
@@ -186,10 +538,174 @@ BIRDIEAPI BIRDIE_ERROR Birdie_AddWatch(const char* pName, BIRDIE_TYPE type, void
 /// </param>
 /// <returns>
 ///		* Returns BIRDIE_SUCCESS on success.
-///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the handle was already removed, or never valid.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool. The watch is removed regardless.
 /// </returns>
 BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatch(BIRDIE_HANDLE handle);
 
+/// <summary>
+///		Creates many watches at once. Handles are allocated under a single lock and the watches are sent to the
+///		tool in as few chunks as possible. Valid handles are returned, even if there is no connection.
+///		The handles aren't guaranteed to be consecutive.
+/// </summary>
+/// <param name="pDescriptors">
+///		Array of watch descriptors, see Birdie_AddWatch for the meaning of each field.
+/// </param>
+/// <param name="count">
+///		Number of descriptors in the array.
+/// </param>
+/// <param name="pHandles">
+///		Optional array of at least 'count' handles, in which the new watch handles are stored.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more descriptors were malformed or had a removed parent, no
+///		  watches are created then.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_AddWatches(const BIRDIE_WATCH_DESCRIPTOR* pDescriptors, size_t count, LPBIRDIE_HANDLE pHandles);
+
+/// <summary>
+///		Removes many watches or categories at once.
+///     This will also remove all of their child watch objects. Handles that were already removed are skipped,
+///		this includes children of a category earlier in the same array.
+/// </summary>
+/// <param name="pHandles">
+///		Array of handles to the watch objects that are to be deleted.
+/// </param>
+/// <param name="count">
+///		Number of handles in the array.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatches(const BIRDIE_HANDLE* pHandles, size_t count);
+
+/// <summary>
+///		Creates a single watch for an array of elements, instead of a watch per field of every element.
+///		Every field of every element has to lie within one block of memory, the watch spans that block and is read and
+///		published as a whole. The tool splits it into elements only when they're looked at.
+///		For an array of structures, give the array the size of a structure as stride and every field its offsetof().
+///		For a structure of arrays, give every field the offset of its own array and its element size as stride.
+///		The elements can't change in number, remove the watch and add it again when they do.
+/// </summary>
+/// <param name="pDescriptor">
+///		Describes the array and its fields, at most 256 of them. Field types are the same as for Birdie_AddWatch.
+/// </param>
+/// <param name="pHandle">
+///		Optional variable in which the handle of the watch is stored. Remove it with Birdie_RemoveWatch.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the descriptor was malformed, its parent was removed or the block is larger than 4 GB.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool, the watch is sent once there is.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_AddArrayWatch(const BIRDIE_ARRAY_DESCRIPTOR* pDescriptor, LPBIRDIE_HANDLE pHandle);
+
+/// <summary>
+///		Sends the current contents of every watch to the tool, in a single snapshot.
+///		Call this once per frame (e.g. next to Birdie_EndFrame) to get consistent values that don't tear between watches.
+///		The tool prefers published values over reading the process memory itself, and remote tools can only show
+///		watches that are published.
+///		Watches that are added inside an open batch are published once that batch has been sent.
+///		Only the watches (or parts of larger watches) that changed since the last publish are sent.
+/// </summary>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient space for the snapshot.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the snapshot was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_PublishWatches(void);
+
+/// <summary>
+///		Samples a watch from a thread of the library, at a rate far above what the tool can read (up to 1 kHz).
+///		Samples are aggregated into windows, and only the minimum, maximum, mean and last sample of every window are
+///		sent. The last few seconds of raw samples are kept in a ring, which the tool fetches when it needs them.
+///		Only watches of the numeric types and BIRDIE_TYPE_BOOL can be sampled. Sampling stops when the watch is removed,
+///		so its memory has to stay valid until then, just like for any other watch.
+/// </summary>
+/// <param name="handle">
+///		Handle of the watch.
+/// </param>
+/// <param name="sampleRateHz">
+///		Samples per second, at most 1000. Pass 0 to stop sampling the watch.
+/// </param>
+/// <param name="windowMs">
+///		Length of a window in milliseconds. Ignored when sampling stops.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the ring or the sampler thread could not be created.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the watch isn't live, can't be sampled, or the rate or window are malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if the library isn't initialized.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_SetWatchSampling(BIRDIE_HANDLE handle, uint32_t sampleRateHz, uint32_t windowMs);
+
+/// <summary>
+///		Adds a watch for an image, such as a framebuffer or a debug view. Its pixels are only sent by Birdie_PublishImage,
+///		the tool never reads them itself. The image is split into tiles of 64x64 pixels and only the tiles that changed
+///		since the last publish are sent, so a mostly static view costs little more than hashing it.
+///		Large images can be downscaled before they're sent, every sent pixel is the average of a box of pixels.
+/// </summary>
+/// <param name="pName">
+///		Name of the watch.
+/// </param>
+/// <param name="width">
+///		Width of the image in pixels.
+/// </param>
+/// <param name="height">
+///		Height of the image in pixels.
+/// </param>
+/// <param name="pitch">
+///		Distance between the starts of two rows in bytes, at least the width times the pixel size.
+/// </param>
+/// <param name="format">
+///		Layout of the pixels.
+/// </param>
+/// <param name="downscale">
+///		Edge of the box of pixels that becomes a single sent pixel, 1 sends the image as is. At most 16.
+/// </param>
+/// <param name="parent">
+///		Handle of the parent category, or 0 for the root.
+/// </param>
+/// <param name="pHandle">
+///		Receives the handle of the watch. Remove it with Birdie_RemoveWatch.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool, the watch is sent once there is.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the watch was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_AddImageWatch(const char* pName, uint32_t width, uint32_t height, uint32_t pitch, BIRDIE_PIXEL_FORMAT format, uint32_t downscale, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle);
+
+/// <summary>
+///		Sends the tiles of an image watch that changed since it was last published.
+///		The pixels only have to be valid during the call, so double-buffered images can pass whichever buffer is current.
+///		Tiles are sent in chunks of about 192 KB, the first publish (and the first after a reconnect) sends every tile.
+/// </summary>
+/// <param name="handle">
+///		Handle of the image watch.
+/// </param>
+/// <param name="pPixels">
+///		The first row of the image, laid out as given to Birdie_AddImageWatch.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient space for the tiles.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the handle isn't a live image watch or pPixels is null.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if tiles were dropped by the asynchronous sender, they're sent again next time.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_PublishImage(BIRDIE_HANDLE handle, const void* pPixels);
+
 
 // Log functions
 
@@ -201,17 +717,21 @@ BIRDIEAPI BIRDIE_ERROR Birdie_RemoveWatch(BIRDIE_HANDLE handle);
 /// </param>
 /// <param name="pMessage">
 ///		Pre-formatted message that is sent to the tool.
+///		The message is sent straight from this memory, so it is not limited by the scratch buffer size.
+///		Messages larger than 256 KB are cut into fragments that the tool puts back together.
 /// </param>
 /// <returns>
 ///		* Returns BIRDIE_SUCCESS on success.
 ///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
 ///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
 ///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the message was dropped by the asynchronous sender.
 /// </returns>
 BIRDIEAPI BIRDIE_ERROR Birdie_Log(const char* pFilter, const char* pMessage);
 
 /// <summary>
 ///		Logs a formatted message to the tool.
+///		Messages that don't fit in the scratch buffer are formatted into a temporary allocation instead.
 /// </summary>
 /// <param name="pFilter">
 ///		Optional filter, can be used to categorize. Use null or "" for no filter.
@@ -227,9 +747,283 @@ BIRDIEAPI BIRDIE_ERROR Birdie_Log(const char* pFilter, const char* pMessage);
 ///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
 ///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
 ///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the message was dropped by the asynchronous sender.
 /// </returns>
 BIRDIEAPI BIRDIE_ERROR Birdie_LogF(const char* pFilter, const char* pFormat, ...);
 
+/// <summary>
+///		Registers a log filter, so that messages can refer to it without hashing it on every call.
+///		Filters passed as strings are registered on first use as well, this only skips the lookup.
+/// </summary>
+/// <param name="pFilter">
+///		Filter to register. "" registers as BIRDIE_LOG_FILTER_NONE.
+/// </param>
+/// <param name="pLogFilter">
+///		Pointer to the variable that receives the filter. Only valid until Birdie_Terminate is called.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the filter could not be stored.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_RegisterLogFilter(const char* pFilter, LPBIRDIE_LOG_FILTER pLogFilter);
+
+/// <summary>
+///		Logs a message to the tool under a registered filter.
+/// </summary>
+/// <param name="logFilter">
+///		Filter returned by Birdie_RegisterLogFilter, or BIRDIE_LOG_FILTER_NONE.
+/// </param>
+/// <param name="pMessage">
+///		Pre-formatted message that is sent to the tool.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the message was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_LogFiltered(BIRDIE_LOG_FILTER logFilter, const char* pMessage);
+
+/// <summary>
+///		Logs a formatted message to the tool under a registered filter.
+/// </summary>
+/// <param name="logFilter">
+///		Filter returned by Birdie_RegisterLogFilter, or BIRDIE_LOG_FILTER_NONE.
+/// </param>
+/// <param name="pFormat">
+///		Format of the message that is sent to the tool.
+/// </param>
+/// <param name="...">
+///		Objects to use in the formatting routine.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the message was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_LogFilteredF(BIRDIE_LOG_FILTER logFilter, const char* pFormat, ...);
+
+/// <summary>
+///		Enables deferred formatting for Birdie_LogF. The format string is sent to the tool once,
+///		after that a call only captures its arguments and the tool does the formatting.
+///		Formats the tool can't be handed this way (%n, %ls, long double) are still formatted right away.
+/// </summary>
+/// <param name="enabled">
+///		True to defer formatting, false to format on the calling thread.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_SetDeferredLogFormatting(bool enabled);
+
+/// <summary>
+///		Logs a message that is formatted by the tool, from arguments that were already captured.
+///		The C++ Birdie_LogDeferred template in BirdieExt.hpp captures them from their types.
+/// </summary>
+/// <param name="pFilter">
+///		Optional filter, can be used to categorize. Use null or "" for no filter.
+/// </param>
+/// <param name="pFormat">
+///		printf-style format of the message. It's only sent the first time it's used.
+/// </param>
+/// <param name="pArguments">
+///		The encoded arguments, see BIRDIE_LOG_ARGUMENT_KIND. Can be null when argumentsSize is 0.
+/// </param>
+/// <param name="argumentsSize">
+///		Size of the encoded arguments in bytes.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the format could not be stored.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the message was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_LogArguments(const char* pFilter, const char* pFormat, const void* pArguments, size_t argumentsSize);
+
+
+/// <summary>
+///		Sets the lowest level that is still sent to the tool. The tool can change it at any time after that.
+///		Can be called before initialization.
+/// </summary>
+/// <param name="threshold">
+///		The lowest level that is logged, or BIRDIE_LOG_LEVEL_NONE to drop all messages.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the level is unknown.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_SetLogLevel(BIRDIE_LOG_LEVEL threshold);
+
+/// <summary>
+///		The current log level threshold, so that callers can skip a message before doing any work for it.
+///		It reads as BIRDIE_LOG_LEVEL_NONE while there is no connection to the tool.
+///		Only the library writes it, it can be read at any time without any synchronization.
+/// </summary>
+BIRDIEAPI volatile int32_t g_birdieLogLevelThreshold;
+
+/// <summary>
+///		Logs a message with a level to the tool.
+/// </summary>
+/// <param name="level">
+///		Level of the message. It's dropped if it's below the threshold.
+/// </param>
+/// <param name="logFilter">
+///		Filter returned by Birdie_RegisterLogFilter, or BIRDIE_LOG_FILTER_NONE.
+/// </param>
+/// <param name="pMessage">
+///		Pre-formatted message that is sent to the tool.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success, or if the message was below the threshold.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the message was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_LogEx(BIRDIE_LOG_LEVEL level, BIRDIE_LOG_FILTER logFilter, const char* pMessage);
+
+/// <summary>
+///		Logs a formatted message with a level to the tool. Nothing is formatted if the level is below the threshold.
+/// </summary>
+/// <param name="level">
+///		Level of the message. It's dropped if it's below the threshold.
+/// </param>
+/// <param name="logFilter">
+///		Filter returned by Birdie_RegisterLogFilter, or BIRDIE_LOG_FILTER_NONE.
+/// </param>
+/// <param name="pFormat">
+///		Format of the message that is sent to the tool.
+/// </param>
+/// <param name="...">
+///		Objects to use in the formatting routine.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success, or if the message was below the threshold.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the message was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_LogExF(BIRDIE_LOG_LEVEL level, BIRDIE_LOG_FILTER logFilter, const char* pFormat, ...);
+
+/// <summary>
+///		Same as Birdie_LogArguments, with a level and a registered filter.
+///		This is what the BIRDIE_LOG_* macros in BirdieExt.hpp end up calling.
+/// </summary>
+/// <param name="level">
+///		Level of the message. It's dropped if it's below the threshold.
+/// </param>
+/// <param name="logFilter">
+///		Filter returned by Birdie_RegisterLogFilter, or BIRDIE_LOG_FILTER_NONE.
+/// </param>
+/// <param name="pFormat">
+///		printf-style format of the message. It's only sent the first time it's used.
+/// </param>
+/// <param name="pArguments">
+///		The encoded arguments, see BIRDIE_LOG_ARGUMENT_KIND. Can be null when argumentsSize is 0.
+/// </param>
+/// <param name="argumentsSize">
+///		Size of the encoded arguments in bytes.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success, or if the message was below the threshold.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the format could not be stored.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the message was dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_LogExArguments(BIRDIE_LOG_LEVEL level, BIRDIE_LOG_FILTER logFilter, const char* pFormat, const void* pArguments, size_t argumentsSize);
+
+// Profiling functions
+
+/// <summary>
+///		Registers a profiling zone. The name is sent to the tool once, zone events only refer to it.
+/// </summary>
+/// <param name="pName">
+///		Name of the zone as shown in the tool.
+/// </param>
+/// <param name="pZone">
+///		Pointer to the variable that receives the zone. Only valid until Birdie_Terminate is called.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the name could not be stored.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_RegisterZone(const char* pName, LPBIRDIE_ZONE pZone);
+
+/// <summary>
+///		Marks the start of a zone on the calling thread. Only a timestamp is recorded, into a buffer of the calling
+///		thread, which makes this cheap enough for hot loops. Zones may nest, but have to end on the thread they began on.
+///		The events are sent by Birdie_EndFrame and Birdie_Flush, or as soon as the thread's buffer fills up.
+///		The BIRDIE_ZONE_SCOPE macro in BirdieExt.hpp ends the zone along with the enclosing scope.
+/// </summary>
+/// <param name="zone">
+///		Zone returned by Birdie_RegisterZone.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the buffer of the thread could not be allocated.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the zone is invalid.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the buffer of the thread is full and could not be sent.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_BeginZone(BIRDIE_ZONE zone);
+
+/// <summary>
+///		Marks the end of a zone on the calling thread, see Birdie_BeginZone.
+/// </summary>
+/// <param name="zone">
+///		The zone that was passed to Birdie_BeginZone.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the buffer of the thread could not be allocated.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if the zone is invalid.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the buffer of the thread is full and could not be sent.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_EndZone(BIRDIE_ZONE zone);
+
+// Statistics functions
+
+/// <summary>
+///		Gathers the counters of the current session. Counters are kept per thread and only summed up here,
+///		so counting adds no contention to the calls being counted. The result is a close approximation while
+///		other threads are busy, and exact once they're idle.
+///		Counters start at zero with every initialization, and carry on across reconnects.
+/// </summary>
+/// <param name="pStats">
+///		Receives the counters.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if pStats is null.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_GetStats(BIRDIE_STATS* pStats);
+
+/// <summary>
+///		Adds a "Birdie" category with a watch for every counter of Birdie_GetStats, so the tool shows what the
+///		library costs next to everything else. The counters are refreshed by Birdie_EndFrame and Birdie_PublishWatches.
+///		The watches point at a copy of the counters that the library owns, it's removed on termination like any other watch.
+/// </summary>
+/// <param name="parent">
+///		Handle of the parent category, or 0 for the root.
+/// </param>
+/// <param name="pHandle">
+///		Receives the handle of the category.
+/// </param>
+/// <returns>
+///		* Returns BIRDIE_SUCCESS on success.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if pHandle is null.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the watches were dropped by the asynchronous sender.
+/// </returns>
+BIRDIEAPI BIRDIE_ERROR Birdie_AddStatsWatches(BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle);
 
 // User-defined customs
 
@@ -241,12 +1035,34 @@ BIRDIEAPI BIRDIE_ERROR Birdie_LogF(const char* pFilter, const char* pFormat, ...
 /// </param>
 /// <param name="handlerCode">
 ///		Custom handler code (C#). Check documentation for the right format.
+///		A copy is kept, so that every new connection to the tool gets the handler as well.
 /// </param>
 /// <returns>
 ///		* Returns BIRDIE_SUCCESS on success.
-///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if there was insufficient temporary space.
-///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool.
+///		* Returns BIRDIE_ERROR_INSUFFICIENT_MEMORY if the copy could not be made.
+///		* Returns BIRDIE_ERROR_INVALID_PARAMS if one or more parameters were malformed.
+///		* Returns BIRDIE_ERROR_NOT_CONNECTED if there is no connection to the tool, the handler is sent once there is.
+///		* Returns BIRDIE_ERROR_QUEUE_FULL if the handler was dropped by the asynchronous sender.
 /// </returns>
 BIRDIEAPI BIRDIE_ERROR Birdie_AddCustomTypeHandler(BIRDIE_TYPE type, const char* handlerCode);
 
+/// <summary>
+///		Checks if handler code was added for a type, with Birdie_AddCustomTypeHandler or Birdie_RegisterCustomType.
+///		Handlers are dropped by Birdie_Terminate.
+/// </summary>
+/// <param name="type">
+///		Type to look for.
+/// </param>
+/// <returns>
+///		* Returns true if the type has a handler.
+/// </returns>
+BIRDIEAPI bool Birdie_IsCustomTypeRegistered(BIRDIE_TYPE type);
+
+/// <summary>
+///		Changes whenever a handler is added for a new type, or Birdie_Terminate drops them all.
+///		An answer of Birdie_IsCustomTypeRegistered stays valid for as long as it doesn't change.
+///		Only the library writes it, it can be read at any time without any synchronization.
+/// </summary>
+BIRDIEAPI volatile uint32_t g_birdieCustomTypeGeneration;
+
 #endif
\ No newline at end of file
@@ -3,16 +3,44 @@
 
 #include "Birdie.h"
 
-#include <Windows.h>
-
+#include <atomic>
+#include <cstddef>
 #include <cstring>
-#include <set>
-#include <typeinfo.h>
+#include <typeinfo>
+#include <vector>
 
 // This header contains extended Birdie functionality, exclusive to C++
 
-BIRDIEAPI bool Birdie_IsTypeRegistered(const char* type);
-BIRDIEAPI void Birdie_AddRegisteredType(const char* type);
+// Registration state of a custom type, as last seen by this module. The library keeps the actual list, this only caches
+// the answer for as long as the library's generation doesn't change. Looking a type up is then two loads and never takes
+// a lock, the list is only searched again after a type was added or Birdie_Terminate dropped them all.
+// It's constant-initialized, which makes it safe to use from other static initializers.
+template <typename T>
+class BirdieTypeRegistry
+{
+public:
+	static bool IsRegistered()
+	{
+		// Bit 0 is the answer, the other bits the generation it was given in. The generation starts at 1, so 0 never matches.
+		uint32_t generation = g_birdieCustomTypeGeneration;
+		uint32_t cachedState = state.load(std::memory_order_relaxed);
+
+		if ((cachedState >> 1) == (generation & 0x7FFFFFFF))
+			return (cachedState & 1) != 0;
+
+		// The generation was read first, a type added while looking it up makes the next call look again
+		bool isRegistered = Birdie_IsCustomTypeRegistered(typeid(T).name());
+
+		state.store((generation << 1) | (isRegistered ? 1 : 0), std::memory_order_relaxed);
+
+		return isRegistered;
+	}
+
+private:
+	static std::atomic<uint32_t> state;
+};
+
+template <typename T> std::atomic<uint32_t> BirdieTypeRegistry<T>::state(0);
 
 
 template <typename T> 
@@ -22,11 +50,8 @@ public:
 	static BIRDIE_TYPE GetType() 
 	{ 
 		// Determine if we have a custom type or not
-		const char* customTypeName = typeid(T).name();
-		bool contains = Birdie_IsTypeRegistered(customTypeName);
-
-		if (contains)
-			return customTypeName;
+		if (BirdieTypeRegistry<T>::IsRegistered())
+			return typeid(T).name();
 
 		return BIRDIE_TYPE_HEX_PATTERN;
 	} 
@@ -65,29 +90,83 @@ BIRDIE_ERROR Birdie_RegisterCustomType(const char* customHandlerCode)
 
 	const char* customTypeName = typeid(T).name();
 
-	// Now check the custom type list
-	bool contains = Birdie_IsTypeRegistered(customTypeName);
+	// Custom type code is sent over to Birdie. The library keeps the handler and sends it along with the next connection.
+	BIRDIE_ERROR error = Birdie_AddCustomTypeHandler(customTypeName, customHandlerCode);
 
-	if (contains)
-		return BIRDIE_ERROR_TYPE_PREEXISTING;
+	if (error == BIRDIE_ERROR_NOT_CONNECTED)
+		return BIRDIE_SUCCESS;
 
-	Birdie_AddRegisteredType(customTypeName);
-
-	// Custom type code is sent over to Birdie
-	return Birdie_AddCustomTypeHandler(customTypeName, customHandlerCode);
+	return error;
 }
 
+
+// Types of the fields of reflected structures. Character arrays are strings, pointers are shown as their address.
+template <typename T> class BirdieFieldTypeGetter : public BirdieTypeGetter<T>                   { };
+template <typename T> class BirdieFieldTypeGetter<T*>       { public: static BIRDIE_TYPE GetType() { return BIRDIE_TYPE_HEX_PATTERN; } };
+template <size_t N>   class BirdieFieldTypeGetter<char[N]>  { public: static BIRDIE_TYPE GetType() { return BIRDIE_TYPE_ANSI_STRING; } };
+
+
+// Structures without BIRDIE_REFLECT are watched as a single value of their type. Arrays of them have a single field.
 template <typename T>
-static BIRDIE_ERROR Birdie_AddWatch(const char* pName, T* pBase, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+class BirdieReflection
 {
-	BIRDIE_TYPE type = BirdieTypeGetter<T>::GetType();
-	size_t size = BirdieSizeGetter<T>::GetSize(pBase);
+public:
+	static BIRDIE_ERROR AddWatch(const char* pName, T* pBase, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+	{
+		return Birdie_AddWatch(pName, BirdieTypeGetter<T>::GetType(), (void*)pBase, BirdieSizeGetter<T>::GetSize(pBase), parent, pHandle);
+	}
 
-	return Birdie_AddWatch(pName, type, (void*)pBase, size, parent, pHandle);
+	static BIRDIE_ERROR AddArrayWatch(const char* pName, T* pBase, size_t count, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+	{
+		const BIRDIE_ARRAY_FIELD field = { "Value", BirdieTypeGetter<T>::GetType(), 0, sizeof(T), 0 };
+		const BIRDIE_ARRAY_DESCRIPTOR descriptor = { pName, (void*)pBase, count, sizeof(T), &field, 1, parent };
+
+		return Birdie_AddArrayWatch(&descriptor, pHandle);
+	}
+};
+
+// Lists the fields of a structure, so its watches are sent along with their layout and the tool shows every field as
+// its own type. No handler code or handles per field are needed. Use it at global scope, after the structure:
+//
+//     BIRDIE_REFLECT(Player,
+//         BIRDIE_FIELD(health),
+//         BIRDIE_FIELD(position))
+//
+// Offsets and sizes are compile-time constants, field types are looked up like for Birdie_AddWatch whenever a watch is added.
+// Fields of other structures show up as a HEX pattern, unless that structure has a custom type handler.
+#define BIRDIE_FIELD(member) \
+	{ #member, BirdieFieldTypeGetter<decltype(BirdieReflectedType::member)>::GetType(), offsetof(BirdieReflectedType, member), sizeof(BirdieReflectedType::member), 0 }
+
+#define BIRDIE_REFLECT(type, ...) \
+	template <> \
+	class BirdieReflection<type> \
+	{ \
+	public: \
+		typedef type BirdieReflectedType; \
+		\
+		static BIRDIE_ERROR AddWatch(const char* pName, type* pBase, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle) \
+		{ \
+			return AddArrayWatch(pName, pBase, 1, parent, pHandle); \
+		} \
+		\
+		static BIRDIE_ERROR AddArrayWatch(const char* pName, type* pBase, size_t count, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle) \
+		{ \
+			const BIRDIE_ARRAY_FIELD fields[] = { __VA_ARGS__ }; \
+			const BIRDIE_ARRAY_DESCRIPTOR descriptor = { pName, (void*)pBase, count, sizeof(type), fields, sizeof(fields) / sizeof(fields[0]), parent }; \
+			\
+			return Birdie_AddArrayWatch(&descriptor, pHandle); \
+		} \
+	};
+
+
+template <typename T>
+static BIRDIE_ERROR Birdie_AddWatch(const char* pName, T* pBase, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+{
+	return BirdieReflection<T>::AddWatch(pName, pBase, parent, pHandle);
 }
 
 template <>
-static BIRDIE_ERROR Birdie_AddWatch(const char* pName, const char* pBase, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+inline BIRDIE_ERROR Birdie_AddWatch(const char* pName, const char* pBase, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
 {
 	BIRDIE_TYPE type = BirdieTypeGetter<const char*>::GetType();
 	size_t size = BirdieSizeGetter<const char*>::GetSize(pBase);
@@ -95,4 +174,202 @@ static BIRDIE_ERROR Birdie_AddWatch(const char* pName, const char* pBase, BIRDIE
 	return Birdie_AddWatch(pName, type, (void*)pBase, size, parent, pHandle);
 }
 
+// Watches 'count' elements as a single array watch, see Birdie_AddArrayWatch. Reflected structures keep their fields.
+template <typename T>
+static BIRDIE_ERROR Birdie_AddArrayWatch(const char* pName, T* pBase, size_t count, BIRDIE_HANDLE parent, LPBIRDIE_HANDLE pHandle)
+{
+	return BirdieReflection<T>::AddArrayWatch(pName, pBase, count, parent, pHandle);
+}
+
+
+// Encodes log arguments the way Birdie_LogArguments expects them.
+// Overload resolution picks the same promotions a va_list would, so any printf argument works.
+class BirdieLogArgumentEncoder
+{
+public:
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, int value)                { return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_INT32,   (int32_t)value);  }
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, unsigned int value)       { return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_UINT32,  (uint32_t)value); }
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, long long value)          { return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_INT64,   (int64_t)value);  }
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, unsigned long long value) { return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_UINT64,  (uint64_t)value); }
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, double value)             { return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_FLOAT64, value);           }
+
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, long value)
+	{
+		// 32 bits on Windows, 64 bits on most other platforms
+		if (sizeof(long) == sizeof(int64_t))
+			return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_INT64, (int64_t)value);
+
+		return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_INT32, (int32_t)value);
+	}
+
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, unsigned long value)
+	{
+		if (sizeof(unsigned long) == sizeof(uint64_t))
+			return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_UINT64, (uint64_t)value);
+
+		return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_UINT32, (uint32_t)value);
+	}
+
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, const void* value)
+	{
+		return EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_POINTER, (uint64_t)(uintptr_t)value);
+	}
+
+	static size_t Encode(char* pBuffer, size_t bufferSize, size_t offset, const char* value)
+	{
+		if (value == NULL)
+			value = "(null)";
+
+		uint32_t length = (uint32_t)strlen(value);
+		size_t newOffset = EncodeValue(pBuffer, bufferSize, offset, BIRDIE_LOG_ARGUMENT_STRING, length);
+
+		if (newOffset + length <= bufferSize)
+			memcpy(pBuffer + newOffset, value, length);
+
+		return newOffset + length;
+	}
+
+private:
+	template <typename T>
+	static size_t EncodeValue(char* pBuffer, size_t bufferSize, size_t offset, BIRDIE_LOG_ARGUMENT_KIND kind, T value)
+	{
+		// Only measures once the buffer is full, the caller tries again with a bigger one
+		if (offset + sizeof(uint8_t) + sizeof(T) <= bufferSize)
+		{
+			pBuffer[offset] = (char)kind;
+			memcpy(pBuffer + offset + sizeof(uint8_t), &value, sizeof(T));
+		}
+
+		return offset + sizeof(uint8_t) + sizeof(T);
+	}
+};
+
+inline size_t Birdie_EncodeLogArguments(char* pBuffer, size_t bufferSize, size_t offset)
+{
+	return offset;
+}
+
+template <typename T, typename... Arguments>
+size_t Birdie_EncodeLogArguments(char* pBuffer, size_t bufferSize, size_t offset, T argument, Arguments... arguments)
+{
+	offset = BirdieLogArgumentEncoder::Encode(pBuffer, bufferSize, offset, argument);
+
+	return Birdie_EncodeLogArguments(pBuffer, bufferSize, offset, arguments...);
+}
+
+template <typename... Arguments>
+BIRDIE_ERROR Birdie_LogDeferred(const char* pFilter, const char* pFormat, Arguments... arguments)
+{
+	// Most argument lists fit on the stack, only long strings need the heap
+	char buffer[256];
+	size_t size = Birdie_EncodeLogArguments(buffer, sizeof(buffer), 0, arguments...);
+
+	if (size <= sizeof(buffer))
+		return Birdie_LogArguments(pFilter, pFormat, buffer, size);
+
+	std::vector<char> largeBuffer(size);
+	Birdie_EncodeLogArguments(largeBuffer.data(), size, 0, arguments...);
+
+	return Birdie_LogArguments(pFilter, pFormat, largeBuffer.data(), size);
+}
+
+template <typename... Arguments>
+BIRDIE_ERROR Birdie_LogDeferredEx(BIRDIE_LOG_LEVEL level, BIRDIE_LOG_FILTER logFilter, const char* pFormat, Arguments... arguments)
+{
+	char buffer[256];
+	size_t size = Birdie_EncodeLogArguments(buffer, sizeof(buffer), 0, arguments...);
+
+	if (size <= sizeof(buffer))
+		return Birdie_LogExArguments(level, logFilter, pFormat, buffer, size);
+
+	std::vector<char> largeBuffer(size);
+	Birdie_EncodeLogArguments(largeBuffer.data(), size, 0, arguments...);
+
+	return Birdie_LogExArguments(level, logFilter, pFormat, largeBuffer.data(), size);
+}
+
+
+// Log levels. BIRDIE_LOG_TRACE .. BIRDIE_LOG_ERROR take a registered filter, a format and its arguments.
+// Calls below BIRDIE_MIN_LOG_LEVEL are removed by the preprocessor, arguments included.
+// The others check the runtime threshold before any of their arguments are evaluated.
+
+// 0 trace, 1 debug, 2 info, 3 warning, 4 error, 5 none. The numbers match BIRDIE_LOG_LEVEL.
+#ifndef BIRDIE_MIN_LOG_LEVEL
+#define BIRDIE_MIN_LOG_LEVEL 0
+#endif
+
+inline bool Birdie_IsLogLevelEnabled(BIRDIE_LOG_LEVEL level)
+{
+	// An aligned 32 bit load, a new threshold only has to show up eventually.
+	// The library initializes it as a constant, so it can be read during static initialization too.
+	return (int32_t)level >= g_birdieLogLevelThreshold;
+}
+
+#define BIRDIE_LOG_AT_LEVEL(level, logFilter, ...) \
+	do { if (Birdie_IsLogLevelEnabled(level)) Birdie_LogDeferredEx(level, logFilter, __VA_ARGS__); } while (0)
+
+#if BIRDIE_MIN_LOG_LEVEL <= 0
+#define BIRDIE_LOG_TRACE(logFilter, ...) BIRDIE_LOG_AT_LEVEL(BIRDIE_LOG_LEVEL_TRACE, logFilter, __VA_ARGS__)
+#else
+#define BIRDIE_LOG_TRACE(logFilter, ...) ((void)0)
+#endif
+
+#if BIRDIE_MIN_LOG_LEVEL <= 1
+#define BIRDIE_LOG_DEBUG(logFilter, ...) BIRDIE_LOG_AT_LEVEL(BIRDIE_LOG_LEVEL_DEBUG, logFilter, __VA_ARGS__)
+#else
+#define BIRDIE_LOG_DEBUG(logFilter, ...) ((void)0)
+#endif
+
+#if BIRDIE_MIN_LOG_LEVEL <= 2
+#define BIRDIE_LOG_INFO(logFilter, ...) BIRDIE_LOG_AT_LEVEL(BIRDIE_LOG_LEVEL_INFO, logFilter, __VA_ARGS__)
+#else
+#define BIRDIE_LOG_INFO(logFilter, ...) ((void)0)
+#endif
+
+#if BIRDIE_MIN_LOG_LEVEL <= 3
+#define BIRDIE_LOG_WARNING(logFilter, ...) BIRDIE_LOG_AT_LEVEL(BIRDIE_LOG_LEVEL_WARNING, logFilter, __VA_ARGS__)
+#else
+#define BIRDIE_LOG_WARNING(logFilter, ...) ((void)0)
+#endif
+
+#if BIRDIE_MIN_LOG_LEVEL <= 4
+#define BIRDIE_LOG_ERROR(logFilter, ...) BIRDIE_LOG_AT_LEVEL(BIRDIE_LOG_LEVEL_ERROR, logFilter, __VA_ARGS__)
+#else
+#define BIRDIE_LOG_ERROR(logFilter, ...) ((void)0)
+#endif
+
+
+
+// Profiling zones. BIRDIE_ZONE_SCOPE times the rest of the enclosing scope as a registered zone.
+// Defining BIRDIE_DISABLE_ZONES removes them altogether.
+
+class BirdieZoneScope
+{
+public:
+	explicit BirdieZoneScope(BIRDIE_ZONE zone) : zone(zone)
+	{
+		Birdie_BeginZone(zone);
+	}
+
+	~BirdieZoneScope()
+	{
+		Birdie_EndZone(zone);
+	}
+
+	BirdieZoneScope(const BirdieZoneScope&) = delete;
+	BirdieZoneScope& operator=(const BirdieZoneScope&) = delete;
+
+private:
+	BIRDIE_ZONE zone;
+};
+
+#define BIRDIE_ZONE_CONCAT_INNER(a, b) a##b
+#define BIRDIE_ZONE_CONCAT(a, b) BIRDIE_ZONE_CONCAT_INNER(a, b)
+
+#ifndef BIRDIE_DISABLE_ZONES
+#define BIRDIE_ZONE_SCOPE(zone) BirdieZoneScope BIRDIE_ZONE_CONCAT(birdieZoneScope, __LINE__)(zone)
+#else
+#define BIRDIE_ZONE_SCOPE(zone) ((void)0)
+#endif
+
 #endif
\ No newline at end of file
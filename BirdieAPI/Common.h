@@ -4,6 +4,6 @@
 // This header contains common functionality
 
 #define BIRDIE_STATIC_CALL(f, args) \
-	class StaticCaller_ ##f { public: StaticCaller_ ##f () { ##f args ; } }; static StaticCaller_ ##f ___StaticCaller_ ##f ;
+	class StaticCaller_ ##f { public: StaticCaller_ ##f () { f args ; } }; static StaticCaller_ ##f ___StaticCaller_ ##f ;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "Compression.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+#define BIRDIE_LZ4_MIN_MATCH         4
+#define BIRDIE_LZ4_MAX_OFFSET        65535
+
+// Blocks always end in literals: matches can't start in the last 12 bytes, and can't reach into the last 5
+#define BIRDIE_LZ4_MATCH_START_LIMIT 12
+#define BIRDIE_LZ4_LAST_LITERALS     5
+
+
+// Prototypes
+
+static bool Birdie_ReserveCompressorBuffer(char** ppBuffer, size_t* pCapacity, size_t size);
+static size_t Birdie_CompressBlock(BIRDIE_COMPRESSOR* pCompressor, const uint8_t* pSource, size_t sourceSize, uint8_t* pDestination, size_t destinationCapacity);
+static uint8_t* Birdie_WriteSequence(uint8_t* pOutput, const uint8_t* pOutputEnd, const uint8_t* pLiterals, size_t literalLength, size_t matchOffset, size_t matchLength);
+
+static inline uint32_t Birdie_ReadSequence(const uint8_t* pSource)
+{
+	uint32_t sequence;
+	memcpy(&sequence, pSource, sizeof(sequence));
+
+	return sequence;
+}
+
+static inline uint32_t Birdie_HashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - BIRDIE_COMPRESSION_HASH_BITS);
+}
+
+
+// Function implementations
+
+void Birdie_InitializeCompressor(BIRDIE_COMPRESSOR* pCompressor)
+{
+	memset(pCompressor, 0, sizeof(BIRDIE_COMPRESSOR));
+}
+
+void Birdie_DestroyCompressor(BIRDIE_COMPRESSOR* pCompressor)
+{
+	if (pCompressor->pInput != NULL)
+		g_deallocFunction(pCompressor->pInput);
+
+	if (pCompressor->pOutput != NULL)
+		g_deallocFunction(pCompressor->pOutput);
+
+	memset(pCompressor, 0, sizeof(BIRDIE_COMPRESSOR));
+}
+
+size_t Birdie_Compress(BIRDIE_COMPRESSOR* pCompressor, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize, const char** ppCompressed)
+{
+	const char* pSource = (const char*)pBuffers[0].pData;
+
+	// Matches can point anywhere in the frame, so it has to be in one piece
+	if (bufferCount > 1)
+	{
+		if (!Birdie_ReserveCompressorBuffer(&pCompressor->pInput, &pCompressor->inputCapacity, totalSize))
+			return 0;
+
+		size_t offset = 0;
+
+		for (size_t i = 0; i < bufferCount; i++)
+		{
+			memcpy((void*)(pCompressor->pInput + offset), pBuffers[i].pData, pBuffers[i].size);
+			offset += pBuffers[i].size;
+		}
+
+		pSource = pCompressor->pInput;
+	}
+
+	// A frame that doesn't get smaller is sent as is, so the output never needs more room than the input
+	if (!Birdie_ReserveCompressorBuffer(&pCompressor->pOutput, &pCompressor->outputCapacity, totalSize))
+		return 0;
+
+	*ppCompressed = pCompressor->pOutput;
+
+	return Birdie_CompressBlock(pCompressor, (const uint8_t*)pSource, totalSize, (uint8_t*)pCompressor->pOutput, totalSize);
+}
+
+static bool Birdie_ReserveCompressorBuffer(char** ppBuffer, size_t* pCapacity, size_t size)
+{
+	if (*pCapacity >= size)
+		return true;
+
+	if (*ppBuffer != NULL)
+		g_deallocFunction(*ppBuffer);
+
+	// Doubled, so slowly growing frames don't reallocate every time
+	size_t capacity = *pCapacity > 0 ? *pCapacity : 4096;
+
+	while (capacity < size)
+		capacity *= 2;
+
+	*ppBuffer = (char*)g_allocFunction(capacity);
+	*pCapacity = *ppBuffer != NULL ? capacity : 0;
+
+	return *ppBuffer != NULL;
+}
+
+static size_t Birdie_CompressBlock(BIRDIE_COMPRESSOR* pCompressor, const uint8_t* pSource, size_t sourceSize, uint8_t* pDestination, size_t destinationCapacity)
+{
+	const uint8_t* pOutputEnd = pDestination + destinationCapacity;
+	uint8_t* pOutput = pDestination;
+
+	// Literals from here on haven't been written yet
+	size_t anchor = 0;
+	size_t position = 0;
+
+	if (sourceSize > BIRDIE_LZ4_MATCH_START_LIMIT)
+	{
+		size_t matchStartLimit = sourceSize - BIRDIE_LZ4_MATCH_START_LIMIT;
+		size_t matchEndLimit = sourceSize - BIRDIE_LZ4_LAST_LITERALS;
+
+		while (position <= matchStartLimit)
+		{
+			uint32_t sequence = Birdie_ReadSequence(pSource + position);
+			uint32_t* pEntry = &pCompressor->hashTable[Birdie_HashSequence(sequence)];
+
+			size_t candidate = *pEntry;
+			*pEntry = (uint32_t)position;
+
+			// The entry may be left over from another frame, or simply collide
+			if (candidate >= position || position - candidate > BIRDIE_LZ4_MAX_OFFSET || Birdie_ReadSequence(pSource + candidate) != sequence)
+			{
+				// Data that doesn't compress is skipped over faster and faster
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			size_t matchLength = BIRDIE_LZ4_MIN_MATCH;
+
+			while (position + matchLength < matchEndLimit && pSource[candidate + matchLength] == pSource[position + matchLength])
+				matchLength++;
+
+			pOutput = Birdie_WriteSequence(pOutput, pOutputEnd, pSource + anchor, position - anchor, position - candidate, matchLength);
+
+			if (pOutput == NULL)
+				return 0;
+
+			position += matchLength;
+			anchor = position;
+		}
+	}
+
+	pOutput = Birdie_WriteSequence(pOutput, pOutputEnd, pSource + anchor, sourceSize - anchor, 0, 0);
+
+	if (pOutput == NULL)
+		return 0;
+
+	return (size_t)(pOutput - pDestination);
+}
+
+static uint8_t* Birdie_WriteSequence(uint8_t* pOutput, const uint8_t* pOutputEnd, const uint8_t* pLiterals, size_t literalLength, size_t matchOffset, size_t matchLength)
+{
+	// Layout: token (literal length and match length, 4 bits each), more literal length, literals, match offset (2b), more match length.
+	// Lengths that don't fit the token continue in bytes of up to 255 each.
+	size_t maxSize = 1 + literalLength / 255 + 1 + literalLength + sizeof(uint16_t) + matchLength / 255 + 1;
+
+	if ((size_t)(pOutputEnd - pOutput) < maxSize)
+		return NULL;
+
+	uint8_t* pToken = pOutput++;
+	*pToken = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+
+	if (literalLength >= 15)
+	{
+		for (size_t length = literalLength - 15; ; length -= 255)
+		{
+			*pOutput++ = (uint8_t)(length < 255 ? length : 255);
+
+			if (length < 255)
+				break;
+		}
+	}
+
+	memcpy(pOutput, pLiterals, literalLength);
+	pOutput += literalLength;
+
+	// The last sequence of a block is only literals
+	if (matchLength == 0)
+		return pOutput;
+
+	*pOutput++ = (uint8_t)matchOffset;
+	*pOutput++ = (uint8_t)(matchOffset >> 8);
+
+	size_t matchCode = matchLength - BIRDIE_LZ4_MIN_MATCH;
+	*pToken |= (uint8_t)(matchCode < 15 ? matchCode : 15);
+
+	if (matchCode >= 15)
+	{
+		for (size_t length = matchCode - 15; ; length -= 255)
+		{
+			*pOutput++ = (uint8_t)(length < 255 ? length : 255);
+
+			if (length < 255)
+				break;
+		}
+	}
+
+	return pOutput;
+}
@@ -0,0 +1,47 @@
+#ifndef BIRDIEAPI_COMPRESSION_H
+#define BIRDIEAPI_COMPRESSION_H
+
+#include "Birdie.h"
+#include "SendQueue.h"
+#include "Platform.h"
+
+// This header contains the frame compression used for connections to a tool on another machine.
+// Frames are compressed into the LZ4 block format: fast enough to keep up with the sender, and simple enough to decode in the tool.
+// A compressor is only ever used by one thread at a time, the sender thread or whoever holds the send lock.
+
+#define BIRDIE_COMPRESSION_METHOD_LZ4    1
+
+// Entries in the match table, every entry is a position in the frame
+#define BIRDIE_COMPRESSION_HASH_BITS     12
+
+typedef struct
+{
+	// The frame is gathered here when it's made up of more than one span
+	char*    pInput;
+	size_t   inputCapacity;
+
+	char*    pOutput;
+	size_t   outputCapacity;
+
+	// Positions of recently seen 4-byte sequences. Left as is between frames, every candidate is verified anyway.
+	uint32_t hashTable[1 << BIRDIE_COMPRESSION_HASH_BITS];
+} BIRDIE_COMPRESSOR;
+
+typedef struct
+{
+	uint64_t frameCount;
+	uint64_t uncompressedBytes;
+	uint64_t compressedBytes;
+
+	// Time spent compressing, in performance counter ticks
+	uint64_t compressionTicks;
+} BIRDIE_COMPRESSION_STATS;
+
+void Birdie_InitializeCompressor(BIRDIE_COMPRESSOR* pCompressor);
+void Birdie_DestroyCompressor(BIRDIE_COMPRESSOR* pCompressor);
+
+// Compresses all spans as one frame. Returns the compressed size, or 0 if the frame doesn't get any smaller
+// or there was no memory for it. The compressed data is valid until the next call.
+size_t Birdie_Compress(BIRDIE_COMPRESSOR* pCompressor, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount, size_t totalSize, const char** ppCompressed);
+
+#endif
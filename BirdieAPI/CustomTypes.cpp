@@ -0,0 +1,167 @@
+#include "CustomTypes.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+// Only a handful of types ever get registered, a list is plenty
+static CRITICAL_SECTION    g_csCustomTypes;
+static BIRDIE_CUSTOM_TYPE* g_pFirstCustomType = NULL;
+static BIRDIE_CUSTOM_TYPE* g_pLastCustomType = NULL;
+
+// Exported, BirdieTypeRegistry caches are only trusted while it stays the same. Only changed with the list locked.
+volatile uint32_t          g_birdieCustomTypeGeneration = 1;
+
+
+// Prototypes
+
+static void Birdie_InitializeCustomTypes();
+
+
+// Function implementations
+
+// Handlers can be registered before there's a connection, they're sent once there is one
+static void Birdie_InitializeCustomTypes()
+{
+	InitializeCriticalSection(&g_csCustomTypes);
+}
+
+BIRDIE_STATIC_CALL(Birdie_InitializeCustomTypes, ());
+
+void Birdie_FreeCustomTypes()
+{
+	EnterCriticalSection(&g_csCustomTypes);
+
+	BIRDIE_CUSTOM_TYPE* pCustomType = g_pFirstCustomType;
+
+	while (pCustomType != NULL)
+	{
+		BIRDIE_CUSTOM_TYPE* pNext = pCustomType->pNext;
+
+		g_deallocFunction(pCustomType->pType);
+		g_deallocFunction(pCustomType->pHandlerCode);
+		g_deallocFunction(pCustomType);
+
+		pCustomType = pNext;
+	}
+
+	g_pFirstCustomType = NULL;
+	g_pLastCustomType = NULL;
+
+	g_birdieCustomTypeGeneration++;
+
+	LeaveCriticalSection(&g_csCustomTypes);
+}
+
+bool Birdie_HasCustomType(const char* pType)
+{
+	size_t typeLength = strlen(pType);
+	bool hasCustomType = false;
+
+	EnterCriticalSection(&g_csCustomTypes);
+
+	for (BIRDIE_CUSTOM_TYPE* pCustomType = g_pFirstCustomType; pCustomType != NULL; pCustomType = pCustomType->pNext)
+	{
+		if (pCustomType->typeLength == typeLength && memcmp(pCustomType->pType, pType, typeLength) == 0)
+		{
+			hasCustomType = true;
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&g_csCustomTypes);
+
+	return hasCustomType;
+}
+
+BIRDIE_ERROR Birdie_AddCustomType(const char* pType, const char* pHandlerCode)
+{
+	size_t typeLength = strlen(pType);
+	size_t handlerCodeLength = strlen(pHandlerCode);
+
+	char* pHandlerCodeCopy = (char*)g_allocFunction(handlerCodeLength + 1);
+
+	if (pHandlerCodeCopy == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	memcpy(pHandlerCodeCopy, pHandlerCode, handlerCodeLength + 1);
+
+	EnterCriticalSection(&g_csCustomTypes);
+
+	// The tool replaces the handler of a known type as well
+	for (BIRDIE_CUSTOM_TYPE* pCustomType = g_pFirstCustomType; pCustomType != NULL; pCustomType = pCustomType->pNext)
+	{
+		if (pCustomType->typeLength != typeLength || memcmp(pCustomType->pType, pType, typeLength) != 0)
+			continue;
+
+		g_deallocFunction(pCustomType->pHandlerCode);
+
+		pCustomType->pHandlerCode = pHandlerCodeCopy;
+		pCustomType->handlerCodeLength = handlerCodeLength;
+
+		LeaveCriticalSection(&g_csCustomTypes);
+		return BIRDIE_SUCCESS;
+	}
+
+	BIRDIE_CUSTOM_TYPE* pCustomType = (BIRDIE_CUSTOM_TYPE*)g_allocFunction(sizeof(BIRDIE_CUSTOM_TYPE));
+	char* pTypeCopy = (char*)g_allocFunction(typeLength + 1);
+
+	if (pCustomType == NULL || pTypeCopy == NULL)
+	{
+		if (pCustomType != NULL)
+			g_deallocFunction(pCustomType);
+
+		if (pTypeCopy != NULL)
+			g_deallocFunction(pTypeCopy);
+
+		g_deallocFunction(pHandlerCodeCopy);
+
+		LeaveCriticalSection(&g_csCustomTypes);
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	memcpy(pTypeCopy, pType, typeLength + 1);
+
+	pCustomType->pType = pTypeCopy;
+	pCustomType->typeLength = typeLength;
+	pCustomType->pHandlerCode = pHandlerCodeCopy;
+	pCustomType->handlerCodeLength = handlerCodeLength;
+	pCustomType->pNext = NULL;
+
+	if (g_pLastCustomType != NULL)
+		g_pLastCustomType->pNext = pCustomType;
+	else
+		g_pFirstCustomType = pCustomType;
+
+	g_pLastCustomType = pCustomType;
+
+	g_birdieCustomTypeGeneration++;
+
+	LeaveCriticalSection(&g_csCustomTypes);
+
+	return BIRDIE_SUCCESS;
+}
+
+void Birdie_LockCustomTypes()
+{
+	EnterCriticalSection(&g_csCustomTypes);
+}
+
+void Birdie_UnlockCustomTypes()
+{
+	LeaveCriticalSection(&g_csCustomTypes);
+}
+
+BIRDIE_ERROR Birdie_ReplayCustomTypes(BIRDIE_CUSTOM_TYPE_FUNCTION pFunction)
+{
+	for (BIRDIE_CUSTOM_TYPE* pCustomType = g_pFirstCustomType; pCustomType != NULL; pCustomType = pCustomType->pNext)
+	{
+		BIRDIE_ERROR error = pFunction(pCustomType);
+
+		if (error != BIRDIE_SUCCESS)
+			return error;
+	}
+
+	return BIRDIE_SUCCESS;
+}
@@ -0,0 +1,38 @@
+#ifndef BIRDIEAPI_CUSTOMTYPES_H
+#define BIRDIEAPI_CUSTOMTYPES_H
+
+#include "Birdie.h"
+#include "Platform.h"
+
+// This header contains the list of custom type handlers registered with Birdie_AddCustomTypeHandler.
+// Handlers are registered once per type, so a copy is kept for every new connection to the tool.
+
+typedef struct BIRDIE_CUSTOM_TYPE
+{
+	char*                      pType;
+	size_t                     typeLength;
+	char*                      pHandlerCode;
+	size_t                     handlerCodeLength;
+
+	// Kept in the order the types were registered
+	struct BIRDIE_CUSTOM_TYPE* pNext;
+} BIRDIE_CUSTOM_TYPE;
+
+typedef BIRDIE_ERROR (*BIRDIE_CUSTOM_TYPE_FUNCTION)(const BIRDIE_CUSTOM_TYPE* pCustomType);
+
+void Birdie_FreeCustomTypes();
+
+// Copies a handler into the list, replacing the handler of a type that was registered before
+BIRDIE_ERROR Birdie_AddCustomType(const char* pType, const char* pHandlerCode);
+
+// Looks a type up by name, takes the lock
+bool Birdie_HasCustomType(const char* pType);
+
+// Keeps handlers from being added, so a replay can't miss any
+void Birdie_LockCustomTypes();
+void Birdie_UnlockCustomTypes();
+
+// Calls pFunction for every handler. Expects the list to be locked, stops at the first error and returns it.
+BIRDIE_ERROR Birdie_ReplayCustomTypes(BIRDIE_CUSTOM_TYPE_FUNCTION pFunction);
+
+#endif
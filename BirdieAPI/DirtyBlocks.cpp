@@ -0,0 +1,330 @@
+#include "DirtyBlocks.h"
+
+#include <string.h>
+
+// Only on x64, where SSE2 is always there. 32 bit x86 builds aren't compiled for SSE2 and use the scalar functions.
+#if defined(_M_X64)
+#define BIRDIE_DIRTY_BLOCKS_SIMD
+#define BIRDIE_TARGET_AVX2
+#include <intrin.h>
+#elif defined(__x86_64__)
+// GCC and Clang only emit AVX2 instructions in functions that ask for them
+#define BIRDIE_DIRTY_BLOCKS_SIMD
+#define BIRDIE_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+typedef size_t (*BIRDIE_FIND_BLOCK_FUNCTION)(const char*, const char*, size_t, size_t, bool);
+typedef uint64_t (*BIRDIE_HASH_ROWS_FUNCTION)(const char*, size_t, size_t, size_t);
+
+// Keys of the hash lanes, and what they move on by with every stripe. Arbitrary odd constants with well mixed bits.
+#define BIRDIE_HASH_KEY_0    0x9E3779B185EBCA87ull
+#define BIRDIE_HASH_KEY_1    0xC2B2AE3D27D4EB4Full
+#define BIRDIE_HASH_KEY_2    0x165667B19E3779F9ull
+#define BIRDIE_HASH_KEY_3    0x85EBCA77C2B2AE63ull
+#define BIRDIE_HASH_KEY_STEP 0x27D4EB2F165667C5ull
+
+// Prototypes
+
+static size_t Birdie_FindBlockScalar(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty);
+static uint64_t Birdie_HashRowsScalar(const char* pData, size_t rowSize, size_t pitch, size_t rowCount);
+static uint64_t Birdie_MixHash(uint64_t hash, uint64_t value);
+static uint64_t Birdie_HashTail(uint64_t accumulator, const char* pTail, size_t size, uint64_t* pKey);
+
+static inline uint64_t Birdie_HashWord(uint64_t accumulator, uint64_t word, uint64_t key)
+{
+	// The halves of the keyed word multiplied with each other, like XXH3 does it. There's a 32 x 32 bit multiply in every
+	// instruction set, and the product makes changes that would cancel out in a plain sum show up.
+	uint64_t mixed = word ^ key;
+
+	return accumulator + (mixed & 0xFFFFFFFFull) * (mixed >> 32) + word;
+}
+
+#ifdef BIRDIE_DIRTY_BLOCKS_SIMD
+static size_t Birdie_FindBlockSSE2(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty);
+static size_t Birdie_FindBlockAVX2(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty);
+static uint64_t Birdie_HashRowsSSE2(const char* pData, size_t rowSize, size_t pitch, size_t rowCount);
+static uint64_t Birdie_HashRowsAVX2(const char* pData, size_t rowSize, size_t pitch, size_t rowCount);
+static bool Birdie_IsAVX2Supported();
+#endif
+
+static BIRDIE_FIND_BLOCK_FUNCTION g_findBlockFunction = Birdie_FindBlockScalar;
+static BIRDIE_HASH_ROWS_FUNCTION  g_hashRowsFunction = Birdie_HashRowsScalar;
+
+
+// Function implementations
+
+void Birdie_InitializeDirtyBlocks()
+{
+#ifdef BIRDIE_DIRTY_BLOCKS_SIMD
+	// SSE2 is part of every x64 CPU
+	if (Birdie_IsAVX2Supported())
+	{
+		g_findBlockFunction = Birdie_FindBlockAVX2;
+		g_hashRowsFunction = Birdie_HashRowsAVX2;
+	}
+	else
+	{
+		g_findBlockFunction = Birdie_FindBlockSSE2;
+		g_hashRowsFunction = Birdie_HashRowsSSE2;
+	}
+#else
+	g_findBlockFunction = Birdie_FindBlockScalar;
+	g_hashRowsFunction = Birdie_HashRowsScalar;
+#endif
+}
+
+size_t Birdie_FindBlock(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty)
+{
+	return g_findBlockFunction(pCurrent, pShadow, size, offset, findDirty);
+}
+
+uint64_t Birdie_HashRows(const char* pData, size_t rowSize, size_t pitch, size_t rowCount)
+{
+	return g_hashRowsFunction(pData, rowSize, pitch, rowCount);
+}
+
+static size_t Birdie_FindLastBlock(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty)
+{
+	// The (possibly partial) last block is always compared the slow way
+	if (offset >= size)
+		return size;
+
+	bool isDirty = memcmp(pCurrent + offset, pShadow + offset, size - offset) != 0;
+
+	return isDirty == findDirty ? offset : size;
+}
+
+static size_t Birdie_FindBlockScalar(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty)
+{
+	for (; offset + BIRDIE_DIRTY_BLOCK_SIZE <= size; offset += BIRDIE_DIRTY_BLOCK_SIZE)
+	{
+		bool isDirty = memcmp(pCurrent + offset, pShadow + offset, BIRDIE_DIRTY_BLOCK_SIZE) != 0;
+
+		if (isDirty == findDirty)
+			return offset;
+	}
+
+	return Birdie_FindLastBlock(pCurrent, pShadow, size, offset, findDirty);
+}
+
+// Rows are hashed in stripes of 64 bit lanes, every lane gets Birdie_HashWord of its word. The keys move on with every stripe,
+// so the same data at another place hashes differently. Bytes that don't fill a stripe go into the tail, 8 at a time.
+static uint64_t Birdie_HashRowsScalar(const char* pData, size_t rowSize, size_t pitch, size_t rowCount)
+{
+	uint64_t accumulators[2] = { 0, 0 };
+	uint64_t keys[2] = { BIRDIE_HASH_KEY_0, BIRDIE_HASH_KEY_1 };
+	uint64_t tailAccumulator = 0;
+	uint64_t tailKey = BIRDIE_HASH_KEY_2;
+
+	for (size_t row = 0; row < rowCount; row++)
+	{
+		const char* pRow = pData + row * pitch;
+		size_t offset = 0;
+
+		// Same lanes as the SSE2 version
+		for (; offset + 16 <= rowSize; offset += 16)
+		{
+			for (int lane = 0; lane < 2; lane++)
+			{
+				uint64_t word;
+				memcpy(&word, pRow + offset + lane * sizeof(uint64_t), sizeof(uint64_t));
+
+				accumulators[lane] = Birdie_HashWord(accumulators[lane], word, keys[lane]);
+				keys[lane] += BIRDIE_HASH_KEY_STEP;
+			}
+		}
+
+		tailAccumulator = Birdie_HashTail(tailAccumulator, pRow + offset, rowSize - offset, &tailKey);
+	}
+
+	uint64_t hash = 0;
+
+	for (int lane = 0; lane < 2; lane++)
+		hash = Birdie_MixHash(hash, accumulators[lane]);
+
+	return Birdie_MixHash(hash, tailAccumulator);
+}
+
+static uint64_t Birdie_HashTail(uint64_t accumulator, const char* pTail, size_t size, uint64_t* pKey)
+{
+	for (size_t offset = 0; offset < size; offset += sizeof(uint64_t))
+	{
+		// The last word is padded with zeros, every row has the same size so that can't be mistaken for data
+		uint64_t word = 0;
+		memcpy(&word, pTail + offset, size - offset < sizeof(uint64_t) ? size - offset : sizeof(uint64_t));
+
+		accumulator = Birdie_HashWord(accumulator, word, *pKey);
+		*pKey += BIRDIE_HASH_KEY_STEP;
+	}
+
+	return accumulator;
+}
+
+static uint64_t Birdie_MixHash(uint64_t hash, uint64_t value)
+{
+	// Combined like boost::hash_combine, then run through the finalizer of SplitMix64 so every bit affects every other
+	uint64_t mixed = hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2));
+
+	mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+	mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBull;
+
+	return mixed ^ (mixed >> 31);
+}
+
+#ifdef BIRDIE_DIRTY_BLOCKS_SIMD
+
+static size_t Birdie_FindBlockSSE2(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty)
+{
+	for (; offset + BIRDIE_DIRTY_BLOCK_SIZE <= size; offset += BIRDIE_DIRTY_BLOCK_SIZE)
+	{
+		__m128i current0 = _mm_loadu_si128((const __m128i*)(pCurrent + offset));
+		__m128i current1 = _mm_loadu_si128((const __m128i*)(pCurrent + offset + 16));
+		__m128i shadow0 = _mm_loadu_si128((const __m128i*)(pShadow + offset));
+		__m128i shadow1 = _mm_loadu_si128((const __m128i*)(pShadow + offset + 16));
+
+		__m128i equal = _mm_and_si128(_mm_cmpeq_epi8(current0, shadow0), _mm_cmpeq_epi8(current1, shadow1));
+		bool isDirty = _mm_movemask_epi8(equal) != 0xFFFF;
+
+		if (isDirty == findDirty)
+			return offset;
+	}
+
+	return Birdie_FindLastBlock(pCurrent, pShadow, size, offset, findDirty);
+}
+
+BIRDIE_TARGET_AVX2 static size_t Birdie_FindBlockAVX2(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty)
+{
+	for (; offset + BIRDIE_DIRTY_BLOCK_SIZE <= size; offset += BIRDIE_DIRTY_BLOCK_SIZE)
+	{
+		__m256i current = _mm256_loadu_si256((const __m256i*)(pCurrent + offset));
+		__m256i shadow = _mm256_loadu_si256((const __m256i*)(pShadow + offset));
+
+		bool isDirty = _mm256_movemask_epi8(_mm256_cmpeq_epi8(current, shadow)) != -1;
+
+		if (isDirty == findDirty)
+		{
+			_mm256_zeroupper();
+			return offset;
+		}
+	}
+
+	// Avoid the AVX to SSE transition penalty in whatever runs next
+	_mm256_zeroupper();
+
+	return Birdie_FindLastBlock(pCurrent, pShadow, size, offset, findDirty);
+}
+
+static uint64_t Birdie_HashRowsSSE2(const char* pData, size_t rowSize, size_t pitch, size_t rowCount)
+{
+	__m128i accumulators = _mm_setzero_si128();
+	__m128i keys = _mm_set_epi64x((long long)BIRDIE_HASH_KEY_1, (long long)BIRDIE_HASH_KEY_0);
+	__m128i keyStep = _mm_set1_epi64x((long long)BIRDIE_HASH_KEY_STEP);
+	uint64_t tailAccumulator = 0;
+	uint64_t tailKey = BIRDIE_HASH_KEY_2;
+
+	for (size_t row = 0; row < rowCount; row++)
+	{
+		const char* pRow = pData + row * pitch;
+		size_t offset = 0;
+
+		for (; offset + 16 <= rowSize; offset += 16)
+		{
+			__m128i words = _mm_loadu_si128((const __m128i*)(pRow + offset));
+			__m128i mixed = _mm_xor_si128(words, keys);
+
+			// Multiplies the low half of every lane with its high half
+			__m128i products = _mm_mul_epu32(mixed, _mm_srli_epi64(mixed, 32));
+
+			accumulators = _mm_add_epi64(accumulators, _mm_add_epi64(products, words));
+			keys = _mm_add_epi64(keys, keyStep);
+		}
+
+		tailAccumulator = Birdie_HashTail(tailAccumulator, pRow + offset, rowSize - offset, &tailKey);
+	}
+
+	uint64_t laneAccumulators[2];
+
+	_mm_storeu_si128((__m128i*)laneAccumulators, accumulators);
+
+	uint64_t hash = 0;
+
+	for (int lane = 0; lane < 2; lane++)
+		hash = Birdie_MixHash(hash, laneAccumulators[lane]);
+
+	return Birdie_MixHash(hash, tailAccumulator);
+}
+
+BIRDIE_TARGET_AVX2 static uint64_t Birdie_HashRowsAVX2(const char* pData, size_t rowSize, size_t pitch, size_t rowCount)
+{
+	__m256i accumulators = _mm256_setzero_si256();
+	__m256i keys = _mm256_set_epi64x((long long)BIRDIE_HASH_KEY_3, (long long)BIRDIE_HASH_KEY_2, (long long)BIRDIE_HASH_KEY_1, (long long)BIRDIE_HASH_KEY_0);
+	__m256i keyStep = _mm256_set1_epi64x((long long)BIRDIE_HASH_KEY_STEP);
+	uint64_t tailAccumulator = 0;
+	uint64_t tailKey = BIRDIE_HASH_KEY_2;
+
+	for (size_t row = 0; row < rowCount; row++)
+	{
+		const char* pRow = pData + row * pitch;
+		size_t offset = 0;
+
+		for (; offset + 32 <= rowSize; offset += 32)
+		{
+			__m256i words = _mm256_loadu_si256((const __m256i*)(pRow + offset));
+			__m256i mixed = _mm256_xor_si256(words, keys);
+			__m256i products = _mm256_mul_epu32(mixed, _mm256_srli_epi64(mixed, 32));
+
+			accumulators = _mm256_add_epi64(accumulators, _mm256_add_epi64(products, words));
+			keys = _mm256_add_epi64(keys, keyStep);
+		}
+
+		// Whatever doesn't fill a register
+		tailAccumulator = Birdie_HashTail(tailAccumulator, pRow + offset, rowSize - offset, &tailKey);
+	}
+
+	uint64_t laneAccumulators[4];
+
+	_mm256_storeu_si256((__m256i*)laneAccumulators, accumulators);
+
+	_mm256_zeroupper();
+
+	uint64_t hash = 0;
+
+	for (int lane = 0; lane < 4; lane++)
+		hash = Birdie_MixHash(hash, laneAccumulators[lane]);
+
+	return Birdie_MixHash(hash, tailAccumulator);
+}
+
+static bool Birdie_IsAVX2Supported()
+{
+#ifndef _MSC_VER
+	// Covers the same CPU and OS checks as below
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	int cpuInfo[4];
+
+	__cpuid(cpuInfo, 0);
+
+	if (cpuInfo[0] < 7)
+		return false;
+
+	// The CPU has to support AVX and XSAVE, and the OS has to save the YMM registers
+	__cpuid(cpuInfo, 1);
+
+	bool hasOSXSave = (cpuInfo[2] & (1 << 27)) != 0;
+	bool hasAVX = (cpuInfo[2] & (1 << 28)) != 0;
+
+	if (!hasOSXSave || !hasAVX)
+		return false;
+
+	if ((_xgetbv(0) & 0x6) != 0x6)
+		return false;
+
+	__cpuidex(cpuInfo, 7, 0);
+
+	return (cpuInfo[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef BIRDIEAPI_DIRTYBLOCKS_H
+#define BIRDIEAPI_DIRTYBLOCKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header contains the vectorized comparison used to find the parts of a watch that changed since the last publish.
+// Memory is compared in blocks, a block is dirty when any of its bytes differs from the shadow copy.
+// Image watches are too big for shadow copies, their tiles are hashed instead and a tile is dirty when its hash changed.
+
+// 32 bytes, one AVX2 compare or two SSE2 compares
+#define BIRDIE_DIRTY_BLOCK_SIZE 32
+
+// Picks the fastest implementation the CPU supports, safe to call more than once
+void Birdie_InitializeDirtyBlocks();
+
+// Returns the offset of the first block at or after 'offset' that is dirty (or clean, if findDirty is false).
+// Offsets are multiples of BIRDIE_DIRTY_BLOCK_SIZE, except that 'size' is returned if there is no such block.
+// The last block may be shorter than BIRDIE_DIRTY_BLOCK_SIZE.
+size_t Birdie_FindBlock(const char* pCurrent, const char* pShadow, size_t size, size_t offset, bool findDirty);
+
+// Hashes 'rowCount' rows of 'rowSize' bytes, 'pitch' bytes apart. Hashes are only comparable within the same process,
+// every implementation has its own.
+uint64_t Birdie_HashRows(const char* pData, size_t rowSize, size_t pitch, size_t rowCount);
+
+#endif
@@ -0,0 +1,301 @@
+#include "Images.h"
+#include "DirtyBlocks.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+typedef struct
+{
+	BIRDIE_HANDLE       handle;
+
+	// As the caller has it
+	uint32_t            width;
+	uint32_t            height;
+	uint32_t            pitch;
+	BIRDIE_PIXEL_FORMAT format;
+	uint32_t            pixelSize;
+	uint32_t            downscale;
+
+	// As the tool gets it
+	uint32_t            sentWidth;
+	uint32_t            sentHeight;
+	uint32_t            tileColumns;
+	uint32_t            tileRows;
+
+	// Hashes of the tiles as they were last sent, only compared once every tile was sent at least once
+	uint64_t*           pTileHashes;
+	bool                hasTileHashes;
+} BIRDIE_IMAGE;
+
+static BIRDIE_IMAGE* g_pImages = NULL;
+static size_t        g_imageCount = 0;
+static size_t        g_imageCapacity = 0;
+
+// Reused between snapshots, it only ever grows
+static char*         g_pTileBuffer = NULL;
+static size_t        g_tileBufferSize = 0;
+
+
+// Prototypes
+
+static BIRDIE_IMAGE* Birdie_FindImage(BIRDIE_HANDLE handle);
+static void Birdie_DropRemovedImages();
+static void Birdie_DownscaleTile(const BIRDIE_IMAGE* pImage, const char* pSource, uint32_t sourceWidth, uint32_t sourceHeight, uint32_t width, uint32_t height, char* pTarget);
+
+
+// Function implementations
+
+void Birdie_FreeImages()
+{
+	for (size_t i = 0; i < g_imageCount; i++)
+		g_deallocFunction(g_pImages[i].pTileHashes);
+
+	if (g_pImages != NULL)
+		g_deallocFunction(g_pImages);
+
+	if (g_pTileBuffer != NULL)
+		g_deallocFunction(g_pTileBuffer);
+
+	g_pImages = NULL;
+	g_imageCount = 0;
+	g_imageCapacity = 0;
+
+	g_pTileBuffer = NULL;
+	g_tileBufferSize = 0;
+}
+
+uint32_t Birdie_GetPixelSize(BIRDIE_PIXEL_FORMAT format)
+{
+	switch (format)
+	{
+	case BIRDIE_PIXEL_FORMAT_RGBA8:
+	case BIRDIE_PIXEL_FORMAT_BGRA8:
+		return 4;
+	case BIRDIE_PIXEL_FORMAT_R8:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+BIRDIE_ERROR Birdie_AddImage(BIRDIE_HANDLE handle, uint32_t width, uint32_t height, uint32_t pitch, BIRDIE_PIXEL_FORMAT format, uint32_t downscale)
+{
+	Birdie_DropRemovedImages();
+
+	if (g_imageCount == g_imageCapacity)
+	{
+		size_t newCapacity = g_imageCapacity == 0 ? 4 : g_imageCapacity * 2;
+		BIRDIE_IMAGE* pNewImages = (BIRDIE_IMAGE*)g_allocFunction(newCapacity * sizeof(BIRDIE_IMAGE));
+
+		if (pNewImages == NULL)
+			return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+		if (g_pImages != NULL)
+		{
+			memcpy((void*)pNewImages, (void*)g_pImages, g_imageCount * sizeof(BIRDIE_IMAGE));
+			g_deallocFunction(g_pImages);
+		}
+
+		g_pImages = pNewImages;
+		g_imageCapacity = newCapacity;
+	}
+
+	BIRDIE_IMAGE image;
+
+	image.handle = handle;
+	image.width = width;
+	image.height = height;
+	image.pitch = pitch;
+	image.format = format;
+	image.pixelSize = Birdie_GetPixelSize(format);
+	image.downscale = downscale;
+
+	// Partial boxes along the edges are averaged over the pixels they have
+	image.sentWidth = (width + downscale - 1) / downscale;
+	image.sentHeight = (height + downscale - 1) / downscale;
+	image.tileColumns = (image.sentWidth + BIRDIE_IMAGE_TILE_SIZE - 1) / BIRDIE_IMAGE_TILE_SIZE;
+	image.tileRows = (image.sentHeight + BIRDIE_IMAGE_TILE_SIZE - 1) / BIRDIE_IMAGE_TILE_SIZE;
+
+	image.pTileHashes = (uint64_t*)g_allocFunction((size_t)image.tileColumns * image.tileRows * sizeof(uint64_t));
+	image.hasTileHashes = false;
+
+	if (image.pTileHashes == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	g_pImages[g_imageCount++] = image;
+
+	return BIRDIE_SUCCESS;
+}
+
+bool Birdie_GetImageLayout(BIRDIE_HANDLE handle, BIRDIE_IMAGE_LAYOUT* pLayout)
+{
+	const BIRDIE_IMAGE* pImage = Birdie_FindImage(handle);
+
+	if (pImage == NULL)
+		return false;
+
+	pLayout->width = pImage->sentWidth;
+	pLayout->height = pImage->sentHeight;
+	pLayout->format = (uint32_t)pImage->format;
+	pLayout->tileSize = BIRDIE_IMAGE_TILE_SIZE;
+
+	return true;
+}
+
+void Birdie_ResetImageTiles(BIRDIE_HANDLE handle)
+{
+	BIRDIE_IMAGE* pImage = Birdie_FindImage(handle);
+
+	if (pImage != NULL)
+		pImage->hasTileHashes = false;
+}
+
+char* Birdie_SnapshotImageTiles(BIRDIE_HANDLE handle, const void* pPixels, size_t headerSize, size_t* pSize, uint32_t* pTileCount, uint32_t* pNextTile)
+{
+	BIRDIE_IMAGE* pImage = Birdie_FindImage(handle);
+
+	if (pImage == NULL)
+		return NULL;
+
+	// The tile that crosses the chunk size still has to fit
+	size_t tileHeaderSize = sizeof(uint32_t) * 4;
+	size_t maxTileSize = tileHeaderSize + BIRDIE_IMAGE_TILE_SIZE * BIRDIE_IMAGE_TILE_SIZE * pImage->pixelSize;
+	size_t bufferSize = headerSize + BIRDIE_IMAGE_CHUNK_SIZE + maxTileSize;
+
+	if (bufferSize > g_tileBufferSize)
+	{
+		char* pNewBuffer = (char*)g_allocFunction(bufferSize);
+
+		if (pNewBuffer == NULL)
+			return NULL;
+
+		if (g_pTileBuffer != NULL)
+			g_deallocFunction(g_pTileBuffer);
+
+		g_pTileBuffer = pNewBuffer;
+		g_tileBufferSize = bufferSize;
+	}
+
+	uint32_t tileTotal = pImage->tileColumns * pImage->tileRows;
+	uint32_t tile = *pNextTile;
+	uint32_t tileCount = 0;
+	size_t offset = headerSize;
+
+	for (; tile < tileTotal && offset - headerSize < BIRDIE_IMAGE_CHUNK_SIZE; tile++)
+	{
+		uint32_t x = (tile % pImage->tileColumns) * BIRDIE_IMAGE_TILE_SIZE;
+		uint32_t y = (tile / pImage->tileColumns) * BIRDIE_IMAGE_TILE_SIZE;
+		uint32_t width = pImage->sentWidth - x < BIRDIE_IMAGE_TILE_SIZE ? pImage->sentWidth - x : BIRDIE_IMAGE_TILE_SIZE;
+		uint32_t height = pImage->sentHeight - y < BIRDIE_IMAGE_TILE_SIZE ? pImage->sentHeight - y : BIRDIE_IMAGE_TILE_SIZE;
+
+		// The part of the caller's image the tile is made from
+		uint32_t sourceX = x * pImage->downscale;
+		uint32_t sourceY = y * pImage->downscale;
+		uint32_t sourceWidth = pImage->width - sourceX < width * pImage->downscale ? pImage->width - sourceX : width * pImage->downscale;
+		uint32_t sourceHeight = pImage->height - sourceY < height * pImage->downscale ? pImage->height - sourceY : height * pImage->downscale;
+
+		const char* pSource = (const char*)pPixels + (size_t)sourceY * pImage->pitch + (size_t)sourceX * pImage->pixelSize;
+
+		// Hashed at full size, downscaling is only worth it for the tiles that are sent
+		uint64_t hash = Birdie_HashRows(pSource, (size_t)sourceWidth * pImage->pixelSize, pImage->pitch, sourceHeight);
+
+		if (pImage->hasTileHashes && pImage->pTileHashes[tile] == hash)
+			continue;
+
+		pImage->pTileHashes[tile] = hash;
+
+		uint32_t tileHeader[4] = { x, y, width, height };
+
+		memcpy((void*)(g_pTileBuffer + offset), (void*)tileHeader, tileHeaderSize);
+		offset += tileHeaderSize;
+
+		Birdie_DownscaleTile(pImage, pSource, sourceWidth, sourceHeight, width, height, g_pTileBuffer + offset);
+		offset += (size_t)width * height * pImage->pixelSize;
+
+		tileCount++;
+	}
+
+	if (tile == tileTotal)
+	{
+		pImage->hasTileHashes = true;
+		tile = 0;
+	}
+
+	*pSize = offset;
+	*pTileCount = tileCount;
+	*pNextTile = tile;
+
+	return g_pTileBuffer;
+}
+
+static BIRDIE_IMAGE* Birdie_FindImage(BIRDIE_HANDLE handle)
+{
+	for (size_t i = 0; i < g_imageCount; i++)
+	{
+		if (g_pImages[i].handle == handle)
+			return &g_pImages[i];
+	}
+
+	return NULL;
+}
+
+static void Birdie_DropRemovedImages()
+{
+	// Removing a watch doesn't tell us, the handles of removed watches simply aren't live anymore
+	for (size_t i = 0; i < g_imageCount;)
+	{
+		if (Birdie_FindWatchEntry(g_pImages[i].handle) != NULL)
+		{
+			i++;
+			continue;
+		}
+
+		g_deallocFunction(g_pImages[i].pTileHashes);
+		g_pImages[i] = g_pImages[--g_imageCount];
+	}
+}
+
+static void Birdie_DownscaleTile(const BIRDIE_IMAGE* pImage, const char* pSource, uint32_t sourceWidth, uint32_t sourceHeight, uint32_t width, uint32_t height, char* pTarget)
+{
+	size_t pixelSize = pImage->pixelSize;
+
+	if (pImage->downscale == 1)
+	{
+		for (uint32_t y = 0; y < height; y++)
+			memcpy((void*)(pTarget + y * width * pixelSize), (void*)(pSource + (size_t)y * pImage->pitch), width * pixelSize);
+
+		return;
+	}
+
+	// Every channel is the average of its box, the boxes along the right and bottom edges may be cut off
+	for (uint32_t y = 0; y < height; y++)
+	{
+		uint32_t boxTop = y * pImage->downscale;
+		uint32_t boxBottom = boxTop + pImage->downscale < sourceHeight ? boxTop + pImage->downscale : sourceHeight;
+
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t boxLeft = x * pImage->downscale;
+			uint32_t boxRight = boxLeft + pImage->downscale < sourceWidth ? boxLeft + pImage->downscale : sourceWidth;
+			uint32_t boxSize = (boxRight - boxLeft) * (boxBottom - boxTop);
+
+			uint32_t sums[4] = { 0, 0, 0, 0 };
+
+			for (uint32_t boxY = boxTop; boxY < boxBottom; boxY++)
+			{
+				const uint8_t* pRow = (const uint8_t*)(pSource + (size_t)boxY * pImage->pitch);
+
+				for (uint32_t boxX = boxLeft; boxX < boxRight; boxX++)
+				{
+					for (size_t channel = 0; channel < pixelSize; channel++)
+						sums[channel] += pRow[boxX * pixelSize + channel];
+				}
+			}
+
+			for (size_t channel = 0; channel < pixelSize; channel++)
+				*pTarget++ = (char)((sums[channel] + boxSize / 2) / boxSize);
+		}
+	}
+}
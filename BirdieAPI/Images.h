@@ -0,0 +1,52 @@
+#ifndef BIRDIEAPI_IMAGES_H
+#define BIRDIEAPI_IMAGES_H
+
+#include "Birdie.h"
+#include "Platform.h"
+#include "WatchRegistry.h"
+
+// This header contains the state of image watches.
+// Images are registered as watches without a region, so they're removed and replayed like any other watch, but never
+// snapshot by Birdie_PublishWatches. Publishing an image splits it into tiles and only sends the tiles whose hash changed,
+// downscaled if the image asked for it. Everything here expects the watch registry to be locked.
+
+// Edge of a tile in sent pixels, tiles along the right and bottom edges may be smaller
+#define BIRDIE_IMAGE_TILE_SIZE      64
+
+// Tiles are sent in chunks of about this size, so a full image doesn't need a queue record or scratch buffer of its own.
+// A chunk and the tile that crosses this size stay within a single fragment, see BIRDIE_MAX_FRAGMENT_SIZE.
+#define BIRDIE_IMAGE_CHUNK_SIZE     (192 * 1024)
+
+#define BIRDIE_IMAGE_MAX_DOWNSCALE  16
+
+// What the tool needs to know about an image, sizes are in sent pixels
+typedef struct
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	uint32_t tileSize;
+} BIRDIE_IMAGE_LAYOUT;
+
+void Birdie_FreeImages();
+
+// Returns the size of a pixel in bytes, or 0 if the format is unknown
+uint32_t Birdie_GetPixelSize(BIRDIE_PIXEL_FORMAT format);
+
+// Keeps track of the image behind a watch that was just registered. Drops images of watches that were removed since.
+BIRDIE_ERROR Birdie_AddImage(BIRDIE_HANDLE handle, uint32_t width, uint32_t height, uint32_t pitch, BIRDIE_PIXEL_FORMAT format, uint32_t downscale);
+
+// Returns false if the watch isn't an image
+bool Birdie_GetImageLayout(BIRDIE_HANDLE handle, BIRDIE_IMAGE_LAYOUT* pLayout);
+
+// Forgets what was sent of an image, so the next snapshot sends every tile. Used when the tool missed tiles.
+void Birdie_ResetImageTiles(BIRDIE_HANDLE handle);
+
+// Copies the tiles of an image that changed, starting at tile '*pNextTile', into a buffer owned by the images, behind
+// 'headerSize' bytes that are left for the caller. Stops after about BIRDIE_IMAGE_CHUNK_SIZE bytes.
+// Every tile is stored as: x (4b), y (4b), width (4b), height (4b), then its rows of pixels without any padding.
+// Returns NULL if memory ran out, otherwise the buffer and its total size and tile count. '*pNextTile' is set to the
+// tile to continue with, or 0 once every tile was looked at.
+char* Birdie_SnapshotImageTiles(BIRDIE_HANDLE handle, const void* pPixels, size_t headerSize, size_t* pSize, uint32_t* pTileCount, uint32_t* pNextTile);
+
+#endif
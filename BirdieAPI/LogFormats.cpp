@@ -0,0 +1,481 @@
+#include "LogFormats.h"
+#include "Common.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+#define BIRDIE_LOG_FORMAT_TABLE_MIN_CAPACITY 64
+
+// Per thread, direct mapped by the address of the format
+#define BIRDIE_LOG_FORMAT_CACHE_SIZE         32
+
+typedef struct
+{
+	const char*              pFormat;
+	const BIRDIE_LOG_FORMAT* pLogFormat;
+	LONG                     generation;
+} BIRDIE_LOG_FORMAT_CACHE_ENTRY;
+
+// Open addressing, keyed by the contents of the format. Keying by pointer would break on formats in reused buffers.
+static CRITICAL_SECTION    g_csLogFormats;
+static BIRDIE_LOG_FORMAT** g_ppLogFormatTable = NULL;
+static size_t              g_logFormatTableCapacity = 0;
+static uint32_t            g_logFormatCount = 0;
+
+// Bumped whenever the entries are released, cached entries of an older generation are stale
+static volatile LONG       g_logFormatGeneration = 1;
+
+static BIRDIE_THREAD_LOCAL BIRDIE_LOG_FORMAT_CACHE_ENTRY g_logFormatCache[BIRDIE_LOG_FORMAT_CACHE_SIZE];
+
+
+// Prototypes
+
+static void Birdie_InitializeLogFormats();
+static const BIRDIE_LOG_FORMAT* Birdie_LookUpLogFormat(const char* pFormat, BIRDIE_LOG_FORMAT_FUNCTION pAddFunction);
+static uint32_t Birdie_HashLogFormat(const char* pFormat, size_t* pLength);
+static bool Birdie_GrowLogFormatTable();
+static bool Birdie_ParseLogFormat(BIRDIE_LOG_FORMAT* pLogFormat);
+
+
+// Function implementations
+
+// The lock lives as long as the process, just like the other tables
+static void Birdie_InitializeLogFormats()
+{
+	InitializeCriticalSection(&g_csLogFormats);
+}
+
+BIRDIE_STATIC_CALL(Birdie_InitializeLogFormats, ());
+
+void Birdie_FreeLogFormats()
+{
+	EnterCriticalSection(&g_csLogFormats);
+
+	for (size_t i = 0; i < g_logFormatTableCapacity; i++)
+	{
+		BIRDIE_LOG_FORMAT* pLogFormat = g_ppLogFormatTable[i];
+
+		if (pLogFormat == NULL)
+			continue;
+
+		g_deallocFunction(pLogFormat->pFormat);
+		g_deallocFunction(pLogFormat);
+	}
+
+	if (g_ppLogFormatTable != NULL)
+		g_deallocFunction(g_ppLogFormatTable);
+
+	g_ppLogFormatTable = NULL;
+	g_logFormatTableCapacity = 0;
+	g_logFormatCount = 0;
+
+	InterlockedIncrement(&g_logFormatGeneration);
+
+	LeaveCriticalSection(&g_csLogFormats);
+}
+
+const BIRDIE_LOG_FORMAT* Birdie_GetLogFormat(const char* pFormat, BIRDIE_LOG_FORMAT_FUNCTION pAddFunction)
+{
+	// Formats are almost always literals, so the address alone nearly always finds it.
+	// The contents are still compared, a buffer that's reused for another format must not find the old one.
+	uintptr_t address = (uintptr_t)pFormat;
+	BIRDIE_LOG_FORMAT_CACHE_ENTRY* pCacheEntry = &g_logFormatCache[((address >> 4) ^ (address >> 12)) & (BIRDIE_LOG_FORMAT_CACHE_SIZE - 1)];
+	LONG generation = g_logFormatGeneration;
+
+	if (pCacheEntry->pFormat == pFormat && pCacheEntry->generation == generation && strcmp(pCacheEntry->pLogFormat->pFormat, pFormat) == 0)
+		return pCacheEntry->pLogFormat;
+
+	const BIRDIE_LOG_FORMAT* pLogFormat = Birdie_LookUpLogFormat(pFormat, pAddFunction);
+
+	if (pLogFormat != NULL)
+	{
+		pCacheEntry->pFormat = pFormat;
+		pCacheEntry->pLogFormat = pLogFormat;
+		pCacheEntry->generation = generation;
+	}
+
+	return pLogFormat;
+}
+
+static const BIRDIE_LOG_FORMAT* Birdie_LookUpLogFormat(const char* pFormat, BIRDIE_LOG_FORMAT_FUNCTION pAddFunction)
+{
+	size_t formatLength = 0;
+	uint32_t hash = Birdie_HashLogFormat(pFormat, &formatLength);
+
+	EnterCriticalSection(&g_csLogFormats);
+
+	size_t mask = g_logFormatTableCapacity - 1;
+	size_t index = hash & mask;
+
+	for (; g_logFormatTableCapacity > 0 && g_ppLogFormatTable[index] != NULL; index = (index + 1) & mask)
+	{
+		BIRDIE_LOG_FORMAT* pLogFormat = g_ppLogFormatTable[index];
+
+		if (pLogFormat->hash == hash && pLogFormat->formatLength == formatLength && memcmp(pLogFormat->pFormat, pFormat, formatLength) == 0)
+		{
+			LeaveCriticalSection(&g_csLogFormats);
+			return pLogFormat;
+		}
+	}
+
+	// Not seen before, keep the table at most half full
+	if ((g_logFormatCount + 1) * 2 > g_logFormatTableCapacity && !Birdie_GrowLogFormatTable())
+	{
+		LeaveCriticalSection(&g_csLogFormats);
+		return NULL;
+	}
+
+	BIRDIE_LOG_FORMAT* pLogFormat = (BIRDIE_LOG_FORMAT*)g_allocFunction(sizeof(BIRDIE_LOG_FORMAT));
+	char* pFormatCopy = (char*)g_allocFunction(formatLength + 1);
+
+	if (pLogFormat == NULL || pFormatCopy == NULL)
+	{
+		if (pLogFormat != NULL)
+			g_deallocFunction(pLogFormat);
+
+		if (pFormatCopy != NULL)
+			g_deallocFunction(pFormatCopy);
+
+		LeaveCriticalSection(&g_csLogFormats);
+		return NULL;
+	}
+
+	memcpy(pFormatCopy, pFormat, formatLength + 1);
+
+	memset(pLogFormat, 0, sizeof(BIRDIE_LOG_FORMAT));
+	pLogFormat->hash = hash;
+	pLogFormat->formatId = g_logFormatCount + 1;
+	pLogFormat->formatLength = formatLength;
+	pLogFormat->pFormat = pFormatCopy;
+	pLogFormat->canCaptureArguments = Birdie_ParseLogFormat(pLogFormat);
+
+	// The tool has to know the format before it's used, so it's sent before anyone else can find it
+	if (pAddFunction(pLogFormat) != BIRDIE_SUCCESS)
+	{
+		g_deallocFunction(pFormatCopy);
+		g_deallocFunction(pLogFormat);
+
+		LeaveCriticalSection(&g_csLogFormats);
+		return NULL;
+	}
+
+	mask = g_logFormatTableCapacity - 1;
+
+	for (index = hash & mask; g_ppLogFormatTable[index] != NULL; index = (index + 1) & mask)
+		continue;
+
+	g_ppLogFormatTable[index] = pLogFormat;
+	g_logFormatCount++;
+
+	LeaveCriticalSection(&g_csLogFormats);
+
+	return pLogFormat;
+}
+
+void Birdie_LockLogFormats()
+{
+	EnterCriticalSection(&g_csLogFormats);
+}
+
+void Birdie_UnlockLogFormats()
+{
+	LeaveCriticalSection(&g_csLogFormats);
+}
+
+BIRDIE_ERROR Birdie_ReplayLogFormats(BIRDIE_LOG_FORMAT_FUNCTION pFunction)
+{
+	for (size_t i = 0; i < g_logFormatTableCapacity; i++)
+	{
+		if (g_ppLogFormatTable[i] == NULL)
+			continue;
+
+		BIRDIE_ERROR error = pFunction(g_ppLogFormatTable[i]);
+
+		if (error != BIRDIE_SUCCESS)
+			return error;
+	}
+
+	return BIRDIE_SUCCESS;
+}
+
+size_t Birdie_CaptureLogArguments(const BIRDIE_LOG_FORMAT* pLogFormat, char* pBuffer, size_t bufferSize, va_list args)
+{
+	size_t offset = 0;
+
+	for (uint32_t i = 0; i < pLogFormat->argumentCount; i++)
+	{
+		uint8_t kind = pLogFormat->argumentKinds[i];
+
+		// Every value is written through this, so measuring and encoding are the same pass
+		const void* pValue = NULL;
+		size_t valueSize = 0;
+
+		int32_t int32Value = 0;
+		int64_t int64Value = 0;
+		double float64Value = 0.0;
+		uint64_t pointerValue = 0;
+		uint32_t stringLength = 0;
+		const char* pString = NULL;
+
+		switch (kind)
+		{
+			case BIRDIE_LOG_ARGUMENT_INT32:
+			case BIRDIE_LOG_ARGUMENT_UINT32:
+				int32Value = va_arg(args, int32_t);
+				pValue = &int32Value;
+				valueSize = sizeof(int32_t);
+				break;
+
+			case BIRDIE_LOG_ARGUMENT_INT64:
+			case BIRDIE_LOG_ARGUMENT_UINT64:
+				int64Value = va_arg(args, int64_t);
+				pValue = &int64Value;
+				valueSize = sizeof(int64_t);
+				break;
+
+			case BIRDIE_LOG_ARGUMENT_FLOAT64:
+				float64Value = va_arg(args, double);
+				pValue = &float64Value;
+				valueSize = sizeof(double);
+				break;
+
+			case BIRDIE_LOG_ARGUMENT_POINTER:
+				pointerValue = (uint64_t)(uintptr_t)va_arg(args, void*);
+				pValue = &pointerValue;
+				valueSize = sizeof(uint64_t);
+				break;
+
+			case BIRDIE_LOG_ARGUMENT_STRING:
+				// Strings are the only arguments that have to be copied, the caller may free them right after
+				pString = va_arg(args, const char*);
+
+				if (pString == NULL)
+					pString = "(null)";
+
+				stringLength = (uint32_t)strlen(pString);
+				pValue = &stringLength;
+				valueSize = sizeof(uint32_t);
+				break;
+		}
+
+		if (offset + sizeof(uint8_t) + valueSize + stringLength <= bufferSize)
+		{
+			memcpy((void*)(pBuffer + offset), (void*)&kind, sizeof(uint8_t));
+			memcpy((void*)(pBuffer + offset + sizeof(uint8_t)), pValue, valueSize);
+
+			if (pString != NULL)
+				memcpy((void*)(pBuffer + offset + sizeof(uint8_t) + valueSize), (void*)pString, stringLength);
+		}
+
+		offset += sizeof(uint8_t) + valueSize + stringLength;
+	}
+
+	return offset;
+}
+
+static uint32_t Birdie_HashLogFormat(const char* pFormat, size_t* pLength)
+{
+	// FNV-1a, measures the string on the way
+	uint32_t hash = 2166136261u;
+	const char* pCurrent = pFormat;
+
+	for (; *pCurrent != '\0'; pCurrent++)
+		hash = (hash ^ (uint8_t)*pCurrent) * 16777619u;
+
+	*pLength = (size_t)(pCurrent - pFormat);
+
+	return hash;
+}
+
+static bool Birdie_GrowLogFormatTable()
+{
+	size_t newCapacity = g_logFormatTableCapacity == 0 ? BIRDIE_LOG_FORMAT_TABLE_MIN_CAPACITY : g_logFormatTableCapacity * 2;
+	BIRDIE_LOG_FORMAT** ppNewTable = (BIRDIE_LOG_FORMAT**)g_allocFunction(newCapacity * sizeof(BIRDIE_LOG_FORMAT*));
+
+	if (ppNewTable == NULL)
+		return false;
+
+	memset(ppNewTable, 0, newCapacity * sizeof(BIRDIE_LOG_FORMAT*));
+
+	size_t mask = newCapacity - 1;
+
+	for (size_t i = 0; i < g_logFormatTableCapacity; i++)
+	{
+		BIRDIE_LOG_FORMAT* pLogFormat = g_ppLogFormatTable[i];
+
+		if (pLogFormat == NULL)
+			continue;
+
+		size_t index = pLogFormat->hash & mask;
+
+		while (ppNewTable[index] != NULL)
+			index = (index + 1) & mask;
+
+		ppNewTable[index] = pLogFormat;
+	}
+
+	if (g_ppLogFormatTable != NULL)
+		g_deallocFunction(g_ppLogFormatTable);
+
+	g_ppLogFormatTable = ppNewTable;
+	g_logFormatTableCapacity = newCapacity;
+
+	return true;
+}
+
+static bool Birdie_ParseLogFormat(BIRDIE_LOG_FORMAT* pLogFormat)
+{
+	// Walks the conversion specifications the way printf does, only to learn what it would pull from the va_list
+	const char* pCurrent = pLogFormat->pFormat;
+
+	while (*pCurrent != '\0')
+	{
+		if (*pCurrent++ != '%')
+			continue;
+
+		if (*pCurrent == '%')
+		{
+			pCurrent++;
+			continue;
+		}
+
+		// Flags
+		while (*pCurrent != '\0' && strchr("-+ #0'", *pCurrent) != NULL)
+			pCurrent++;
+
+		// Width and precision, '*' takes an int from the arguments
+		for (int field = 0; field < 2; field++)
+		{
+			if (field == 1)
+			{
+				if (*pCurrent != '.')
+					break;
+
+				pCurrent++;
+			}
+
+			if (*pCurrent == '*')
+			{
+				if (pLogFormat->argumentCount == BIRDIE_MAX_LOG_ARGUMENTS)
+					return false;
+
+				pLogFormat->argumentKinds[pLogFormat->argumentCount++] = BIRDIE_LOG_ARGUMENT_INT32;
+				pCurrent++;
+			}
+			else
+			{
+				while (*pCurrent >= '0' && *pCurrent <= '9')
+					pCurrent++;
+			}
+		}
+
+		// Length modifiers, only the size of the argument matters here
+		size_t argumentSize = sizeof(int);
+		bool isWide = false;
+
+		if (pCurrent[0] == 'h')
+		{
+			pCurrent += pCurrent[1] == 'h' ? 2 : 1;
+		}
+		else if (pCurrent[0] == 'l' && pCurrent[1] == 'l')
+		{
+			argumentSize = sizeof(long long);
+			pCurrent += 2;
+		}
+		else if (pCurrent[0] == 'l' || pCurrent[0] == 'w')
+		{
+			argumentSize = sizeof(long);
+			isWide = true;
+			pCurrent++;
+		}
+		else if (pCurrent[0] == 'z' || pCurrent[0] == 't')
+		{
+			argumentSize = sizeof(size_t);
+			pCurrent++;
+		}
+		else if (pCurrent[0] == 'j')
+		{
+			argumentSize = sizeof(intmax_t);
+			pCurrent++;
+		}
+		else if (pCurrent[0] == 'I' && pCurrent[1] == '6' && pCurrent[2] == '4')
+		{
+			argumentSize = sizeof(int64_t);
+			pCurrent += 3;
+		}
+		else if (pCurrent[0] == 'I' && pCurrent[1] == '3' && pCurrent[2] == '2')
+		{
+			argumentSize = sizeof(int32_t);
+			pCurrent += 3;
+		}
+		else if (pCurrent[0] == 'I')
+		{
+			argumentSize = sizeof(size_t);
+			pCurrent++;
+		}
+		else if (pCurrent[0] == 'L')
+		{
+			// long double isn't worth a kind of its own
+			return false;
+		}
+
+		uint8_t kind = 0;
+
+		switch (*pCurrent)
+		{
+			case 'd':
+			case 'i':
+				kind = argumentSize == sizeof(int64_t) ? BIRDIE_LOG_ARGUMENT_INT64 : BIRDIE_LOG_ARGUMENT_INT32;
+				break;
+
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+				kind = argumentSize == sizeof(uint64_t) ? BIRDIE_LOG_ARGUMENT_UINT64 : BIRDIE_LOG_ARGUMENT_UINT32;
+				break;
+
+			case 'c':
+				// Wide characters are promoted to int as well
+				kind = BIRDIE_LOG_ARGUMENT_INT32;
+				break;
+
+			case 'f':
+			case 'F':
+			case 'e':
+			case 'E':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+				kind = BIRDIE_LOG_ARGUMENT_FLOAT64;
+				break;
+
+			case 's':
+				// Wide strings would have to be converted, leave those to vsnprintf
+				if (isWide)
+					return false;
+
+				kind = BIRDIE_LOG_ARGUMENT_STRING;
+				break;
+
+			case 'p':
+				kind = BIRDIE_LOG_ARGUMENT_POINTER;
+				break;
+
+			default:
+				// %n, or something we don't know
+				return false;
+		}
+
+		if (pLogFormat->argumentCount == BIRDIE_MAX_LOG_ARGUMENTS)
+			return false;
+
+		pLogFormat->argumentKinds[pLogFormat->argumentCount++] = kind;
+		pCurrent++;
+	}
+
+	return true;
+}
@@ -0,0 +1,49 @@
+#ifndef BIRDIEAPI_LOGFORMATS_H
+#define BIRDIEAPI_LOGFORMATS_H
+
+#include "Birdie.h"
+#include "Platform.h"
+
+// This header contains the format string table used for deferred log formatting.
+// Every distinct format string is sent to the tool once and parsed once, after that a log call
+// only sends the format's id and the raw bytes of its arguments. The tool does the formatting.
+
+// Maximum amount of arguments a format can consume, '*' widths and precisions included
+#define BIRDIE_MAX_LOG_ARGUMENTS 32
+
+typedef struct
+{
+	uint32_t    hash;
+	uint32_t    formatId;
+	size_t      formatLength;
+	char*       pFormat;
+
+	// Only filled in when the arguments can be captured from a va_list, not all formats can
+	bool        canCaptureArguments;
+	uint32_t    argumentCount;
+	uint8_t     argumentKinds[BIRDIE_MAX_LOG_ARGUMENTS];
+} BIRDIE_LOG_FORMAT;
+
+// Called for formats that haven't been seen before, while the table is still locked.
+// Whatever this sends reaches the tool before anything that uses the format.
+typedef BIRDIE_ERROR (*BIRDIE_LOG_FORMAT_FUNCTION)(const BIRDIE_LOG_FORMAT* pLogFormat);
+
+void Birdie_FreeLogFormats();
+
+// Returns the entry for a format, adding it (and calling pAddFunction) if needed. Returns NULL if memory ran out.
+// Entries stay valid until Birdie_FreeLogFormats. Every thread remembers the formats it used last by their address,
+// a format that's still at the same address with the same contents is found without taking the lock.
+const BIRDIE_LOG_FORMAT* Birdie_GetLogFormat(const char* pFormat, BIRDIE_LOG_FORMAT_FUNCTION pAddFunction);
+
+// Keeps formats from being added, so a replay can't miss any
+void Birdie_LockLogFormats();
+void Birdie_UnlockLogFormats();
+
+// Calls pFunction for every format in the table. Expects the table to be locked, stops at the first error and returns it.
+BIRDIE_ERROR Birdie_ReplayLogFormats(BIRDIE_LOG_FORMAT_FUNCTION pFunction);
+
+// Encodes the arguments of a format as kind bytes followed by their values, see BIRDIE_LOG_ARGUMENT_KIND.
+// Returns the encoded size, which may be larger than bufferSize. Nothing is written past bufferSize.
+size_t Birdie_CaptureLogArguments(const BIRDIE_LOG_FORMAT* pLogFormat, char* pBuffer, size_t bufferSize, va_list args);
+
+#endif
@@ -0,0 +1,300 @@
+#include "Platform.h"
+#include "Birdie.h"
+
+// Nothing to do on Windows, the real thing is used there
+#ifndef _WIN32
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+typedef enum
+{
+	BIRDIE_OBJECT_EVENT,
+	BIRDIE_OBJECT_THREAD
+} BIRDIE_OBJECT_TYPE;
+
+// What a HANDLE points to
+typedef struct
+{
+	BIRDIE_OBJECT_TYPE     type;
+
+	// Events
+	pthread_mutex_t        mutex;
+	pthread_cond_t         condition;
+	bool                   isSignaled;
+	bool                   isManualReset;
+
+	// Threads
+	pthread_t              thread;
+	LPTHREAD_START_ROUTINE pStartRoutine;
+	LPVOID                 pParameter;
+	bool                   isJoined;
+} BIRDIE_OBJECT;
+
+
+// Function implementations
+
+BOOL SwitchToThread()
+{
+	return sched_yield() == 0;
+}
+
+void Sleep(DWORD milliseconds)
+{
+	struct timespec duration;
+
+	duration.tv_sec = milliseconds / 1000;
+	duration.tv_nsec = (long)(milliseconds % 1000) * 1000000;
+
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR)
+		continue;
+}
+
+DWORD GetTickCount()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (DWORD)((uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000);
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* pCount)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	pCount->QuadPart = (LONGLONG)now.tv_sec * 1000000000 + (LONGLONG)now.tv_nsec;
+
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* pFrequency)
+{
+	// The counter is in nanoseconds
+	pFrequency->QuadPart = 1000000000;
+
+	return TRUE;
+}
+
+DWORD GetCurrentProcessId()
+{
+	return (DWORD)getpid();
+}
+
+DWORD GetCurrentThreadId()
+{
+#ifdef __linux__
+	return (DWORD)syscall(SYS_gettid);
+#else
+	return (DWORD)(uintptr_t)pthread_self();
+#endif
+}
+
+void InitializeCriticalSection(CRITICAL_SECTION* pCriticalSection)
+{
+	pthread_mutexattr_t attributes;
+
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(pCriticalSection, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+}
+
+void EnterCriticalSection(CRITICAL_SECTION* pCriticalSection)
+{
+	pthread_mutex_lock(pCriticalSection);
+}
+
+BOOL TryEnterCriticalSection(CRITICAL_SECTION* pCriticalSection)
+{
+	return pthread_mutex_trylock(pCriticalSection) == 0;
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION* pCriticalSection)
+{
+	pthread_mutex_unlock(pCriticalSection);
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION* pCriticalSection)
+{
+	pthread_mutex_destroy(pCriticalSection);
+}
+
+HANDLE CreateEvent(void* pAttributes, BOOL isManualReset, BOOL isInitiallySignaled, const char* pName)
+{
+	if (pName != NULL)
+		return NULL;
+
+	BIRDIE_OBJECT* pObject = (BIRDIE_OBJECT*)g_allocFunction(sizeof(BIRDIE_OBJECT));
+
+	if (pObject == NULL)
+		return NULL;
+
+	memset((void*)pObject, 0, sizeof(BIRDIE_OBJECT));
+
+	pObject->type = BIRDIE_OBJECT_EVENT;
+	pObject->isManualReset = isManualReset != FALSE;
+	pObject->isSignaled = isInitiallySignaled != FALSE;
+
+	// Timed waits are measured against the monotonic clock
+	pthread_condattr_t conditionAttributes;
+
+	pthread_condattr_init(&conditionAttributes);
+	pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+
+	pthread_mutex_init(&pObject->mutex, NULL);
+	pthread_cond_init(&pObject->condition, &conditionAttributes);
+
+	pthread_condattr_destroy(&conditionAttributes);
+
+	return pObject;
+}
+
+BOOL SetEvent(HANDLE event)
+{
+	BIRDIE_OBJECT* pObject = (BIRDIE_OBJECT*)event;
+
+	pthread_mutex_lock(&pObject->mutex);
+	pObject->isSignaled = true;
+
+	if (pObject->isManualReset)
+		pthread_cond_broadcast(&pObject->condition);
+	else
+		pthread_cond_signal(&pObject->condition);
+
+	pthread_mutex_unlock(&pObject->mutex);
+
+	return TRUE;
+}
+
+static void* Birdie_ThreadTrampoline(void* pParameter)
+{
+	BIRDIE_OBJECT* pObject = (BIRDIE_OBJECT*)pParameter;
+	pObject->pStartRoutine(pObject->pParameter);
+
+	return NULL;
+}
+
+HANDLE CreateThread(void* pAttributes, size_t stackSize, LPTHREAD_START_ROUTINE pStartRoutine, LPVOID pParameter, DWORD flags, DWORD* pThreadId)
+{
+	BIRDIE_OBJECT* pObject = (BIRDIE_OBJECT*)g_allocFunction(sizeof(BIRDIE_OBJECT));
+
+	if (pObject == NULL)
+		return NULL;
+
+	memset((void*)pObject, 0, sizeof(BIRDIE_OBJECT));
+
+	pObject->type = BIRDIE_OBJECT_THREAD;
+	pObject->pStartRoutine = pStartRoutine;
+	pObject->pParameter = pParameter;
+
+	if (pthread_create(&pObject->thread, NULL, Birdie_ThreadTrampoline, pObject) != 0)
+	{
+		g_deallocFunction(pObject);
+		return NULL;
+	}
+
+	return pObject;
+}
+
+DWORD WaitForSingleObject(HANDLE object, DWORD milliseconds)
+{
+	BIRDIE_OBJECT* pObject = (BIRDIE_OBJECT*)object;
+
+	if (pObject->type == BIRDIE_OBJECT_THREAD)
+	{
+		if (!pObject->isJoined)
+			pthread_join(pObject->thread, NULL);
+
+		pObject->isJoined = true;
+
+		return WAIT_OBJECT_0;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000;
+
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	DWORD result = WAIT_OBJECT_0;
+
+	pthread_mutex_lock(&pObject->mutex);
+
+	while (!pObject->isSignaled)
+	{
+		int error = 0;
+
+		if (milliseconds == INFINITE)
+			error = pthread_cond_wait(&pObject->condition, &pObject->mutex);
+		else
+			error = pthread_cond_timedwait(&pObject->condition, &pObject->mutex, &deadline);
+
+		if (error == ETIMEDOUT)
+		{
+			result = WAIT_TIMEOUT;
+			break;
+		}
+	}
+
+	if (result == WAIT_OBJECT_0 && !pObject->isManualReset)
+		pObject->isSignaled = false;
+
+	pthread_mutex_unlock(&pObject->mutex);
+
+	return result;
+}
+
+BOOL CloseHandle(HANDLE object)
+{
+	BIRDIE_OBJECT* pObject = (BIRDIE_OBJECT*)object;
+
+	if (pObject->type == BIRDIE_OBJECT_THREAD)
+	{
+		// Closing a thread handle doesn't stop the thread
+		if (!pObject->isJoined)
+			pthread_detach(pObject->thread);
+	}
+	else
+	{
+		pthread_cond_destroy(&pObject->condition);
+		pthread_mutex_destroy(&pObject->mutex);
+	}
+
+	g_deallocFunction(pObject);
+
+	return TRUE;
+}
+
+DWORD FlsAlloc(PFLS_CALLBACK_FUNCTION pCallback)
+{
+	pthread_key_t key;
+
+	if (pthread_key_create(&key, pCallback) != 0)
+		return FLS_OUT_OF_INDEXES;
+
+	return (DWORD)key;
+}
+
+BOOL FlsSetValue(DWORD index, LPVOID pValue)
+{
+	return pthread_setspecific((pthread_key_t)index, pValue) == 0;
+}
+
+#endif
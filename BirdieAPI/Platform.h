@@ -0,0 +1,131 @@
+#ifndef BIRDIEAPI_PLATFORM_H
+#define BIRDIEAPI_PLATFORM_H
+
+// This header contains the platform layer of the Birdie API.
+// The library is written against the subset of Win32 that it needs, on other platforms that subset is provided here.
+
+#ifdef _WIN32
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <timeapi.h>
+
+#pragma comment(lib, "winmm.lib")
+
+#define BIRDIE_THREAD_LOCAL __declspec(thread)
+
+#else
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#define BIRDIE_THREAD_LOCAL __thread
+
+typedef int32_t  LONG;
+typedef uint32_t ULONG;
+typedef uint32_t DWORD;
+typedef int64_t  LONGLONG;
+typedef int      BOOL;
+typedef void*    LPVOID;
+typedef void*    HANDLE;
+
+typedef union
+{
+	LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef pthread_mutex_t CRITICAL_SECTION;
+
+#define TRUE          1
+#define FALSE         0
+#define WINAPI
+#define INFINITE      0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT  258
+
+#define FLS_OUT_OF_INDEXES 0xFFFFFFFF
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+typedef void (WINAPI *PFLS_CALLBACK_FUNCTION)(LPVOID);
+
+// Interlocked functions, all of them are full barriers like their Win32 counterparts
+
+inline LONG InterlockedIncrement(volatile LONG* pValue)                     { return __atomic_add_fetch(pValue, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedDecrement(volatile LONG* pValue)                     { return __atomic_sub_fetch(pValue, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchange(volatile LONG* pValue, LONG value)          { return __atomic_exchange_n(pValue, value, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchangeAdd(volatile LONG* pValue, LONG value)       { return __atomic_fetch_add(pValue, value, __ATOMIC_SEQ_CST); }
+inline uint32_t InterlockedIncrement(volatile uint32_t* pValue)             { return __atomic_add_fetch(pValue, 1, __ATOMIC_SEQ_CST); }
+
+inline LONG InterlockedCompareExchange(volatile LONG* pValue, LONG exchange, LONG comparand)
+{
+	__atomic_compare_exchange_n(pValue, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+
+inline LONGLONG InterlockedExchange64(volatile LONGLONG* pValue, LONGLONG value)    { return __atomic_exchange_n(pValue, value, __ATOMIC_SEQ_CST); }
+inline LONGLONG InterlockedExchangeAdd64(volatile LONGLONG* pValue, LONGLONG value) { return __atomic_fetch_add(pValue, value, __ATOMIC_SEQ_CST); }
+
+inline LONGLONG InterlockedCompareExchange64(volatile LONGLONG* pValue, LONGLONG exchange, LONGLONG comparand)
+{
+	__atomic_compare_exchange_n(pValue, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+
+inline void* InterlockedExchangePointer(void* volatile* pValue, void* value) { return __atomic_exchange_n(pValue, value, __ATOMIC_SEQ_CST); }
+
+inline void* InterlockedCompareExchangePointer(void* volatile* pValue, void* exchange, void* comparand)
+{
+	__atomic_compare_exchange_n(pValue, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+
+// Plain loads and stores with ordering, cheaper than a full barrier
+inline LONG ReadAcquire(const volatile LONG* pValue)          { return __atomic_load_n(pValue, __ATOMIC_ACQUIRE); }
+inline void WriteRelease(volatile LONG* pValue, LONG value)   { __atomic_store_n(pValue, value, __ATOMIC_RELEASE); }
+inline void* ReadPointerAcquire(void* const volatile* pValue) { return __atomic_load_n(pValue, __ATOMIC_ACQUIRE); }
+
+inline void YieldProcessor()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+// Scheduling and time
+BOOL SwitchToThread();
+void Sleep(DWORD milliseconds);
+DWORD GetTickCount();
+BOOL QueryPerformanceCounter(LARGE_INTEGER* pCount);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* pFrequency);
+DWORD GetCurrentProcessId();
+DWORD GetCurrentThreadId();
+
+// Sleeps and timed waits are as precise as the system allows already, there's no timer resolution to raise
+inline DWORD timeBeginPeriod(DWORD period) { return 0; }
+inline DWORD timeEndPeriod(DWORD period)   { return 0; }
+
+// Critical sections are recursive, just like on Windows
+void InitializeCriticalSection(CRITICAL_SECTION* pCriticalSection);
+void EnterCriticalSection(CRITICAL_SECTION* pCriticalSection);
+BOOL TryEnterCriticalSection(CRITICAL_SECTION* pCriticalSection);
+void LeaveCriticalSection(CRITICAL_SECTION* pCriticalSection);
+void DeleteCriticalSection(CRITICAL_SECTION* pCriticalSection);
+
+// Events and threads. Named events are not supported, WaitForSingleObject only takes INFINITE for threads.
+HANDLE CreateEvent(void* pAttributes, BOOL isManualReset, BOOL isInitiallySignaled, const char* pName);
+BOOL SetEvent(HANDLE event);
+HANDLE CreateThread(void* pAttributes, size_t stackSize, LPTHREAD_START_ROUTINE pStartRoutine, LPVOID pParameter, DWORD flags, DWORD* pThreadId);
+DWORD WaitForSingleObject(HANDLE object, DWORD milliseconds);
+BOOL CloseHandle(HANDLE object);
+
+// Fiber local storage is thread local storage here, the callback runs when a thread with a value other than NULL exits
+DWORD FlsAlloc(PFLS_CALLBACK_FUNCTION pCallback);
+BOOL FlsSetValue(DWORD index, LPVOID pValue);
+
+#endif
+
+#endif
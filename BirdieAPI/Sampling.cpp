@@ -0,0 +1,483 @@
+#include "Sampling.h"
+#include "StringTable.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+typedef enum
+{
+	BIRDIE_SAMPLE_BOOL = 0,
+	BIRDIE_SAMPLE_INT8,
+	BIRDIE_SAMPLE_INT16,
+	BIRDIE_SAMPLE_INT32,
+	BIRDIE_SAMPLE_INT64,
+	BIRDIE_SAMPLE_UINT8,
+	BIRDIE_SAMPLE_UINT16,
+	BIRDIE_SAMPLE_UINT32,
+	BIRDIE_SAMPLE_UINT64,
+	BIRDIE_SAMPLE_FLOAT32,
+	BIRDIE_SAMPLE_FLOAT64,
+	BIRDIE_SAMPLE_KINDS
+} BIRDIE_SAMPLE_KIND;
+
+typedef struct
+{
+	BIRDIE_TYPE type;
+	size_t      size;
+} BIRDIE_SAMPLE_TYPE;
+
+// In the order of BIRDIE_SAMPLE_KIND
+static const BIRDIE_SAMPLE_TYPE g_sampleTypes[BIRDIE_SAMPLE_KINDS] =
+{
+	{ BIRDIE_TYPE_BOOL,    BIRDIE_SIZE_BOOL },
+	{ BIRDIE_TYPE_INT8,    BIRDIE_SIZE_INT8 },
+	{ BIRDIE_TYPE_INT16,   BIRDIE_SIZE_INT16 },
+	{ BIRDIE_TYPE_INT32,   BIRDIE_SIZE_INT32 },
+	{ BIRDIE_TYPE_INT64,   BIRDIE_SIZE_INT64 },
+	{ BIRDIE_TYPE_UINT8,   BIRDIE_SIZE_UINT8 },
+	{ BIRDIE_TYPE_UINT16,  BIRDIE_SIZE_UINT16 },
+	{ BIRDIE_TYPE_UINT32,  BIRDIE_SIZE_UINT32 },
+	{ BIRDIE_TYPE_UINT64,  BIRDIE_SIZE_UINT64 },
+	{ BIRDIE_TYPE_FLOAT32, BIRDIE_SIZE_FLOAT32 },
+	{ BIRDIE_TYPE_FLOAT64, BIRDIE_SIZE_FLOAT64 }
+};
+
+typedef struct
+{
+	BIRDIE_HANDLE        handle;
+	BIRDIE_SAMPLE_KIND   kind;
+	uint32_t             sampleRate;
+
+	// In performance counter ticks
+	LONGLONG             sampleInterval;
+	LONGLONG             windowLength;
+	LONGLONG             nextSample;
+	LONGLONG             windowEnd;
+
+	// Samples taken so far, the ring is written at the sequence
+	uint64_t             sequence;
+	double*              pRing;
+
+	// The mean holds the sum until the window ends
+	BIRDIE_SAMPLE_WINDOW window;
+
+	bool                 isRingRequested;
+} BIRDIE_SAMPLED_WATCH;
+
+static CRITICAL_SECTION      g_csSampling;
+
+static BIRDIE_SAMPLED_WATCH* g_pSampledWatches = NULL;
+static size_t                g_sampledWatchCount = 0;
+static size_t                g_sampledWatchCapacity = 0;
+
+// Reused by the sampler thread, they only ever grow
+static char*                 g_pWindowBuffer = NULL;
+static size_t                g_windowBufferSize = 0;
+static char*                 g_pRingBuffer = NULL;
+static size_t                g_ringBufferSize = 0;
+
+
+// Prototypes
+
+static void Birdie_InitializeSampling();
+static BIRDIE_SAMPLED_WATCH* Birdie_FindSampledWatch(BIRDIE_HANDLE handle);
+static void Birdie_RemoveSampledWatch(size_t index);
+static bool Birdie_GetSampleKind(const BIRDIE_WATCH_ENTRY* pEntry, BIRDIE_SAMPLE_KIND* pKind);
+static double Birdie_ReadSample(const void* pBase, BIRDIE_SAMPLE_KIND kind);
+static void Birdie_ResetSampleWindow(BIRDIE_SAMPLED_WATCH* pWatch);
+static bool Birdie_ReserveSamplingBuffer(char** ppBuffer, size_t* pBufferSize, size_t size);
+
+
+// Function implementations
+
+static void Birdie_InitializeSampling()
+{
+	InitializeCriticalSection(&g_csSampling);
+}
+
+BIRDIE_STATIC_CALL(Birdie_InitializeSampling, ());
+
+void Birdie_FreeSampling()
+{
+	EnterCriticalSection(&g_csSampling);
+
+	for (size_t i = 0; i < g_sampledWatchCount; i++)
+		g_deallocFunction(g_pSampledWatches[i].pRing);
+
+	if (g_pSampledWatches != NULL)
+		g_deallocFunction(g_pSampledWatches);
+
+	if (g_pWindowBuffer != NULL)
+		g_deallocFunction(g_pWindowBuffer);
+
+	if (g_pRingBuffer != NULL)
+		g_deallocFunction(g_pRingBuffer);
+
+	g_pSampledWatches = NULL;
+	g_sampledWatchCount = 0;
+	g_sampledWatchCapacity = 0;
+
+	g_pWindowBuffer = NULL;
+	g_windowBufferSize = 0;
+	g_pRingBuffer = NULL;
+	g_ringBufferSize = 0;
+
+	LeaveCriticalSection(&g_csSampling);
+}
+
+BIRDIE_ERROR Birdie_SetSampling(const BIRDIE_WATCH_ENTRY* pEntry, uint32_t sampleRateHz, uint32_t windowMs)
+{
+	if (sampleRateHz > BIRDIE_MAX_SAMPLE_RATE || (sampleRateHz != 0 && windowMs == 0))
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	EnterCriticalSection(&g_csSampling);
+
+	BIRDIE_SAMPLED_WATCH* pWatch = Birdie_FindSampledWatch(pEntry->handle);
+
+	if (sampleRateHz == 0)
+	{
+		if (pWatch != NULL)
+			Birdie_RemoveSampledWatch((size_t)(pWatch - g_pSampledWatches));
+
+		LeaveCriticalSection(&g_csSampling);
+		return BIRDIE_SUCCESS;
+	}
+
+	BIRDIE_SAMPLE_KIND kind;
+
+	if (!Birdie_GetSampleKind(pEntry, &kind))
+	{
+		LeaveCriticalSection(&g_csSampling);
+		return BIRDIE_ERROR_INVALID_PARAMS;
+	}
+
+	if (pWatch == NULL)
+	{
+		if (g_sampledWatchCount == g_sampledWatchCapacity)
+		{
+			size_t newCapacity = g_sampledWatchCapacity == 0 ? 16 : g_sampledWatchCapacity * 2;
+			BIRDIE_SAMPLED_WATCH* pNewWatches = (BIRDIE_SAMPLED_WATCH*)g_allocFunction(newCapacity * sizeof(BIRDIE_SAMPLED_WATCH));
+
+			if (pNewWatches == NULL)
+			{
+				LeaveCriticalSection(&g_csSampling);
+				return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+			}
+
+			if (g_pSampledWatches != NULL)
+			{
+				memcpy((void*)pNewWatches, (void*)g_pSampledWatches, g_sampledWatchCount * sizeof(BIRDIE_SAMPLED_WATCH));
+				g_deallocFunction(g_pSampledWatches);
+			}
+
+			g_pSampledWatches = pNewWatches;
+			g_sampledWatchCapacity = newCapacity;
+		}
+
+		double* pRing = (double*)g_allocFunction(BIRDIE_SAMPLE_RING_SIZE * sizeof(double));
+
+		if (pRing == NULL)
+		{
+			LeaveCriticalSection(&g_csSampling);
+			return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+		}
+
+		pWatch = &g_pSampledWatches[g_sampledWatchCount++];
+		memset((void*)pWatch, 0, sizeof(BIRDIE_SAMPLED_WATCH));
+
+		pWatch->handle = pEntry->handle;
+		pWatch->pRing = pRing;
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	// A changed rate keeps the ring, the samples in it are still what the watch was
+	pWatch->kind = kind;
+	pWatch->sampleRate = sampleRateHz;
+	pWatch->sampleInterval = frequency.QuadPart / sampleRateHz;
+	pWatch->windowLength = frequency.QuadPart * windowMs / 1000;
+
+	if (pWatch->windowLength < pWatch->sampleInterval)
+		pWatch->windowLength = pWatch->sampleInterval;
+
+	// Both are set by the first sample
+	pWatch->nextSample = 0;
+	pWatch->windowEnd = 0;
+
+	Birdie_ResetSampleWindow(pWatch);
+
+	LeaveCriticalSection(&g_csSampling);
+
+	return BIRDIE_SUCCESS;
+}
+
+char* Birdie_TakeSamples(LONGLONG now, size_t headerSize, size_t* pSize, uint32_t* pWindowCount, LONGLONG* pNextSample)
+{
+	EnterCriticalSection(&g_csSampling);
+
+	// Every watch ends at most one window per call
+	if (!Birdie_ReserveSamplingBuffer(&g_pWindowBuffer, &g_windowBufferSize, headerSize + g_sampledWatchCount * sizeof(BIRDIE_SAMPLE_WINDOW)))
+	{
+		LeaveCriticalSection(&g_csSampling);
+		return NULL;
+	}
+
+	size_t offset = headerSize;
+	uint32_t windowCount = 0;
+	LONGLONG nextSample = 0;
+
+	for (size_t i = 0; i < g_sampledWatchCount;)
+	{
+		BIRDIE_SAMPLED_WATCH* pWatch = &g_pSampledWatches[i];
+		const BIRDIE_WATCH_ENTRY* pEntry = Birdie_FindWatchEntry(pWatch->handle);
+
+		// Removed along with the watch, or with its category. The last watch takes its place.
+		if (pEntry == NULL)
+		{
+			Birdie_RemoveSampledWatch(i);
+			continue;
+		}
+
+		if (pWatch->nextSample == 0)
+		{
+			pWatch->nextSample = now;
+			pWatch->windowEnd = now + pWatch->windowLength;
+		}
+
+		if (now >= pWatch->nextSample)
+		{
+			double sample = Birdie_ReadSample(pEntry->pBase, pWatch->kind);
+			BIRDIE_SAMPLE_WINDOW* pWindow = &pWatch->window;
+
+			pWatch->pRing[pWatch->sequence & (BIRDIE_SAMPLE_RING_SIZE - 1)] = sample;
+			pWatch->sequence++;
+
+			if (pWindow->sampleCount == 0 || sample < pWindow->minimum)
+				pWindow->minimum = sample;
+
+			if (pWindow->sampleCount == 0 || sample > pWindow->maximum)
+				pWindow->maximum = sample;
+
+			pWindow->mean += sample;
+			pWindow->last = sample;
+			pWindow->sampleCount++;
+
+			// Samples that were missed are gone, catching up would only read the same value several times
+			pWatch->nextSample += pWatch->sampleInterval;
+
+			if (pWatch->nextSample <= now)
+				pWatch->nextSample = now + pWatch->sampleInterval;
+		}
+
+		// Windows end on time, a window that got fewer samples than its rate asks for says so with its count
+		if (now >= pWatch->windowEnd)
+		{
+			BIRDIE_SAMPLE_WINDOW* pWindow = &pWatch->window;
+
+			if (pWindow->sampleCount > 0)
+			{
+				pWindow->mean /= pWindow->sampleCount;
+				pWindow->sequence = pWatch->sequence;
+
+				memcpy((void*)(g_pWindowBuffer + offset), (void*)pWindow, sizeof(BIRDIE_SAMPLE_WINDOW));
+				offset += sizeof(BIRDIE_SAMPLE_WINDOW);
+
+				windowCount++;
+			}
+
+			Birdie_ResetSampleWindow(pWatch);
+
+			pWatch->windowEnd += pWatch->windowLength;
+
+			if (pWatch->windowEnd <= now)
+				pWatch->windowEnd = now + pWatch->windowLength;
+		}
+
+		LONGLONG nextEvent = pWatch->nextSample < pWatch->windowEnd ? pWatch->nextSample : pWatch->windowEnd;
+
+		if (nextSample == 0 || nextEvent < nextSample)
+			nextSample = nextEvent;
+
+		i++;
+	}
+
+	LeaveCriticalSection(&g_csSampling);
+
+	*pSize = offset;
+	*pWindowCount = windowCount;
+	*pNextSample = nextSample;
+
+	return g_pWindowBuffer;
+}
+
+bool Birdie_RequestSampleRing(BIRDIE_HANDLE handle)
+{
+	EnterCriticalSection(&g_csSampling);
+
+	BIRDIE_SAMPLED_WATCH* pWatch = Birdie_FindSampledWatch(handle);
+
+	if (pWatch != NULL)
+		pWatch->isRingRequested = true;
+
+	LeaveCriticalSection(&g_csSampling);
+
+	return pWatch != NULL;
+}
+
+char* Birdie_CopyRequestedSampleRing(size_t headerSize, size_t* pSize)
+{
+	EnterCriticalSection(&g_csSampling);
+
+	BIRDIE_SAMPLED_WATCH* pWatch = NULL;
+
+	for (size_t i = 0; i < g_sampledWatchCount && pWatch == NULL; i++)
+	{
+		if (g_pSampledWatches[i].isRingRequested)
+			pWatch = &g_pSampledWatches[i];
+	}
+
+	if (pWatch == NULL)
+	{
+		LeaveCriticalSection(&g_csSampling);
+		return NULL;
+	}
+
+	pWatch->isRingRequested = false;
+
+	uint32_t count = pWatch->sequence < BIRDIE_SAMPLE_RING_SIZE ? (uint32_t)pWatch->sequence : BIRDIE_SAMPLE_RING_SIZE;
+	size_t totalSize = headerSize + sizeof(BIRDIE_HANDLE) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t) + count * sizeof(double);
+
+	if (!Birdie_ReserveSamplingBuffer(&g_pRingBuffer, &g_ringBufferSize, totalSize))
+	{
+		LeaveCriticalSection(&g_csSampling);
+		return NULL;
+	}
+
+	size_t offset = headerSize;
+
+	memcpy((void*)(g_pRingBuffer + offset), (void*)&pWatch->handle, sizeof(BIRDIE_HANDLE));
+	offset += sizeof(BIRDIE_HANDLE);
+
+	memcpy((void*)(g_pRingBuffer + offset), (void*)&pWatch->sampleRate, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	memcpy((void*)(g_pRingBuffer + offset), (void*)&pWatch->sequence, sizeof(uint64_t));
+	offset += sizeof(uint64_t);
+
+	memcpy((void*)(g_pRingBuffer + offset), (void*)&count, sizeof(uint32_t));
+	offset += sizeof(uint32_t);
+
+	// Oldest first, in two parts once the ring has wrapped around
+	uint32_t firstIndex = (uint32_t)((pWatch->sequence - count) & (BIRDIE_SAMPLE_RING_SIZE - 1));
+	uint32_t firstCount = BIRDIE_SAMPLE_RING_SIZE - firstIndex;
+
+	if (firstCount > count)
+		firstCount = count;
+
+	memcpy((void*)(g_pRingBuffer + offset), (void*)(pWatch->pRing + firstIndex), firstCount * sizeof(double));
+	offset += firstCount * sizeof(double);
+
+	memcpy((void*)(g_pRingBuffer + offset), (void*)pWatch->pRing, (count - firstCount) * sizeof(double));
+	offset += (count - firstCount) * sizeof(double);
+
+	LeaveCriticalSection(&g_csSampling);
+
+	*pSize = offset;
+
+	return g_pRingBuffer;
+}
+
+static BIRDIE_SAMPLED_WATCH* Birdie_FindSampledWatch(BIRDIE_HANDLE handle)
+{
+	for (size_t i = 0; i < g_sampledWatchCount; i++)
+	{
+		if (g_pSampledWatches[i].handle == handle)
+			return &g_pSampledWatches[i];
+	}
+
+	return NULL;
+}
+
+static void Birdie_RemoveSampledWatch(size_t index)
+{
+	g_deallocFunction(g_pSampledWatches[index].pRing);
+
+	// Order doesn't matter, the last watch takes the free spot
+	g_sampledWatchCount--;
+
+	if (index != g_sampledWatchCount)
+		memcpy((void*)&g_pSampledWatches[index], (void*)&g_pSampledWatches[g_sampledWatchCount], sizeof(BIRDIE_SAMPLED_WATCH));
+}
+
+static bool Birdie_GetSampleKind(const BIRDIE_WATCH_ENTRY* pEntry, BIRDIE_SAMPLE_KIND* pKind)
+{
+	// Types are only known by their string id. One that was never interned can't be the type of any watch.
+	for (int i = 0; i < BIRDIE_SAMPLE_KINDS; i++)
+	{
+		uint32_t typeId = Birdie_FindString(g_sampleTypes[i].type, strlen(g_sampleTypes[i].type));
+
+		if (typeId == 0 || typeId != pEntry->typeId)
+			continue;
+
+		if (pEntry->dataSizeBytes != g_sampleTypes[i].size)
+			return false;
+
+		*pKind = (BIRDIE_SAMPLE_KIND)i;
+		return true;
+	}
+
+	return false;
+}
+
+static double Birdie_ReadSample(const void* pBase, BIRDIE_SAMPLE_KIND kind)
+{
+	// Copied out, watches don't have to be aligned
+	switch (kind)
+	{
+	case BIRDIE_SAMPLE_BOOL:    { bool value;     memcpy(&value, pBase, sizeof(value)); return value ? 1.0 : 0.0; }
+	case BIRDIE_SAMPLE_INT8:    { int8_t value;   memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_INT16:   { int16_t value;  memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_INT32:   { int32_t value;  memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_INT64:   { int64_t value;  memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_UINT8:   { uint8_t value;  memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_UINT16:  { uint16_t value; memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_UINT32:  { uint32_t value; memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_UINT64:  { uint64_t value; memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_FLOAT32: { float value;    memcpy(&value, pBase, sizeof(value)); return (double)value; }
+	case BIRDIE_SAMPLE_FLOAT64: { double value;   memcpy(&value, pBase, sizeof(value)); return value; }
+	default:                    return 0.0;
+	}
+}
+
+static void Birdie_ResetSampleWindow(BIRDIE_SAMPLED_WATCH* pWatch)
+{
+	memset((void*)&pWatch->window, 0, sizeof(BIRDIE_SAMPLE_WINDOW));
+	pWatch->window.handle = pWatch->handle;
+}
+
+static bool Birdie_ReserveSamplingBuffer(char** ppBuffer, size_t* pBufferSize, size_t size)
+{
+	if (size <= *pBufferSize)
+		return true;
+
+	size_t newSize = *pBufferSize == 0 ? 4096 : *pBufferSize;
+
+	while (newSize < size)
+		newSize *= 2;
+
+	char* pNewBuffer = (char*)g_allocFunction(newSize);
+
+	if (pNewBuffer == NULL)
+		return false;
+
+	if (*ppBuffer != NULL)
+		g_deallocFunction(*ppBuffer);
+
+	*ppBuffer = pNewBuffer;
+	*pBufferSize = newSize;
+
+	return true;
+}
@@ -0,0 +1,58 @@
+#ifndef BIRDIEAPI_SAMPLING_H
+#define BIRDIEAPI_SAMPLING_H
+
+#include "Birdie.h"
+#include "Platform.h"
+#include "WatchRegistry.h"
+
+// This header contains the client-side sampling of watches.
+// A sampled watch is read by the sampler thread at its own rate, far more often than the tool could read it.
+// Every sample goes into a ring of the watch and into the aggregate of its current window. Only the aggregates of
+// finished windows are sent, the ring is sent when the tool asks for it.
+// Samples are taken while the watch registry is locked, so a watch can't be removed while it's being read.
+
+// Samples kept per watch, a power of two. Four seconds at the highest rate.
+#define BIRDIE_SAMPLE_RING_SIZE 4096
+
+// The sampler thread sleeps between samples, it can't keep up with more than this
+#define BIRDIE_MAX_SAMPLE_RATE  1000
+
+// Sent as is, see Birdie_TakeSamples
+typedef struct
+{
+	BIRDIE_HANDLE handle;
+	uint32_t      sampleCount;
+
+	// Samples the watch had when the window ended, matches the sequence of its ring
+	uint64_t      sequence;
+
+	double        minimum;
+	double        maximum;
+	double        mean;
+	double        last;
+} BIRDIE_SAMPLE_WINDOW;
+
+// Stops sampling every watch
+void Birdie_FreeSampling();
+
+// Starts sampling a watch, changes its rate or window, or stops sampling it if the rate is 0.
+// Only watches of the numeric types and bools can be sampled. Expects the registry to be locked.
+BIRDIE_ERROR Birdie_SetSampling(const BIRDIE_WATCH_ENTRY* pEntry, uint32_t sampleRateHz, uint32_t windowMs);
+
+// Samples every watch that is due at 'now' (in performance counter ticks). Expects the registry to be locked.
+// Windows that ended are copied into a buffer owned by the sampling, behind 'headerSize' bytes that are left for the caller.
+// Watches that were removed since the last call stop being sampled. Only the sampler thread may call this.
+// Returns NULL if memory ran out, otherwise the buffer and its total size and window count. pNextSample receives
+// the counter of the next sample that is due, or 0 if nothing is sampled anymore.
+char* Birdie_TakeSamples(LONGLONG now, size_t headerSize, size_t* pSize, uint32_t* pWindowCount, LONGLONG* pNextSample);
+
+// Asks for the ring of a watch to be sent. Returns false if the watch isn't sampled.
+bool Birdie_RequestSampleRing(BIRDIE_HANDLE handle);
+
+// Copies the ring of a watch that was asked for into a buffer owned by the sampling, behind 'headerSize' bytes that are
+// left for the caller. The ring is stored as: handle (4b), sample rate (4b), sequence (8b), count (4b), then the samples
+// (8b each), oldest first. Only the sampler thread may call this.
+// Returns NULL if no ring was asked for or memory ran out, otherwise the buffer and its total size.
+char* Birdie_CopyRequestedSampleRing(size_t headerSize, size_t* pSize);
+
+#endif
@@ -0,0 +1,364 @@
+#include "SendQueue.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+// Prototypes
+
+static BIRDIE_QUEUE_SEGMENT* Birdie_QueueAllocateSegment(size_t capacity);
+static void Birdie_QueueCopyIn(BIRDIE_QUEUE_SEGMENT* pSegment, LONGLONG position, const void* pData, size_t size);
+static void Birdie_QueueZero(BIRDIE_QUEUE_SEGMENT* pSegment, LONGLONG position, size_t size);
+
+static size_t Birdie_QueueRoundCapacity(size_t capacity)
+{
+	size_t roundedCapacity = BIRDIE_QUEUE_MIN_CAPACITY;
+
+	while (roundedCapacity < capacity)
+		roundedCapacity <<= 1;
+
+	return roundedCapacity;
+}
+
+// Function implementations
+
+LONGLONG Birdie_AtomicLoad64(volatile LONGLONG* pValue)
+{
+#ifdef _WIN64
+	return *pValue;
+#else
+	// 64 bit loads are not atomic on x86, a no-op CAS is
+	return InterlockedCompareExchange64(pValue, 0, 0);
+#endif
+}
+
+BIRDIE_ERROR Birdie_QueueCreate(BIRDIE_SEND_QUEUE* pQueue, size_t capacity, BIRDIE_OVERFLOW_POLICY overflowPolicy)
+{
+	if (pQueue == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	BIRDIE_QUEUE_SEGMENT* pSegment = Birdie_QueueAllocateSegment(Birdie_QueueRoundCapacity(capacity));
+
+	if (pSegment == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	pQueue->pFirst = pSegment;
+	pQueue->pHead = pSegment;
+	pQueue->pTail = pSegment;
+	pQueue->overflowPolicy = overflowPolicy;
+	pQueue->isClosed = 0;
+
+	return BIRDIE_SUCCESS;
+}
+
+void Birdie_QueueDestroy(BIRDIE_SEND_QUEUE* pQueue)
+{
+	// Segments are never released while the queue is alive, since producers and flush tickets may still hold on to a sealed one.
+	// The consumer's head moves past drained segments, so walk the chain from the first segment instead.
+	BIRDIE_QUEUE_SEGMENT* pSegment = pQueue->pFirst;
+
+	while (pSegment != NULL)
+	{
+		BIRDIE_QUEUE_SEGMENT* pNext = pSegment->pNext;
+
+		g_deallocFunction(pSegment->pData);
+		g_deallocFunction(pSegment);
+
+		pSegment = pNext;
+	}
+
+	pQueue->pFirst = NULL;
+	pQueue->pHead = NULL;
+	pQueue->pTail = NULL;
+}
+
+void Birdie_QueueClose(BIRDIE_SEND_QUEUE* pQueue)
+{
+	// Releases producers that are blocked on a full queue
+	InterlockedExchange(&pQueue->isClosed, 1);
+}
+
+BIRDIE_ERROR Birdie_QueuePush(BIRDIE_SEND_QUEUE* pQueue, const void* pData, size_t size)
+{
+	BIRDIE_SEND_BUFFER buffer = { pData, size };
+
+	return Birdie_QueuePushV(pQueue, &buffer, 1);
+}
+
+BIRDIE_ERROR Birdie_QueuePushV(BIRDIE_SEND_QUEUE* pQueue, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < bufferCount; i++)
+		size += pBuffers[i].size;
+
+	if (size == 0 || size >= BIRDIE_QUEUE_RECORD_COMMITTED)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	BIRDIE_QUEUE_RESERVATION reservation;
+	BIRDIE_ERROR error = Birdie_QueueReserve(pQueue, Birdie_QueueGetRecordSize(size), pQueue->overflowPolicy, &reservation);
+
+	if (error != BIRDIE_SUCCESS)
+		return error;
+
+	return Birdie_QueueCommit(&reservation, pBuffers, bufferCount);
+}
+
+BIRDIE_ERROR Birdie_QueueReserve(BIRDIE_SEND_QUEUE* pQueue, size_t size, BIRDIE_OVERFLOW_POLICY overflowPolicy, BIRDIE_QUEUE_RESERVATION* pReservation)
+{
+	// 'size' is the sum of the record sizes that are going to be committed, it's reserved as a whole or not at all.
+	// The policy is usually that of the queue, but callers may choose to wait where dropping would do more harm.
+	if (size == 0 || (size & 3) != 0)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	LONGLONG recordSize = (LONGLONG)size;
+
+	BIRDIE_QUEUE_SEGMENT* pSegment = NULL;
+	LONGLONG position = 0;
+
+	for (;;)
+	{
+		if (pQueue->isClosed)
+			return BIRDIE_ERROR_NOT_CONNECTED;
+
+		pSegment = pQueue->pTail;
+		position = Birdie_AtomicLoad64(&pSegment->reserveCursor);
+
+		// Someone is busy replacing the tail, wait for it to show up
+		if (position & BIRDIE_QUEUE_SEGMENT_SEALED)
+		{
+			YieldProcessor();
+			continue;
+		}
+
+		LONGLONG readPosition = Birdie_AtomicLoad64(&pSegment->readCursor);
+
+		if (position + recordSize - readPosition > (LONGLONG)pSegment->capacity)
+		{
+			// Segment is full (or the records will never fit)
+			bool canEverFit = recordSize <= (LONGLONG)pSegment->capacity;
+
+			if (overflowPolicy == BIRDIE_OVERFLOW_DROP)
+				return BIRDIE_ERROR_QUEUE_FULL;
+
+			if (overflowPolicy == BIRDIE_OVERFLOW_BLOCK)
+			{
+				if (!canEverFit)
+					return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+				// Give the sender thread a chance to drain
+				SwitchToThread();
+				continue;
+			}
+
+			// BIRDIE_OVERFLOW_GROW: seal this segment and chain a bigger one behind it
+			if (InterlockedCompareExchange64(&pSegment->reserveCursor, position | BIRDIE_QUEUE_SEGMENT_SEALED, position) != position)
+				continue;
+
+			size_t newCapacity = Birdie_QueueRoundCapacity(pSegment->capacity * 2);
+
+			while (newCapacity < (size_t)recordSize)
+				newCapacity <<= 1;
+
+			BIRDIE_QUEUE_SEGMENT* pNewSegment = Birdie_QueueAllocateSegment(newCapacity);
+
+			if (pNewSegment == NULL)
+			{
+				// Un-seal, other producers can keep trying
+				InterlockedExchange64(&pSegment->reserveCursor, position);
+				return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+			}
+
+			InterlockedExchangePointer((void* volatile*)&pSegment->pNext, pNewSegment);
+			InterlockedExchangePointer((void* volatile*)&pQueue->pTail, pNewSegment);
+			continue;
+		}
+
+		if (InterlockedCompareExchange64(&pSegment->reserveCursor, position + recordSize, position) == position)
+			break;
+	}
+
+	pReservation->pSegment = pSegment;
+	pReservation->position = position;
+	pReservation->endPosition = position + recordSize;
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_QueueCommit(BIRDIE_QUEUE_RESERVATION* pReservation, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < bufferCount; i++)
+		size += pBuffers[i].size;
+
+	LONGLONG recordSize = (LONGLONG)Birdie_QueueGetRecordSize(size);
+
+	if (size == 0 || size >= BIRDIE_QUEUE_RECORD_COMMITTED || pReservation->position + recordSize > pReservation->endPosition)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	BIRDIE_QUEUE_SEGMENT* pSegment = pReservation->pSegment;
+	LONGLONG position = pReservation->position;
+
+	// We own [position, position + recordSize) now, gather the spans into it
+	LONGLONG writePosition = position + sizeof(uint32_t);
+
+	for (size_t i = 0; i < bufferCount; i++)
+	{
+		Birdie_QueueCopyIn(pSegment, writePosition, pBuffers[i].pData, pBuffers[i].size);
+		writePosition += (LONGLONG)pBuffers[i].size;
+	}
+
+	pReservation->position = position + recordSize;
+
+	// Publishing the header makes the record visible to the consumer
+	volatile LONG* pHeader = (volatile LONG*)(pSegment->pData + (position & (pSegment->capacity - 1)));
+	InterlockedExchange(pHeader, (LONG)((uint32_t)size | BIRDIE_QUEUE_RECORD_COMMITTED));
+
+	return BIRDIE_SUCCESS;
+}
+
+size_t Birdie_QueueGetRecordSize(size_t payloadSize)
+{
+	// Records are kept 4 byte aligned so that a header never straddles the end of a segment
+	return sizeof(uint32_t) + ((payloadSize + 3) & ~(size_t)3);
+}
+
+size_t Birdie_QueueGetCapacity(BIRDIE_SEND_QUEUE* pQueue)
+{
+	// The largest reservation that can ever be made without growing
+	return pQueue->pTail->capacity;
+}
+
+LONGLONG Birdie_QueueGetFlushTicket(BIRDIE_SEND_QUEUE* pQueue, BIRDIE_QUEUE_SEGMENT** ppSegment)
+{
+	BIRDIE_QUEUE_SEGMENT* pSegment = pQueue->pTail;
+
+	*ppSegment = pSegment;
+
+	// Everything reserved up until now has been sent once the segment's read cursor passes this point
+	return Birdie_AtomicLoad64(&pSegment->reserveCursor) & ~BIRDIE_QUEUE_SEGMENT_SEALED;
+}
+
+bool Birdie_QueuePeek(BIRDIE_SEND_QUEUE* pQueue, BIRDIE_QUEUE_RECORD* pRecord)
+{
+	for (;;)
+	{
+		BIRDIE_QUEUE_SEGMENT* pSegment = pQueue->pHead;
+
+		LONGLONG reservePosition = Birdie_AtomicLoad64(&pSegment->reserveCursor);
+		LONGLONG readPosition = pSegment->readCursor;
+
+		if (readPosition == (reservePosition & ~BIRDIE_QUEUE_SEGMENT_SEALED))
+		{
+			// Drained, move on to the next segment if this one has been replaced.
+			// Acquire, so that the new segment is seen the way its producer set it up.
+			BIRDIE_QUEUE_SEGMENT* pNext = (BIRDIE_QUEUE_SEGMENT*)ReadPointerAcquire((void* const volatile*)&pSegment->pNext);
+
+			if ((reservePosition & BIRDIE_QUEUE_SEGMENT_SEALED) && pNext != NULL)
+			{
+				pQueue->pHead = pNext;
+				continue;
+			}
+
+			return false;
+		}
+
+		size_t mask = pSegment->capacity - 1;
+		// Pairs with the exchange that publishes the header, the payload is only read after it.
+		// A plain volatile load doesn't order anything on ARM and other weakly ordered CPUs.
+		uint32_t header = (uint32_t)ReadAcquire((const volatile LONG*)(pSegment->pData + (readPosition & mask)));
+
+		// Reserved, but the producer is still writing
+		if ((header & BIRDIE_QUEUE_RECORD_COMMITTED) == 0)
+			return false;
+
+		size_t payloadSize = header & ~BIRDIE_QUEUE_RECORD_COMMITTED;
+		size_t payloadOffset = (size_t)((readPosition + sizeof(uint32_t)) & mask);
+		size_t firstSpanSize = pSegment->capacity - payloadOffset;
+
+		if (firstSpanSize > payloadSize)
+			firstSpanSize = payloadSize;
+
+		pRecord->pSegment = pSegment;
+		pRecord->pSpans[0] = pSegment->pData + payloadOffset;
+		pRecord->spanSizes[0] = firstSpanSize;
+		pRecord->pSpans[1] = pSegment->pData;
+		pRecord->spanSizes[1] = payloadSize - firstSpanSize;
+		pRecord->recordSize = Birdie_QueueGetRecordSize(payloadSize);
+
+		return true;
+	}
+}
+
+void Birdie_QueuePop(BIRDIE_SEND_QUEUE* pQueue, const BIRDIE_QUEUE_RECORD* pRecord)
+{
+	BIRDIE_QUEUE_SEGMENT* pSegment = pRecord->pSegment;
+	LONGLONG readPosition = pSegment->readCursor;
+
+	// Producers expect free space to be zeroed, so that uncommitted headers read as 0
+	Birdie_QueueZero(pSegment, readPosition, pRecord->recordSize);
+
+	InterlockedExchange64(&pSegment->readCursor, readPosition + (LONGLONG)pRecord->recordSize);
+}
+
+size_t Birdie_QueueGetSize(BIRDIE_SEND_QUEUE* pQueue)
+{
+	size_t size = 0;
+
+	// Reserved but uncommitted records count as well, they're about to be. Drained segments add nothing.
+	for (BIRDIE_QUEUE_SEGMENT* pSegment = pQueue->pFirst; pSegment != NULL; pSegment = pSegment->pNext)
+		size += (size_t)((Birdie_AtomicLoad64(&pSegment->reserveCursor) & ~BIRDIE_QUEUE_SEGMENT_SEALED) - pSegment->readCursor);
+
+	return size;
+}
+
+static BIRDIE_QUEUE_SEGMENT* Birdie_QueueAllocateSegment(size_t capacity)
+{
+	BIRDIE_QUEUE_SEGMENT* pSegment = (BIRDIE_QUEUE_SEGMENT*)g_allocFunction(sizeof(BIRDIE_QUEUE_SEGMENT));
+
+	if (pSegment == NULL)
+		return NULL;
+
+	pSegment->pData = (char*)g_allocFunction(capacity);
+
+	if (pSegment->pData == NULL)
+	{
+		g_deallocFunction(pSegment);
+		return NULL;
+	}
+
+	memset(pSegment->pData, 0, capacity);
+
+	pSegment->capacity = capacity;
+	pSegment->reserveCursor = 0;
+	pSegment->readCursor = 0;
+	pSegment->pNext = NULL;
+
+	return pSegment;
+}
+
+static void Birdie_QueueCopyIn(BIRDIE_QUEUE_SEGMENT* pSegment, LONGLONG position, const void* pData, size_t size)
+{
+	size_t offset = (size_t)(position & (pSegment->capacity - 1));
+	size_t firstSize = pSegment->capacity - offset;
+
+	if (firstSize > size)
+		firstSize = size;
+
+	memcpy(pSegment->pData + offset, pData, firstSize);
+	memcpy(pSegment->pData, (const char*)pData + firstSize, size - firstSize);
+}
+
+static void Birdie_QueueZero(BIRDIE_QUEUE_SEGMENT* pSegment, LONGLONG position, size_t size)
+{
+	size_t offset = (size_t)(position & (pSegment->capacity - 1));
+	size_t firstSize = pSegment->capacity - offset;
+
+	if (firstSize > size)
+		firstSize = size;
+
+	memset(pSegment->pData + offset, 0, firstSize);
+	memset(pSegment->pData, 0, size - firstSize);
+}
@@ -0,0 +1,87 @@
+#ifndef BIRDIEAPI_SENDQUEUE_H
+#define BIRDIEAPI_SENDQUEUE_H
+
+#include "Birdie.h"
+#include "Platform.h"
+
+// This header contains the lock-free multi-producer, single-consumer queue used by the asynchronous sender.
+// Producers reserve space with a CAS on the tail segment, copy their bytes and then publish a record header.
+// The single consumer (the sender thread) walks the records in reservation order.
+
+// Record header bit which is set once a producer has finished writing the record
+#define BIRDIE_QUEUE_RECORD_COMMITTED 0x80000000u
+
+// Bit of a segment's reserve cursor which is set once the segment no longer accepts reservations
+#define BIRDIE_QUEUE_SEGMENT_SEALED   0x4000000000000000ll
+
+#define BIRDIE_QUEUE_MIN_CAPACITY     4096
+
+typedef struct BIRDIE_QUEUE_SEGMENT
+{
+	char*                                  pData;
+	size_t                                 capacity;
+	volatile LONGLONG                      reserveCursor;
+	volatile LONGLONG                      readCursor;
+	struct BIRDIE_QUEUE_SEGMENT* volatile  pNext;
+} BIRDIE_QUEUE_SEGMENT;
+
+typedef struct
+{
+	// Oldest segment ever allocated, every other segment is chained behind it
+	BIRDIE_QUEUE_SEGMENT*           pFirst;
+
+	// Consumer side
+	BIRDIE_QUEUE_SEGMENT*           pHead;
+
+	// Producer side
+	BIRDIE_QUEUE_SEGMENT* volatile  pTail;
+
+	BIRDIE_OVERFLOW_POLICY          overflowPolicy;
+	volatile LONG                   isClosed;
+} BIRDIE_SEND_QUEUE;
+
+// A span of bytes to be gathered into a single record
+typedef struct
+{
+	const void* pData;
+	size_t      size;
+} BIRDIE_SEND_BUFFER;
+
+// A committed record, split into at most two spans when it wraps around the end of a segment
+typedef struct
+{
+	BIRDIE_QUEUE_SEGMENT* pSegment;
+	const char*           pSpans[2];
+	size_t                spanSizes[2];
+	size_t                recordSize;
+} BIRDIE_QUEUE_RECORD;
+
+// Room for one or more records taken in a single go, Birdie_QueueCommit fills it in front to back
+typedef struct
+{
+	BIRDIE_QUEUE_SEGMENT* pSegment;
+	LONGLONG              position;
+	LONGLONG              endPosition;
+} BIRDIE_QUEUE_RESERVATION;
+
+BIRDIE_ERROR Birdie_QueueCreate(BIRDIE_SEND_QUEUE* pQueue, size_t capacity, BIRDIE_OVERFLOW_POLICY overflowPolicy);
+void Birdie_QueueDestroy(BIRDIE_SEND_QUEUE* pQueue);
+void Birdie_QueueClose(BIRDIE_SEND_QUEUE* pQueue);
+
+// Producer functions, safe to call from any thread
+BIRDIE_ERROR Birdie_QueuePush(BIRDIE_SEND_QUEUE* pQueue, const void* pData, size_t size);
+BIRDIE_ERROR Birdie_QueuePushV(BIRDIE_SEND_QUEUE* pQueue, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
+BIRDIE_ERROR Birdie_QueueReserve(BIRDIE_SEND_QUEUE* pQueue, size_t size, BIRDIE_OVERFLOW_POLICY overflowPolicy, BIRDIE_QUEUE_RESERVATION* pReservation);
+BIRDIE_ERROR Birdie_QueueCommit(BIRDIE_QUEUE_RESERVATION* pReservation, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
+size_t Birdie_QueueGetRecordSize(size_t payloadSize);
+size_t Birdie_QueueGetCapacity(BIRDIE_SEND_QUEUE* pQueue);
+LONGLONG Birdie_QueueGetFlushTicket(BIRDIE_SEND_QUEUE* pQueue, BIRDIE_QUEUE_SEGMENT** ppSegment);
+
+// Consumer functions, only to be called from the sender thread
+bool Birdie_QueuePeek(BIRDIE_SEND_QUEUE* pQueue, BIRDIE_QUEUE_RECORD* pRecord);
+void Birdie_QueuePop(BIRDIE_SEND_QUEUE* pQueue, const BIRDIE_QUEUE_RECORD* pRecord);
+size_t Birdie_QueueGetSize(BIRDIE_SEND_QUEUE* pQueue);
+
+LONGLONG Birdie_AtomicLoad64(volatile LONGLONG* pValue);
+
+#endif
@@ -0,0 +1,222 @@
+#include "SharedRing.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+// Gives every ring of this process a unique name
+static volatile LONG g_sharedRingCounter = 0;
+
+
+// Prototypes
+
+static void Birdie_WakeSharedRingReader(BIRDIE_SHARED_RING* pRing);
+
+
+// Function implementations
+
+BIRDIE_ERROR Birdie_CreateSharedRing(BIRDIE_SHARED_RING* pRing, size_t capacity)
+{
+	if (pRing == NULL)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	// Power of two, so cursors can be masked
+	size_t roundedCapacity = BIRDIE_SHARED_RING_MIN_CAPACITY;
+
+	while (roundedCapacity < capacity)
+		roundedCapacity <<= 1;
+
+	memset(pRing, 0, sizeof(BIRDIE_SHARED_RING));
+
+	size_t mappingSize = BIRDIE_SHARED_RING_HEADER_SIZE + roundedCapacity;
+
+#ifdef _WIN32
+	snprintf(pRing->name, sizeof(pRing->name), "Local\\Birdie_%lu_%ld", (unsigned long)GetCurrentProcessId(), (long)InterlockedIncrement(&g_sharedRingCounter));
+
+	pRing->mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)mappingSize >> 32), (DWORD)mappingSize, pRing->name);
+
+	if (pRing->mapping == NULL)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	char* pView = (char*)MapViewOfFile(pRing->mapping, FILE_MAP_ALL_ACCESS, 0, 0, mappingSize);
+
+	if (pView == NULL)
+	{
+		Birdie_DestroySharedRing(pRing);
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	char eventName[BIRDIE_SHARED_RING_NAME_SIZE + 8];
+	snprintf(eventName, sizeof(eventName), "%s_Data", pRing->name);
+
+	// Auto-reset, there's only one reader
+	pRing->dataEvent = CreateEvent(NULL, FALSE, FALSE, eventName);
+
+	pRing->pHeader = (BIRDIE_SHARED_RING_HEADER*)pView;
+	pRing->pData = pView + BIRDIE_SHARED_RING_HEADER_SIZE;
+	pRing->capacity = roundedCapacity;
+
+	if (pRing->dataEvent == NULL)
+	{
+		Birdie_DestroySharedRing(pRing);
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+#else
+	snprintf(pRing->name, sizeof(pRing->name), "/Birdie_%lu_%ld", (unsigned long)GetCurrentProcessId(), (long)InterlockedIncrement(&g_sharedRingCounter));
+
+	int descriptor = shm_open(pRing->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+	if (descriptor < 0)
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+
+	// The mapping keeps the memory alive, the descriptor isn't needed past this point
+	void* pView = MAP_FAILED;
+
+	if (ftruncate(descriptor, (off_t)mappingSize) == 0)
+		pView = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+	close(descriptor);
+
+	if (pView == MAP_FAILED)
+	{
+		shm_unlink(pRing->name);
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	pRing->pHeader = (BIRDIE_SHARED_RING_HEADER*)pView;
+	pRing->pData = (char*)pView + BIRDIE_SHARED_RING_HEADER_SIZE;
+	pRing->capacity = roundedCapacity;
+#endif
+
+	// Fresh mappings are zeroed, only the capacity has to be filled in
+	pRing->pHeader->capacity = (uint32_t)roundedCapacity;
+
+	return BIRDIE_SUCCESS;
+}
+
+void Birdie_DestroySharedRing(BIRDIE_SHARED_RING* pRing)
+{
+#ifdef _WIN32
+	if (pRing->pHeader != NULL)
+		UnmapViewOfFile(pRing->pHeader);
+
+	if (pRing->dataEvent != NULL)
+		CloseHandle(pRing->dataEvent);
+
+	if (pRing->mapping != NULL)
+		CloseHandle(pRing->mapping);
+#else
+	// The tool keeps its own mapping, unlinking only removes the name
+	if (pRing->pHeader != NULL)
+	{
+		munmap(pRing->pHeader, BIRDIE_SHARED_RING_HEADER_SIZE + pRing->capacity);
+		shm_unlink(pRing->name);
+	}
+#endif
+
+	memset(pRing, 0, sizeof(BIRDIE_SHARED_RING));
+}
+
+bool Birdie_WriteSharedRing(BIRDIE_SHARED_RING* pRing, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	BIRDIE_SHARED_RING_HEADER* pHeader = pRing->pHeader;
+	size_t mask = pRing->capacity - 1;
+
+	// Only we move the write cursor, so it can be read without any ceremony
+	LONGLONG writePosition = pHeader->writeCursor;
+
+	for (size_t i = 0; i < bufferCount; i++)
+	{
+		const char* pSource = (const char*)pBuffers[i].pData;
+		size_t bytesRemaining = pBuffers[i].size;
+
+		DWORD stallStart = 0;
+
+		while (bytesRemaining > 0)
+		{
+			if (pHeader->isReaderClosed)
+				return false;
+
+			size_t freeSize = pRing->capacity - (size_t)(writePosition - Birdie_AtomicLoad64(&pHeader->readCursor));
+
+			if (freeSize == 0)
+			{
+				// Make what we have so far visible, the tool can't make room otherwise
+				InterlockedExchange64(&pHeader->writeCursor, writePosition);
+				Birdie_WakeSharedRingReader(pRing);
+
+				if (stallStart == 0)
+					stallStart = GetTickCount();
+				else if (GetTickCount() - stallStart > BIRDIE_SHARED_RING_STALL_TIMEOUT_MS)
+					return false;
+
+				SwitchToThread();
+				continue;
+			}
+
+			stallStart = 0;
+
+			size_t offset = (size_t)writePosition & mask;
+			size_t copySize = bytesRemaining;
+
+			if (copySize > freeSize)
+				copySize = freeSize;
+
+			if (copySize > pRing->capacity - offset)
+				copySize = pRing->capacity - offset;
+
+			memcpy((void*)(pRing->pData + offset), (void*)pSource, copySize);
+
+			pSource += copySize;
+			bytesRemaining -= copySize;
+			writePosition += (LONGLONG)copySize;
+		}
+	}
+
+	// Publishing the cursor makes everything up until here visible to the tool
+	InterlockedExchange64(&pHeader->writeCursor, writePosition);
+	Birdie_WakeSharedRingReader(pRing);
+
+	return true;
+}
+
+bool Birdie_DrainSharedRing(BIRDIE_SHARED_RING* pRing, DWORD timeoutMs)
+{
+	BIRDIE_SHARED_RING_HEADER* pHeader = pRing->pHeader;
+	DWORD startTime = GetTickCount();
+
+	while (Birdie_AtomicLoad64(&pHeader->readCursor) != pHeader->writeCursor)
+	{
+		if (pHeader->isReaderClosed || GetTickCount() - startTime > timeoutMs)
+			return false;
+
+		Birdie_WakeSharedRingReader(pRing);
+		Sleep(1);
+	}
+
+	return true;
+}
+
+static void Birdie_WakeSharedRingReader(BIRDIE_SHARED_RING* pRing)
+{
+	// Only pay for the wake-up when the tool is actually waiting
+	if (pRing->pHeader->isReaderSleeping && InterlockedExchange(&pRing->pHeader->isReaderSleeping, 0))
+	{
+#if defined(_WIN32)
+		SetEvent(pRing->dataEvent);
+#elif defined(__linux__)
+		// The reader waits on isReaderSleeping while it's 1, the mapping is shared so this can't be a private futex
+		syscall(SYS_futex, &pRing->pHeader->isReaderSleeping, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef BIRDIEAPI_SHAREDRING_H
+#define BIRDIEAPI_SHAREDRING_H
+
+#include "Birdie.h"
+#include "SendQueue.h"
+#include "Platform.h"
+
+// This header contains the shared-memory transport used when the tool runs on the same machine.
+// The ring carries exactly the same byte stream as the socket would, the tool reads it from its own thread.
+// There is a single writer at any time: the sender thread, or whoever holds the send lock in blocking mode.
+// On Windows the ring is a named file mapping with a named event, elsewhere it's a POSIX shared memory object
+// and the reader is woken with a futex on isReaderSleeping (Linux), or has to poll.
+
+// The header layout is shared with the tool, keep both in sync
+#define BIRDIE_SHARED_RING_HEADER_SIZE        256
+#define BIRDIE_SHARED_RING_MIN_CAPACITY       65536
+
+// Maximum length of the mapping name, including the terminator
+#define BIRDIE_SHARED_RING_NAME_SIZE          64
+
+// How long a writer waits for the tool to make room before giving up on it
+#define BIRDIE_SHARED_RING_STALL_TIMEOUT_MS   5000
+
+typedef struct
+{
+	// Cursors are on their own cache lines, the writer and the reader live in different processes
+	volatile LONGLONG writeCursor;
+	char              padding0[56];
+	volatile LONGLONG readCursor;
+	char              padding1[56];
+
+	// Set by the tool before it waits on the data event, the writer only signals it when this is set
+	volatile LONG     isReaderSleeping;
+
+	// Set by the tool once it stops reading
+	volatile LONG     isReaderClosed;
+
+	uint32_t          capacity;
+} BIRDIE_SHARED_RING_HEADER;
+
+typedef struct
+{
+#ifdef _WIN32
+	HANDLE                     mapping;
+	HANDLE                     dataEvent;
+#endif
+	BIRDIE_SHARED_RING_HEADER* pHeader;
+	char*                      pData;
+	size_t                     capacity;
+	char                       name[BIRDIE_SHARED_RING_NAME_SIZE];
+} BIRDIE_SHARED_RING;
+
+// Creates a uniquely named ring of at least 'capacity' bytes. The data event is named after the ring, with a "_Data" suffix.
+// Outside of Windows the name is that of the shared memory object, there is no event.
+BIRDIE_ERROR Birdie_CreateSharedRing(BIRDIE_SHARED_RING* pRing, size_t capacity);
+void Birdie_DestroySharedRing(BIRDIE_SHARED_RING* pRing);
+
+// Writes all spans to the ring, waiting for room when it's full.
+// Returns false if the tool stopped reading or didn't make room for BIRDIE_SHARED_RING_STALL_TIMEOUT_MS.
+bool Birdie_WriteSharedRing(BIRDIE_SHARED_RING* pRing, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
+
+// Waits until the tool has read everything that was written, returns false on timeout
+bool Birdie_DrainSharedRing(BIRDIE_SHARED_RING* pRing, DWORD timeoutMs);
+
+#endif
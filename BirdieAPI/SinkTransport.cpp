@@ -0,0 +1,63 @@
+#include "Transport.h"
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+typedef struct
+{
+	BIRDIE_TRANSPORT     base;
+	BIRDIE_SINK_FUNCTION sinkFunction;
+	void*                pUserData;
+} BIRDIE_SINK_TRANSPORT;
+
+
+// Function implementations
+
+static bool Birdie_SinkSend(BIRDIE_TRANSPORT* pTransport, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	BIRDIE_SINK_TRANSPORT* pSinkTransport = (BIRDIE_SINK_TRANSPORT*)pTransport;
+
+	for (size_t i = 0; i < bufferCount; i++)
+	{
+		if (pBuffers[i].size > 0)
+			pSinkTransport->sinkFunction(pSinkTransport->pUserData, pBuffers[i].pData, pBuffers[i].size);
+	}
+
+	return true;
+}
+
+static bool Birdie_SinkReceive(BIRDIE_TRANSPORT* pTransport, void* pData, size_t size, uint32_t timeoutMs)
+{
+	// Nobody on the other end to answer
+	return false;
+}
+
+static size_t Birdie_SinkPoll(BIRDIE_TRANSPORT* pTransport, void* pData, size_t size)
+{
+	return 0;
+}
+
+static void Birdie_SinkClose(BIRDIE_TRANSPORT* pTransport)
+{
+	g_deallocFunction(pTransport);
+}
+
+BIRDIE_TRANSPORT* Birdie_CreateSinkTransport(BIRDIE_SINK_FUNCTION sinkFunction, void* pUserData)
+{
+	BIRDIE_SINK_TRANSPORT* pSinkTransport = (BIRDIE_SINK_TRANSPORT*)g_allocFunction(sizeof(BIRDIE_SINK_TRANSPORT));
+
+	if (pSinkTransport == NULL)
+		return NULL;
+
+	pSinkTransport->base.pSend = Birdie_SinkSend;
+	pSinkTransport->base.pReceive = Birdie_SinkReceive;
+	pSinkTransport->base.pPoll = Birdie_SinkPoll;
+	pSinkTransport->base.pClose = Birdie_SinkClose;
+	pSinkTransport->base.isLoopback = false;
+	pSinkTransport->base.isRemote = false;
+
+	pSinkTransport->sinkFunction = sinkFunction;
+	pSinkTransport->pUserData = pUserData;
+
+	return &pSinkTransport->base;
+}
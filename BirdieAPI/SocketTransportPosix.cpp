@@ -0,0 +1,298 @@
+#include "Transport.h"
+#include "Platform.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+// Maximum amount of spans that are handed to a single sendmsg
+#define BIRDIE_MAX_IOVECS 16
+
+// The socket is non-blocking. Whenever the kernel buffer is full (or empty, when receiving),
+// the calling thread waits for the socket with epoll, so the API itself still behaves like blocking sends.
+typedef struct
+{
+	BIRDIE_TRANSPORT base;
+	int              toolSocket;
+	int              epollDescriptor;
+} BIRDIE_SOCKET_TRANSPORT;
+
+
+// Prototypes
+
+static bool Birdie_WaitForSocket(BIRDIE_SOCKET_TRANSPORT* pSocketTransport, bool isWriting, int timeoutMs);
+static bool Birdie_IsLoopbackAddress(const sockaddr* pAddress);
+
+
+// Function implementations
+
+static bool Birdie_SocketSend(BIRDIE_TRANSPORT* pTransport, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)pTransport;
+
+	struct iovec ioVectors[BIRDIE_MAX_IOVECS];
+	size_t bufferIndex = 0;
+
+	while (bufferIndex < bufferCount)
+	{
+		int ioVectorCount = 0;
+
+		for (; bufferIndex < bufferCount && ioVectorCount < BIRDIE_MAX_IOVECS; bufferIndex++)
+		{
+			if (pBuffers[bufferIndex].size == 0)
+				continue;
+
+			ioVectors[ioVectorCount].iov_base = (void*)pBuffers[bufferIndex].pData;
+			ioVectors[ioVectorCount].iov_len = pBuffers[bufferIndex].size;
+			ioVectorCount++;
+		}
+
+		struct iovec* pCurrent = ioVectors;
+
+		while (ioVectorCount > 0)
+		{
+			struct msghdr message;
+
+			memset(&message, 0, sizeof(message));
+			message.msg_iov = pCurrent;
+			message.msg_iovlen = ioVectorCount;
+
+			// A closed tool should show up as an error, not as SIGPIPE
+			ssize_t bytesSent = sendmsg(pSocketTransport->toolSocket, &message, MSG_NOSIGNAL);
+
+			if (bytesSent < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				if ((errno == EAGAIN || errno == EWOULDBLOCK) && Birdie_WaitForSocket(pSocketTransport, true, -1))
+					continue;
+
+				return false;
+			}
+
+			size_t bytesRemaining = (size_t)bytesSent;
+
+			while (ioVectorCount > 0 && bytesRemaining >= pCurrent->iov_len)
+			{
+				bytesRemaining -= pCurrent->iov_len;
+				pCurrent++;
+				ioVectorCount--;
+			}
+
+			if (ioVectorCount > 0)
+			{
+				pCurrent->iov_base = (char*)pCurrent->iov_base + bytesRemaining;
+				pCurrent->iov_len -= bytesRemaining;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool Birdie_SocketReceive(BIRDIE_TRANSPORT* pTransport, void* pData, size_t size, uint32_t timeoutMs)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)pTransport;
+
+	size_t bytesReceived = 0;
+	DWORD startTime = GetTickCount();
+
+	while (bytesReceived < size)
+	{
+		ssize_t result = recv(pSocketTransport->toolSocket, (char*)pData + bytesReceived, size - bytesReceived, 0);
+
+		if (result > 0)
+		{
+			bytesReceived += (size_t)result;
+			continue;
+		}
+
+		if (result == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+			return false;
+
+		DWORD elapsedMs = GetTickCount() - startTime;
+
+		if (elapsedMs >= timeoutMs || !Birdie_WaitForSocket(pSocketTransport, false, (int)(timeoutMs - elapsedMs)))
+			return false;
+	}
+
+	return true;
+}
+
+static size_t Birdie_SocketPoll(BIRDIE_TRANSPORT* pTransport, void* pData, size_t size)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)pTransport;
+
+	// The socket is non-blocking already. A closed connection is noticed by the next send.
+	ssize_t result = recv(pSocketTransport->toolSocket, pData, size, 0);
+
+	return result > 0 ? (size_t)result : 0;
+}
+
+static void Birdie_SocketClose(BIRDIE_TRANSPORT* pTransport)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)pTransport;
+
+	shutdown(pSocketTransport->toolSocket, SHUT_RDWR);
+	close(pSocketTransport->toolSocket);
+
+	if (pSocketTransport->epollDescriptor >= 0)
+		close(pSocketTransport->epollDescriptor);
+
+	g_deallocFunction(pSocketTransport);
+}
+
+BIRDIE_TRANSPORT* Birdie_CreateSocketTransport(const char* pAddress, const char* pPort)
+{
+	addrinfo hints;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo* serverInfo;
+
+	if (getaddrinfo(pAddress, pPort, &hints, &serverInfo) != 0)
+		return NULL;
+
+	int toolSocket = -1;
+	addrinfo* connection = NULL;
+
+	// Loop through network interfaces to find one that can make a valid connection.
+	// Connecting is done while the socket is still blocking, it only happens once.
+	for (connection = serverInfo; connection != NULL; connection = connection->ai_next)
+	{
+		if ((toolSocket = socket(connection->ai_family, connection->ai_socktype, connection->ai_protocol)) < 0)
+			continue;
+
+		if (connect(toolSocket, connection->ai_addr, connection->ai_addrlen) != 0)
+		{
+			close(toolSocket);
+			continue;
+		}
+
+		break;
+	}
+
+	if (connection == NULL)
+	{
+		freeaddrinfo(serverInfo);
+		return NULL;
+	}
+
+	bool isLoopback = Birdie_IsLoopbackAddress(connection->ai_addr);
+
+	freeaddrinfo(serverInfo);
+
+	// Disable Nagle's algorithm, failure should not be fatal
+	int optVal = 1;
+	setsockopt(toolSocket, IPPROTO_TCP, TCP_NODELAY, &optVal, sizeof(optVal));
+
+	fcntl(toolSocket, F_SETFL, fcntl(toolSocket, F_GETFL, 0) | O_NONBLOCK);
+
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)g_allocFunction(sizeof(BIRDIE_SOCKET_TRANSPORT));
+
+	if (pSocketTransport == NULL)
+	{
+		close(toolSocket);
+		return NULL;
+	}
+
+	pSocketTransport->base.pSend = Birdie_SocketSend;
+	pSocketTransport->base.pReceive = Birdie_SocketReceive;
+	pSocketTransport->base.pPoll = Birdie_SocketPoll;
+	pSocketTransport->base.pClose = Birdie_SocketClose;
+	pSocketTransport->base.isLoopback = isLoopback;
+	pSocketTransport->base.isRemote = !isLoopback;
+
+	pSocketTransport->toolSocket = toolSocket;
+	pSocketTransport->epollDescriptor = -1;
+
+#ifdef __linux__
+	pSocketTransport->epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLOUT;
+	event.data.fd = toolSocket;
+
+	if (pSocketTransport->epollDescriptor < 0 || epoll_ctl(pSocketTransport->epollDescriptor, EPOLL_CTL_ADD, toolSocket, &event) != 0)
+	{
+		Birdie_SocketClose(&pSocketTransport->base);
+		return NULL;
+	}
+#endif
+
+	return &pSocketTransport->base;
+}
+
+static bool Birdie_WaitForSocket(BIRDIE_SOCKET_TRANSPORT* pSocketTransport, bool isWriting, int timeoutMs)
+{
+#ifdef __linux__
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = isWriting ? EPOLLOUT : EPOLLIN;
+	event.data.fd = pSocketTransport->toolSocket;
+
+	if (epoll_ctl(pSocketTransport->epollDescriptor, EPOLL_CTL_MOD, pSocketTransport->toolSocket, &event) != 0)
+		return false;
+
+	int result = 0;
+
+	do
+	{
+		result = epoll_wait(pSocketTransport->epollDescriptor, &event, 1, timeoutMs);
+	} while (result < 0 && errno == EINTR);
+
+	// Errors and hang-ups are reported by the send or receive that follows
+	return result > 0;
+#else
+	struct pollfd descriptor;
+
+	descriptor.fd = pSocketTransport->toolSocket;
+	descriptor.events = isWriting ? POLLOUT : POLLIN;
+	descriptor.revents = 0;
+
+	int result = 0;
+
+	do
+	{
+		result = poll(&descriptor, 1, timeoutMs);
+	} while (result < 0 && errno == EINTR);
+
+	return result > 0;
+#endif
+}
+
+static bool Birdie_IsLoopbackAddress(const sockaddr* pAddress)
+{
+	if (pAddress->sa_family == AF_INET)
+		return (ntohl(((const sockaddr_in*)pAddress)->sin_addr.s_addr) >> 24) == 127;
+
+	if (pAddress->sa_family == AF_INET6)
+		return IN6_IS_ADDR_LOOPBACK(&((const sockaddr_in6*)pAddress)->sin6_addr) != 0;
+
+	return false;
+}
+
+#endif
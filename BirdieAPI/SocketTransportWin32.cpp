@@ -0,0 +1,221 @@
+#include "Transport.h"
+#include "Platform.h"
+
+#ifdef _WIN32
+
+#include <WS2tcpip.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+// Maximum amount of spans that are handed to a single WSASend
+#define BIRDIE_MAX_WSA_BUFFERS 16
+
+typedef struct
+{
+	BIRDIE_TRANSPORT base;
+	SOCKET           toolSocket;
+	WSAData          wsaData;
+} BIRDIE_SOCKET_TRANSPORT;
+
+
+// Prototypes
+
+static bool Birdie_IsLoopbackAddress(const sockaddr* pAddress);
+
+
+// Function implementations
+
+static bool Birdie_SocketSend(BIRDIE_TRANSPORT* pTransport, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)pTransport;
+
+	WSABUF wsaBuffers[BIRDIE_MAX_WSA_BUFFERS];
+	size_t bufferIndex = 0;
+
+	while (bufferIndex < bufferCount)
+	{
+		DWORD wsaBufferCount = 0;
+
+		for (; bufferIndex < bufferCount && wsaBufferCount < BIRDIE_MAX_WSA_BUFFERS; bufferIndex++)
+		{
+			if (pBuffers[bufferIndex].size == 0)
+				continue;
+
+			wsaBuffers[wsaBufferCount].buf = (char*)pBuffers[bufferIndex].pData;
+			wsaBuffers[wsaBufferCount].len = (ULONG)pBuffers[bufferIndex].size;
+			wsaBufferCount++;
+		}
+
+		// One vectored send for the whole chunk, nothing gets copied
+		WSABUF* pCurrent = wsaBuffers;
+
+		while (wsaBufferCount > 0)
+		{
+			DWORD bytesSent = 0;
+
+			if (WSASend(pSocketTransport->toolSocket, pCurrent, wsaBufferCount, &bytesSent, 0, NULL, NULL) == SOCKET_ERROR)
+				return false;
+
+			// Skip past whatever made it, blocking sockets usually send everything at once
+			while (wsaBufferCount > 0 && bytesSent >= pCurrent->len)
+			{
+				bytesSent -= pCurrent->len;
+				pCurrent++;
+				wsaBufferCount--;
+			}
+
+			if (wsaBufferCount > 0)
+			{
+				pCurrent->buf += bytesSent;
+				pCurrent->len -= bytesSent;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool Birdie_SocketReceive(BIRDIE_TRANSPORT* pTransport, void* pData, size_t size, uint32_t timeoutMs)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)pTransport;
+
+	DWORD timeout = timeoutMs;
+	setsockopt(pSocketTransport->toolSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, (int) sizeof(timeout));
+
+	size_t bytesReceived = 0;
+
+	while (bytesReceived < size)
+	{
+		int result = recv(pSocketTransport->toolSocket, (char*)pData + bytesReceived, (int)(size - bytesReceived), 0);
+
+		if (result <= 0)
+			break;
+
+		bytesReceived += (size_t)result;
+	}
+
+	timeout = 0;
+	setsockopt(pSocketTransport->toolSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, (int) sizeof(timeout));
+
+	return bytesReceived == size;
+}
+
+static size_t Birdie_SocketPoll(BIRDIE_TRANSPORT* pTransport, void* pData, size_t size)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)pTransport;
+
+	// The socket is blocking, only read what's already there. A closed connection is noticed by the next send.
+	u_long bytesAvailable = 0;
+
+	if (ioctlsocket(pSocketTransport->toolSocket, FIONREAD, &bytesAvailable) != 0 || bytesAvailable == 0)
+		return 0;
+
+	if (bytesAvailable < size)
+		size = bytesAvailable;
+
+	int result = recv(pSocketTransport->toolSocket, (char*)pData, (int)size, 0);
+
+	return result > 0 ? (size_t)result : 0;
+}
+
+static void Birdie_SocketClose(BIRDIE_TRANSPORT* pTransport)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)pTransport;
+
+	// Shut down our socket and WinSock
+	shutdown(pSocketTransport->toolSocket, SD_BOTH);
+	closesocket(pSocketTransport->toolSocket);
+	WSACleanup();
+
+	g_deallocFunction(pSocketTransport);
+}
+
+BIRDIE_TRANSPORT* Birdie_CreateSocketTransport(const char* pAddress, const char* pPort)
+{
+	BIRDIE_SOCKET_TRANSPORT* pSocketTransport = (BIRDIE_SOCKET_TRANSPORT*)g_allocFunction(sizeof(BIRDIE_SOCKET_TRANSPORT));
+
+	if (pSocketTransport == NULL)
+		return NULL;
+
+	// Initialize WinSock
+	int wsaError = WSAStartup(MAKEWORD(2, 0), &pSocketTransport->wsaData);
+
+	if (wsaError != 0)
+	{
+		g_deallocFunction(pSocketTransport);
+		return NULL;
+	}
+
+	addrinfo hints;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo* serverInfo;
+	int getAddrInfoError = getaddrinfo(pAddress, pPort, &hints, &serverInfo);
+
+	if (getAddrInfoError != 0)
+	{
+		WSACleanup();
+		g_deallocFunction(pSocketTransport);
+		return NULL;
+	}
+
+	SOCKET toolSocket = INVALID_SOCKET;
+	addrinfo* connection = NULL;
+
+	// Loop through network interfaces to find one that can make a valid connection
+	for (connection = serverInfo; connection != NULL; connection = connection->ai_next)
+	{
+		if ((toolSocket = socket(connection->ai_family, connection->ai_socktype, connection->ai_protocol)) == INVALID_SOCKET)
+			continue;
+
+		if (connect(toolSocket, connection->ai_addr, (int)connection->ai_addrlen) != 0)
+		{
+			closesocket(toolSocket);
+			continue;
+		}
+
+		break;
+	}
+
+	if (connection == NULL)
+	{
+		freeaddrinfo(serverInfo);
+		WSACleanup();
+		g_deallocFunction(pSocketTransport);
+		return NULL;
+	}
+
+	// Disable Nagle's algorithm, failure should not be fatal
+	int optVal = 1;
+	setsockopt(toolSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&optVal, (int) sizeof(optVal));
+
+	pSocketTransport->base.pSend = Birdie_SocketSend;
+	pSocketTransport->base.pReceive = Birdie_SocketReceive;
+	pSocketTransport->base.pPoll = Birdie_SocketPoll;
+	pSocketTransport->base.pClose = Birdie_SocketClose;
+	pSocketTransport->base.isLoopback = Birdie_IsLoopbackAddress(connection->ai_addr);
+	pSocketTransport->base.isRemote = !pSocketTransport->base.isLoopback;
+
+	pSocketTransport->toolSocket = toolSocket;
+
+	freeaddrinfo(serverInfo);
+
+	return &pSocketTransport->base;
+}
+
+static bool Birdie_IsLoopbackAddress(const sockaddr* pAddress)
+{
+	if (pAddress->sa_family == AF_INET)
+		return (ntohl(((const sockaddr_in*)pAddress)->sin_addr.s_addr) >> 24) == 127;
+
+	if (pAddress->sa_family == AF_INET6)
+		return IN6_IS_ADDR_LOOPBACK(&((const sockaddr_in6*)pAddress)->sin6_addr) != 0;
+
+	return false;
+}
+
+#endif
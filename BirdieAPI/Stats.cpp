@@ -0,0 +1,116 @@
+#include "Stats.h"
+#include "ThreadContext.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef struct
+{
+	const char* pName;
+	size_t      offset;
+} BIRDIE_STATS_FIELD;
+
+// Names as they show up in the tool, in the order of BIRDIE_STATS
+static const BIRDIE_STATS_FIELD g_statsFields[] =
+{
+	{ "Log messages",              offsetof(BIRDIE_STATS, logMessageCount) },
+	{ "Watch operations",          offsetof(BIRDIE_STATS, watchOperationCount) },
+	{ "Remove operations",         offsetof(BIRDIE_STATS, removeOperationCount) },
+	{ "Publishes",                 offsetof(BIRDIE_STATS, publishCount) },
+	{ "Zone flushes",              offsetof(BIRDIE_STATS, zoneFlushCount) },
+	{ "Metadata operations",       offsetof(BIRDIE_STATS, metadataOperationCount) },
+	{ "Encoded bytes",             offsetof(BIRDIE_STATS, encodedBytes) },
+	{ "Sends",                     offsetof(BIRDIE_STATS, sendCount) },
+	{ "Sent bytes",                offsetof(BIRDIE_STATS, sentBytes) },
+	{ "Send blocked time (ns)",    offsetof(BIRDIE_STATS, sendBlockedTime) },
+	{ "Send lock contentions",     offsetof(BIRDIE_STATS, sendLockContentionCount) },
+	{ "Send lock wait time (ns)",  offsetof(BIRDIE_STATS, sendLockWaitTime) },
+	{ "Queue high-water bytes",    offsetof(BIRDIE_STATS, queueHighWaterBytes) },
+	{ "Dropped",                   offsetof(BIRDIE_STATS, droppedCount) },
+	{ "Connections lost",          offsetof(BIRDIE_STATS, connectionLostCount) },
+	{ "Reconnects",                offsetof(BIRDIE_STATS, reconnectCount) },
+	{ "Compressed frames",         offsetof(BIRDIE_STATS, compressedFrameCount) },
+	{ "Uncompressed bytes",        offsetof(BIRDIE_STATS, uncompressedBytes) },
+	{ "Compressed bytes",          offsetof(BIRDIE_STATS, compressedBytes) },
+	{ "Compression time (ns)",     offsetof(BIRDIE_STATS, compressionTime) }
+};
+
+
+// Prototypes
+
+static uint64_t Birdie_TicksToNanoseconds(uint64_t ticks, uint64_t frequency);
+
+
+// Function implementations
+
+void Birdie_CollectStats(BIRDIE_STATS* pStats, const BIRDIE_SEND_STATS* pSendStats, const BIRDIE_COMPRESSION_STATS* pCompressionStats)
+{
+	memset(pStats, 0, sizeof(BIRDIE_STATS));
+
+	uint64_t operationCounts[BIRDIE_STATS_OPERATION_KINDS] = { 0 };
+	uint64_t sendLockWaitTicks = 0;
+
+	// Other threads keep counting while we read, every counter is only ever written by its own thread
+	for (BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContexts(); pContext != NULL; pContext = pContext->pNext)
+	{
+		const BIRDIE_THREAD_STATS* pThreadStats = &pContext->stats;
+
+		for (int i = 0; i < BIRDIE_STATS_OPERATION_KINDS; i++)
+			operationCounts[i] += pThreadStats->operationCounts[i];
+
+		pStats->encodedBytes += pThreadStats->encodedBytes;
+		pStats->sendLockContentionCount += pThreadStats->sendLockContentionCount;
+		pStats->droppedCount += pThreadStats->droppedCount;
+
+		sendLockWaitTicks += pThreadStats->sendLockWaitTicks;
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	pStats->logMessageCount = operationCounts[BIRDIE_STATS_LOG];
+	pStats->watchOperationCount = operationCounts[BIRDIE_STATS_WATCH];
+	pStats->removeOperationCount = operationCounts[BIRDIE_STATS_REMOVE];
+	pStats->publishCount = operationCounts[BIRDIE_STATS_PUBLISH];
+	pStats->zoneFlushCount = operationCounts[BIRDIE_STATS_ZONE];
+	pStats->metadataOperationCount = operationCounts[BIRDIE_STATS_METADATA];
+
+	pStats->sendCount = pSendStats->sendCount;
+	pStats->sentBytes = pSendStats->sentBytes;
+	pStats->sendBlockedTime = Birdie_TicksToNanoseconds(pSendStats->sendTicks, (uint64_t)frequency.QuadPart);
+	pStats->sendLockWaitTime = Birdie_TicksToNanoseconds(sendLockWaitTicks, (uint64_t)frequency.QuadPart);
+	pStats->queueHighWaterBytes = pSendStats->queueHighWaterBytes;
+	pStats->droppedCount += pSendStats->droppedCount;
+	pStats->connectionLostCount = pSendStats->connectionLostCount;
+	pStats->reconnectCount = pSendStats->reconnectCount;
+
+	pStats->compressedFrameCount = pCompressionStats->frameCount;
+	pStats->uncompressedBytes = pCompressionStats->uncompressedBytes;
+	pStats->compressedBytes = pCompressionStats->compressedBytes;
+	pStats->compressionTime = Birdie_TicksToNanoseconds(pCompressionStats->compressionTicks, (uint64_t)frequency.QuadPart);
+}
+
+size_t Birdie_GetStatsWatchDescriptors(BIRDIE_STATS* pStats, BIRDIE_HANDLE parent, BIRDIE_WATCH_DESCRIPTOR* pDescriptors)
+{
+	size_t count = sizeof(g_statsFields) / sizeof(g_statsFields[0]);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		pDescriptors[i].pName = g_statsFields[i].pName;
+		pDescriptors[i].type = BIRDIE_TYPE_UINT64;
+		pDescriptors[i].pBase = (char*)pStats + g_statsFields[i].offset;
+		pDescriptors[i].dataSizeBytes = BIRDIE_SIZE_UINT64;
+		pDescriptors[i].parent = parent;
+	}
+
+	return count;
+}
+
+static uint64_t Birdie_TicksToNanoseconds(uint64_t ticks, uint64_t frequency)
+{
+	if (frequency == 0)
+		return 0;
+
+	// Split up, so that long running sessions don't overflow
+	return ticks / frequency * 1000000000ull + ticks % frequency * 1000000000ull / frequency;
+}
@@ -0,0 +1,58 @@
+#ifndef BIRDIEAPI_STATS_H
+#define BIRDIEAPI_STATS_H
+
+#include "Birdie.h"
+#include "Compression.h"
+#include "Platform.h"
+
+// This header contains the counters behind Birdie_GetStats.
+// Counters of the calling thread live in its thread context and are only summed up on request, so counting never contends.
+// Counters of the send side are only written by whoever is sending: the sender thread, or the holder of the send lock.
+// Times are kept in performance counter ticks and converted when they're collected.
+
+typedef enum
+{
+	BIRDIE_STATS_LOG = 0,
+	BIRDIE_STATS_WATCH,
+	BIRDIE_STATS_REMOVE,
+	BIRDIE_STATS_PUBLISH,
+	BIRDIE_STATS_ZONE,
+	BIRDIE_STATS_METADATA,
+	BIRDIE_STATS_OPERATION_KINDS
+} BIRDIE_STATS_OPERATION_KIND;
+
+typedef struct
+{
+	uint64_t operationCounts[BIRDIE_STATS_OPERATION_KINDS];
+	uint64_t encodedBytes;
+
+	uint64_t sendLockContentionCount;
+	uint64_t sendLockWaitTicks;
+
+	uint64_t droppedCount;
+} BIRDIE_THREAD_STATS;
+
+typedef struct
+{
+	uint64_t sendCount;
+	uint64_t sentBytes;
+	uint64_t sendTicks;
+
+	uint64_t queueHighWaterBytes;
+
+	// Records the sender thread threw away, or that failed to send
+	uint64_t droppedCount;
+
+	uint64_t connectionLostCount;
+	uint64_t reconnectCount;
+} BIRDIE_SEND_STATS;
+
+// Sums up the counters of all thread contexts and the send side
+void Birdie_CollectStats(BIRDIE_STATS* pStats, const BIRDIE_SEND_STATS* pSendStats, const BIRDIE_COMPRESSION_STATS* pCompressionStats);
+
+// Fills in a watch for every counter of pStats, returns the amount of descriptors (at most BIRDIE_STATS_WATCH_COUNT)
+size_t Birdie_GetStatsWatchDescriptors(BIRDIE_STATS* pStats, BIRDIE_HANDLE parent, BIRDIE_WATCH_DESCRIPTOR* pDescriptors);
+
+#define BIRDIE_STATS_WATCH_COUNT (sizeof(BIRDIE_STATS) / sizeof(uint64_t))
+
+#endif
@@ -0,0 +1,294 @@
+#include "StringTable.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+#define BIRDIE_STRING_TABLE_MIN_CAPACITY 64
+
+// Open addressing, kept at most half full. Lookups don't take the lock, so a table only ever changes by filling a free slot.
+// A table that has been outgrown stays around until Birdie_FreeStringTable, someone may still be looking through it.
+typedef struct BIRDIE_STRING_TABLE
+{
+	size_t                             capacity;
+	BIRDIE_INTERNED_STRING* volatile*  ppSlots;
+
+	// Indexed by id - 1, there are never more than half as many strings as slots
+	BIRDIE_INTERNED_STRING* volatile*  ppStringsById;
+
+	struct BIRDIE_STRING_TABLE*        pRetiredTable;
+} BIRDIE_STRING_TABLE;
+
+static CRITICAL_SECTION              g_csStringTable;
+static BIRDIE_STRING_TABLE* volatile g_pStringTable = NULL;
+static volatile LONG                 g_stringCount = 0;
+
+
+// Prototypes
+
+static void Birdie_InitializeStringTable();
+static uint32_t Birdie_HashString(const char* pString, size_t length);
+static bool Birdie_GrowStringTable();
+static BIRDIE_INTERNED_STRING* Birdie_LookUpString(const BIRDIE_STRING_TABLE* pTable, const char* pString, size_t length, uint32_t hash);
+
+static BIRDIE_STRING_TABLE* Birdie_GetStringTable()
+{
+	// Pairs with the exchange that published the table, its slots are filled in by then
+	return (BIRDIE_STRING_TABLE*)ReadPointerAcquire((void* const volatile*)&g_pStringTable);
+}
+
+
+// Function implementations
+
+// Watches can be added before there's a connection and their names are interned right away, so the table is ready as soon as the library is loaded
+static void Birdie_InitializeStringTable()
+{
+	InitializeCriticalSection(&g_csStringTable);
+}
+
+BIRDIE_STATIC_CALL(Birdie_InitializeStringTable, ());
+
+void Birdie_FreeStringTable()
+{
+	EnterCriticalSection(&g_csStringTable);
+
+	BIRDIE_STRING_TABLE* pTable = (BIRDIE_STRING_TABLE*)InterlockedExchangePointer((void* volatile*)&g_pStringTable, NULL);
+
+	// Every string is in the newest table, the retired ones only hold pointers to them
+	if (pTable != NULL)
+	{
+		for (LONG i = 0; i < g_stringCount; i++)
+		{
+			BIRDIE_INTERNED_STRING* pInternedString = pTable->ppStringsById[i];
+
+			g_deallocFunction(pInternedString->pString);
+			g_deallocFunction(pInternedString);
+		}
+	}
+
+	while (pTable != NULL)
+	{
+		BIRDIE_STRING_TABLE* pRetiredTable = pTable->pRetiredTable;
+
+		g_deallocFunction(pTable);
+
+		pTable = pRetiredTable;
+	}
+
+	g_stringCount = 0;
+
+	LeaveCriticalSection(&g_csStringTable);
+}
+
+uint32_t Birdie_InternString(const char* pString, size_t length, BIRDIE_INTERN_FUNCTION pAddFunction)
+{
+	uint32_t hash = Birdie_HashString(pString, length);
+
+	// Strings are complete before they're published, a hit needs no lock
+	BIRDIE_INTERNED_STRING* pExistingString = Birdie_LookUpString(Birdie_GetStringTable(), pString, length, hash);
+
+	if (pExistingString != NULL)
+		return pExistingString->stringId;
+
+	EnterCriticalSection(&g_csStringTable);
+
+	// Someone else may have added it in the meantime
+	pExistingString = Birdie_LookUpString(g_pStringTable, pString, length, hash);
+
+	if (pExistingString != NULL)
+	{
+		uint32_t stringId = pExistingString->stringId;
+
+		LeaveCriticalSection(&g_csStringTable);
+		return stringId;
+	}
+
+	// Ids have to leave room for BIRDIE_STRING_ID_FLAG
+	bool isFull = (uint32_t)g_stringCount + 1 >= BIRDIE_STRING_ID_FLAG;
+	size_t capacity = g_pStringTable != NULL ? g_pStringTable->capacity : 0;
+
+	if (isFull || (((size_t)g_stringCount + 1) * 2 > capacity && !Birdie_GrowStringTable()))
+	{
+		LeaveCriticalSection(&g_csStringTable);
+		return 0;
+	}
+
+	BIRDIE_INTERNED_STRING* pInternedString = (BIRDIE_INTERNED_STRING*)g_allocFunction(sizeof(BIRDIE_INTERNED_STRING));
+	char* pStringCopy = (char*)g_allocFunction(length + 1);
+
+	if (pInternedString == NULL || pStringCopy == NULL)
+	{
+		if (pInternedString != NULL)
+			g_deallocFunction(pInternedString);
+
+		if (pStringCopy != NULL)
+			g_deallocFunction(pStringCopy);
+
+		LeaveCriticalSection(&g_csStringTable);
+		return 0;
+	}
+
+	memcpy(pStringCopy, pString, length);
+	pStringCopy[length] = '\0';
+
+	pInternedString->hash = hash;
+	pInternedString->stringId = (uint32_t)g_stringCount + 1;
+	pInternedString->length = length;
+	pInternedString->pString = pStringCopy;
+	pInternedString->isLogFilter = 0;
+
+	// The tool has to know the string before its id is used, so it's sent before anyone else can find it
+	if (pAddFunction(pInternedString) != BIRDIE_SUCCESS)
+	{
+		g_deallocFunction(pStringCopy);
+		g_deallocFunction(pInternedString);
+
+		LeaveCriticalSection(&g_csStringTable);
+		return 0;
+	}
+
+	BIRDIE_STRING_TABLE* pTable = g_pStringTable;
+	size_t mask = pTable->capacity - 1;
+	size_t index = hash & mask;
+
+	for (; pTable->ppSlots[index] != NULL; index = (index + 1) & mask)
+		continue;
+
+	// Publishing the pointer makes the string visible to lookups that don't lock
+	InterlockedExchangePointer((void* volatile*)&pTable->ppStringsById[pInternedString->stringId - 1], pInternedString);
+	InterlockedExchangePointer((void* volatile*)&pTable->ppSlots[index], pInternedString);
+	InterlockedIncrement(&g_stringCount);
+
+	uint32_t stringId = pInternedString->stringId;
+
+	LeaveCriticalSection(&g_csStringTable);
+
+	return stringId;
+}
+
+uint32_t Birdie_FindString(const char* pString, size_t length)
+{
+	uint32_t hash = Birdie_HashString(pString, length);
+
+	BIRDIE_INTERNED_STRING* pInternedString = Birdie_LookUpString(Birdie_GetStringTable(), pString, length, hash);
+
+	return pInternedString != NULL ? pInternedString->stringId : 0;
+}
+
+void Birdie_AddLogFilter(uint32_t stringId)
+{
+	EnterCriticalSection(&g_csStringTable);
+
+	if (stringId != 0 && stringId <= (uint32_t)g_stringCount)
+		InterlockedExchange(&g_pStringTable->ppStringsById[stringId - 1]->isLogFilter, 1);
+
+	LeaveCriticalSection(&g_csStringTable);
+}
+
+bool Birdie_IsLogFilterValid(uint32_t stringId)
+{
+	BIRDIE_STRING_TABLE* pTable = Birdie_GetStringTable();
+
+	if (pTable == NULL || stringId == 0 || stringId > pTable->capacity / 2)
+		return false;
+
+	BIRDIE_INTERNED_STRING* pInternedString = (BIRDIE_INTERNED_STRING*)ReadPointerAcquire((void* const volatile*)&pTable->ppStringsById[stringId - 1]);
+
+	return pInternedString != NULL && ReadAcquire(&pInternedString->isLogFilter) != 0;
+}
+
+void Birdie_LockStringTable()
+{
+	EnterCriticalSection(&g_csStringTable);
+}
+
+void Birdie_UnlockStringTable()
+{
+	LeaveCriticalSection(&g_csStringTable);
+}
+
+BIRDIE_ERROR Birdie_ReplayStrings(BIRDIE_INTERN_FUNCTION pFunction)
+{
+	// In the order they were added, the tool doesn't care though
+	for (LONG i = 0; i < g_stringCount; i++)
+	{
+		BIRDIE_ERROR error = pFunction(g_pStringTable->ppStringsById[i]);
+
+		if (error != BIRDIE_SUCCESS)
+			return error;
+	}
+
+	return BIRDIE_SUCCESS;
+}
+
+static uint32_t Birdie_HashString(const char* pString, size_t length)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (uint8_t)pString[i]) * 16777619u;
+
+	return hash;
+}
+
+static bool Birdie_GrowStringTable()
+{
+	BIRDIE_STRING_TABLE* pTable = g_pStringTable;
+	size_t newCapacity = pTable == NULL ? BIRDIE_STRING_TABLE_MIN_CAPACITY : pTable->capacity * 2;
+
+	// The table and both of its arrays are a single allocation
+	size_t slotsSize = newCapacity * sizeof(BIRDIE_INTERNED_STRING*);
+	size_t stringsByIdSize = newCapacity / 2 * sizeof(BIRDIE_INTERNED_STRING*);
+	char* pMemory = (char*)g_allocFunction(sizeof(BIRDIE_STRING_TABLE) + slotsSize + stringsByIdSize);
+
+	if (pMemory == NULL)
+		return false;
+
+	memset(pMemory, 0, sizeof(BIRDIE_STRING_TABLE) + slotsSize + stringsByIdSize);
+
+	BIRDIE_STRING_TABLE* pNewTable = (BIRDIE_STRING_TABLE*)pMemory;
+	pNewTable->capacity = newCapacity;
+	pNewTable->ppSlots = (BIRDIE_INTERNED_STRING* volatile*)(pMemory + sizeof(BIRDIE_STRING_TABLE));
+	pNewTable->ppStringsById = (BIRDIE_INTERNED_STRING* volatile*)(pMemory + sizeof(BIRDIE_STRING_TABLE) + slotsSize);
+	pNewTable->pRetiredTable = pTable;
+
+	size_t mask = newCapacity - 1;
+
+	for (LONG i = 0; i < g_stringCount; i++)
+	{
+		BIRDIE_INTERNED_STRING* pInternedString = pTable->ppStringsById[i];
+		size_t index = pInternedString->hash & mask;
+
+		while (pNewTable->ppSlots[index] != NULL)
+			index = (index + 1) & mask;
+
+		pNewTable->ppSlots[index] = pInternedString;
+		pNewTable->ppStringsById[i] = pInternedString;
+	}
+
+	// Lookups that already hold the old table finish on it, it's released along with the rest
+	InterlockedExchangePointer((void* volatile*)&g_pStringTable, pNewTable);
+
+	return true;
+}
+
+static BIRDIE_INTERNED_STRING* Birdie_LookUpString(const BIRDIE_STRING_TABLE* pTable, const char* pString, size_t length, uint32_t hash)
+{
+	if (pTable == NULL)
+		return NULL;
+
+	size_t mask = pTable->capacity - 1;
+
+	for (size_t index = hash & mask; ; index = (index + 1) & mask)
+	{
+		BIRDIE_INTERNED_STRING* pInternedString = (BIRDIE_INTERNED_STRING*)ReadPointerAcquire((void* const volatile*)&pTable->ppSlots[index]);
+
+		if (pInternedString == NULL)
+			return NULL;
+
+		if (pInternedString->hash == hash && pInternedString->length == length && memcmp(pInternedString->pString, pString, length) == 0)
+			return pInternedString;
+	}
+}
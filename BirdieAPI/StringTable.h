@@ -0,0 +1,51 @@
+#ifndef BIRDIEAPI_STRINGTABLE_H
+#define BIRDIEAPI_STRINGTABLE_H
+
+#include "Birdie.h"
+#include "Platform.h"
+
+// This header contains the string intern table.
+// The first use of a string sends it to the tool together with an id, after that only the id is sent.
+// The table lives until Birdie_Terminate, a new connection to the tool is sent every string again by Birdie_ReplayStrings.
+// Strings in the wire format are either a length (4b) followed by the characters, or an id with BIRDIE_STRING_ID_FLAG set.
+
+#define BIRDIE_STRING_ID_FLAG 0x80000000u
+
+typedef struct
+{
+	uint32_t      hash;
+	uint32_t      stringId;
+	size_t        length;
+	char*         pString;
+
+	// Set by Birdie_AddLogFilter, only such strings are accepted as a BIRDIE_LOG_FILTER
+	volatile LONG isLogFilter;
+} BIRDIE_INTERNED_STRING;
+
+// Called for strings that haven't been seen before, while the table is still locked.
+// Whatever this sends reaches the tool before anything that uses the id.
+typedef BIRDIE_ERROR (*BIRDIE_INTERN_FUNCTION)(const BIRDIE_INTERNED_STRING* pInternedString);
+
+void Birdie_FreeStringTable();
+
+// Returns the id of a string, adding it (and calling pAddFunction) if needed. Returns 0 if memory ran out.
+// Strings that are in the table already are found without taking the lock.
+uint32_t Birdie_InternString(const char* pString, size_t length, BIRDIE_INTERN_FUNCTION pAddFunction);
+
+// Returns the id of a string that was interned before, or 0 if it never was. Nothing is added or sent.
+uint32_t Birdie_FindString(const char* pString, size_t length);
+
+// Makes an interned string usable as a BIRDIE_LOG_FILTER
+void Birdie_AddLogFilter(uint32_t stringId);
+
+// Returns true if the id was added with Birdie_AddLogFilter since the last Birdie_FreeStringTable. Never locks.
+bool Birdie_IsLogFilterValid(uint32_t stringId);
+
+// Keeps strings from being added, so a replay can't miss any
+void Birdie_LockStringTable();
+void Birdie_UnlockStringTable();
+
+// Calls pFunction for every string in the table. Expects the table to be locked, stops at the first error and returns it.
+BIRDIE_ERROR Birdie_ReplayStrings(BIRDIE_INTERN_FUNCTION pFunction);
+
+#endif
@@ -0,0 +1,104 @@
+#include "BirdieExt.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+// Registers a custom type, terminates, initializes again and checks that the type has to be registered again and then
+// reaches the tool, both as a handler and as the type of a watch.
+
+#define BIRDIE_TEST_ADD_CUSTOM_TYPE_HANDLER 6
+#define BIRDIE_TEST_ADD_STRING              14
+
+struct TestVector
+{
+	float x;
+	float y;
+};
+
+static std::vector<unsigned char> g_stream;
+
+
+// Prototypes
+
+static void CollectStream(void* pUserData, const void* pData, size_t size);
+static bool StreamContains(uint32_t operationType, const char* pText);
+static bool Check(bool condition, const char* pDescription);
+
+
+// Function implementations
+
+int main()
+{
+	bool isPassing = true;
+	TestVector vector = { 1.0f, 2.0f };
+	BIRDIE_HANDLE handle = 0;
+	const char* pTypeName = typeid(TestVector).name();
+
+	isPassing &= Check(Birdie_InitializeWithSink(CollectStream, NULL) == BIRDIE_SUCCESS, "first initialize");
+	isPassing &= Check(Birdie_RegisterCustomType<TestVector>("handler") == BIRDIE_SUCCESS, "first register");
+	isPassing &= Check(Birdie_RegisterCustomType<TestVector>("handler") == BIRDIE_ERROR_TYPE_PREEXISTING, "second register is refused");
+	isPassing &= Check(strcmp(BirdieTypeGetter<TestVector>::GetType(), pTypeName) == 0, "type is custom after register");
+
+	Birdie_Terminate();
+	g_stream.clear();
+
+	// Terminate drops the handlers, the cached state of this module has to follow
+	isPassing &= Check(strcmp(BirdieTypeGetter<TestVector>::GetType(), BIRDIE_TYPE_HEX_PATTERN) == 0, "type is unknown after terminate");
+
+	isPassing &= Check(Birdie_InitializeWithSink(CollectStream, NULL) == BIRDIE_SUCCESS, "second initialize");
+	isPassing &= Check(Birdie_RegisterCustomType<TestVector>("handler") == BIRDIE_SUCCESS, "register after terminate");
+	isPassing &= Check(Birdie_AddWatch("Vector", &vector, 0, &handle) == BIRDIE_SUCCESS, "add watch");
+	isPassing &= Check(Birdie_Flush() == BIRDIE_SUCCESS, "flush");
+
+	isPassing &= Check(StreamContains(BIRDIE_TEST_ADD_CUSTOM_TYPE_HANDLER, pTypeName), "handler is sent again");
+	isPassing &= Check(StreamContains(BIRDIE_TEST_ADD_STRING, pTypeName), "watch uses the custom type");
+
+	Birdie_Terminate();
+
+	return isPassing ? 0 : 1;
+}
+
+static void CollectStream(void* pUserData, const void* pData, size_t size)
+{
+	g_stream.insert(g_stream.end(), (const unsigned char*)pData, (const unsigned char*)pData + size);
+}
+
+static bool StreamContains(uint32_t operationType, const char* pText)
+{
+	// Layout of every chunk: chunk size, operation type, then the operation itself
+	size_t textLength = strlen(pText);
+	size_t offset = 0;
+
+	while (offset + sizeof(uint32_t) * 2 <= g_stream.size())
+	{
+		uint32_t chunkSize = 0;
+		uint32_t chunkOperationType = 0;
+
+		memcpy(&chunkSize, &g_stream[offset], sizeof(uint32_t));
+		memcpy(&chunkOperationType, &g_stream[offset + sizeof(uint32_t)], sizeof(uint32_t));
+
+		const unsigned char* pChunk = &g_stream[offset + sizeof(uint32_t)];
+
+		if (chunkOperationType == operationType)
+		{
+			for (size_t i = 0; i + textLength <= chunkSize; i++)
+			{
+				if (memcmp(pChunk + i, pText, textLength) == 0)
+					return true;
+			}
+		}
+
+		offset += sizeof(uint32_t) + chunkSize;
+	}
+
+	return false;
+}
+
+static bool Check(bool condition, const char* pDescription)
+{
+	printf("%s: %s\n", condition ? "PASS" : "FAIL", pDescription);
+
+	return condition;
+}
@@ -0,0 +1,205 @@
+#include "ThreadContext.h"
+#include "Common.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+// Every context that was handed out during the current session
+static BIRDIE_THREAD_CONTEXT* volatile g_pThreadContexts = NULL;
+static volatile LONG                   g_threadContextSession = 0;
+
+// Thread-local, the session tells us whether the pointer is still valid without having to touch it
+static BIRDIE_THREAD_LOCAL BIRDIE_THREAD_CONTEXT* g_pThreadContext = NULL;
+static BIRDIE_THREAD_LOCAL LONG                   g_threadContextOwnerSession = -1;
+
+// Tells us when a thread exits, its value is the thread's context
+static DWORD                           g_threadExitIndex = FLS_OUT_OF_INDEXES;
+
+
+// Prototypes
+
+static void Birdie_InitializeThreadContexts();
+static BIRDIE_THREAD_CONTEXT* Birdie_ReuseThreadContext();
+static void WINAPI Birdie_OnThreadExit(LPVOID pValue);
+
+
+// Function implementations
+
+// Lives as long as the process, threads of any session may still exit after termination
+static void Birdie_InitializeThreadContexts()
+{
+	g_threadExitIndex = FlsAlloc(Birdie_OnThreadExit);
+}
+
+BIRDIE_STATIC_CALL(Birdie_InitializeThreadContexts, ());
+
+static void Birdie_BeginThreadContextSession()
+{
+	// Contexts from the previous session are no longer used after this
+	InterlockedIncrement(&g_threadContextSession);
+}
+
+BIRDIE_THREAD_CONTEXT* Birdie_GetThreadContext()
+{
+	if (g_threadContextOwnerSession == g_threadContextSession)
+		return g_pThreadContext;
+
+	BIRDIE_THREAD_CONTEXT* pContext = Birdie_ReuseThreadContext();
+
+	if (pContext != NULL)
+	{
+		pContext->threadId = GetCurrentThreadId();
+
+		g_pThreadContext = pContext;
+		g_threadContextOwnerSession = g_threadContextSession;
+
+		if (g_threadExitIndex != FLS_OUT_OF_INDEXES)
+			FlsSetValue(g_threadExitIndex, pContext);
+
+		return pContext;
+	}
+
+	pContext = (BIRDIE_THREAD_CONTEXT*)g_allocFunction(sizeof(BIRDIE_THREAD_CONTEXT));
+
+	if (pContext == NULL)
+		return NULL;
+
+	pContext->pTopScratchBuffer = (char*)g_allocFunction(BIRDIE_INITIAL_SCRATCH_BUFFER_SIZE + sizeof(uint32_t));
+
+	if (pContext->pTopScratchBuffer == NULL)
+	{
+		g_deallocFunction(pContext);
+		return NULL;
+	}
+
+	pContext->pScratchBuffer = pContext->pTopScratchBuffer + sizeof(uint32_t);
+	pContext->scratchBufferSize = BIRDIE_INITIAL_SCRATCH_BUFFER_SIZE;
+
+	pContext->pTopBatchBuffer = NULL;
+	pContext->batchSize = 0;
+	pContext->batchCount = 0;
+	pContext->batchDepth = 0;
+	pContext->batchLock = 0;
+
+	pContext->pZoneEvents = NULL;
+	pContext->zoneWriteIndex = 0;
+	pContext->zoneReadIndex = 0;
+	pContext->zoneFlushLock = 0;
+	pContext->threadId = GetCurrentThreadId();
+
+	memset(&pContext->stats, 0, sizeof(BIRDIE_THREAD_STATS));
+
+	pContext->isInUse = 1;
+
+	// Lock-free push onto the list of contexts
+	BIRDIE_THREAD_CONTEXT* pHead;
+
+	do
+	{
+		pHead = g_pThreadContexts;
+		pContext->pNext = pHead;
+	} while (InterlockedCompareExchangePointer((void* volatile*)&g_pThreadContexts, pContext, pHead) != pHead);
+
+	g_pThreadContext = pContext;
+	g_threadContextOwnerSession = g_threadContextSession;
+
+	// Without a way to learn about the thread's exit the context just stays around until termination
+	if (g_threadExitIndex != FLS_OUT_OF_INDEXES)
+		FlsSetValue(g_threadExitIndex, pContext);
+
+	return pContext;
+}
+
+static BIRDIE_THREAD_CONTEXT* Birdie_ReuseThreadContext()
+{
+	// Contexts never leave the list during a session, whoever wins the exchange owns the context
+	for (BIRDIE_THREAD_CONTEXT* pContext = g_pThreadContexts; pContext != NULL; pContext = pContext->pNext)
+	{
+		if (pContext->isInUse == 0 && InterlockedCompareExchange(&pContext->isInUse, 1, 0) == 0)
+			return pContext;
+	}
+
+	return NULL;
+}
+
+static void WINAPI Birdie_OnThreadExit(LPVOID pValue)
+{
+	BIRDIE_THREAD_CONTEXT* pContext = (BIRDIE_THREAD_CONTEXT*)pValue;
+
+	// Contexts of an earlier session have been released on termination already
+	if (g_threadContextOwnerSession != g_threadContextSession || pContext != g_pThreadContext)
+		return;
+
+	Birdie_FlushThreadContext(pContext);
+
+	g_pThreadContext = NULL;
+	g_threadContextOwnerSession = -1;
+
+	InterlockedExchange(&pContext->isInUse, 0);
+}
+
+char* Birdie_GetScratchBuffer(size_t size)
+{
+	BIRDIE_THREAD_CONTEXT* pContext = Birdie_GetThreadContext();
+
+	if (pContext == NULL)
+		return NULL;
+
+	if (size <= pContext->scratchBufferSize)
+		return pContext->pScratchBuffer;
+
+	if (size > BIRDIE_SCRATCH_BUFFER_SIZE)
+		return NULL;
+
+	size_t newSize = pContext->scratchBufferSize;
+
+	while (newSize < size)
+		newSize <<= 1;
+
+	char* pNewTopBuffer = (char*)g_allocFunction(newSize + sizeof(uint32_t));
+
+	if (pNewTopBuffer == NULL)
+		return NULL;
+
+	// Keep what was encoded so far, so callers can grow the buffer while encoding
+	memcpy(pNewTopBuffer, pContext->pTopScratchBuffer, pContext->scratchBufferSize + sizeof(uint32_t));
+
+	g_deallocFunction(pContext->pTopScratchBuffer);
+
+	pContext->pTopScratchBuffer = pNewTopBuffer;
+	pContext->pScratchBuffer = pNewTopBuffer + sizeof(uint32_t);
+	pContext->scratchBufferSize = newSize;
+
+	return pContext->pScratchBuffer;
+}
+
+BIRDIE_THREAD_CONTEXT* Birdie_GetThreadContexts()
+{
+	return g_pThreadContexts;
+}
+
+void Birdie_FreeThreadContexts()
+{
+	BIRDIE_THREAD_CONTEXT* pContext = (BIRDIE_THREAD_CONTEXT*)InterlockedExchangePointer((void* volatile*)&g_pThreadContexts, NULL);
+
+	// Invalidate the thread-local pointers before releasing what they point to
+	Birdie_BeginThreadContextSession();
+
+	while (pContext != NULL)
+	{
+		BIRDIE_THREAD_CONTEXT* pNext = pContext->pNext;
+
+		if (pContext->pTopBatchBuffer != NULL)
+			g_deallocFunction(pContext->pTopBatchBuffer);
+
+		if (pContext->pZoneEvents != NULL)
+			g_deallocFunction(pContext->pZoneEvents);
+
+		g_deallocFunction(pContext->pTopScratchBuffer);
+		g_deallocFunction(pContext);
+
+		pContext = pNext;
+	}
+}
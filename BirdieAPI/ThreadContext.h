@@ -0,0 +1,79 @@
+#ifndef BIRDIEAPI_THREADCONTEXT_H
+#define BIRDIEAPI_THREADCONTEXT_H
+
+#include "Birdie.h"
+#include "Platform.h"
+#include "Stats.h"
+#include "Zones.h"
+
+// This header contains the per-thread state of the Birdie API.
+// Every thread that calls into the API encodes into its own scratch buffer, so encoding never has to take a lock.
+
+// 256k
+#define BIRDIE_SCRATCH_BUFFER_SIZE		   262144
+
+// Scratch buffers start small and grow on demand, up to BIRDIE_SCRATCH_BUFFER_SIZE. That's as large as they get, since a
+// thread keeps its buffer until termination. Anything larger gets a buffer of its own for the duration of the call.
+#define BIRDIE_INITIAL_SCRATCH_BUFFER_SIZE 4096
+
+// 64k, a full batch is flushed as one chunk
+#define BIRDIE_BATCH_BUFFER_SIZE		   65536
+
+typedef struct BIRDIE_THREAD_CONTEXT
+{
+	// The top buffer has room for the chunk size in front of the scratch buffer
+	char*                         pTopScratchBuffer;
+	char*                         pScratchBuffer;
+	size_t                        scratchBufferSize;
+
+	// Operations collected while batching, allocated on first use.
+	// The top buffer has room for the chunk size, operation type and count of the batch chunk.
+	char*                         pTopBatchBuffer;
+	size_t                        batchSize;
+	uint32_t                      batchCount;
+	int                           batchDepth;
+
+	// Only contended when another thread flushes this thread's automatic batch
+	volatile LONG                 batchLock;
+
+	// Zone events, allocated on first use. The indices only ever grow and are masked to find the event.
+	// Only this thread writes events, the flush lock makes sure only one thread at a time reads them.
+	BIRDIE_ZONE_EVENT*            pZoneEvents;
+	volatile LONG                 zoneWriteIndex;
+	volatile LONG                 zoneReadIndex;
+	volatile LONG                 zoneFlushLock;
+
+	// Tells the zones of different threads apart in the tool
+	DWORD                         threadId;
+
+	// Only written by its own thread, read by Birdie_GetStats. Carries over to the next owner, so nothing is lost from the totals.
+	BIRDIE_THREAD_STATS           stats;
+
+	// Cleared once the owning thread has exited, the next new thread takes the context over instead of making another one
+	volatile LONG                 isInUse;
+
+	// All contexts are chained together so they can be released on termination
+	struct BIRDIE_THREAD_CONTEXT* pNext;
+} BIRDIE_THREAD_CONTEXT;
+
+// Returns the calling thread's context, creating it on first use. Returns NULL if memory ran out.
+BIRDIE_THREAD_CONTEXT* Birdie_GetThreadContext();
+
+// Returns a scratch buffer of at least 'size' bytes for the calling thread.
+// Returns NULL if memory ran out or 'size' is larger than BIRDIE_SCRATCH_BUFFER_SIZE.
+// The contents are preserved when the buffer has to grow, but the returned pointer may change.
+char* Birdie_GetScratchBuffer(size_t size);
+
+// Returns the first of all thread contexts of the current session, use pNext to walk the rest.
+// Contexts are never released while a session is active, so the list is safe to walk from any thread.
+// The contexts of exited threads are in there as well, waiting to be reused. They hold nothing to flush.
+BIRDIE_THREAD_CONTEXT* Birdie_GetThreadContexts();
+
+// Sends whatever the context still holds, called on its thread right before the thread exits.
+// Implemented next to the send path, the context is handed to the next new thread afterwards.
+void Birdie_FlushThreadContext(BIRDIE_THREAD_CONTEXT* pContext);
+
+// Releases all thread contexts. No other thread may be using the API at this point.
+void Birdie_FreeThreadContexts();
+
+#endif
@@ -0,0 +1,534 @@
+#include "Birdie.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+
+typedef SOCKET BIRDIE_BENCH_SOCKET;
+#define BIRDIE_BENCH_INVALID_SOCKET INVALID_SOCKET
+#define BIRDIE_BENCH_CLOSE_SOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef int BIRDIE_BENCH_SOCKET;
+#define BIRDIE_BENCH_INVALID_SOCKET (-1)
+#define BIRDIE_BENCH_CLOSE_SOCKET close
+#endif
+
+// Microbenchmarks for the hot paths of the API. Every scenario connects to a stand-in for the tool in this process,
+// which speaks the same protocol as the tool: a challenge key, then chunks prefixed with their size.
+// The stand-in can be slowed down, to see how the API behaves when the tool can't keep up.
+
+typedef std::chrono::steady_clock BenchClock;
+
+typedef enum
+{
+	BENCH_LOG,
+	BENCH_LOGF,
+	BENCH_WATCHES,
+	BENCH_ZONES,
+	BENCH_THREAD_CHURN,
+	BENCH_CONTENTION
+} BENCH_OPERATION;
+
+typedef struct
+{
+	uint32_t threadCount;
+	uint32_t iterations;
+	size_t   asyncQueueSize;
+	uint32_t slowBytesPerSecond;
+} BENCH_OPTIONS;
+
+typedef struct
+{
+	// Latencies in nanoseconds, one per call. Watch scenarios fill both, the second one with removals.
+	// Failures are counted the same way, so every kind of call only reports its own.
+	std::vector<uint32_t> latencies;
+	std::vector<uint32_t> secondLatencies;
+	uint32_t              failureCount;
+	uint32_t              secondFailureCount;
+} BENCH_THREAD_RESULT;
+
+// Stand-in for the tool
+static BIRDIE_BENCH_SOCKET   g_listenSocket = BIRDIE_BENCH_INVALID_SOCKET;
+static char                  g_listenPort[16];
+static std::atomic<uint32_t> g_sinkBytesPerSecond(0);
+static std::atomic<uint64_t> g_sinkBytes(0);
+static std::atomic<uint64_t> g_sinkChunks(0);
+
+// Registered anew for every scenario, zones are only valid until termination
+static BIRDIE_ZONE           g_benchZone = 0;
+
+// Thread churn runs waves of short-lived threads, each making this many calls before it exits
+#define BENCH_CHURN_CALLS_PER_THREAD 100
+
+
+// Prototypes
+
+static bool StartSink();
+static void SinkThread();
+static void ReceiveSession(BIRDIE_BENCH_SOCKET clientSocket);
+static void RunScenario(const BENCH_OPTIONS* pOptions, BENCH_OPERATION operation, uint32_t threadCount, size_t messageSize, const char* pLabel);
+static void RunThread(BENCH_OPERATION operation, uint32_t iterations, size_t messageSize, std::atomic<bool>* pStart, BENCH_THREAD_RESULT* pResult);
+static void RunThreadChurn(uint32_t threadCount, uint32_t iterations, size_t messageSize, std::vector<BENCH_THREAD_RESULT>& results);
+static void PrintResult(const char* pName, const char* pLabel, uint32_t threadCount, size_t messageSize, std::vector<BENCH_THREAD_RESULT>& results, bool isSecond);
+static void PrintContention(uint32_t threadCount, size_t messageSize, std::vector<BENCH_THREAD_RESULT>& results, const BIRDIE_STATS* pStats);
+static void PrintUsage();
+
+static inline uint32_t ElapsedNanoseconds(BenchClock::time_point start, BenchClock::time_point end)
+{
+	long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	return nanoseconds > 0xFFFFFFFFll ? 0xFFFFFFFFu : (uint32_t)nanoseconds;
+}
+
+
+// Function implementations
+
+int main(int argc, char** argv)
+{
+	BENCH_OPTIONS options;
+	options.threadCount = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+	options.iterations = 100000;
+	options.asyncQueueSize = 0;
+	options.slowBytesPerSecond = 4 * 1024 * 1024;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			options.threadCount = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			options.iterations = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--async") == 0 && i + 1 < argc)
+			options.asyncQueueSize = (size_t)atol(argv[++i]);
+		else if (strcmp(argv[i], "--slow") == 0 && i + 1 < argc)
+			options.slowBytesPerSecond = (uint32_t)atol(argv[++i]);
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (options.threadCount == 0 || options.iterations == 0)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+	if (!StartSink())
+	{
+		fprintf(stderr, "Could not start the stand-in tool\n");
+		return 1;
+	}
+
+	std::thread(SinkThread).detach();
+
+	if (options.asyncQueueSize > 0)
+		Birdie_SetAsyncMode(options.asyncQueueSize, BIRDIE_OVERFLOW_BLOCK);
+
+	printf("%-12s %-8s %7s %6s %12s %9s %9s %9s %8s\n", "operation", "sink", "threads", "size", "calls/s", "p50 ns", "p99 ns", "p999 ns", "failed");
+
+	// Thread sweeps double up to the requested count, and always include it
+	std::vector<uint32_t> threadCounts;
+
+	for (uint32_t threadCount = 1; threadCount < options.threadCount; threadCount *= 2)
+		threadCounts.push_back(threadCount);
+
+	threadCounts.push_back(options.threadCount);
+
+	for (size_t i = 0; i < threadCounts.size(); i++)
+	{
+		RunScenario(&options, BENCH_LOG, threadCounts[i], 64, "fast");
+		RunScenario(&options, BENCH_LOGF, threadCounts[i], 0, "fast");
+		RunScenario(&options, BENCH_WATCHES, threadCounts[i], 0, "fast");
+		RunScenario(&options, BENCH_ZONES, threadCounts[i], 0, "fast");
+	}
+
+	// Threads that come and go, every end of frame has to look at what each of them left behind
+	RunScenario(&options, BENCH_THREAD_CHURN, options.threadCount, 64, "fast");
+
+	// Message sizes, on a single thread so that only the encoding and the send path show
+	const size_t messageSizes[] = { 16, 256, 1024, 4096, 16384 };
+
+	for (size_t i = 0; i < sizeof(messageSizes) / sizeof(messageSizes[0]); i++)
+		RunScenario(&options, BENCH_LOG, 1, messageSizes[i], "fast");
+
+	// A tool that can't keep up: blocking sends stall, a full asynchronous queue blocks as well
+	g_sinkBytesPerSecond = options.slowBytesPerSecond;
+
+	RunScenario(&options, BENCH_LOG, 1, 256, "slow");
+	RunScenario(&options, BENCH_LOG, options.threadCount, 256, "slow");
+
+	g_sinkBytesPerSecond = 0;
+
+	// Threads logging all at once. Encoding is done in per-thread scratch buffers, only the hand-off to the transport is
+	// shared, so the send lock is where they can still run into each other. Asynchronous sends don't take it at all.
+	printf("\n%-12s %7s %6s %12s %9s %9s %12s %12s\n", "operation", "threads", "size", "calls/s", "p50 ns", "p99 ns", "lock waits", "wait ns/call");
+
+	for (size_t i = 0; i < threadCounts.size(); i++)
+		RunScenario(&options, BENCH_CONTENTION, threadCounts[i], 64, "fast");
+
+	printf("\nThe stand-in tool received %llu chunks, %llu bytes\n", (unsigned long long)g_sinkChunks.load(), (unsigned long long)g_sinkBytes.load());
+
+	return 0;
+}
+
+static bool StartSink()
+{
+	g_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	if (g_listenSocket == BIRDIE_BENCH_INVALID_SOCKET)
+		return false;
+
+	// Any free port on the loopback interface
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+
+	socklen_t addressLength = sizeof(address);
+
+	if (bind(g_listenSocket, (sockaddr*)&address, sizeof(address)) != 0 ||
+		listen(g_listenSocket, 1) != 0 ||
+		getsockname(g_listenSocket, (sockaddr*)&address, &addressLength) != 0)
+	{
+		BIRDIE_BENCH_CLOSE_SOCKET(g_listenSocket);
+		return false;
+	}
+
+	snprintf(g_listenPort, sizeof(g_listenPort), "%u", (unsigned)ntohs(address.sin_port));
+
+	return true;
+}
+
+static void SinkThread()
+{
+	// One session at a time, every scenario makes a new connection
+	for (;;)
+	{
+		BIRDIE_BENCH_SOCKET clientSocket = accept(g_listenSocket, NULL, NULL);
+
+		if (clientSocket == BIRDIE_BENCH_INVALID_SOCKET)
+			return;
+
+		ReceiveSession(clientSocket);
+		BIRDIE_BENCH_CLOSE_SOCKET(clientSocket);
+	}
+}
+
+static void ReceiveSession(BIRDIE_BENCH_SOCKET clientSocket)
+{
+	// The challenge key comes first, then chunk sizes and chunk bodies take turns.
+	// The stream can be split anywhere, so the size is assembled byte by byte.
+	uint64_t skipRemaining = sizeof(uint64_t);
+	unsigned char chunkSize[sizeof(uint32_t)];
+	uint32_t chunkSizeBytes = 0;
+
+	char buffer[4096];
+
+	BenchClock::time_point startTime = BenchClock::now();
+	uint64_t sessionBytes = 0;
+
+	for (;;)
+	{
+		int receivedSize = (int)recv(clientSocket, buffer, sizeof(buffer), 0);
+
+		if (receivedSize <= 0)
+			return;
+
+		g_sinkBytes += (uint64_t)receivedSize;
+		sessionBytes += (uint64_t)receivedSize;
+
+		for (int offset = 0; offset < receivedSize; )
+		{
+			if (skipRemaining > 0)
+			{
+				uint64_t skipSize = std::min<uint64_t>(skipRemaining, (uint64_t)(receivedSize - offset));
+
+				skipRemaining -= skipSize;
+				offset += (int)skipSize;
+				continue;
+			}
+
+			chunkSize[chunkSizeBytes++] = (unsigned char)buffer[offset++];
+
+			if (chunkSizeBytes == sizeof(chunkSize))
+			{
+				uint32_t size;
+				memcpy(&size, chunkSize, sizeof(size));
+
+				skipRemaining = size;
+				chunkSizeBytes = 0;
+				g_sinkChunks++;
+			}
+		}
+
+		// Slowed down by simply not reading, the socket buffers fill up and the client has to wait
+		uint32_t bytesPerSecond = g_sinkBytesPerSecond;
+
+		if (bytesPerSecond > 0)
+		{
+			BenchClock::time_point dueTime = startTime + std::chrono::microseconds(sessionBytes * 1000000 / bytesPerSecond);
+			std::this_thread::sleep_until(dueTime);
+		}
+	}
+}
+
+static void RunScenario(const BENCH_OPTIONS* pOptions, BENCH_OPERATION operation, uint32_t threadCount, size_t messageSize, const char* pLabel)
+{
+	if (Birdie_Initialize(0, "127.0.0.1", g_listenPort) != BIRDIE_SUCCESS)
+	{
+		fprintf(stderr, "Could not connect to the stand-in tool\n");
+		return;
+	}
+
+	Birdie_RegisterZone("bench", &g_benchZone);
+
+	// Watches are added and removed once per iteration, a lot fewer of them fit into a sensible run
+	uint32_t iterations = operation == BENCH_WATCHES ? std::max(1u, pOptions->iterations / 10) : pOptions->iterations;
+
+	std::vector<BENCH_THREAD_RESULT> results(threadCount);
+
+	if (operation == BENCH_THREAD_CHURN)
+		RunThreadChurn(threadCount, iterations, messageSize, results);
+	else
+	{
+		std::vector<std::thread> threads;
+		std::atomic<bool> start(false);
+
+		for (uint32_t i = 0; i < threadCount; i++)
+			threads.push_back(std::thread(RunThread, operation, iterations, messageSize, &start, &results[i]));
+
+		start = true;
+
+		for (uint32_t i = 0; i < threadCount; i++)
+			threads[i].join();
+	}
+
+	// Counters are reset by the next initialization
+	BIRDIE_STATS stats;
+	Birdie_GetStats(&stats);
+
+	Birdie_Terminate();
+
+	switch (operation)
+	{
+	case BENCH_LOG:
+		PrintResult("Log", pLabel, threadCount, messageSize, results, false);
+		break;
+
+	case BENCH_LOGF:
+		PrintResult("LogF", pLabel, threadCount, messageSize, results, false);
+		break;
+
+	case BENCH_WATCHES:
+		PrintResult("AddWatch", pLabel, threadCount, messageSize, results, false);
+		PrintResult("RemoveWatch", pLabel, threadCount, messageSize, results, true);
+		break;
+
+	case BENCH_ZONES:
+		PrintResult("Zone", pLabel, threadCount, messageSize, results, false);
+		break;
+
+	case BENCH_THREAD_CHURN:
+		// Ends of frames are timed on a single thread
+		PrintResult("ChurnLog", pLabel, threadCount, messageSize, results, false);
+		PrintResult("ChurnFrame", pLabel, 1, messageSize, results, true);
+		break;
+
+	case BENCH_CONTENTION:
+		PrintContention(threadCount, messageSize, results, &stats);
+		break;
+	}
+}
+
+static void RunThread(BENCH_OPERATION operation, uint32_t iterations, size_t messageSize, std::atomic<bool>* pStart, BENCH_THREAD_RESULT* pResult)
+{
+	pResult->latencies.reserve(iterations);
+	pResult->failureCount = 0;
+	pResult->secondFailureCount = 0;
+
+	std::vector<char> message(messageSize + 1, 'x');
+	message[messageSize] = '\0';
+
+	std::vector<int32_t> values(operation == BENCH_WATCHES ? iterations : 0);
+	std::vector<BIRDIE_HANDLE> handles(values.size());
+
+	while (!*pStart)
+		std::this_thread::yield();
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		BenchClock::time_point callStart = BenchClock::now();
+		BIRDIE_ERROR error = BIRDIE_SUCCESS;
+
+		switch (operation)
+		{
+		case BENCH_LOG:
+		case BENCH_THREAD_CHURN:
+		case BENCH_CONTENTION:
+			// Threads that come and go and threads that all log at once make the same call
+			error = Birdie_Log("bench", message.data());
+			break;
+
+		case BENCH_LOGF:
+			error = Birdie_LogF("bench", "iteration %u of %u, value %f", i, iterations, (double)i * 0.5);
+			break;
+
+		case BENCH_WATCHES:
+			error = Birdie_AddWatch("value", BIRDIE_TYPE_INT32, &values[i], sizeof(int32_t), 0, &handles[i]);
+			break;
+
+		case BENCH_ZONES:
+			// A begin and an end, timed together
+			error = Birdie_BeginZone(g_benchZone);
+
+			if (error == BIRDIE_SUCCESS)
+				error = Birdie_EndZone(g_benchZone);
+			break;
+		}
+
+		pResult->latencies.push_back(ElapsedNanoseconds(callStart, BenchClock::now()));
+
+		if (error != BIRDIE_SUCCESS)
+			pResult->failureCount++;
+	}
+
+	if (operation == BENCH_WATCHES)
+	{
+		pResult->secondLatencies.reserve(iterations);
+
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			BenchClock::time_point callStart = BenchClock::now();
+
+			if (Birdie_RemoveWatch(handles[i]) != BIRDIE_SUCCESS)
+				pResult->secondFailureCount++;
+
+			pResult->secondLatencies.push_back(ElapsedNanoseconds(callStart, BenchClock::now()));
+		}
+	}
+}
+
+static void RunThreadChurn(uint32_t threadCount, uint32_t iterations, size_t messageSize, std::vector<BENCH_THREAD_RESULT>& results)
+{
+	// Every wave starts fresh threads, which log a few times and exit.
+	// The end of frame after each wave is timed on this thread, it goes into the second latencies of the first result.
+	uint32_t waveCount = std::max(1u, iterations / BENCH_CHURN_CALLS_PER_THREAD);
+
+	for (uint32_t wave = 0; wave < waveCount; wave++)
+	{
+		std::vector<BENCH_THREAD_RESULT> waveResults(threadCount);
+		std::vector<std::thread> threads;
+		std::atomic<bool> start(false);
+
+		for (uint32_t i = 0; i < threadCount; i++)
+			threads.push_back(std::thread(RunThread, BENCH_THREAD_CHURN, (uint32_t)BENCH_CHURN_CALLS_PER_THREAD, messageSize, &start, &waveResults[i]));
+
+		start = true;
+
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			threads[i].join();
+
+			results[i].latencies.insert(results[i].latencies.end(), waveResults[i].latencies.begin(), waveResults[i].latencies.end());
+			results[i].failureCount += waveResults[i].failureCount;
+		}
+
+		BenchClock::time_point frameStart = BenchClock::now();
+
+		if (Birdie_EndFrame() != BIRDIE_SUCCESS)
+			results[0].secondFailureCount++;
+
+		results[0].secondLatencies.push_back(ElapsedNanoseconds(frameStart, BenchClock::now()));
+	}
+}
+
+static void PrintResult(const char* pName, const char* pLabel, uint32_t threadCount, size_t messageSize, std::vector<BENCH_THREAD_RESULT>& results, bool isSecond)
+{
+	std::vector<uint32_t> latencies;
+	uint64_t totalNanoseconds = 0;
+	uint32_t failureCount = 0;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const std::vector<uint32_t>& threadLatencies = isSecond ? results[i].secondLatencies : results[i].latencies;
+
+		latencies.insert(latencies.end(), threadLatencies.begin(), threadLatencies.end());
+		failureCount += isSecond ? results[i].secondFailureCount : results[i].failureCount;
+
+		for (size_t j = 0; j < threadLatencies.size(); j++)
+			totalNanoseconds += threadLatencies[j];
+	}
+
+	if (latencies.empty())
+		return;
+
+	std::sort(latencies.begin(), latencies.end());
+
+	// Calls per second over all threads, each thread only counts the time it spent in the calls being measured
+	double callsPerSecond = totalNanoseconds > 0 ? (double)latencies.size() * threadCount * 1e9 / (double)totalNanoseconds : 0.0;
+
+	size_t count = latencies.size();
+
+	printf("%-12s %-8s %7u %6u %12.0f %9u %9u %9u %8u\n", pName, pLabel, threadCount, (unsigned)messageSize, callsPerSecond,
+		latencies[count / 2], latencies[std::min(count - 1, count * 99 / 100)], latencies[std::min(count - 1, count * 999 / 1000)],
+		failureCount);
+}
+
+static void PrintContention(uint32_t threadCount, size_t messageSize, std::vector<BENCH_THREAD_RESULT>& results, const BIRDIE_STATS* pStats)
+{
+	std::vector<uint32_t> latencies;
+	uint64_t totalNanoseconds = 0;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		latencies.insert(latencies.end(), results[i].latencies.begin(), results[i].latencies.end());
+
+		for (size_t j = 0; j < results[i].latencies.size(); j++)
+			totalNanoseconds += results[i].latencies[j];
+	}
+
+	if (latencies.empty())
+		return;
+
+	std::sort(latencies.begin(), latencies.end());
+
+	size_t count = latencies.size();
+	double callsPerSecond = totalNanoseconds > 0 ? (double)count * threadCount * 1e9 / (double)totalNanoseconds : 0.0;
+
+	// Lock waits as a share of all calls, the wait time spread over all calls as well
+	printf("%-12s %7u %6u %12.0f %9u %9u %11.1f%% %12.0f\n", "Contended", threadCount, (unsigned)messageSize, callsPerSecond,
+		latencies[count / 2], latencies[std::min(count - 1, count * 99 / 100)],
+		100.0 * (double)pStats->sendLockContentionCount / (double)count, (double)pStats->sendLockWaitTime / (double)count);
+}
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"Usage: BirdieBench [--threads <count>] [--iterations <count>] [--async <queue bytes>] [--slow <bytes per second>]\n"
+		"  Runs every scenario at 1 up to <count> threads (default: hardware threads, at most 8).\n"
+		"  --iterations  Calls per thread and scenario (default 100000, a tenth of that for watches).\n"
+		"  --async       Uses asynchronous sending with a queue of the given size, blocking when it's full.\n"
+		"  --slow        Rate of the stand-in tool in the slow-consumer scenarios (default 4 MB/s).\n");
+}
@@ -0,0 +1,142 @@
+#include "Birdie.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Replays a trace recorded with Birdie_InitializeWithTraceFile.
+// Without an address the trace goes to a local stand-in for the tool, which only counts the chunks in the stream.
+
+#define BIRDIE_REPLAY_MAX_OPS 64
+
+typedef struct
+{
+	// The challenge key comes first, chunks follow
+	uint64_t headerRemaining;
+
+	// Length and op of the chunk being read, assembled byte by byte as the stream can be split anywhere
+	unsigned char prefix[8];
+	uint32_t      prefixSize;
+	uint64_t      chunkRemaining;
+
+	uint64_t      byteCount;
+	uint64_t      chunkCount;
+	uint64_t      opCounts[BIRDIE_REPLAY_MAX_OPS];
+} BIRDIE_REPLAY_STATS;
+
+
+// Prototypes
+
+static void CountChunks(void* pUserData, const void* pData, size_t size);
+static void PrintUsage();
+
+
+// Function implementations
+
+int main(int argc, char** argv)
+{
+	const char* pPath = NULL;
+	const char* pAddress = NULL;
+	const char* pPort = NULL;
+	float speed = 1.0f;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc)
+			speed = (float)atof(argv[++i]);
+		else if (pPath == NULL)
+			pPath = argv[i];
+		else if (pAddress == NULL)
+			pAddress = argv[i];
+		else if (pPort == NULL)
+			pPort = argv[i];
+		else
+			pPath = NULL;
+	}
+
+	if (pPath == NULL || (pAddress != NULL && pPort == NULL) || speed < 0.0f)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	BIRDIE_ERROR error;
+
+	if (pAddress != NULL)
+	{
+		error = Birdie_ReplayTraceFile(pPath, pAddress, pPort, speed);
+	}
+	else
+	{
+		BIRDIE_REPLAY_STATS stats;
+		memset(&stats, 0, sizeof(stats));
+		stats.headerRemaining = sizeof(uint64_t);
+
+		error = Birdie_ReplayTraceFileToSink(pPath, CountChunks, &stats, speed);
+
+		printf("%llu bytes, %llu chunks\n", (unsigned long long)stats.byteCount, (unsigned long long)stats.chunkCount);
+
+		for (uint32_t op = 0; op < BIRDIE_REPLAY_MAX_OPS; op++)
+		{
+			if (stats.opCounts[op] > 0)
+				printf("  op %2u: %llu\n", op, (unsigned long long)stats.opCounts[op]);
+		}
+	}
+
+	if (error != BIRDIE_SUCCESS)
+	{
+		fprintf(stderr, "Replay failed with error %d\n", (int)error);
+		return 1;
+	}
+
+	return 0;
+}
+
+static void CountChunks(void* pUserData, const void* pData, size_t size)
+{
+	BIRDIE_REPLAY_STATS* pStats = (BIRDIE_REPLAY_STATS*)pUserData;
+	const unsigned char* pBytes = (const unsigned char*)pData;
+
+	pStats->byteCount += size;
+
+	while (size > 0)
+	{
+		if (pStats->headerRemaining > 0 || pStats->chunkRemaining > 0)
+		{
+			uint64_t* pRemaining = pStats->headerRemaining > 0 ? &pStats->headerRemaining : &pStats->chunkRemaining;
+			size_t skipSize = *pRemaining < size ? (size_t)*pRemaining : size;
+
+			*pRemaining -= skipSize;
+			pBytes += skipSize;
+			size -= skipSize;
+			continue;
+		}
+
+		pStats->prefix[pStats->prefixSize++] = *pBytes++;
+		size--;
+
+		if (pStats->prefixSize < sizeof(pStats->prefix))
+			continue;
+
+		// The length covers the op, which has been read already
+		uint32_t length;
+		uint32_t op;
+		memcpy(&length, pStats->prefix, sizeof(length));
+		memcpy(&op, pStats->prefix + sizeof(length), sizeof(op));
+
+		pStats->prefixSize = 0;
+		pStats->chunkRemaining = length > sizeof(op) ? length - sizeof(op) : 0;
+		pStats->chunkCount++;
+
+		if (op < BIRDIE_REPLAY_MAX_OPS)
+			pStats->opCounts[op]++;
+	}
+}
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"Usage: BirdieReplay <trace path> [<address> <port>] [--speed <factor>]\n"
+		"  Sends the trace to the tool at <address>:<port>, or counts its chunks when no address is given.\n"
+		"  A speed of 1 keeps the original timing, 0 replays as fast as possible.\n");
+}
@@ -0,0 +1,429 @@
+#include "TraceFile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+typedef struct
+{
+	BIRDIE_TRANSPORT             base;
+	char                         path[BIRDIE_TRACE_PATH_SIZE];
+
+	// Size of every segment file, header included
+	size_t                       segmentSize;
+	uint32_t                     segmentIndex;
+
+#ifdef _WIN32
+	HANDLE                       file;
+	HANDLE                       mapping;
+#else
+	int                          descriptor;
+#endif
+	BIRDIE_TRACE_SEGMENT_HEADER* pHeader;
+	char*                        pData;
+	size_t                       dataCapacity;
+	size_t                       dataSize;
+
+	DWORD                        lastSendTime;
+} BIRDIE_TRACE_TRANSPORT;
+
+// Reads the record data of consecutive segments as one stream
+typedef struct
+{
+	const char* pPath;
+	uint32_t    segmentIndex;
+	FILE*       pFile;
+	LONGLONG    bytesRemaining;
+} BIRDIE_TRACE_READER;
+
+
+// Prototypes
+
+static bool Birdie_OpenTraceSegment(BIRDIE_TRACE_TRANSPORT* pTraceTransport);
+static void Birdie_CloseTraceSegment(BIRDIE_TRACE_TRANSPORT* pTraceTransport);
+static bool Birdie_WriteTrace(BIRDIE_TRACE_TRANSPORT* pTraceTransport, const void* pData, size_t size);
+static bool Birdie_OpenNextTraceSegment(BIRDIE_TRACE_READER* pReader);
+static bool Birdie_ReadTrace(BIRDIE_TRACE_READER* pReader, void* pData, size_t size);
+
+
+// Function implementations
+
+bool Birdie_GetTraceSegmentPath(char* pSegmentPath, const char* pPath, uint32_t segmentIndex)
+{
+	int length = snprintf(pSegmentPath, BIRDIE_TRACE_PATH_SIZE, "%s.%u", pPath, segmentIndex);
+
+	return length > 0 && length < BIRDIE_TRACE_PATH_SIZE;
+}
+
+static bool Birdie_TraceSend(BIRDIE_TRANSPORT* pTransport, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount)
+{
+	BIRDIE_TRACE_TRANSPORT* pTraceTransport = (BIRDIE_TRACE_TRANSPORT*)pTransport;
+
+	BIRDIE_TRACE_RECORD_HEADER record;
+	record.size = 0;
+
+	for (size_t i = 0; i < bufferCount; i++)
+		record.size += (uint32_t)pBuffers[i].size;
+
+	DWORD now = GetTickCount();
+	record.delayMs = now - pTraceTransport->lastSendTime;
+	pTraceTransport->lastSendTime = now;
+
+	if (!Birdie_WriteTrace(pTraceTransport, &record, sizeof(record)))
+		return false;
+
+	for (size_t i = 0; i < bufferCount; i++)
+	{
+		if (!Birdie_WriteTrace(pTraceTransport, pBuffers[i].pData, pBuffers[i].size))
+			return false;
+	}
+
+	// Only complete records count, a reader never sees half of one
+	pTraceTransport->pHeader->dataSize = (LONGLONG)pTraceTransport->dataSize;
+
+	return true;
+}
+
+static bool Birdie_TraceReceive(BIRDIE_TRANSPORT* pTransport, void* pData, size_t size, uint32_t timeoutMs)
+{
+	// Nobody on the other end to answer
+	return false;
+}
+
+static size_t Birdie_TracePoll(BIRDIE_TRANSPORT* pTransport, void* pData, size_t size)
+{
+	return 0;
+}
+
+static void Birdie_TraceClose(BIRDIE_TRANSPORT* pTransport)
+{
+	Birdie_CloseTraceSegment((BIRDIE_TRACE_TRANSPORT*)pTransport);
+
+	g_deallocFunction(pTransport);
+}
+
+BIRDIE_TRANSPORT* Birdie_CreateTraceTransport(const char* pPath, size_t segmentSize)
+{
+	// Leaves room for the segment suffix
+	if (strlen(pPath) + 12 > BIRDIE_TRACE_PATH_SIZE)
+		return NULL;
+
+	BIRDIE_TRACE_TRANSPORT* pTraceTransport = (BIRDIE_TRACE_TRANSPORT*)g_allocFunction(sizeof(BIRDIE_TRACE_TRANSPORT));
+
+	if (pTraceTransport == NULL)
+		return NULL;
+
+	memset(pTraceTransport, 0, sizeof(BIRDIE_TRACE_TRANSPORT));
+
+	pTraceTransport->base.pSend = Birdie_TraceSend;
+	pTraceTransport->base.pReceive = Birdie_TraceReceive;
+	pTraceTransport->base.pPoll = Birdie_TracePoll;
+	pTraceTransport->base.pClose = Birdie_TraceClose;
+	pTraceTransport->base.isLoopback = false;
+	pTraceTransport->base.isRemote = false;
+
+	strcpy(pTraceTransport->path, pPath);
+
+	pTraceTransport->segmentSize = segmentSize < BIRDIE_TRACE_MIN_SEGMENT_SIZE ? BIRDIE_TRACE_MIN_SEGMENT_SIZE : segmentSize;
+	pTraceTransport->lastSendTime = GetTickCount();
+
+#ifndef _WIN32
+	pTraceTransport->descriptor = -1;
+#endif
+
+	if (!Birdie_OpenTraceSegment(pTraceTransport))
+	{
+		g_deallocFunction(pTraceTransport);
+		return NULL;
+	}
+
+	return &pTraceTransport->base;
+}
+
+static bool Birdie_OpenTraceSegment(BIRDIE_TRACE_TRANSPORT* pTraceTransport)
+{
+	char segmentPath[BIRDIE_TRACE_PATH_SIZE];
+
+	if (!Birdie_GetTraceSegmentPath(segmentPath, pTraceTransport->path, pTraceTransport->segmentIndex))
+		return false;
+
+	size_t segmentSize = pTraceTransport->segmentSize;
+	void* pView = NULL;
+
+#ifdef _WIN32
+	pTraceTransport->file = CreateFileA(segmentPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (pTraceTransport->file == INVALID_HANDLE_VALUE)
+	{
+		pTraceTransport->file = NULL;
+		return false;
+	}
+
+	// Mapping more than the file holds grows the file
+	pTraceTransport->mapping = CreateFileMapping(pTraceTransport->file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)segmentSize >> 32), (DWORD)segmentSize, NULL);
+
+	if (pTraceTransport->mapping != NULL)
+		pView = MapViewOfFile(pTraceTransport->mapping, FILE_MAP_ALL_ACCESS, 0, 0, segmentSize);
+#else
+	pTraceTransport->descriptor = open(segmentPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (pTraceTransport->descriptor < 0)
+		return false;
+
+	if (ftruncate(pTraceTransport->descriptor, (off_t)segmentSize) == 0)
+	{
+		// Reserves the blocks up front, a full disk then fails here instead of faulting a write into the mapping later.
+		// Only a file system that can't reserve blocks is let through, the segment still works without.
+		int allocateError = posix_fallocate(pTraceTransport->descriptor, 0, (off_t)segmentSize);
+
+		if (allocateError == 0 || allocateError == EOPNOTSUPP || allocateError == EINVAL)
+		{
+			pView = mmap(NULL, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, pTraceTransport->descriptor, 0);
+
+			if (pView == MAP_FAILED)
+				pView = NULL;
+		}
+		else
+		{
+			// Out of space, an empty segment would only read as a damaged trace
+			unlink(segmentPath);
+		}
+	}
+#endif
+
+	pTraceTransport->pHeader = (BIRDIE_TRACE_SEGMENT_HEADER*)pView;
+
+	if (pView == NULL)
+	{
+		Birdie_CloseTraceSegment(pTraceTransport);
+		return false;
+	}
+
+	pTraceTransport->pData = (char*)pView + sizeof(BIRDIE_TRACE_SEGMENT_HEADER);
+	pTraceTransport->dataCapacity = segmentSize - sizeof(BIRDIE_TRACE_SEGMENT_HEADER);
+	pTraceTransport->dataSize = 0;
+
+	pTraceTransport->pHeader->magic = BIRDIE_TRACE_MAGIC;
+	pTraceTransport->pHeader->version = BIRDIE_TRACE_VERSION;
+	pTraceTransport->pHeader->segmentIndex = pTraceTransport->segmentIndex;
+	pTraceTransport->pHeader->dataSize = 0;
+
+	return true;
+}
+
+static void Birdie_CloseTraceSegment(BIRDIE_TRACE_TRANSPORT* pTraceTransport)
+{
+	// The unused end of the segment is cut off
+	uint64_t fileSize = sizeof(BIRDIE_TRACE_SEGMENT_HEADER) + pTraceTransport->dataSize;
+
+#ifdef _WIN32
+	if (pTraceTransport->pHeader != NULL)
+		UnmapViewOfFile(pTraceTransport->pHeader);
+
+	if (pTraceTransport->mapping != NULL)
+		CloseHandle(pTraceTransport->mapping);
+
+	if (pTraceTransport->file != NULL)
+	{
+		LARGE_INTEGER position;
+		position.QuadPart = (LONGLONG)fileSize;
+
+		if (pTraceTransport->pHeader != NULL && SetFilePointerEx(pTraceTransport->file, position, NULL, FILE_BEGIN))
+			SetEndOfFile(pTraceTransport->file);
+
+		CloseHandle(pTraceTransport->file);
+	}
+
+	pTraceTransport->file = NULL;
+	pTraceTransport->mapping = NULL;
+#else
+	if (pTraceTransport->pHeader != NULL)
+	{
+		munmap(pTraceTransport->pHeader, pTraceTransport->segmentSize);
+
+		// Failing to cut it off only wastes space, the header still says how much of the segment is used
+		ftruncate(pTraceTransport->descriptor, (off_t)fileSize);
+	}
+
+	if (pTraceTransport->descriptor >= 0)
+		close(pTraceTransport->descriptor);
+
+	pTraceTransport->descriptor = -1;
+#endif
+
+	pTraceTransport->pHeader = NULL;
+	pTraceTransport->pData = NULL;
+}
+
+static bool Birdie_WriteTrace(BIRDIE_TRACE_TRANSPORT* pTraceTransport, const void* pData, size_t size)
+{
+	const char* pSource = (const char*)pData;
+
+	while (size > 0)
+	{
+		if (pTraceTransport->dataSize == pTraceTransport->dataCapacity)
+		{
+			// The segment is full, the record continues in the next one
+			pTraceTransport->pHeader->dataSize = (LONGLONG)pTraceTransport->dataSize;
+
+			Birdie_CloseTraceSegment(pTraceTransport);
+			pTraceTransport->segmentIndex++;
+
+			if (!Birdie_OpenTraceSegment(pTraceTransport))
+				return false;
+		}
+
+		size_t copySize = pTraceTransport->dataCapacity - pTraceTransport->dataSize;
+
+		if (copySize > size)
+			copySize = size;
+
+		memcpy((void*)(pTraceTransport->pData + pTraceTransport->dataSize), (void*)pSource, copySize);
+
+		pTraceTransport->dataSize += copySize;
+		pSource += copySize;
+		size -= copySize;
+	}
+
+	return true;
+}
+
+BIRDIE_ERROR Birdie_ReplayTrace(const char* pPath, BIRDIE_TRANSPORT* pTransport, float speed)
+{
+	BIRDIE_TRACE_READER reader;
+	memset(&reader, 0, sizeof(reader));
+
+	reader.pPath = pPath;
+
+	// Only the first segment has to be there, the trace ends wherever the segments end
+	if (!Birdie_OpenNextTraceSegment(&reader))
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	BIRDIE_ERROR error = BIRDIE_SUCCESS;
+
+	char* pRecordData = NULL;
+	size_t recordCapacity = 0;
+
+	// Records are sent relative to the start, so rounding doesn't add up over a long trace
+	DWORD startTime = GetTickCount();
+	uint64_t captureTime = 0;
+
+	BIRDIE_TRACE_RECORD_HEADER record;
+
+	while (Birdie_ReadTrace(&reader, &record, sizeof(record)))
+	{
+		if (record.size > recordCapacity)
+		{
+			if (pRecordData != NULL)
+				g_deallocFunction(pRecordData);
+
+			pRecordData = (char*)g_allocFunction(record.size);
+			recordCapacity = pRecordData != NULL ? record.size : 0;
+
+			if (pRecordData == NULL)
+			{
+				error = BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+				break;
+			}
+		}
+
+		// A process that crashed while rotating segments can leave half a record behind
+		if (!Birdie_ReadTrace(&reader, pRecordData, record.size))
+			break;
+
+		captureTime += record.delayMs;
+
+		if (speed > 0.0f)
+		{
+			DWORD dueTime = (DWORD)((double)captureTime / speed);
+			DWORD elapsedTime = GetTickCount() - startTime;
+
+			if (dueTime > elapsedTime)
+				Sleep(dueTime - elapsedTime);
+		}
+
+		BIRDIE_SEND_BUFFER buffer = { pRecordData, record.size };
+
+		if (!pTransport->pSend(pTransport, &buffer, 1))
+		{
+			error = BIRDIE_ERROR_COULD_NOT_CONNECT;
+			break;
+		}
+	}
+
+	if (pRecordData != NULL)
+		g_deallocFunction(pRecordData);
+
+	if (reader.pFile != NULL)
+		fclose(reader.pFile);
+
+	return error;
+}
+
+static bool Birdie_OpenNextTraceSegment(BIRDIE_TRACE_READER* pReader)
+{
+	if (pReader->pFile != NULL)
+	{
+		fclose(pReader->pFile);
+		pReader->pFile = NULL;
+		pReader->segmentIndex++;
+	}
+
+	char segmentPath[BIRDIE_TRACE_PATH_SIZE];
+
+	if (!Birdie_GetTraceSegmentPath(segmentPath, pReader->pPath, pReader->segmentIndex))
+		return false;
+
+	pReader->pFile = fopen(segmentPath, "rb");
+
+	if (pReader->pFile == NULL)
+		return false;
+
+	BIRDIE_TRACE_SEGMENT_HEADER header;
+
+	if (fread(&header, sizeof(header), 1, pReader->pFile) != 1 ||
+		header.magic != BIRDIE_TRACE_MAGIC || header.version != BIRDIE_TRACE_VERSION || header.segmentIndex != pReader->segmentIndex)
+	{
+		fclose(pReader->pFile);
+		pReader->pFile = NULL;
+		return false;
+	}
+
+	pReader->bytesRemaining = header.dataSize;
+
+	return true;
+}
+
+static bool Birdie_ReadTrace(BIRDIE_TRACE_READER* pReader, void* pData, size_t size)
+{
+	char* pDestination = (char*)pData;
+
+	while (size > 0)
+	{
+		if (pReader->bytesRemaining == 0 && !Birdie_OpenNextTraceSegment(pReader))
+			return false;
+
+		size_t readSize = size;
+
+		if ((LONGLONG)readSize > pReader->bytesRemaining)
+			readSize = (size_t)pReader->bytesRemaining;
+
+		if (fread(pDestination, 1, readSize, pReader->pFile) != readSize)
+			return false;
+
+		pReader->bytesRemaining -= (LONGLONG)readSize;
+		pDestination += readSize;
+		size -= readSize;
+	}
+
+	return true;
+}
@@ -0,0 +1,46 @@
+#ifndef BIRDIEAPI_TRACEFILE_H
+#define BIRDIEAPI_TRACEFILE_H
+
+#include "Birdie.h"
+#include "Transport.h"
+#include "Platform.h"
+
+// This header contains the layout of trace files, which hold a captured stream for later replay.
+// A trace is split into segments named "<path>.0", "<path>.1" and so on, each one a pre-sized file that is written through a mapping.
+// The data of all segments together is a sequence of records, one per send, and records may continue in the next segment.
+// Only moving on to the next segment makes system calls, writing a record is a copy into the mapping.
+
+#define BIRDIE_TRACE_MAGIC              0x4543415254445242ull // "BRDTRACE"
+#define BIRDIE_TRACE_VERSION            1
+#define BIRDIE_TRACE_MIN_SEGMENT_SIZE   65536
+
+// Maximum length of a segment path, including the suffix and the terminator
+#define BIRDIE_TRACE_PATH_SIZE          260
+
+typedef struct
+{
+	uint64_t          magic;
+	uint32_t          version;
+	uint32_t          segmentIndex;
+
+	// Bytes of record data following the header, updated after every record so that a crashed process leaves a readable trace
+	volatile LONGLONG dataSize;
+} BIRDIE_TRACE_SEGMENT_HEADER;
+
+typedef struct
+{
+	// Size of the data that follows
+	uint32_t size;
+
+	// Milliseconds since the previous record
+	uint32_t delayMs;
+} BIRDIE_TRACE_RECORD_HEADER;
+
+// Formats the path of a segment, returns false if it doesn't fit
+bool Birdie_GetTraceSegmentPath(char* pSegmentPath, const char* pPath, uint32_t segmentIndex);
+
+// Sends every record of a trace to a transport, waiting in between records as they were captured.
+// A speed of 2 replays twice as fast, 0 doesn't wait at all. The transport is left open.
+BIRDIE_ERROR Birdie_ReplayTrace(const char* pPath, BIRDIE_TRANSPORT* pTransport, float speed);
+
+#endif
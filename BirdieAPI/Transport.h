@@ -0,0 +1,41 @@
+#ifndef BIRDIEAPI_TRANSPORT_H
+#define BIRDIEAPI_TRANSPORT_H
+
+#include "Birdie.h"
+#include "SendQueue.h"
+
+// This header contains the interface every transport implements.
+// The encoder only ever produces a byte stream, a transport decides where that stream goes.
+// Sends are never made concurrently, they're serialized by the send lock or done by the sender thread.
+
+typedef struct BIRDIE_TRANSPORT
+{
+	// Sends all spans in order, waiting until they're out. Returns false once the connection is gone.
+	bool (*pSend)(struct BIRDIE_TRANSPORT* pTransport, const BIRDIE_SEND_BUFFER* pBuffers, size_t bufferCount);
+
+	// Receives exactly 'size' bytes from the tool. Returns false on timeout, or if the transport can't receive.
+	bool (*pReceive)(struct BIRDIE_TRANSPORT* pTransport, void* pData, size_t size, uint32_t timeoutMs);
+
+	// Receives whatever the tool has sent so far, up to 'size' bytes, without waiting. Returns the amount received.
+	size_t (*pPoll)(struct BIRDIE_TRANSPORT* pTransport, void* pData, size_t size);
+
+	// Closes the connection and releases the transport
+	void (*pClose)(struct BIRDIE_TRANSPORT* pTransport);
+
+	// Set when the tool runs on this machine, which makes shared memory an option
+	bool isLoopback;
+
+	// Set when the tool runs on another machine, which makes compression worth it
+	bool isRemote;
+} BIRDIE_TRANSPORT;
+
+// Connects to the tool over TCP, returns NULL on failure. Implemented once per platform.
+BIRDIE_TRANSPORT* Birdie_CreateSocketTransport(const char* pAddress, const char* pPort);
+
+// Hands the stream to a function in this process, mostly useful for measuring the encoder
+BIRDIE_TRANSPORT* Birdie_CreateSinkTransport(BIRDIE_SINK_FUNCTION sinkFunction, void* pUserData);
+
+// Appends the stream to memory-mapped trace segments of 'segmentSize' bytes each, returns NULL if the first one can't be created
+BIRDIE_TRANSPORT* Birdie_CreateTraceTransport(const char* pPath, size_t segmentSize);
+
+#endif
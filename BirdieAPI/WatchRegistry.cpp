@@ -0,0 +1,580 @@
+#include "WatchRegistry.h"
+#include "DirtyBlocks.h"
+
+#include <string.h>
+
+extern BIRDIE_ALLOCATION_FUNCTION   g_allocFunction;
+extern BIRDIE_DEALLOCATION_FUNCTION g_deallocFunction;
+
+static CRITICAL_SECTION     g_csWatchRegistry;
+
+// Slots are never moved, a handle's index stays valid for as long as the handle does
+static BIRDIE_WATCH_ENTRY*  g_pWatchEntries = NULL;
+static size_t               g_watchEntryCount = 0;
+static size_t               g_watchEntryCapacity = 0;
+static uint32_t             g_firstFreeWatchEntry = BIRDIE_NO_WATCH_ENTRY;
+static size_t               g_freeWatchEntryCount = 0;
+
+// Generation of slots that haven't been used yet. It carries over between sessions, so handles of an earlier one don't alias.
+static uint32_t             g_firstGeneration = 1;
+
+// Reused between snapshots, it only ever grows
+static char*                g_pSnapshotBuffer = NULL;
+static size_t               g_snapshotBufferSize = 0;
+
+
+// Prototypes
+
+static void Birdie_InitializeWatchRegistry();
+static bool Birdie_ReserveWatchEntries(size_t count);
+static bool Birdie_ReserveSnapshotBuffer(size_t size);
+static size_t Birdie_SnapshotWatchRegion(BIRDIE_WATCH_ENTRY* pRegion, size_t offset);
+static void Birdie_DropSnapshotShadows(size_t offset, size_t endOffset);
+static BIRDIE_WATCH_ENTRY* Birdie_GetWatchEntry(BIRDIE_HANDLE handle);
+static BIRDIE_HANDLE Birdie_AllocateWatchEntry(BIRDIE_HANDLE parent, uint32_t nameId, uint32_t typeId, const void* pBase, size_t dataSizeBytes);
+static void Birdie_FreeWatchEntry(uint32_t index);
+static void Birdie_ReleaseWatchEntry(uint32_t index);
+static BIRDIE_ERROR Birdie_ReplayWatchEntry(uint32_t index, BIRDIE_WATCH_ENTRY_FUNCTION pFunction);
+
+static uint32_t Birdie_NextGeneration(uint32_t generation)
+{
+	generation = (generation + 1) % BIRDIE_HANDLE_GENERATIONS;
+
+	// Generation 0 would make index 0 hand out handle 0, which is the root
+	return generation != 0 ? generation : 1;
+}
+
+
+// Function implementations
+
+// Watches can be added before there's a connection, so the registry is ready as soon as the library is loaded
+static void Birdie_InitializeWatchRegistry()
+{
+	InitializeCriticalSection(&g_csWatchRegistry);
+	Birdie_InitializeDirtyBlocks();
+}
+
+BIRDIE_STATIC_CALL(Birdie_InitializeWatchRegistry, ());
+
+void Birdie_FreeWatchRegistry()
+{
+	EnterCriticalSection(&g_csWatchRegistry);
+
+	uint32_t lastGeneration = g_firstGeneration;
+
+	for (size_t i = 0; i < g_watchEntryCount; i++)
+	{
+		if (g_pWatchEntries[i].pShadow != NULL)
+			g_deallocFunction(g_pWatchEntries[i].pShadow);
+
+		if (g_pWatchEntries[i].generation > lastGeneration)
+			lastGeneration = g_pWatchEntries[i].generation;
+	}
+
+	// The next session starts past every generation this one handed out
+	g_firstGeneration = Birdie_NextGeneration(lastGeneration);
+
+	if (g_pWatchEntries != NULL)
+		g_deallocFunction(g_pWatchEntries);
+
+	if (g_pSnapshotBuffer != NULL)
+		g_deallocFunction(g_pSnapshotBuffer);
+
+	g_pWatchEntries = NULL;
+	g_watchEntryCount = 0;
+	g_watchEntryCapacity = 0;
+	g_firstFreeWatchEntry = BIRDIE_NO_WATCH_ENTRY;
+	g_freeWatchEntryCount = 0;
+
+	g_pSnapshotBuffer = NULL;
+	g_snapshotBufferSize = 0;
+
+	LeaveCriticalSection(&g_csWatchRegistry);
+}
+
+BIRDIE_ERROR Birdie_AddWatchEntry(BIRDIE_HANDLE parent, uint32_t nameId, uint32_t typeId, const void* pBase, size_t dataSizeBytes, LPBIRDIE_HANDLE pHandle)
+{
+	// Region sizes are stored and sent as 32 bit values
+	if (dataSizeBytes > 0xFFFFFFFFu)
+		return BIRDIE_ERROR_INVALID_PARAMS;
+
+	EnterCriticalSection(&g_csWatchRegistry);
+
+	if (parent != 0 && Birdie_GetWatchEntry(parent) == NULL)
+	{
+		LeaveCriticalSection(&g_csWatchRegistry);
+		return BIRDIE_ERROR_INVALID_PARAMS;
+	}
+
+	if (!Birdie_ReserveWatchEntries(1))
+	{
+		LeaveCriticalSection(&g_csWatchRegistry);
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	*pHandle = Birdie_AllocateWatchEntry(parent, nameId, typeId, pBase, dataSizeBytes);
+
+	LeaveCriticalSection(&g_csWatchRegistry);
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_AddWatchEntries(const BIRDIE_WATCH_DESCRIPTOR* pDescriptors, const uint32_t* pStringIds, size_t count, LPBIRDIE_HANDLE pHandles)
+{
+	EnterCriticalSection(&g_csWatchRegistry);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (pDescriptors[i].dataSizeBytes > 0xFFFFFFFFu)
+		{
+			LeaveCriticalSection(&g_csWatchRegistry);
+			return BIRDIE_ERROR_INVALID_PARAMS;
+		}
+
+		if (pDescriptors[i].parent != 0 && Birdie_GetWatchEntry(pDescriptors[i].parent) == NULL)
+		{
+			LeaveCriticalSection(&g_csWatchRegistry);
+			return BIRDIE_ERROR_INVALID_PARAMS;
+		}
+	}
+
+	if (!Birdie_ReserveWatchEntries(count))
+	{
+		LeaveCriticalSection(&g_csWatchRegistry);
+		return BIRDIE_ERROR_INSUFFICIENT_MEMORY;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		pHandles[i] = Birdie_AllocateWatchEntry(pDescriptors[i].parent, pStringIds[i * 2], pStringIds[i * 2 + 1], pDescriptors[i].pBase, pDescriptors[i].dataSizeBytes);
+
+	LeaveCriticalSection(&g_csWatchRegistry);
+
+	return BIRDIE_SUCCESS;
+}
+
+BIRDIE_ERROR Birdie_RemoveWatchEntry(BIRDIE_HANDLE handle)
+{
+	EnterCriticalSection(&g_csWatchRegistry);
+
+	if (Birdie_GetWatchEntry(handle) == NULL)
+	{
+		LeaveCriticalSection(&g_csWatchRegistry);
+		return BIRDIE_ERROR_INVALID_PARAMS;
+	}
+
+	Birdie_FreeWatchEntry(handle & BIRDIE_HANDLE_INDEX_MASK);
+
+	LeaveCriticalSection(&g_csWatchRegistry);
+
+	return BIRDIE_SUCCESS;
+}
+
+void Birdie_LockWatchRegistry()
+{
+	EnterCriticalSection(&g_csWatchRegistry);
+}
+
+void Birdie_UnlockWatchRegistry()
+{
+	LeaveCriticalSection(&g_csWatchRegistry);
+}
+
+const BIRDIE_WATCH_ENTRY* Birdie_FindWatchEntry(BIRDIE_HANDLE handle)
+{
+	return Birdie_GetWatchEntry(handle);
+}
+
+BIRDIE_ERROR Birdie_ReplayWatchEntries(BIRDIE_WATCH_ENTRY_FUNCTION pFunction)
+{
+	// Children are replayed along with their parent, so only the roots are started from here
+	for (size_t i = 0; i < g_watchEntryCount; i++)
+	{
+		if (g_pWatchEntries[i].handle == 0 || g_pWatchEntries[i].parent != 0)
+			continue;
+
+		BIRDIE_ERROR error = Birdie_ReplayWatchEntry((uint32_t)i, pFunction);
+
+		if (error != BIRDIE_SUCCESS)
+			return error;
+	}
+
+	return BIRDIE_SUCCESS;
+}
+
+char* Birdie_SnapshotWatchRegions(size_t headerSize, size_t* pSize, uint32_t* pRegionCount)
+{
+	if (!Birdie_ReserveSnapshotBuffer(headerSize))
+		return NULL;
+
+	size_t offset = headerSize;
+	uint32_t regionCount = 0;
+
+	for (size_t i = 0; i < g_watchEntryCount; i++)
+	{
+		BIRDIE_WATCH_ENTRY* pRegion = &g_pWatchEntries[i];
+
+		// Free slots and categories
+		if (pRegion->handle == 0 || pRegion->pBase == NULL)
+			continue;
+
+		// Worst case every other block changed, which needs a range for every dirty block
+		size_t maxRangeCount = pRegion->dataSizeBytes / (BIRDIE_DIRTY_BLOCK_SIZE * 2) + 1;
+		size_t maxRegionSize = sizeof(BIRDIE_HANDLE) + sizeof(uint32_t) + maxRangeCount * (sizeof(uint32_t) + sizeof(uint32_t)) + pRegion->dataSizeBytes;
+
+		if (!Birdie_ReserveSnapshotBuffer(offset + maxRegionSize))
+		{
+			// What made it in so far won't be sent either
+			Birdie_DropSnapshotShadows(headerSize, offset);
+			return NULL;
+		}
+
+		size_t regionSize = Birdie_SnapshotWatchRegion(pRegion, offset);
+
+		if (regionSize > 0)
+		{
+			offset += regionSize;
+			regionCount++;
+		}
+	}
+
+	*pSize = offset;
+	*pRegionCount = regionCount;
+
+	return g_pSnapshotBuffer;
+}
+
+void Birdie_DiscardWatchSnapshot(size_t headerSize, size_t size)
+{
+	Birdie_DropSnapshotShadows(headerSize, size);
+}
+
+static void Birdie_DropSnapshotShadows(size_t offset, size_t endOffset)
+{
+	// Walks the regions as Birdie_SnapshotWatchRegion stored them
+	while (offset < endOffset)
+	{
+		BIRDIE_HANDLE handle;
+		uint32_t rangeCount;
+
+		memcpy((void*)&handle, (void*)(g_pSnapshotBuffer + offset), sizeof(BIRDIE_HANDLE));
+		offset += sizeof(BIRDIE_HANDLE);
+
+		memcpy((void*)&rangeCount, (void*)(g_pSnapshotBuffer + offset), sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		for (uint32_t i = 0; i < rangeCount; i++)
+		{
+			uint32_t rangeLength;
+
+			memcpy((void*)&rangeLength, (void*)(g_pSnapshotBuffer + offset + sizeof(uint32_t)), sizeof(uint32_t));
+			offset += sizeof(uint32_t) + sizeof(uint32_t) + rangeLength;
+		}
+
+		BIRDIE_WATCH_ENTRY* pRegion = Birdie_GetWatchEntry(handle);
+
+		if (pRegion != NULL && pRegion->pShadow != NULL)
+		{
+			g_deallocFunction(pRegion->pShadow);
+			pRegion->pShadow = NULL;
+		}
+	}
+}
+
+static size_t Birdie_SnapshotWatchRegion(BIRDIE_WATCH_ENTRY* pRegion, size_t offset)
+{
+	const char* pCurrent = (const char*)pRegion->pBase;
+	size_t size = pRegion->dataSizeBytes;
+
+	size_t startOffset = offset;
+	size_t rangeCountOffset = offset + sizeof(BIRDIE_HANDLE);
+	uint32_t rangeCount = 0;
+
+	memcpy((void*)(g_pSnapshotBuffer + offset), (void*)&pRegion->handle, sizeof(BIRDIE_HANDLE));
+	offset += sizeof(BIRDIE_HANDLE) + sizeof(uint32_t);
+
+	if (pRegion->pShadow == NULL)
+	{
+		// First publish, send everything and start tracking changes from here on.
+		// Without a shadow copy (out of memory) the region is simply sent in full every time.
+		uint32_t rangeOffset = 0;
+
+		memcpy((void*)(g_pSnapshotBuffer + offset), (void*)&rangeOffset, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		memcpy((void*)(g_pSnapshotBuffer + offset), (void*)&pRegion->dataSizeBytes, sizeof(uint32_t));
+		offset += sizeof(uint32_t);
+
+		memcpy((void*)(g_pSnapshotBuffer + offset), (void*)pCurrent, size);
+		offset += size;
+
+		rangeCount = 1;
+
+		pRegion->pShadow = (char*)g_allocFunction(size);
+
+		if (pRegion->pShadow != NULL)
+			memcpy((void*)pRegion->pShadow, (void*)pCurrent, size);
+	}
+	else
+	{
+		// Every run of dirty blocks becomes a range
+		size_t rangeStart = Birdie_FindBlock(pCurrent, pRegion->pShadow, size, 0, true);
+
+		while (rangeStart < size)
+		{
+			size_t rangeEnd = Birdie_FindBlock(pCurrent, pRegion->pShadow, size, rangeStart + BIRDIE_DIRTY_BLOCK_SIZE, false);
+
+			if (rangeEnd > size)
+				rangeEnd = size;
+
+			uint32_t rangeOffset = (uint32_t)rangeStart;
+			uint32_t rangeLength = (uint32_t)(rangeEnd - rangeStart);
+
+			memcpy((void*)(g_pSnapshotBuffer + offset), (void*)&rangeOffset, sizeof(uint32_t));
+			offset += sizeof(uint32_t);
+
+			memcpy((void*)(g_pSnapshotBuffer + offset), (void*)&rangeLength, sizeof(uint32_t));
+			offset += sizeof(uint32_t);
+
+			memcpy((void*)(g_pSnapshotBuffer + offset), (void*)(pCurrent + rangeStart), rangeLength);
+			offset += rangeLength;
+
+			// The shadow gets the bytes that were actually sent, not whatever is there by now
+			memcpy((void*)(pRegion->pShadow + rangeStart), (void*)(g_pSnapshotBuffer + offset - rangeLength), rangeLength);
+
+			rangeCount++;
+
+			if (rangeEnd >= size)
+				break;
+
+			rangeStart = Birdie_FindBlock(pCurrent, pRegion->pShadow, size, rangeEnd, true);
+		}
+	}
+
+	if (rangeCount == 0)
+		return 0;
+
+	memcpy((void*)(g_pSnapshotBuffer + rangeCountOffset), (void*)&rangeCount, sizeof(uint32_t));
+
+	return offset - startOffset;
+}
+
+static bool Birdie_ReserveWatchEntries(size_t count)
+{
+	// Free slots are used up first
+	size_t newEntryCount = count > g_freeWatchEntryCount ? count - g_freeWatchEntryCount : 0;
+
+	if (g_watchEntryCount + newEntryCount > (size_t)BIRDIE_HANDLE_INDEX_MASK + 1)
+		return false;
+
+	if (g_watchEntryCount + newEntryCount <= g_watchEntryCapacity)
+		return true;
+
+	size_t newCapacity = g_watchEntryCapacity > 0 ? g_watchEntryCapacity : 64;
+
+	while (newCapacity < g_watchEntryCount + newEntryCount)
+		newCapacity <<= 1;
+
+	BIRDIE_WATCH_ENTRY* pNewEntries = (BIRDIE_WATCH_ENTRY*)g_allocFunction(newCapacity * sizeof(BIRDIE_WATCH_ENTRY));
+
+	if (pNewEntries == NULL)
+		return false;
+
+	if (g_pWatchEntries != NULL)
+	{
+		memcpy((void*)pNewEntries, (void*)g_pWatchEntries, g_watchEntryCount * sizeof(BIRDIE_WATCH_ENTRY));
+		g_deallocFunction(g_pWatchEntries);
+	}
+
+	g_pWatchEntries = pNewEntries;
+	g_watchEntryCapacity = newCapacity;
+
+	return true;
+}
+
+static bool Birdie_ReserveSnapshotBuffer(size_t size)
+{
+	if (size <= g_snapshotBufferSize)
+		return true;
+
+	size_t newSize = g_snapshotBufferSize > 0 ? g_snapshotBufferSize : 4096;
+
+	while (newSize < size)
+		newSize <<= 1;
+
+	char* pNewBuffer = (char*)g_allocFunction(newSize);
+
+	if (pNewBuffer == NULL)
+		return false;
+
+	// Snapshots are encoded incrementally, keep what's there
+	if (g_pSnapshotBuffer != NULL)
+	{
+		memcpy((void*)pNewBuffer, (void*)g_pSnapshotBuffer, g_snapshotBufferSize);
+		g_deallocFunction(g_pSnapshotBuffer);
+	}
+
+	g_pSnapshotBuffer = pNewBuffer;
+	g_snapshotBufferSize = newSize;
+
+	return true;
+}
+
+static BIRDIE_WATCH_ENTRY* Birdie_GetWatchEntry(BIRDIE_HANDLE handle)
+{
+	uint32_t index = handle & BIRDIE_HANDLE_INDEX_MASK;
+
+	if (handle == 0 || index >= g_watchEntryCount)
+		return NULL;
+
+	// Free slots have a handle of 0, reused ones have a newer generation
+	if (g_pWatchEntries[index].handle != handle)
+		return NULL;
+
+	return &g_pWatchEntries[index];
+}
+
+static BIRDIE_HANDLE Birdie_AllocateWatchEntry(BIRDIE_HANDLE parent, uint32_t nameId, uint32_t typeId, const void* pBase, size_t dataSizeBytes)
+{
+	// Room has been reserved by the caller
+	uint32_t index = 0;
+	BIRDIE_WATCH_ENTRY* pEntry = NULL;
+
+	if (g_firstFreeWatchEntry != BIRDIE_NO_WATCH_ENTRY)
+	{
+		index = g_firstFreeWatchEntry;
+		pEntry = &g_pWatchEntries[index];
+
+		g_firstFreeWatchEntry = pEntry->nextSibling;
+		g_freeWatchEntryCount--;
+
+		pEntry->generation = Birdie_NextGeneration(pEntry->generation);
+	}
+	else
+	{
+		index = (uint32_t)g_watchEntryCount++;
+		pEntry = &g_pWatchEntries[index];
+
+		pEntry->generation = g_firstGeneration;
+	}
+
+	pEntry->handle = index | (pEntry->generation << BIRDIE_HANDLE_INDEX_BITS);
+	pEntry->parent = parent;
+	pEntry->firstChild = BIRDIE_NO_WATCH_ENTRY;
+	pEntry->nextSibling = BIRDIE_NO_WATCH_ENTRY;
+	pEntry->previousSibling = BIRDIE_NO_WATCH_ENTRY;
+	pEntry->nameId = nameId;
+	pEntry->typeId = typeId;
+	pEntry->pBase = pBase;
+	pEntry->dataSizeBytes = (uint32_t)dataSizeBytes;
+	pEntry->pShadow = NULL;
+
+	// Children are linked in front, order doesn't matter
+	BIRDIE_WATCH_ENTRY* pParent = Birdie_GetWatchEntry(parent);
+
+	if (pParent != NULL)
+	{
+		pEntry->nextSibling = pParent->firstChild;
+
+		if (pParent->firstChild != BIRDIE_NO_WATCH_ENTRY)
+			g_pWatchEntries[pParent->firstChild].previousSibling = index;
+
+		pParent->firstChild = index;
+	}
+
+	return pEntry->handle;
+}
+
+static void Birdie_FreeWatchEntry(uint32_t index)
+{
+	// The tool removes children along with their category, so their entries have to go as well.
+	// The walk goes down to an entry without children, releases it and goes on from its parent. Every child unlinks
+	// itself, which moves the next one to the front. The parent links lead back up, so deep nesting needs no stack.
+	uint32_t currentIndex = index;
+
+	for (;;)
+	{
+		while (g_pWatchEntries[currentIndex].firstChild != BIRDIE_NO_WATCH_ENTRY)
+			currentIndex = g_pWatchEntries[currentIndex].firstChild;
+
+		uint32_t parentIndex = g_pWatchEntries[currentIndex].parent & BIRDIE_HANDLE_INDEX_MASK;
+
+		Birdie_ReleaseWatchEntry(currentIndex);
+
+		if (currentIndex == index)
+			return;
+
+		currentIndex = parentIndex;
+	}
+}
+
+static void Birdie_ReleaseWatchEntry(uint32_t index)
+{
+	// Expects the entry to have no children left
+	BIRDIE_WATCH_ENTRY* pEntry = &g_pWatchEntries[index];
+	BIRDIE_WATCH_ENTRY* pParent = Birdie_GetWatchEntry(pEntry->parent);
+
+	if (pParent != NULL)
+	{
+		if (pEntry->previousSibling != BIRDIE_NO_WATCH_ENTRY)
+			g_pWatchEntries[pEntry->previousSibling].nextSibling = pEntry->nextSibling;
+		else
+			pParent->firstChild = pEntry->nextSibling;
+
+		if (pEntry->nextSibling != BIRDIE_NO_WATCH_ENTRY)
+			g_pWatchEntries[pEntry->nextSibling].previousSibling = pEntry->previousSibling;
+	}
+
+	if (pEntry->pShadow != NULL)
+		g_deallocFunction(pEntry->pShadow);
+
+	pEntry->handle = 0;
+	pEntry->pBase = NULL;
+	pEntry->pShadow = NULL;
+
+	pEntry->nextSibling = g_firstFreeWatchEntry;
+	g_firstFreeWatchEntry = index;
+	g_freeWatchEntryCount++;
+}
+
+static BIRDIE_ERROR Birdie_ReplayWatchEntry(uint32_t index, BIRDIE_WATCH_ENTRY_FUNCTION pFunction)
+{
+	// Parents go before their children, walked the same way as when freeing them
+	uint32_t currentIndex = index;
+
+	for (;;)
+	{
+		BIRDIE_WATCH_ENTRY* pEntry = &g_pWatchEntries[currentIndex];
+
+		// The tool hasn't seen any of the data yet
+		if (pEntry->pShadow != NULL)
+		{
+			g_deallocFunction(pEntry->pShadow);
+			pEntry->pShadow = NULL;
+		}
+
+		BIRDIE_ERROR error = pFunction(pEntry);
+
+		if (error != BIRDIE_SUCCESS)
+			return error;
+
+		// Children are linked in front, starting from the last one keeps the order they were added in
+		if (pEntry->firstChild != BIRDIE_NO_WATCH_ENTRY)
+		{
+			currentIndex = pEntry->firstChild;
+
+			while (g_pWatchEntries[currentIndex].nextSibling != BIRDIE_NO_WATCH_ENTRY)
+				currentIndex = g_pWatchEntries[currentIndex].nextSibling;
+
+			continue;
+		}
+
+		// Otherwise on to the sibling added before this entry, or before the closest parent that has one
+		while (currentIndex != index && g_pWatchEntries[currentIndex].previousSibling == BIRDIE_NO_WATCH_ENTRY)
+			currentIndex = g_pWatchEntries[currentIndex].parent & BIRDIE_HANDLE_INDEX_MASK;
+
+		if (currentIndex == index)
+			return BIRDIE_SUCCESS;
+
+		currentIndex = g_pWatchEntries[currentIndex].previousSibling;
+	}
+}
@@ -0,0 +1,86 @@
+#ifndef BIRDIEAPI_WATCHREGISTRY_H
+#define BIRDIEAPI_WATCHREGISTRY_H
+
+#include "Birdie.h"
+#include "Platform.h"
+
+// This header contains the client-side registry of watches and categories.
+// It hands out their handles: a slot index in the low bits and the slot's generation in the high bits.
+// A slot's generation changes every time it's reused, so a stale handle never refers to a newer watch.
+// Entries keep their interned name and type, so a new connection to the tool can be sent all of them by Birdie_ReplayWatchEntries.
+// Birdie_PublishWatches uses it to snapshot every region into one buffer, so the tool doesn't have to read them out itself.
+// Every region keeps a shadow copy of what was last published, so only the parts that changed have to be sent.
+
+#define BIRDIE_HANDLE_INDEX_BITS  20
+#define BIRDIE_HANDLE_INDEX_MASK  ((1u << BIRDIE_HANDLE_INDEX_BITS) - 1)
+#define BIRDIE_HANDLE_GENERATIONS (1u << (32 - BIRDIE_HANDLE_INDEX_BITS))
+
+// Marks the end of a child or free list
+#define BIRDIE_NO_WATCH_ENTRY 0xFFFFFFFFu
+
+typedef struct
+{
+	// Index and generation, 0 while the slot is free
+	BIRDIE_HANDLE handle;
+	BIRDIE_HANDLE parent;
+
+	// Slot indices of the children, so a category can be removed along with them.
+	// nextSibling doubles as the free list link.
+	uint32_t      firstChild;
+	uint32_t      nextSibling;
+	uint32_t      previousSibling;
+
+	// Kept while the slot is free, the next handle for this slot uses the one after it
+	uint32_t      generation;
+
+	// String table ids, categories have no type
+	uint32_t      nameId;
+	uint32_t      typeId;
+
+	// Categories have no region
+	const void*   pBase;
+	uint32_t      dataSizeBytes;
+
+	// Contents as of the last publish, allocated on the first one
+	char*         pShadow;
+} BIRDIE_WATCH_ENTRY;
+
+// Drops every watch and category. Handles handed out before stay invalid, even once their slots are reused.
+void Birdie_FreeWatchRegistry();
+
+typedef BIRDIE_ERROR (*BIRDIE_WATCH_ENTRY_FUNCTION)(const BIRDIE_WATCH_ENTRY* pEntry);
+
+// Registers a watch and returns its new handle, pass 0, NULL and 0 for the type, base and size of categories.
+// Returns BIRDIE_ERROR_INVALID_PARAMS if the parent isn't 0 and not a live category, or the region is 4 GB or larger.
+BIRDIE_ERROR Birdie_AddWatchEntry(BIRDIE_HANDLE parent, uint32_t nameId, uint32_t typeId, const void* pBase, size_t dataSizeBytes, LPBIRDIE_HANDLE pHandle);
+
+// Registers a set of watches, all or none of them. pStringIds holds the name and type id of every descriptor.
+BIRDIE_ERROR Birdie_AddWatchEntries(const BIRDIE_WATCH_DESCRIPTOR* pDescriptors, const uint32_t* pStringIds, size_t count, LPBIRDIE_HANDLE pHandles);
+
+// Removes a watch or category, along with everything that was registered under it.
+// Returns BIRDIE_ERROR_INVALID_PARAMS if the handle isn't live.
+BIRDIE_ERROR Birdie_RemoveWatchEntry(BIRDIE_HANDLE handle);
+
+// The snapshot buffer is owned by the registry, keep it locked until the snapshot has been sent
+void Birdie_LockWatchRegistry();
+void Birdie_UnlockWatchRegistry();
+
+// Returns the entry of a live handle, or NULL. Expects the registry to be locked, the entry is only valid until it's unlocked.
+const BIRDIE_WATCH_ENTRY* Birdie_FindWatchEntry(BIRDIE_HANDLE handle);
+
+// Calls pFunction for every watch and category, parents before their children. Expects the registry to be locked,
+// stops at the first error and returns it. Shadow copies are dropped, so the next publish sends every region in full.
+BIRDIE_ERROR Birdie_ReplayWatchEntries(BIRDIE_WATCH_ENTRY_FUNCTION pFunction);
+
+// Copies the changes of every registered region into the snapshot buffer, behind 'headerSize' bytes that are left for the caller.
+// Every changed region is stored as: handle (4b), range count (4b), then every range as: offset (4b), length (4b), data (*b).
+// Regions are sent in full the first time. Unchanged regions are left out.
+// Returns NULL if memory ran out, otherwise the buffer and its total size and changed region count.
+// Shadow copies already hold what the snapshot sends, call Birdie_DiscardWatchSnapshot if it doesn't get sent.
+char* Birdie_SnapshotWatchRegions(size_t headerSize, size_t* pSize, uint32_t* pRegionCount);
+
+// Drops the shadow copies of every region in the last snapshot, so the next publish sends them in full.
+// Expects the registry to be locked since the snapshot was taken.
+void Birdie_DiscardWatchSnapshot(size_t headerSize, size_t size);
+
+#endif
@@ -0,0 +1,39 @@
+#include "Zones.h"
+
+static uint64_t g_referenceTimestamp = 0;
+static LONGLONG g_referenceCounter = 0;
+
+
+// Function implementations
+
+void Birdie_InitializeTimestamps()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	g_referenceTimestamp = Birdie_ReadTimestamp();
+	g_referenceCounter = counter.QuadPart;
+}
+
+uint64_t Birdie_GetTimestampFrequency()
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+#ifdef BIRDIE_HAS_TSC
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	uint64_t elapsedTimestamp = Birdie_ReadTimestamp() - g_referenceTimestamp;
+	uint64_t elapsedCounter = (uint64_t)(counter.QuadPart - g_referenceCounter);
+
+	// Too early to tell, the tool keeps the last frequency it got
+	if (elapsedCounter == 0)
+		return 0;
+
+	// Floating point, the product would overflow 64 bits within minutes
+	return (uint64_t)((double)elapsedTimestamp * (double)frequency.QuadPart / (double)elapsedCounter);
+#else
+	return (uint64_t)frequency.QuadPart;
+#endif
+}
@@ -0,0 +1,57 @@
+#ifndef BIRDIEAPI_ZONES_H
+#define BIRDIEAPI_ZONES_H
+
+#include "Birdie.h"
+#include "Platform.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BIRDIE_HAS_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BIRDIE_HAS_TSC
+#endif
+
+// This header contains the per-thread buffers of profiling zones.
+// Every thread records its zone events into a ring of its own, the owning thread is the only writer.
+// Flushing hands the events to the send path straight from the ring, one flush at a time per ring.
+// Timestamps are read from the TSC where there is one, and converted by the tool using the frequency sent along.
+
+// Events per thread, a power of two. 64k of events, the same as a batch.
+#define BIRDIE_ZONE_BUFFER_EVENTS 4096
+
+typedef enum
+{
+	BIRDIE_ZONE_BEGIN = 0,
+	BIRDIE_ZONE_END
+} BIRDIE_ZONE_EVENT_KIND;
+
+// Sent as is, see Birdie_FlushZones
+typedef struct
+{
+	uint64_t timestamp;
+	uint32_t zone;
+	uint32_t kind;
+} BIRDIE_ZONE_EVENT;
+
+inline uint64_t Birdie_ReadTimestamp()
+{
+#ifdef BIRDIE_HAS_TSC
+	// Invariant on every CPU of the last decade, so it's safe to compare across cores
+	return __rdtsc();
+#else
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t)counter.QuadPart;
+#endif
+}
+
+// Remembers a reference point for Birdie_GetTimestampFrequency, called at the start of every session
+void Birdie_InitializeTimestamps();
+
+// Returns the timestamp ticks per second. The TSC rate is measured against the performance counter since the reference
+// point, so it gets more precise the longer the session runs and nothing has to be calibrated up front.
+uint64_t Birdie_GetTimestampFrequency();
+
+#endif